@@ -1,8 +1,41 @@
 #include "vtkCombinatoricGenerator.h"
 #include <vtkObjectFactory.h> //for vtkStandardNewMacro() macro
 
+#include <algorithm>
+
 const int MAIN_SET_INDEX_FOR_PERMUTATION_AND_COMBINATION = 0; // use only the zeroth set in permutation and combination operations
 
+namespace
+{
+  //------------------------------------------------------------------------------
+  // n choose k, computed incrementally so that the factorials do not overflow
+  unsigned int BinomialCoefficient( unsigned int n, unsigned int k )
+  {
+    if ( k > n )
+    {
+      return 0;
+    }
+    unsigned int binomialCoefficient = 1;
+    for ( unsigned int i = 1; i <= k; i++ )
+    {
+      binomialCoefficient = binomialCoefficient * ( n - k + i ) / i;
+    }
+    return binomialCoefficient;
+  }
+
+  //------------------------------------------------------------------------------
+  // number of ordered selections of k elements out of n: n! / ( n - k )!
+  unsigned int NumberOfOrderedSelections( unsigned int n, unsigned int k )
+  {
+    unsigned int numberOfSelections = 1;
+    for ( unsigned int factor = n - k + 1; factor <= n; factor++ )
+    {
+      numberOfSelections *= factor;
+    }
+    return numberOfSelections;
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro( vtkCombinatoricGenerator );
 
@@ -11,6 +44,9 @@ vtkCombinatoricGenerator::vtkCombinatoricGenerator()
 {
   this->Combinatoric = COMBINATORIC_COMBINATION;
   this->SubsetSize = 1;
+  this->TraversalStarted = false;
+  this->TraversalFinished = true;
+  this->TraversalStartIndex = 0;
   this->InputChangedTime.Modified();
   this->OutputChangedTime.Modified();
 }
@@ -240,19 +276,7 @@ std::vector< std::vector< int > > vtkCombinatoricGenerator::GetOutputSets()
   }
 
   // return a deep copy
-  std::vector< std::vector< int > > returnValue;
-  returnValue.reserve( this->OutputSets.size() );
-  for ( unsigned int setIndex = 0; setIndex < this->OutputSets.size(); setIndex++ )
-  {
-    std::vector< int > innerList;
-    innerList.reserve( this->OutputSets[ setIndex ].size() );
-    for ( unsigned int elementIndex = 0; elementIndex < this->OutputSets[ setIndex ].size(); elementIndex++ )
-    {
-      innerList.push_back( this->OutputSets[ setIndex ][ elementIndex ] );
-    }
-    returnValue.push_back( this->OutputSets[ setIndex ] );
-  }
-  return returnValue;
+  return this->OutputSets;
 }
 
 //------------------------------------------------------------------------------
@@ -321,6 +345,242 @@ int vtkCombinatoricGenerator::GetOutputElement( unsigned int setIndex, unsigned
   return this->OutputSets[ setIndex ][ elementIndex ];
 }
 
+//------------------------------------------------------------------------------
+// LAZY TRAVERSAL
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+void vtkCombinatoricGenerator::InitTraversal()
+{
+  this->InitTraversal( 0 );
+}
+
+//------------------------------------------------------------------------------
+void vtkCombinatoricGenerator::InitTraversal( unsigned int firstOutputSetIndex )
+{
+  this->TraversalStarted = false;
+  this->TraversalFinished = false;
+  this->TraversalStartIndex = firstOutputSetIndex;
+}
+
+//------------------------------------------------------------------------------
+bool vtkCombinatoricGenerator::GetNextOutputSet( std::vector< int >& outputSet )
+{
+  if ( this->TraversalFinished )
+  {
+    return false;
+  }
+
+  bool outputSetAvailable = false;
+  if ( !this->TraversalStarted )
+  {
+    this->TraversalStarted = true;
+    outputSetAvailable = this->InitTraversalPositions();
+  }
+  else
+  {
+    switch ( this->Combinatoric )
+    {
+      case COMBINATORIC_CARTESIAN_PRODUCT:
+        outputSetAvailable = this->AdvanceCartesianProductTraversal();
+        break;
+      case COMBINATORIC_COMBINATION:
+        outputSetAvailable = this->AdvanceCombinationTraversal();
+        break;
+      case COMBINATORIC_PERMUTATION:
+        outputSetAvailable = this->AdvancePermutationTraversal();
+        break;
+      default:
+        vtkErrorMacro( "Unknown combinatoric. Cannot traverse." );
+        break;
+    }
+  }
+
+  if ( !outputSetAvailable )
+  {
+    this->TraversalFinished = true;
+    return false;
+  }
+
+  // copy the elements at the current positions to the output
+  if ( this->Combinatoric == COMBINATORIC_CARTESIAN_PRODUCT )
+  {
+    unsigned int numberOfInputSets = this->InputSets.size();
+    outputSet.resize( numberOfInputSets );
+    for ( unsigned int setIndex = 0; setIndex < numberOfInputSets; setIndex++ )
+    {
+      outputSet[ setIndex ] = this->InputSets[ setIndex ][ this->TraversalPositions[ setIndex ] ];
+    }
+  }
+  else
+  {
+    const std::vector< int >& mainInputSet = this->InputSets[ MAIN_SET_INDEX_FOR_PERMUTATION_AND_COMBINATION ];
+    outputSet.resize( this->SubsetSize );
+    for ( unsigned int elementIndex = 0; elementIndex < this->SubsetSize; elementIndex++ )
+    {
+      outputSet[ elementIndex ] = mainInputSet[ this->TraversalPositions[ elementIndex ] ];
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkCombinatoricGenerator::InitTraversalPositions()
+{
+  if ( this->InputSets.size() == 0 )
+  {
+    vtkGenericWarningMacro( "There is no input. Output will be empty." );
+    return false;
+  }
+
+  if ( this->Combinatoric == COMBINATORIC_CARTESIAN_PRODUCT )
+  {
+    unsigned int numberOfInputSets = this->InputSets.size();
+    for ( unsigned int setIndex = 0; setIndex < numberOfInputSets; setIndex++ )
+    {
+      if ( this->InputSets[ setIndex ].empty() )
+      {
+        return false;
+      }
+    }
+    this->TraversalPositions.assign( numberOfInputSets, 0 );
+    return this->SeekTraversalPositions( this->TraversalStartIndex );
+  }
+
+  // combination and permutation: start with the first SubsetSize elements, in order
+  unsigned int setSize = this->GetInputSetSize( MAIN_SET_INDEX_FOR_PERMUTATION_AND_COMBINATION );
+  if ( setSize < this->SubsetSize )
+  {
+    return false;
+  }
+  this->TraversalPositions.resize( setSize );
+  for ( unsigned int position = 0; position < setSize; position++ )
+  {
+    this->TraversalPositions[ position ] = position;
+  }
+  return this->SeekTraversalPositions( this->TraversalStartIndex );
+}
+
+//------------------------------------------------------------------------------
+// Set the traversal positions directly to the output set with the given index (the positions
+// must already be initialized to the first output set). The index is decomposed in the same
+// order as the sets are traversed, so no preceding output sets need to be generated.
+bool vtkCombinatoricGenerator::SeekTraversalPositions( unsigned int outputSetIndex )
+{
+  if ( outputSetIndex == 0 )
+  {
+    return true;
+  }
+  if ( outputSetIndex >= this->ComputeNumberOfOutputSets() )
+  {
+    return false;
+  }
+
+  switch ( this->Combinatoric )
+  {
+    case COMBINATORIC_CARTESIAN_PRODUCT:
+    {
+      // mixed radix number, the last input set changes fastest
+      for ( int setIndex = (int)this->InputSets.size() - 1; setIndex >= 0; setIndex-- )
+      {
+        unsigned int setSize = this->InputSets[ setIndex ].size();
+        this->TraversalPositions[ setIndex ] = outputSetIndex % setSize;
+        outputSetIndex /= setSize;
+      }
+      return true;
+    }
+    case COMBINATORIC_COMBINATION:
+    {
+      // ( N - 1 - position ) choose ( K - 1 - elementIndex ) combinations have the element at position
+      // in elementIndex (with all preceding elements fixed), skip these blocks until the index is inside one
+      unsigned int setSize = this->GetInputSetSize( MAIN_SET_INDEX_FOR_PERMUTATION_AND_COMBINATION );
+      unsigned int position = 0;
+      for ( unsigned int elementIndex = 0; elementIndex < this->SubsetSize; elementIndex++ )
+      {
+        unsigned int numberOfCombinationsWithPosition = BinomialCoefficient( setSize - 1 - position, this->SubsetSize - 1 - elementIndex );
+        while ( outputSetIndex >= numberOfCombinationsWithPosition )
+        {
+          outputSetIndex -= numberOfCombinationsWithPosition;
+          position++;
+          numberOfCombinationsWithPosition = BinomialCoefficient( setSize - 1 - position, this->SubsetSize - 1 - elementIndex );
+        }
+        this->TraversalPositions[ elementIndex ] = position;
+        position++;
+      }
+      return true;
+    }
+    case COMBINATORIC_PERMUTATION:
+    {
+      // each choice for elementIndex (among the positions that are not used yet, in increasing order)
+      // is followed by ( N - 1 - elementIndex )! / ( N - K )! permutations.
+      // The unused positions are stored after the first K positions in increasing order, as in the traversal.
+      unsigned int setSize = this->GetInputSetSize( MAIN_SET_INDEX_FOR_PERMUTATION_AND_COMBINATION );
+      std::vector< unsigned int > unusedPositions( this->TraversalPositions );
+      for ( unsigned int elementIndex = 0; elementIndex < this->SubsetSize; elementIndex++ )
+      {
+        unsigned int numberOfPermutationsPerChoice = NumberOfOrderedSelections( setSize - 1 - elementIndex, this->SubsetSize - 1 - elementIndex );
+        unsigned int choice = outputSetIndex / numberOfPermutationsPerChoice;
+        outputSetIndex %= numberOfPermutationsPerChoice;
+        this->TraversalPositions[ elementIndex ] = unusedPositions[ choice ];
+        unusedPositions.erase( unusedPositions.begin() + choice );
+      }
+      std::copy( unusedPositions.begin(), unusedPositions.end(), this->TraversalPositions.begin() + this->SubsetSize );
+      return true;
+    }
+    default:
+      vtkErrorMacro( "Unknown combinatoric. Cannot traverse." );
+      return false;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Increment the positions like an odometer, the last input set changes fastest
+bool vtkCombinatoricGenerator::AdvanceCartesianProductTraversal()
+{
+  for ( int setIndex = this->InputSets.size() - 1; setIndex >= 0; setIndex-- )
+  {
+    this->TraversalPositions[ setIndex ]++;
+    if ( this->TraversalPositions[ setIndex ] < this->InputSets[ setIndex ].size() )
+    {
+      return true;
+    }
+    this->TraversalPositions[ setIndex ] = 0;
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Positions of a combination are strictly increasing. Find the last position that can
+// still be incremented, increment it, and place the following positions right after it.
+bool vtkCombinatoricGenerator::AdvanceCombinationTraversal()
+{
+  unsigned int setSize = this->GetInputSetSize( MAIN_SET_INDEX_FOR_PERMUTATION_AND_COMBINATION );
+  int subsetSize = this->SubsetSize;
+  for ( int elementIndex = subsetSize - 1; elementIndex >= 0; elementIndex-- )
+  {
+    if ( this->TraversalPositions[ elementIndex ] < setSize - subsetSize + elementIndex )
+    {
+      this->TraversalPositions[ elementIndex ]++;
+      for ( int followingElementIndex = elementIndex + 1; followingElementIndex < subsetSize; followingElementIndex++ )
+      {
+        this->TraversalPositions[ followingElementIndex ] = this->TraversalPositions[ followingElementIndex - 1 ] + 1;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// All positions are kept as a full permutation, the first SubsetSize positions form the output set.
+// Reversing the unused tail makes it the largest possible, so the next full permutation
+// is the first one with a different set of leading SubsetSize positions.
+bool vtkCombinatoricGenerator::AdvancePermutationTraversal()
+{
+  std::reverse( this->TraversalPositions.begin() + this->SubsetSize, this->TraversalPositions.end() );
+  return std::next_permutation( this->TraversalPositions.begin(), this->TraversalPositions.end() );
+}
+
 //------------------------------------------------------------------------------
 // LOGIC
 //------------------------------------------------------------------------------
@@ -500,7 +760,6 @@ unsigned int vtkCombinatoricGenerator::NumberOfPossibleCombinations()
   }
 
   int setSize = this->GetInputSetSize( MAIN_SET_INDEX_FOR_PERMUTATION_AND_COMBINATION );
-  int setSizeFactorial = Factorial( setSize );
 
   int subsetSize = this->SubsetSize;
   if ( setSize < subsetSize )
@@ -508,12 +767,14 @@ unsigned int vtkCombinatoricGenerator::NumberOfPossibleCombinations()
     vtkWarningMacro( "Set size " << setSize << " must be greater than subset size " << subsetSize << ". Will set subset size to " << setSize << " for this computation." );
     subsetSize = setSize;
   }
-  int subsetSizeFactorial = Factorial( subsetSize );    
-  
-  int setSizeMinusSubsetSize = setSize - subsetSize;
-  int setSizeMinusSubsetSizeFactorial = Factorial( setSizeMinusSubsetSize );
 
-  int numberOfCombinations = setSizeFactorial / ( subsetSizeFactorial * setSizeMinusSubsetSizeFactorial );
+  // The factorials overflow for sets larger than 12 elements, so the product is computed
+  // incrementally instead: after each step numberOfCombinations is ( N - K + i ) choose i, always an integer
+  unsigned int numberOfCombinations = 1;
+  for ( int i = 1; i <= subsetSize; i++ )
+  {
+    numberOfCombinations = numberOfCombinations * ( setSize - subsetSize + i ) / i;
+  }
   return numberOfCombinations;
 }
 
@@ -616,7 +877,6 @@ unsigned int vtkCombinatoricGenerator::NumberOfPossiblePermutations()
   }
 
   int setSize = this->GetInputSetSize( MAIN_SET_INDEX_FOR_PERMUTATION_AND_COMBINATION );
-  int setSizeFactorial = Factorial( setSize );
 
   int subsetSize = this->SubsetSize;
   if ( setSize < subsetSize )
@@ -625,10 +885,12 @@ unsigned int vtkCombinatoricGenerator::NumberOfPossiblePermutations()
     subsetSize = setSize;
   }
 
-  int setSizeMinusSubsetSize = setSize - subsetSize;
-  int setSizeMinusSubsetSizeFactorial = Factorial( setSizeMinusSubsetSize );
-
-  int numberOfPermutations = setSizeFactorial / setSizeMinusSubsetSizeFactorial;
+  // N * ( N - 1 ) * ... * ( N - K + 1 ), without computing the (overflowing) factorials
+  unsigned int numberOfPermutations = 1;
+  for ( int factor = setSize - subsetSize + 1; factor <= setSize; factor++ )
+  {
+    numberOfPermutations *= factor;
+  }
   return numberOfPermutations;
 }
 
@@ -108,6 +108,22 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkCombinatoricG
     unsigned int GetOutputSetSize();
     int GetOutputElement( unsigned int setIndex, unsigned int elementIndex );
 
+    // Lazy traversal of the output sets, as an alternative to Update() and the output accessors above.
+    // Output sets are generated one at a time on request, none of them are stored, so the
+    // memory use does not depend on the number of output sets. The next output set is written
+    // into the vector passed to GetNextOutputSet (in place, so no allocation is needed after the first call).
+    // Sets are generated in lexicographic order of the positions of the elements in the input set(s)
+    // (for combinations this is the same order as the output of Update()). Example:
+    //   generator->InitTraversal();
+    //   std::vector< int > outputSet;
+    //   while ( generator->GetNextOutputSet( outputSet ) ) { ... }
+    // InitTraversal must be called again after the inputs are changed.
+    // The traversal can start at any output set index, without generating the preceding output sets
+    // (useful for splitting the traversal into independent chunks, e.g., between threads).
+    void InitTraversal();
+    void InitTraversal( unsigned int firstOutputSetIndex );
+    bool GetNextOutputSet( std::vector< int >& outputSet ); // returns false if there are no more output sets
+
     // logic
     void Update();
 
@@ -128,6 +144,13 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkCombinatoricG
     std::vector< std::vector< int > > InputSets;
     std::vector< std::vector< int > > OutputSets;
 
+    // Current state of the lazy traversal: positions of the elements of the current output set in the input set(s).
+    // For permutations all positions are stored, the first SubsetSize of them are in the output set.
+    std::vector< unsigned int > TraversalPositions;
+    bool TraversalStarted;
+    bool TraversalFinished;
+    unsigned int TraversalStartIndex;
+
     // these determine when the output needs to be updated
     vtkTimeStamp InputChangedTime;
     vtkTimeStamp OutputChangedTime;
@@ -148,6 +171,13 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkCombinatoricG
     void UpdatePermutationsHelper( unsigned int currentSubsetSize, std::vector< int >& baseSet, unsigned int& permutationCount ); // recursive helper
     unsigned int NumberOfPossiblePermutations();
     
+    // logic methods for lazy traversal, they return false if there are no more output sets
+    bool InitTraversalPositions();
+    bool SeekTraversalPositions( unsigned int outputSetIndex );
+    bool AdvanceCartesianProductTraversal();
+    bool AdvanceCombinationTraversal();
+    bool AdvancePermutationTraversal();
+
     unsigned int Factorial( unsigned int x );
 
     vtkCombinatoricGenerator(const vtkCombinatoricGenerator&); // Not implemented.
@@ -4,6 +4,77 @@
 #include <vtkMath.h>
 #include <vtkObjectFactory.h> //for vtkStandardNewMacro() macro
 
+#include <array>
+#include <map>
+
+//----------------------------------------------------------------------------
+namespace
+{
+  //----------------------------------------------------------------------------
+  double GetDistanceFromArray( vtkDoubleArray* distanceArray, bool packed, int numberOfColumns, int list1Index, int list2Index )
+  {
+    if ( !packed )
+    {
+      return distanceArray->GetValue( ( vtkIdType )list1Index * numberOfColumns + list2Index );
+    }
+    if ( list1Index == list2Index )
+    {
+      return 0.0;
+    }
+    int lowerIndex = vtkMath::Min( list1Index, list2Index );
+    int higherIndex = vtkMath::Max( list1Index, list2Index );
+    return distanceArray->GetValue( ( vtkIdType )higherIndex * ( higherIndex - 1 ) / 2 + lowerIndex );
+  }
+
+  //----------------------------------------------------------------------------
+  // For each point find its index in the previous coordinates list, -1 if the point was not present.
+  void FindPreviousPointIndices( vtkPoints* points, const std::vector< double >& previousCoordinates, std::vector< int >& previousIndices )
+  {
+    int numberOfPoints = points->GetNumberOfPoints();
+    int numberOfPreviousPoints = previousCoordinates.size() / 3;
+    previousIndices.resize( numberOfPoints );
+    // only built if points are moved within the list
+    std::map< std::array< double, 3 >, int > previousIndexForCoordinates;
+    for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+    {
+      std::array< double, 3 > point;
+      points->GetPoint( pointIndex, point.data() );
+      if ( pointIndex < numberOfPreviousPoints
+        && point[ 0 ] == previousCoordinates[ 3 * pointIndex ]
+        && point[ 1 ] == previousCoordinates[ 3 * pointIndex + 1 ]
+        && point[ 2 ] == previousCoordinates[ 3 * pointIndex + 2 ] )
+      {
+        // most common case: point is not changed
+        previousIndices[ pointIndex ] = pointIndex;
+        continue;
+      }
+      if ( previousIndexForCoordinates.empty() )
+      {
+        for ( int previousPointIndex = 0; previousPointIndex < numberOfPreviousPoints; previousPointIndex++ )
+        {
+          std::array< double, 3 > previousPoint = { previousCoordinates[ 3 * previousPointIndex ],
+            previousCoordinates[ 3 * previousPointIndex + 1 ], previousCoordinates[ 3 * previousPointIndex + 2 ] };
+          previousIndexForCoordinates.insert( std::make_pair( previousPoint, previousPointIndex ) );
+        }
+      }
+      // points at identical positions have identical distances, so any of them can be used
+      std::map< std::array< double, 3 >, int >::iterator previousIndexIt = previousIndexForCoordinates.find( point );
+      previousIndices[ pointIndex ] = ( previousIndexIt != previousIndexForCoordinates.end() ) ? previousIndexIt->second : -1;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void GetPointCoordinates( vtkPoints* points, std::vector< double >& coordinates )
+  {
+    int numberOfPoints = points->GetNumberOfPoints();
+    coordinates.resize( 3 * numberOfPoints );
+    for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+    {
+      points->GetPoint( pointIndex, &coordinates[ 3 * pointIndex ] );
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro( vtkPointDistanceMatrix );
 
@@ -13,8 +84,12 @@ vtkPointDistanceMatrix::vtkPointDistanceMatrix()
   this->PointList1 = NULL;
   this->PointList2 = NULL;
   this->DistanceMatrix = vtkSmartPointer< vtkDoubleArray >::New();
+  this->Packed = false;
+  this->NumberOfRows = 0;
+  this->NumberOfColumns = 0;
   this->MaximumDistance = VTK_DOUBLE_MIN;
   this->MinimumDistance = VTK_DOUBLE_MAX;
+  this->NumberOfComputedDistances = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -42,29 +117,31 @@ double vtkPointDistanceMatrix::GetDistance( int pointList1Index, int pointList2I
     Update();
   }
 
-  if ( this->DistanceMatrix->GetNumberOfTuples() == 0 )
+  if ( this->NumberOfRows == 0 || this->NumberOfColumns == 0 )
   {
     vtkWarningMacro("Matrix has no contents. Returning 0.");
     return 0.0;
   }
 
-  int tupleIndex = pointList1Index;
-  int numberOfTuples = this->DistanceMatrix->GetNumberOfTuples();
-  if ( tupleIndex < 0 || tupleIndex >= numberOfTuples )
+  if ( pointList1Index < 0 || pointList1Index >= this->NumberOfRows )
   {
-    vtkWarningMacro("Point index of first list " << tupleIndex << " is outside the range 0 to " << (numberOfTuples - 1) << ". Returning 0.");
+    vtkWarningMacro("Point index of first list " << pointList1Index << " is outside the range 0 to " << (this->NumberOfRows - 1) << ". Returning 0.");
     return 0.0;
   }
 
-  int componentIndex = pointList2Index;
-  int numberOfComponents = this->DistanceMatrix->GetNumberOfComponents();
-  if ( componentIndex < 0 || componentIndex >= numberOfComponents )
+  if ( pointList2Index < 0 || pointList2Index >= this->NumberOfColumns )
   {
-    vtkWarningMacro("Point index of secondList list " << componentIndex << " is outside the range 0 to " << (numberOfComponents - 1) << ". Returning 0.");
+    vtkWarningMacro("Point index of secondList list " << pointList2Index << " is outside the range 0 to " << (this->NumberOfColumns - 1) << ". Returning 0.");
     return 0.0;
   }
 
-  return this->DistanceMatrix->GetComponent( tupleIndex, componentIndex );
+  return this->GetStoredDistance( pointList1Index, pointList2Index );
+}
+
+//------------------------------------------------------------------------------
+double vtkPointDistanceMatrix::GetStoredDistance( int pointList1Index, int pointList2Index )
+{
+  return GetDistanceFromArray( this->DistanceMatrix, this->Packed, this->NumberOfColumns, pointList1Index, pointList2Index );
 }
 
 //------------------------------------------------------------------------------
@@ -81,43 +158,62 @@ void vtkPointDistanceMatrix::GetDistances( vtkDoubleArray* outputArray )
     return;
   }
 
-  if ( this->DistanceMatrix->GetNumberOfTuples() == 0 )
+  if ( this->NumberOfRows == 0 || this->NumberOfColumns == 0 )
   {
     vtkWarningMacro("Matrix has no contents.");
     return;
   }
 
+  // all elements of the matrix, including both halves of a packed matrix
   outputArray->Reset();
-  int numberOfTuples = this->DistanceMatrix->GetNumberOfTuples(); // aka point list 1 index
-  int numberOfComponents = this->DistanceMatrix->GetNumberOfComponents(); // aka point list 2 index
-  for ( int tupleIndex = 0; tupleIndex < numberOfTuples; tupleIndex++ )
+  outputArray->Allocate( ( vtkIdType )this->NumberOfRows * this->NumberOfColumns );
+  for ( int pointList1Index = 0; pointList1Index < this->NumberOfRows; pointList1Index++ )
   {
-    for ( int componentIndex = 0; componentIndex < numberOfComponents; componentIndex++ )
+    for ( int pointList2Index = 0; pointList2Index < this->NumberOfColumns; pointList2Index++ )
     {
-      double currentDistance = this->DistanceMatrix->GetComponent( tupleIndex, componentIndex );
+      double currentDistance = this->GetStoredDistance( pointList1Index, pointList2Index );
       outputArray->InsertNextTuple1( currentDistance );
     }
   }
 }
 
+//------------------------------------------------------------------------------
+bool vtkPointDistanceMatrix::IsSelfDistanceMatrix()
+{
+  return ( this->PointList1 != NULL && this->PointList1 == this->PointList2 );
+}
+
 //------------------------------------------------------------------------------
 void vtkPointDistanceMatrix::SetPointList1( vtkPoints* points )
 {
+  if ( this->PointList1 == points )
+  {
+    return;
+  }
+  // distances are not reset, they may be reused if the new list contains the same points
   this->PointList1 = points;
-  this->ResetDistances();
+  this->Modified();
 }
 
 //------------------------------------------------------------------------------
 void vtkPointDistanceMatrix::SetPointList2( vtkPoints* points )
 {
-  this->PointList2 = points ;
-  this->ResetDistances();
+  if ( this->PointList2 == points )
+  {
+    return;
+  }
+  this->PointList2 = points;
+  this->Modified();
 }
 
 //------------------------------------------------------------------------------
 void vtkPointDistanceMatrix::ResetDistances()
 {
   this->DistanceMatrix->Reset();
+  this->NumberOfRows = 0;
+  this->NumberOfColumns = 0;
+  this->PointList1Coordinates.clear();
+  this->PointList2Coordinates.clear();
   this->MaximumDistance = VTK_DOUBLE_MIN;
   this->MinimumDistance = VTK_DOUBLE_MAX;
 }
@@ -131,22 +227,107 @@ void vtkPointDistanceMatrix::Update()
     return;
   }
 
-  int pointList2Length = this->PointList2->GetNumberOfPoints();
-  this->DistanceMatrix->SetNumberOfComponents( pointList2Length );
+  if ( !this->UpdateNeeded() )
+  {
+    return;
+  }
+
+  bool packed = this->IsSelfDistanceMatrix();
+  if ( packed != this->Packed )
+  {
+    // storage layout is changed, previous distances cannot be reused
+    this->ResetDistances();
+    this->Packed = packed;
+  }
+
+  // find which points were already in the lists at the previous update
+  std::vector< int > previousPointList1Indices;
+  FindPreviousPointIndices( this->PointList1, this->PointList1Coordinates, previousPointList1Indices );
+  std::vector< int > previousPointList2Indices;
+  if ( packed )
+  {
+    previousPointList2Indices = previousPointList1Indices;
+  }
+  else
+  {
+    FindPreviousPointIndices( this->PointList2, this->PointList2Coordinates, previousPointList2Indices );
+  }
+
   int pointList1Length = this->PointList1->GetNumberOfPoints();
-  this->DistanceMatrix->SetNumberOfTuples( pointList1Length );
+  int pointList2Length = this->PointList2->GetNumberOfPoints();
+
+  // If points are only appended to the end of list 1 (and list 2 is unchanged, or the same list),
+  // then the stored values remain valid at the same positions and new values are appended.
+  bool appendOnly = ( this->NumberOfRows > 0 && pointList1Length >= this->NumberOfRows );
+  for ( int pointList1Index = 0; appendOnly && pointList1Index < this->NumberOfRows; pointList1Index++ )
+  {
+    appendOnly = ( previousPointList1Indices[ pointList1Index ] == pointList1Index );
+  }
+  if ( !packed )
+  {
+    appendOnly = appendOnly && ( pointList2Length == this->NumberOfColumns );
+    for ( int pointList2Index = 0; appendOnly && pointList2Index < pointList2Length; pointList2Index++ )
+    {
+      appendOnly = ( previousPointList2Indices[ pointList2Index ] == pointList2Index );
+    }
+  }
 
-  for ( int pointList1Index = 0; pointList1Index < pointList1Length; pointList1Index++ )
+  vtkSmartPointer< vtkDoubleArray > previousDistanceMatrix = this->DistanceMatrix;
+  int previousNumberOfColumns = this->NumberOfColumns;
+  vtkIdType numberOfValues = packed ? ( vtkIdType )pointList1Length * ( pointList1Length - 1 ) / 2 : ( vtkIdType )pointList1Length * pointList2Length;
+  int firstOuterIndex = 0;
+  if ( appendOnly )
   {
-    for ( int pointList2Index = 0; pointList2Index < pointList2Length; pointList2Index++ )
+    // stored values, maximum and minimum distances are kept
+    firstOuterIndex = this->NumberOfRows;
+    this->DistanceMatrix->SetNumberOfValues( numberOfValues );
+  }
+  else
+  {
+    this->DistanceMatrix = vtkSmartPointer< vtkDoubleArray >::New();
+    this->DistanceMatrix->SetNumberOfValues( numberOfValues );
+    if ( packed )
     {
-      double pointInList1[ 3 ];
-      this->PointList1->GetPoint( pointList1Index, pointInList1 );
-      double pointInList2[ 3 ];
-      this->PointList2->GetPoint( pointList2Index, pointInList2 );
-      double distanceSquared = vtkMath::Distance2BetweenPoints( pointInList1, pointInList2 );
-      double distance = sqrt( distanceSquared );
-      this->DistanceMatrix->SetComponent( pointList1Index, pointList2Index, distance );
+      // the diagonal (distance of each point to itself) is part of the matrix
+      this->MaximumDistance = 0.0;
+      this->MinimumDistance = 0.0;
+    }
+    else
+    {
+      this->MaximumDistance = VTK_DOUBLE_MIN;
+      this->MinimumDistance = VTK_DOUBLE_MAX;
+    }
+  }
+  this->NumberOfComputedDistances = 0;
+
+  vtkIdType valueIndex = packed ? ( vtkIdType )firstOuterIndex * ( firstOuterIndex - 1 ) / 2 : ( vtkIdType )firstOuterIndex * pointList2Length;
+  for ( int outerIndex = firstOuterIndex; outerIndex < pointList1Length; outerIndex++ )
+  {
+    // packed storage is filled column by column (upper triangle), full storage row by row
+    int innerLength = packed ? outerIndex : pointList2Length;
+    for ( int innerIndex = 0; innerIndex < innerLength; innerIndex++ )
+    {
+      int pointList1Index = packed ? innerIndex : outerIndex;
+      int pointList2Index = packed ? outerIndex : innerIndex;
+      int previousPointList1Index = previousPointList1Indices[ pointList1Index ];
+      int previousPointList2Index = previousPointList2Indices[ pointList2Index ];
+      double distance = 0.0;
+      if ( previousPointList1Index >= 0 && previousPointList2Index >= 0 )
+      {
+        distance = GetDistanceFromArray( previousDistanceMatrix, packed, previousNumberOfColumns, previousPointList1Index, previousPointList2Index );
+      }
+      else
+      {
+        double pointInList1[ 3 ];
+        this->PointList1->GetPoint( pointList1Index, pointInList1 );
+        double pointInList2[ 3 ];
+        this->PointList2->GetPoint( pointList2Index, pointInList2 );
+        double distanceSquared = vtkMath::Distance2BetweenPoints( pointInList1, pointInList2 );
+        distance = sqrt( distanceSquared );
+        this->NumberOfComputedDistances++;
+      }
+      this->DistanceMatrix->SetValue( valueIndex, distance );
+      valueIndex++;
       if ( distance > this->MaximumDistance )
       {
         this->MaximumDistance = distance;
@@ -158,6 +339,11 @@ void vtkPointDistanceMatrix::Update()
     }
   }
 
+  this->NumberOfRows = pointList1Length;
+  this->NumberOfColumns = pointList2Length;
+  GetPointCoordinates( this->PointList1, this->PointList1Coordinates );
+  GetPointCoordinates( this->PointList2, this->PointList2Coordinates );
+
   this->Modified();
   this->MatrixUpdateTime.Modified();
 }
@@ -229,4 +415,6 @@ void vtkPointDistanceMatrix::PrintSelf(ostream &os, vtkIndent indent)
 
   os << indent << "Point list 1 length: " << ( ( this->PointList1 != NULL ) ? this->PointList1->GetNumberOfPoints() : 0 ) << endl;
   os << indent << "Point list 2 length: " << ( ( this->PointList2 != NULL ) ? this->PointList2->GetNumberOfPoints() : 0 ) << endl;
+  os << indent << "Packed: " << ( this->Packed ? "true" : "false" ) << endl;
+  os << indent << "Number of computed distances: " << this->NumberOfComputedDistances << endl;
 }
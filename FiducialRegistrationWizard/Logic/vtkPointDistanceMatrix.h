@@ -6,6 +6,8 @@
 #include <vtkPoints.h>
 #include <vtkTimeStamp.h>
 
+#include <vector>
+
 // export
 #include "vtkSlicerFiducialRegistrationWizardModuleLogicExport.h"
 
@@ -15,7 +17,12 @@
 // memorizing how distances are accessed etc... One can use this class to
 // encapsulate that functionality.
 // The contents of the matrix are automatically re-generated when either input
-// point list is changed.
+// point list is changed. Update() returns immediately if neither the inputs nor
+// this object are modified since the last update. Distances of points that were
+// already in the lists at the previous update are reused, only the rows and
+// columns of added or moved points are computed.
+// If both point lists are the same object, then the matrix is symmetric and
+// only the upper triangle is stored (distance of a point to itself is 0).
 class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkPointDistanceMatrix : public vtkObject //vtkAlgorithm?
 {
   public:
@@ -28,8 +35,14 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkPointDistance
     vtkPoints* GetPointList2();
     double GetDistance( int list1Index, int list2Index );
     void GetDistances( vtkDoubleArray* outputArray );
-    vtkGetMacro( MaximumDistance, int );
-    vtkGetMacro( MinimumDistance, int );
+    vtkGetMacro( MaximumDistance, double );
+    vtkGetMacro( MinimumDistance, double );
+
+    // True if distances are computed within a single point list and stored in packed (upper triangular) form
+    bool IsSelfDistanceMatrix();
+
+    // Number of distances that had to be computed (not reused) at the last update
+    vtkGetMacro( NumberOfComputedDistances, vtkIdType );
 
     void SetPointList1( vtkPoints* points );
     void SetPointList2( vtkPoints* points );
@@ -45,15 +58,28 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkPointDistance
     vtkPoints* PointList2;
 
     // outputs
+    // Single component array. Full matrix is stored row by row (row = point list 1 index).
+    // Packed matrix stores distance( i, j ) for i < j at index j * ( j - 1 ) / 2 + i,
+    // so that adding a point to the end of the list only appends values to the existing array
+    // (same for adding points to the end of list 1 of a full matrix).
     vtkSmartPointer< vtkDoubleArray > DistanceMatrix;
+    bool Packed;
+    int NumberOfRows;
+    int NumberOfColumns;
     vtkTimeStamp MatrixUpdateTime;
     double MaximumDistance;
     double MinimumDistance;
+    vtkIdType NumberOfComputedDistances;
+
+    // coordinates of the points that the current matrix contents were computed from
+    std::vector< double > PointList1Coordinates;
+    std::vector< double > PointList2Coordinates;
 
     bool UpdateNeeded();
     bool InputsContainErrors( bool verbose=true );
 
     void ResetDistances();
+    double GetStoredDistance( int list1Index, int list2Index );
 
 		vtkPointDistanceMatrix(const vtkPointDistanceMatrix&); // Not implemented.
 		void operator=(const vtkPointDistanceMatrix&); // Not implemented.
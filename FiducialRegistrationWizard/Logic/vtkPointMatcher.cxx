@@ -3,18 +3,32 @@
 #include "vtkCombinatoricGenerator.h"
 #include <vtkDoubleArray.h>
 #include <vtkGeneralTransform.h>
+#include <vtkIdList.h>
 #include <vtkIterativeClosestPointTransform.h>
 #include <vtkLandmarkTransform.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMinimalStandardRandomSequence.h>
 #include <vtkPointLocator.h>
 #include <vtkPolyData.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
 #include <vtkMath.h>
 
+#include <algorithm>
+#include <vector>
+
 #define RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR VTK_DOUBLE_MAX
 #define MINIMUM_NUMBER_OF_POINTS_NEEDED_TO_MATCH 3
 #define MAXIMUM_NUMBER_OF_POINTS_NEEDED_FOR_DETERMINISTIC_MATCH 5
+#define MAXIMUM_NUMBER_OF_POINTS_FOR_CLOSED_FORM_REGISTRATION_ERROR 12
+#define MAXIMUM_NUMBER_OF_POINTS_FOR_GLOBAL_MATCH 30
+#define NUMBER_OF_NEIGHBORS_IN_DESCRIPTOR 8
+#define NUMBER_OF_DESCRIPTOR_CANDIDATES_PER_POINT 4
+#define MINIMUM_NUMBER_OF_RANSAC_ITERATIONS 100
+#define MAXIMUM_NUMBER_OF_RANSAC_ITERATIONS 5000
+#define RANSAC_CONFIDENCE 0.999
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro( vtkPointMatcher );
@@ -24,6 +38,8 @@ vtkPointMatcher::vtkPointMatcher()
 {
   this->InputSourcePoints = NULL;
   this->InputTargetPoints = NULL;
+  this->InputSourceDistanceMatrix = vtkSmartPointer< vtkPointDistanceMatrix >::New();
+  this->InputTargetDistanceMatrix = vtkSmartPointer< vtkPointDistanceMatrix >::New();
   this->MaximumDifferenceInNumberOfPoints = 2;
   this->ComputedDistanceError = RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR;
   this->TolerableDistanceErrorMultiple = 0.1;
@@ -31,6 +47,7 @@ vtkPointMatcher::vtkPointMatcher()
   this->AmbiguityDistanceErrorMultiple = 0.05;
   this->AmbiguityDistanceError = 0.0;
   this->MatchingAmbiguous = false;
+  this->NumberOfEvaluatedPermutations = 0;
   // outputs are never null
   this->OutputSourcePoints = vtkSmartPointer< vtkPoints >::New();
   this->OutputTargetPoints = vtkSmartPointer< vtkPoints >::New();
@@ -67,6 +84,7 @@ void vtkPointMatcher::PrintSelf( std::ostream &os, vtkIndent indent )
   os << indent << "AmbiguityDistanceErrorMultiple: " << this->AmbiguityDistanceErrorMultiple << std::endl;
   os << indent << "AmbiguityDistanceError: " << this->AmbiguityDistanceError << std::endl;
   os << indent << "MatchingAmbiguous: " << this->MatchingAmbiguous << std::endl;
+  os << indent << "NumberOfEvaluatedPermutations: " << this->NumberOfEvaluatedPermutations << std::endl;
 }
 
 //------------------------------------------------------------------------------
@@ -77,12 +95,16 @@ void vtkPointMatcher::PrintSelf( std::ostream &os, vtkIndent indent )
 void vtkPointMatcher::SetInputSourcePoints( vtkPoints* points )
 {
   vtkSetObjectBodyMacro( InputSourcePoints, vtkPoints, points );
+  this->InputSourceDistanceMatrix->SetPointList1( points );
+  this->InputSourceDistanceMatrix->SetPointList2( points );
 }
 
 //------------------------------------------------------------------------------
 void vtkPointMatcher::SetInputTargetPoints( vtkPoints* points )
 {
   vtkSetObjectBodyMacro( InputTargetPoints, vtkPoints, points );
+  this->InputTargetDistanceMatrix->SetPointList1( points );
+  this->InputTargetDistanceMatrix->SetPointList2( points );
 }
 
 //------------------------------------------------------------------------------
@@ -184,11 +206,12 @@ void vtkPointMatcher::Update()
     return;
   }
   
-  double maximumDistanceInTargetPoints = vtkPointMatcher::ComputeMaximumDistanceInPointSet( this->InputTargetPoints );
+  double maximumDistanceInTargetPoints = vtkPointMatcher::ComputeMaximumDistanceInPointSet( this->InputTargetDistanceMatrix );
   this->ComputedDistanceError = RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR;
   this->TolerableDistanceError = maximumDistanceInTargetPoints * this->TolerableDistanceErrorMultiple;
   this->AmbiguityDistanceError = maximumDistanceInTargetPoints * this->AmbiguityDistanceErrorMultiple;
   this->MatchingAmbiguous = false;
+  this->NumberOfEvaluatedPermutations = 0;
   this->OutputSourcePoints->Reset();
   this->OutputTargetPoints->Reset();
 
@@ -233,6 +256,7 @@ bool vtkPointMatcher::MatchPointsExhaustively()
                                                           this->InputSourcePoints, this->InputTargetPoints,
                                                           this->AmbiguityDistanceError, this->MatchingAmbiguous,
                                                           this->ComputedDistanceError, this->TolerableDistanceError,
+                                                          this->NumberOfEvaluatedPermutations,
                                                           this->OutputSourcePoints, this->OutputTargetPoints );
   return true; // search is exhaustive, so it *will* find the best match
 }
@@ -240,6 +264,15 @@ bool vtkPointMatcher::MatchPointsExhaustively()
 //------------------------------------------------------------------------------
 bool vtkPointMatcher::MatchPointsGenerally()
 {
+  int numberOfSourcePoints = this->InputSourcePoints->GetNumberOfPoints();
+  int numberOfTargetPoints = this->InputTargetPoints->GetNumberOfPoints();
+  if ( vtkMath::Max( numberOfSourcePoints, numberOfTargetPoints ) > MAXIMUM_NUMBER_OF_POINTS_FOR_GLOBAL_MATCH )
+  {
+    // the methods below compare every point with every other point (or try many ICP starting poses),
+    // which is too slow for large point sets. These are matched using local descriptors instead.
+    return this->MatchPointsGenerallyUsingDescriptors();
+  }
+
   bool matchingSuccessful = false;
 
   // try any algorithms here in turn until one is successful
@@ -274,12 +307,12 @@ bool vtkPointMatcher::MatchPointsGenerallyUsingUniqueDistances()
   int numberOfPointsToUseForInitialRegistration = vtkMath::Min( smallerPointListSize, MAXIMUM_NUMBER_OF_POINTS_NEEDED_FOR_DETERMINISTIC_MATCH );
 
   vtkSmartPointer< vtkPoints > unmatchedSourcePointsSortedByUniqueness = vtkSmartPointer< vtkPoints >::New();
-  vtkPointMatcher::ReorderPointsAccordingToUniqueGeometry( this->InputSourcePoints, unmatchedSourcePointsSortedByUniqueness );
+  vtkPointMatcher::ReorderPointsAccordingToUniqueGeometry( this->InputSourceDistanceMatrix, unmatchedSourcePointsSortedByUniqueness );
   vtkSmartPointer< vtkPoints > unmatchedReducedSourcePoints = vtkSmartPointer< vtkPoints >::New();
   vtkPointMatcher::CopyFirstNPoints( unmatchedSourcePointsSortedByUniqueness, unmatchedReducedSourcePoints, numberOfPointsToUseForInitialRegistration );
 
   vtkSmartPointer< vtkPoints > unmatchedTargetPointsSortedByUniqueness = vtkSmartPointer< vtkPoints >::New();
-  vtkPointMatcher::ReorderPointsAccordingToUniqueGeometry( this->InputTargetPoints, unmatchedTargetPointsSortedByUniqueness );
+  vtkPointMatcher::ReorderPointsAccordingToUniqueGeometry( this->InputTargetDistanceMatrix, unmatchedTargetPointsSortedByUniqueness );
   vtkSmartPointer< vtkPoints > unmatchedReducedTargetPoints = vtkSmartPointer< vtkPoints >::New();
   vtkPointMatcher::CopyFirstNPoints( unmatchedTargetPointsSortedByUniqueness, unmatchedReducedTargetPoints, numberOfPointsToUseForInitialRegistration );
 
@@ -292,7 +325,7 @@ bool vtkPointMatcher::MatchPointsGenerallyUsingMaximumDistancesAndCentroid()
   bool featureExtractionSuccessful = false;
 
   vtkSmartPointer< vtkPoints > sourceFeatures = vtkSmartPointer< vtkPoints >::New();
-  featureExtractionSuccessful = vtkPointMatcher::ExtractMaximumDistanceAndCentroidFeatures( this->InputSourcePoints, sourceFeatures );
+  featureExtractionSuccessful = vtkPointMatcher::ExtractMaximumDistanceAndCentroidFeatures( this->InputSourceDistanceMatrix, sourceFeatures );
   if ( featureExtractionSuccessful == false )
   {
     vtkWarningMacro( "Unable to extract maximum distances and centroids from source list" );
@@ -300,7 +333,7 @@ bool vtkPointMatcher::MatchPointsGenerallyUsingMaximumDistancesAndCentroid()
   }
   
   vtkSmartPointer< vtkPoints > targetFeatures = vtkSmartPointer< vtkPoints >::New();
-  featureExtractionSuccessful = vtkPointMatcher::ExtractMaximumDistanceAndCentroidFeatures( this->InputTargetPoints, targetFeatures );
+  featureExtractionSuccessful = vtkPointMatcher::ExtractMaximumDistanceAndCentroidFeatures( this->InputTargetDistanceMatrix, targetFeatures );
   if ( featureExtractionSuccessful == false )
   {
     vtkWarningMacro( "Unable to extract maximum distances and centroids from target list" );
@@ -347,6 +380,7 @@ bool vtkPointMatcher::MatchPointsGenerallyUsingSubsample( vtkPoints* unmatchedRe
                                                           unmatchedReducedSourcePoints, unmatchedReducedTargetPoints,
                                                           this->AmbiguityDistanceError, matchingAmbiguous,
                                                           bestDistanceError, tolerableDistanceErrorForSubsets,
+                                                          this->NumberOfEvaluatedPermutations,
                                                           initiallyMatchedReducedSourcePoints, initiallyMatchedReducedTargetPoints );
 
   // Compute initial registration based on this correspondence
@@ -540,6 +574,326 @@ bool vtkPointMatcher::MatchPointsGenerallyUsingICP()
   return true;
 }
 
+//------------------------------------------------------------------------------
+namespace
+{
+  // Transform the source points and assign the closest target point to each of them.
+  // Source points that are farther than the inlier distance from their closest target point are outliers (index -1).
+  // Returns the number of inliers, or -1 if there are more outliers than the maximum (the assignment is then incomplete).
+  int AssignClosestTargetPoints( vtkMatrix4x4* sourceToTargetMatrix, vtkPoints* sourcePoints, vtkPoints* targetPoints,
+                                 vtkPointLocator* targetPointLocator, double inlierDistance2, int maximumNumberOfOutliers,
+                                 std::vector< int >& assignedTargetIndices, double& sumOfSquaredInlierDistances )
+  {
+    int numberOfSourcePoints = sourcePoints->GetNumberOfPoints();
+    assignedTargetIndices.assign( numberOfSourcePoints, -1 );
+    sumOfSquaredInlierDistances = 0.0;
+    int numberOfOutliers = 0;
+    for ( int sourcePointIndex = 0; sourcePointIndex < numberOfSourcePoints; sourcePointIndex++ )
+    {
+      double sourcePoint[ 4 ] = { 0.0, 0.0, 0.0, 1.0 };
+      sourcePoints->GetPoint( sourcePointIndex, sourcePoint );
+      double transformedSourcePoint[ 4 ];
+      sourceToTargetMatrix->MultiplyPoint( sourcePoint, transformedSourcePoint );
+      vtkIdType targetPointIndex = targetPointLocator->FindClosestPoint( transformedSourcePoint );
+      double targetPoint[ 3 ];
+      targetPoints->GetPoint( targetPointIndex, targetPoint );
+      double distance2 = vtkMath::Distance2BetweenPoints( transformedSourcePoint, targetPoint );
+      if ( distance2 > inlierDistance2 )
+      {
+        numberOfOutliers++;
+        if ( numberOfOutliers > maximumNumberOfOutliers )
+        {
+          return -1;
+        }
+        continue;
+      }
+      assignedTargetIndices[ sourcePointIndex ] = targetPointIndex;
+      sumOfSquaredInlierDistances += distance2;
+    }
+    return numberOfSourcePoints - numberOfOutliers;
+  }
+
+  // Two assignments conflict if a source point is assigned to different target points
+  // (an outlier in one of them is not a conflict)
+  bool AssignmentsConflict( const std::vector< int >& assignedTargetIndices1, const std::vector< int >& assignedTargetIndices2 )
+  {
+    for ( size_t sourcePointIndex = 0; sourcePointIndex < assignedTargetIndices1.size(); sourcePointIndex++ )
+    {
+      if ( assignedTargetIndices1[ sourcePointIndex ] >= 0 && assignedTargetIndices2[ sourcePointIndex ] >= 0
+        && assignedTargetIndices1[ sourcePointIndex ] != assignedTargetIndices2[ sourcePointIndex ] )
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Random integer in the range [ 0, numberOfValues )
+  int GetNextRandomIndex( vtkMinimalStandardRandomSequence* randomSequence, int numberOfValues )
+  {
+    randomSequence->Next();
+    int index = static_cast< int >( randomSequence->GetValue() * numberOfValues );
+    return vtkMath::Min( index, numberOfValues - 1 );
+  }
+}
+
+//------------------------------------------------------------------------------
+// Matching of large point sets, in three steps:
+// 1. Each point is described by the sorted distances to its nearest neighbors, which do not change
+//    under rigid transformation (and only some of them change if a few points are missing or extra).
+//    The target points with the most similar descriptors are the candidate matches of each source point.
+// 2. RANSAC: a rigid transform is computed from three randomly chosen candidate matches,
+//    and all source points are assigned to their closest target point (found using a point locator).
+//    Transforms that match enough points are refined using all of their inliers.
+// 3. The final matching is computed from the best transform, the same way as in the other general methods.
+// The matching is ambiguous if there is another transform that matches the points differently,
+// with a distance error within the ambiguity distance of the best.
+bool vtkPointMatcher::MatchPointsGenerallyUsingDescriptors()
+{
+  int numberOfSourcePoints = this->InputSourcePoints->GetNumberOfPoints();
+  int numberOfTargetPoints = this->InputTargetPoints->GetNumberOfPoints();
+  int numberOfNeighbors = vtkMath::Min( NUMBER_OF_NEIGHBORS_IN_DESCRIPTOR, vtkMath::Min( numberOfSourcePoints, numberOfTargetPoints ) - 1 );
+  if ( numberOfNeighbors < 1 )
+  {
+    vtkWarningMacro( "Not enough points to compute descriptors." );
+    return false;
+  }
+
+  vtkSmartPointer< vtkDoubleArray > sourceDescriptors = vtkSmartPointer< vtkDoubleArray >::New();
+  vtkPointMatcher::ComputeNeighborDistanceDescriptors( this->InputSourcePoints, numberOfNeighbors, sourceDescriptors );
+  vtkSmartPointer< vtkDoubleArray > targetDescriptors = vtkSmartPointer< vtkDoubleArray >::New();
+  vtkPointMatcher::ComputeNeighborDistanceDescriptors( this->InputTargetPoints, numberOfNeighbors, targetDescriptors );
+
+  int numberOfCandidatesPerPoint = vtkMath::Min( NUMBER_OF_DESCRIPTOR_CANDIDATES_PER_POINT, numberOfTargetPoints );
+  std::vector< int > candidateTargetIndices;
+  vtkPointMatcher::FindCandidateMatchesUsingDescriptors( sourceDescriptors, targetDescriptors, numberOfCandidatesPerPoint, candidateTargetIndices );
+
+  // Inlier distance is limited to half of the typical distance between neighboring target points,
+  // so that the closest target point of a registered source point is not a neighbor of the correct one.
+  std::vector< double > nearestNeighborDistances( numberOfTargetPoints );
+  for ( int targetPointIndex = 0; targetPointIndex < numberOfTargetPoints; targetPointIndex++ )
+  {
+    nearestNeighborDistances[ targetPointIndex ] = targetDescriptors->GetComponent( targetPointIndex, 0 );
+  }
+  std::nth_element( nearestNeighborDistances.begin(), nearestNeighborDistances.begin() + numberOfTargetPoints / 2, nearestNeighborDistances.end() );
+  double medianNearestNeighborDistance = nearestNeighborDistances[ numberOfTargetPoints / 2 ];
+  double inlierDistance = vtkMath::Min( this->TolerableDistanceError, 0.5 * medianNearestNeighborDistance );
+  double inlierDistance2 = inlierDistance * inlierDistance;
+
+  int maximumNumberOfOutliers = vtkMath::Min( ( int )this->MaximumDifferenceInNumberOfPoints, numberOfSourcePoints - MINIMUM_NUMBER_OF_POINTS_NEEDED_TO_MATCH );
+
+  vtkSmartPointer< vtkPolyData > targetPointsPolyData = vtkSmartPointer< vtkPolyData >::New();
+  vtkPointMatcher::GeneratePolyDataFromPoints( this->InputTargetPoints, targetPointsPolyData );
+  vtkSmartPointer< vtkPointLocator > targetPointLocator = vtkSmartPointer< vtkPointLocator >::New();
+  targetPointLocator->SetDataSet( targetPointsPolyData );
+  targetPointLocator->BuildLocator();
+
+  vtkSmartPointer< vtkMinimalStandardRandomSequence > randomSequence = vtkSmartPointer< vtkMinimalStandardRandomSequence >::New();
+  randomSequence->SetSeed( 1 ); // fixed seed, so that the result is reproducible
+
+  // re-used variables
+  vtkSmartPointer< vtkLandmarkTransform > landmarkTransform = vtkSmartPointer< vtkLandmarkTransform >::New();
+  landmarkTransform->SetModeToRigidBody();
+  vtkSmartPointer< vtkPoints > sampleSourcePoints = vtkSmartPointer< vtkPoints >::New();
+  vtkSmartPointer< vtkPoints > sampleTargetPoints = vtkSmartPointer< vtkPoints >::New();
+  landmarkTransform->SetSourceLandmarks( sampleSourcePoints );
+  landmarkTransform->SetTargetLandmarks( sampleTargetPoints );
+  vtkSmartPointer< vtkMatrix4x4 > sourceToTargetMatrix = vtkSmartPointer< vtkMatrix4x4 >::New();
+  std::vector< int > assignedTargetIndices;
+
+  vtkSmartPointer< vtkMatrix4x4 > bestSourceToTargetMatrix = vtkSmartPointer< vtkMatrix4x4 >::New();
+  std::vector< int > bestAssignedTargetIndices;
+  int bestNumberOfInliers = 0;
+  double bestDistanceError = VTK_DOUBLE_MAX;
+  bool matchingAmbiguous = false;
+
+  int numberOfIterations = MAXIMUM_NUMBER_OF_RANSAC_ITERATIONS;
+  for ( int iteration = 0; iteration < numberOfIterations; iteration++ )
+  {
+    // choose three different source points and a candidate match for each
+    int sampleSourceIndices[ 3 ];
+    int sampleTargetIndices[ 3 ];
+    sampleSourceIndices[ 0 ] = GetNextRandomIndex( randomSequence, numberOfSourcePoints );
+    do
+    {
+      sampleSourceIndices[ 1 ] = GetNextRandomIndex( randomSequence, numberOfSourcePoints );
+    } while ( sampleSourceIndices[ 1 ] == sampleSourceIndices[ 0 ] );
+    do
+    {
+      sampleSourceIndices[ 2 ] = GetNextRandomIndex( randomSequence, numberOfSourcePoints );
+    } while ( sampleSourceIndices[ 2 ] == sampleSourceIndices[ 0 ] || sampleSourceIndices[ 2 ] == sampleSourceIndices[ 1 ] );
+    for ( int sampleIndex = 0; sampleIndex < 3; sampleIndex++ )
+    {
+      int candidateIndex = GetNextRandomIndex( randomSequence, numberOfCandidatesPerPoint );
+      sampleTargetIndices[ sampleIndex ] = candidateTargetIndices[ sampleSourceIndices[ sampleIndex ] * numberOfCandidatesPerPoint + candidateIndex ];
+    }
+    if ( sampleTargetIndices[ 0 ] == sampleTargetIndices[ 1 ] || sampleTargetIndices[ 0 ] == sampleTargetIndices[ 2 ] || sampleTargetIndices[ 1 ] == sampleTargetIndices[ 2 ] )
+    {
+      continue;
+    }
+
+    // samples that agree with the best matching would just find the same matching again
+    if ( !bestAssignedTargetIndices.empty()
+      && bestAssignedTargetIndices[ sampleSourceIndices[ 0 ] ] == sampleTargetIndices[ 0 ]
+      && bestAssignedTargetIndices[ sampleSourceIndices[ 1 ] ] == sampleTargetIndices[ 1 ]
+      && bestAssignedTargetIndices[ sampleSourceIndices[ 2 ] ] == sampleTargetIndices[ 2 ] )
+    {
+      continue;
+    }
+
+    // distances between the sample points must be preserved by a rigid transform
+    double samplePoints[ 6 ][ 3 ];
+    for ( int sampleIndex = 0; sampleIndex < 3; sampleIndex++ )
+    {
+      this->InputSourcePoints->GetPoint( sampleSourceIndices[ sampleIndex ], samplePoints[ sampleIndex ] );
+      this->InputTargetPoints->GetPoint( sampleTargetIndices[ sampleIndex ], samplePoints[ 3 + sampleIndex ] );
+    }
+    bool sampleConsistent = true;
+    for ( int sampleIndex1 = 0; sampleIndex1 < 3 && sampleConsistent; sampleIndex1++ )
+    {
+      int sampleIndex2 = ( sampleIndex1 + 1 ) % 3;
+      double sourceDistance = sqrt( vtkMath::Distance2BetweenPoints( samplePoints[ sampleIndex1 ], samplePoints[ sampleIndex2 ] ) );
+      double targetDistance = sqrt( vtkMath::Distance2BetweenPoints( samplePoints[ 3 + sampleIndex1 ], samplePoints[ 3 + sampleIndex2 ] ) );
+      sampleConsistent = ( fabs( sourceDistance - targetDistance ) <= 2.0 * inlierDistance );
+    }
+    if ( !sampleConsistent )
+    {
+      continue;
+    }
+
+    // rotation is undetermined if the sample points are (nearly) collinear
+    double sourceEdge1[ 3 ];
+    double sourceEdge2[ 3 ];
+    vtkMath::Subtract( samplePoints[ 1 ], samplePoints[ 0 ], sourceEdge1 );
+    vtkMath::Subtract( samplePoints[ 2 ], samplePoints[ 0 ], sourceEdge2 );
+    double sourceNormal[ 3 ];
+    vtkMath::Cross( sourceEdge1, sourceEdge2, sourceNormal );
+    if ( vtkMath::Norm( sourceNormal ) < 0.01 * vtkMath::Norm( sourceEdge1 ) * vtkMath::Norm( sourceEdge2 ) )
+    {
+      continue;
+    }
+
+    sampleSourcePoints->SetNumberOfPoints( 3 );
+    sampleTargetPoints->SetNumberOfPoints( 3 );
+    for ( int sampleIndex = 0; sampleIndex < 3; sampleIndex++ )
+    {
+      sampleSourcePoints->SetPoint( sampleIndex, samplePoints[ sampleIndex ] );
+      sampleTargetPoints->SetPoint( sampleIndex, samplePoints[ 3 + sampleIndex ] );
+    }
+    sampleSourcePoints->Modified();
+    sampleTargetPoints->Modified();
+    landmarkTransform->Update();
+    landmarkTransform->GetMatrix( sourceToTargetMatrix );
+
+    double sumOfSquaredInlierDistances = 0.0;
+    int numberOfInliers = AssignClosestTargetPoints( sourceToTargetMatrix, this->InputSourcePoints, this->InputTargetPoints,
+                                                     targetPointLocator, inlierDistance2, maximumNumberOfOutliers,
+                                                     assignedTargetIndices, sumOfSquaredInlierDistances );
+    if ( numberOfInliers < 0 )
+    {
+      continue;
+    }
+
+    // refine the transform using all inliers
+    sampleSourcePoints->Reset();
+    sampleTargetPoints->Reset();
+    for ( int sourcePointIndex = 0; sourcePointIndex < numberOfSourcePoints; sourcePointIndex++ )
+    {
+      if ( assignedTargetIndices[ sourcePointIndex ] >= 0 )
+      {
+        sampleSourcePoints->InsertNextPoint( this->InputSourcePoints->GetPoint( sourcePointIndex ) );
+        sampleTargetPoints->InsertNextPoint( this->InputTargetPoints->GetPoint( assignedTargetIndices[ sourcePointIndex ] ) );
+      }
+    }
+    sampleSourcePoints->Modified();
+    sampleTargetPoints->Modified();
+    landmarkTransform->Update();
+    landmarkTransform->GetMatrix( sourceToTargetMatrix );
+    numberOfInliers = AssignClosestTargetPoints( sourceToTargetMatrix, this->InputSourcePoints, this->InputTargetPoints,
+                                                 targetPointLocator, inlierDistance2, maximumNumberOfOutliers,
+                                                 assignedTargetIndices, sumOfSquaredInlierDistances );
+    if ( numberOfInliers < 0 )
+    {
+      continue;
+    }
+    double distanceError = sqrt( sumOfSquaredInlierDistances / numberOfInliers );
+
+    if ( !bestAssignedTargetIndices.empty() && !AssignmentsConflict( assignedTargetIndices, bestAssignedTargetIndices ) )
+    {
+      // same matching as the best, keep the one that matches more points
+      if ( numberOfInliers < bestNumberOfInliers || ( numberOfInliers == bestNumberOfInliers && distanceError >= bestDistanceError ) )
+      {
+        continue;
+      }
+      bestDistanceError = distanceError;
+    }
+    else
+    {
+      // different matching, it may be better than the best
+      vtkPointMatcher::UpdateAmbiguityFlag( distanceError, bestDistanceError, this->AmbiguityDistanceError, matchingAmbiguous );
+      if ( distanceError != bestDistanceError )
+      {
+        continue;
+      }
+    }
+    bestNumberOfInliers = numberOfInliers;
+    bestAssignedTargetIndices = assignedTargetIndices;
+    bestSourceToTargetMatrix->DeepCopy( sourceToTargetMatrix );
+
+    // Update the number of iterations needed to find a correct sample with the required confidence.
+    // A candidate of a source point is correct with probability of about
+    // ( fraction of source points whose match is among their candidates ) / ( number of candidates ).
+    int numberOfCandidatesContainingMatch = 0;
+    for ( int sourcePointIndex = 0; sourcePointIndex < numberOfSourcePoints; sourcePointIndex++ )
+    {
+      const int* candidates = &candidateTargetIndices[ sourcePointIndex * numberOfCandidatesPerPoint ];
+      if ( std::find( candidates, candidates + numberOfCandidatesPerPoint, bestAssignedTargetIndices[ sourcePointIndex ] ) != candidates + numberOfCandidatesPerPoint )
+      {
+        numberOfCandidatesContainingMatch++;
+      }
+    }
+    double probabilityOfCorrectCandidate = double( numberOfCandidatesContainingMatch ) / numberOfSourcePoints / numberOfCandidatesPerPoint;
+    double probabilityOfCorrectSample = pow( probabilityOfCorrectCandidate, 3 );
+    if ( probabilityOfCorrectSample > 0.0 && probabilityOfCorrectSample < 1.0 )
+    {
+      double requiredNumberOfIterations = log( 1.0 - RANSAC_CONFIDENCE ) / log( 1.0 - probabilityOfCorrectSample );
+      numberOfIterations = vtkMath::Max( MINIMUM_NUMBER_OF_RANSAC_ITERATIONS,
+        ( int ) vtkMath::Min( requiredNumberOfIterations, double( MAXIMUM_NUMBER_OF_RANSAC_ITERATIONS ) ) );
+    }
+  }
+
+  if ( bestAssignedTargetIndices.empty() )
+  {
+    return false;
+  }
+
+  vtkSmartPointer< vtkTransform > bestSourceToTargetTransform = vtkSmartPointer< vtkTransform >::New();
+  bestSourceToTargetTransform->SetMatrix( bestSourceToTargetMatrix );
+  vtkSmartPointer< vtkPoints > matchedSourcePoints = vtkSmartPointer< vtkPoints >::New();
+  vtkSmartPointer< vtkPoints > matchedTargetPoints = vtkSmartPointer< vtkPoints >::New();
+  double thresholdDistance2ForOutlier = this->Distance2ForOutlierRemovalAfterInitialRegistration();
+  bool matchingSuccessful = vtkPointMatcher::ComputePointMatchingBasedOnRegistration( bestSourceToTargetTransform,
+                                                                                      this->InputSourcePoints, this->InputTargetPoints,
+                                                                                      thresholdDistance2ForOutlier, this->MaximumDifferenceInNumberOfPoints,
+                                                                                      matchedSourcePoints, matchedTargetPoints );
+  if ( !matchingSuccessful )
+  {
+    return false;
+  }
+
+  double distanceError = vtkPointMatcher::ComputeRegistrationRootMeanSquareError( matchedSourcePoints, matchedTargetPoints );
+  if ( distanceError > this->TolerableDistanceError )
+  {
+    return false;
+  }
+
+  this->MatchingAmbiguous = matchingAmbiguous;
+  this->ComputedDistanceError = distanceError;
+  this->OutputSourcePoints->DeepCopy( matchedSourcePoints );
+  this->OutputTargetPoints->DeepCopy( matchedTargetPoints );
+  return true;
+}
+
 //------------------------------------------------------------------------------
 bool vtkPointMatcher::InputsValid( bool verbose )
 {
@@ -618,6 +972,7 @@ void vtkPointMatcher::UpdateBestMatchingForSubsetsOfPoints( int minimumSubsetSiz
                                                             bool& matchingAmbiguous, 
                                                             double& currentBestDistanceError,
                                                             double tolerableDistanceError,
+                                                            vtkIdType& numberOfEvaluatedPermutations,
                                                             vtkPoints* outputMatchedSourcePoints,
                                                             vtkPoints* outputMatchedTargetPoints )
 {
@@ -683,7 +1038,7 @@ void vtkPointMatcher::UpdateBestMatchingForSubsetsOfPoints( int minimumSubsetSiz
     vtkPointMatcher::UpdateBestMatchingForNSizedSubsetsOfPoints( subsetSize,
                                                                  unmatchedSourcePoints, unmatchedTargetPoints,
                                                                  ambiguityDistanceError, matchingAmbiguous,
-                                                                 currentBestDistanceError,
+                                                                 currentBestDistanceError, numberOfEvaluatedPermutations,
                                                                  outputMatchedSourcePoints, outputMatchedTargetPoints );
     if ( currentBestDistanceError <= tolerableDistanceError )
     {
@@ -693,6 +1048,82 @@ void vtkPointMatcher::UpdateBestMatchingForSubsetsOfPoints( int minimumSubsetSiz
   }
 }
 
+//------------------------------------------------------------------------------
+namespace
+{
+  // Best matching found among the candidates of one source point combination
+  struct SourcePointsCombinationResult
+  {
+    double DistanceError{ RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR };
+    bool MatchingAmbiguous{ false };
+    vtkIdType NumberOfEvaluatedPermutations{ 0 };
+    std::vector< double > MatchedSourcePointCoordinates; // x, y, z of each point
+    std::vector< double > MatchedTargetPointCoordinates; // x, y, z of each point
+  };
+
+  void SetUpPointIndexCombinationGenerator( vtkCombinatoricGenerator* generator, int numberOfPoints, int subsetSize )
+  {
+    generator->SetCombinatoricToCombination();
+    generator->SetSubsetSize( subsetSize );
+    generator->SetNumberOfInputSets( 1 );
+    for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+    {
+      generator->AddInputElement( 0, pointIndex );
+    }
+  }
+
+  // Distances between all pairs of points, row-major, numberOfPoints x numberOfPoints
+  void GetAllDistancesInPointSet( vtkPoints* points, std::vector< double >& distances )
+  {
+    vtkSmartPointer< vtkPointDistanceMatrix > distanceMatrix = vtkSmartPointer< vtkPointDistanceMatrix >::New();
+    distanceMatrix->SetPointList1( points );
+    distanceMatrix->SetPointList2( points );
+    vtkSmartPointer< vtkDoubleArray > distancesArray = vtkSmartPointer< vtkDoubleArray >::New();
+    distanceMatrix->GetDistances( distancesArray );
+    distances.resize( distancesArray->GetNumberOfValues() );
+    for ( vtkIdType valueIndex = 0; valueIndex < distancesArray->GetNumberOfValues(); valueIndex++ )
+    {
+      distances[ valueIndex ] = distancesArray->GetValue( valueIndex );
+    }
+  }
+
+  // Look up the distances between the points of a subset, row-major, subsetSize x subsetSize
+  void GetSubsetDistances( const std::vector< double >& allDistances, int numberOfPoints,
+    const std::vector< int >& subsetPointIndices, std::vector< double >& subsetDistances )
+  {
+    int subsetSize = subsetPointIndices.size();
+    subsetDistances.resize( subsetSize * subsetSize );
+    for ( int subsetPointIndex1 = 0; subsetPointIndex1 < subsetSize; subsetPointIndex1++ )
+    {
+      for ( int subsetPointIndex2 = 0; subsetPointIndex2 < subsetSize; subsetPointIndex2++ )
+      {
+        subsetDistances[ subsetPointIndex1 * subsetSize + subsetPointIndex2 ] =
+          allDistances[ subsetPointIndices[ subsetPointIndex1 ] * numberOfPoints + subsetPointIndices[ subsetPointIndex2 ] ];
+      }
+    }
+  }
+
+  void CopyPointsToCoordinates( vtkPoints* points, std::vector< double >& coordinates )
+  {
+    int numberOfPoints = points->GetNumberOfPoints();
+    coordinates.resize( 3 * numberOfPoints );
+    for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+    {
+      points->GetPoint( pointIndex, &coordinates[ 3 * pointIndex ] );
+    }
+  }
+
+  void CopyCoordinatesToPoints( const std::vector< double >& coordinates, vtkPoints* points )
+  {
+    int numberOfPoints = coordinates.size() / 3;
+    points->SetNumberOfPoints( numberOfPoints );
+    for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+    {
+      points->SetPoint( pointIndex, &coordinates[ 3 * pointIndex ] );
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 void vtkPointMatcher::UpdateBestMatchingForNSizedSubsetsOfPoints(
   int subsetSize,
@@ -701,6 +1132,7 @@ void vtkPointMatcher::UpdateBestMatchingForNSizedSubsetsOfPoints(
   double ambiguityDistanceError,
   bool& matchingAmbiguous,
   double& currentBestDistanceError,
+  vtkIdType& numberOfEvaluatedPermutations,
   vtkPoints* outputMatchedSourcePoints,
   vtkPoints* outputMatchedTargetPoints )
 {
@@ -730,72 +1162,239 @@ void vtkPointMatcher::UpdateBestMatchingForNSizedSubsetsOfPoints(
     return;
   }
 
-  // generate sets of indices for all possible combinations of both input sets
-  vtkSmartPointer< vtkCombinatoricGenerator > sourcePointsCombinationGenerator = vtkSmartPointer< vtkCombinatoricGenerator >::New();
-  sourcePointsCombinationGenerator->SetCombinatoricToCombination();
-  sourcePointsCombinationGenerator->SetSubsetSize( subsetSize );
-  sourcePointsCombinationGenerator->SetNumberOfInputSets( 1 );
-  for ( int pointIndex = 0; pointIndex < numberOfUnmatchedSourcePoints; pointIndex++ )
-  {
-    sourcePointsCombinationGenerator->AddInputElement( 0, pointIndex );
-  }
-  sourcePointsCombinationGenerator->Update();
-  std::vector< std::vector< int > > sourcePointsCombinationIndices = sourcePointsCombinationGenerator->GetOutputSets();
-
-  vtkSmartPointer< vtkCombinatoricGenerator > targetPointsCombinationGenerator = vtkSmartPointer< vtkCombinatoricGenerator >::New();
-  targetPointsCombinationGenerator->SetCombinatoricToCombination();
-  targetPointsCombinationGenerator->SetSubsetSize( subsetSize );
-  targetPointsCombinationGenerator->SetNumberOfInputSets( 1 );
-  for ( int pointIndex = 0; pointIndex < numberOfUnmatchedTargetPoints; pointIndex++ )
-  {
-    targetPointsCombinationGenerator->AddInputElement( 0, pointIndex );
-  }
-  targetPointsCombinationGenerator->Update();
-  std::vector< std::vector< int > > targetPointsCombinationIndices = targetPointsCombinationGenerator->GetOutputSets();
-
-  // these will store the actual combinations of points themselves (not indices)
-  vtkSmartPointer< vtkPoints > unmatchedSourcePointsCombination = vtkSmartPointer< vtkPoints >::New();
-  unmatchedSourcePointsCombination->SetNumberOfPoints( subsetSize );
-  vtkSmartPointer< vtkPoints > unmatchedTargetPointsCombination = vtkSmartPointer< vtkPoints >::New();
-  unmatchedTargetPointsCombination->SetNumberOfPoints( subsetSize );
-  // iterate over all combinations of both input point sets
-  for ( unsigned int sourcePointsCombinationIndex = 0; sourcePointsCombinationIndex < sourcePointsCombinationIndices.size(); sourcePointsCombinationIndex++ )
-  {
-    for ( unsigned int targetPointsCombinationIndex = 0; targetPointsCombinationIndex < targetPointsCombinationIndices.size(); targetPointsCombinationIndex++ )
+  // The candidate space is partitioned by source point combination. The candidates of each
+  // source point combination are evaluated independently (in parallel), with their own best error
+  // and ambiguity flag. These are then merged in the original order, so the result does not depend
+  // on the number of threads, and is the same as if all candidates were evaluated one by one.
+  // The best error found by any thread so far is shared, but only for discarding candidates early:
+  // it never increases, so a discarded candidate is worse than the final best error by more than
+  // the ambiguity distance, and could not have changed the merged result. Only the number of
+  // evaluated permutations depends on the order in which the threads find the candidates.
+  vtkSmartPointer< vtkCombinatoricGenerator > sourcePointsCombinationCounter = vtkSmartPointer< vtkCombinatoricGenerator >::New();
+  SetUpPointIndexCombinationGenerator( sourcePointsCombinationCounter, numberOfUnmatchedSourcePoints, subsetSize );
+  vtkIdType numberOfSourcePointsCombinations = sourcePointsCombinationCounter->ComputeNumberOfOutputSets();
+  std::vector< SourcePointsCombinationResult > sourcePointsCombinationResults( numberOfSourcePointsCombinations );
+
+  // Distances between all unmatched points are computed once, distances within candidate subsets are looked up from these
+  std::vector< double > unmatchedSourceDistances;
+  GetAllDistancesInPointSet( unmatchedSourcePoints, unmatchedSourceDistances );
+  std::vector< double > unmatchedTargetDistances;
+  GetAllDistancesInPointSet( unmatchedTargetPoints, unmatchedTargetDistances );
+
+  std::atomic< double > sharedBestDistanceError( currentBestDistanceError );
+  vtkSMPTools::For( 0, numberOfSourcePointsCombinations, [&]( vtkIdType beginCombinationIndex, vtkIdType endCombinationIndex )
+  {
+    // generators of index sets for all possible combinations of both input sets.
+    // Combinations are traversed lazily, so they are not stored in memory all at once.
+    vtkSmartPointer< vtkCombinatoricGenerator > sourcePointsCombinationGenerator = vtkSmartPointer< vtkCombinatoricGenerator >::New();
+    SetUpPointIndexCombinationGenerator( sourcePointsCombinationGenerator, numberOfUnmatchedSourcePoints, subsetSize );
+    vtkSmartPointer< vtkCombinatoricGenerator > targetPointsCombinationGenerator = vtkSmartPointer< vtkCombinatoricGenerator >::New();
+    SetUpPointIndexCombinationGenerator( targetPointsCombinationGenerator, numberOfUnmatchedTargetPoints, subsetSize );
+
+    // these will store the actual combinations of points themselves (not indices)
+    vtkSmartPointer< vtkPoints > unmatchedSourcePointsCombination = vtkSmartPointer< vtkPoints >::New();
+    unmatchedSourcePointsCombination->SetNumberOfPoints( subsetSize );
+    vtkSmartPointer< vtkPoints > unmatchedTargetPointsCombination = vtkSmartPointer< vtkPoints >::New();
+    unmatchedTargetPointsCombination->SetNumberOfPoints( subsetSize );
+    vtkSmartPointer< vtkPoints > matchedSourcePointsCombination = vtkSmartPointer< vtkPoints >::New();
+    vtkSmartPointer< vtkPoints > matchedTargetPointsCombination = vtkSmartPointer< vtkPoints >::New();
+    std::vector< double > sourcePointsCombinationDistances;
+    std::vector< double > targetPointsCombinationDistances;
+
+    // start directly at the first source point combination of this range
+    std::vector< int > sourcePointsCombinationIndices;
+    std::vector< int > targetPointsCombinationIndices;
+    sourcePointsCombinationGenerator->InitTraversal( beginCombinationIndex );
+
+    for ( vtkIdType sourcePointsCombinationIndex = beginCombinationIndex; sourcePointsCombinationIndex < endCombinationIndex; sourcePointsCombinationIndex++ )
     {
-      // store appropriate contents in the unmatchedSourcePointsCombination and unmatchedTargetPointsCombination variables
+      if ( !sourcePointsCombinationGenerator->GetNextOutputSet( sourcePointsCombinationIndices ) )
+      {
+        break;
+      }
+
+      // store appropriate contents in the unmatchedSourcePointsCombination variable
       for ( vtkIdType combinationPointIndex = 0; combinationPointIndex < subsetSize; combinationPointIndex++ )
       {
-        vtkIdType sourcePointIndex = ( vtkIdType ) sourcePointsCombinationIndices[ sourcePointsCombinationIndex ][ combinationPointIndex ];
+        vtkIdType sourcePointIndex = ( vtkIdType ) sourcePointsCombinationIndices[ combinationPointIndex ];
         double sourcePoint[ 3 ];
         unmatchedSourcePoints->GetPoint( sourcePointIndex, sourcePoint );
         unmatchedSourcePointsCombination->SetPoint( combinationPointIndex, sourcePoint );
+      }
+      GetSubsetDistances( unmatchedSourceDistances, numberOfUnmatchedSourcePoints, sourcePointsCombinationIndices, sourcePointsCombinationDistances );
+
+      // iterate over all combinations of the target point set
+      SourcePointsCombinationResult& result = sourcePointsCombinationResults[ sourcePointsCombinationIndex ];
+      targetPointsCombinationGenerator->InitTraversal();
+      while ( targetPointsCombinationGenerator->GetNextOutputSet( targetPointsCombinationIndices ) )
+      {
+        // store appropriate contents in the unmatchedTargetPointsCombination variable
+        for ( vtkIdType combinationPointIndex = 0; combinationPointIndex < subsetSize; combinationPointIndex++ )
+        {
+          vtkIdType targetPointIndex = ( vtkIdType ) targetPointsCombinationIndices[ combinationPointIndex ];
+          double targetPoint[ 3 ];
+          unmatchedTargetPoints->GetPoint( targetPointIndex, targetPoint );
+          unmatchedTargetPointsCombination->SetPoint( combinationPointIndex, targetPoint );
+        }
+        GetSubsetDistances( unmatchedTargetDistances, numberOfUnmatchedTargetPoints, targetPointsCombinationIndices, targetPointsCombinationDistances );
+        // finally see how good this particular combination is
+        vtkPointMatcher::UpdateBestMatchingForSubsetOfPoints( unmatchedSourcePointsCombination, unmatchedTargetPointsCombination,
+                                                              &sourcePointsCombinationDistances[ 0 ], &targetPointsCombinationDistances[ 0 ],
+                                                              ambiguityDistanceError, result.MatchingAmbiguous,
+                                                              result.DistanceError, &sharedBestDistanceError,
+                                                              result.NumberOfEvaluatedPermutations,
+                                                              matchedSourcePointsCombination, matchedTargetPointsCombination );
+      }
 
-        vtkIdType targetPointIndex = ( vtkIdType ) targetPointsCombinationIndices[ targetPointsCombinationIndex ][ combinationPointIndex ];
-        double targetPoint[ 3 ];
-        unmatchedTargetPoints->GetPoint( targetPointIndex, targetPoint );
-        unmatchedTargetPointsCombination->SetPoint( combinationPointIndex, targetPoint );
+      if ( result.DistanceError != RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR )
+      {
+        CopyPointsToCoordinates( matchedSourcePointsCombination, result.MatchedSourcePointCoordinates );
+        CopyPointsToCoordinates( matchedTargetPointsCombination, result.MatchedTargetPointCoordinates );
       }
-      // finally see how good this particular combination is
-      vtkPointMatcher::UpdateBestMatchingForSubsetOfPoints( unmatchedSourcePointsCombination, unmatchedTargetPointsCombination,
-                                                            ambiguityDistanceError, matchingAmbiguous,
-                                                            currentBestDistanceError,
-                                                            outputMatchedSourcePoints, outputMatchedTargetPoints );
+    }
+  } );
+
+  // Merge the results in order. Only the best candidate of each source point combination
+  // (the last one, if there is a tie) can become the best overall. Other candidates of a combination
+  // can only be within ambiguity distance of the best overall if they are also within ambiguity distance
+  // of the best of their own combination, which is indicated by the ambiguity flag of the combination.
+  for ( vtkIdType sourcePointsCombinationIndex = 0; sourcePointsCombinationIndex < numberOfSourcePointsCombinations; sourcePointsCombinationIndex++ )
+  {
+    const SourcePointsCombinationResult& result = sourcePointsCombinationResults[ sourcePointsCombinationIndex ];
+    numberOfEvaluatedPermutations += result.NumberOfEvaluatedPermutations;
+    if ( result.DistanceError == RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR )
+    {
+      continue;
+    }
+    double previousBestDistanceError = currentBestDistanceError;
+    vtkPointMatcher::UpdateAmbiguityFlag( result.DistanceError, currentBestDistanceError, ambiguityDistanceError, matchingAmbiguous );
+    if ( result.DistanceError <= previousBestDistanceError )
+    {
+      matchingAmbiguous = matchingAmbiguous || result.MatchingAmbiguous;
+      CopyCoordinatesToPoints( result.MatchedSourcePointCoordinates, outputMatchedSourcePoints );
+      CopyCoordinatesToPoints( result.MatchedTargetPointCoordinates, outputMatchedTargetPoints );
     }
   }
 }
 
+//------------------------------------------------------------------------------
+// State of the search for the best ordering of a target subset.
+// Target points are assigned to the source points one at a time (depth-first).
+// For a rigid registration, the residuals of any two points i and j satisfy
+// e_i + e_j >= | sourceDistance( i, j ) - targetDistance( i, j ) |, therefore
+// the root mean square error of n points is at least (maximum distance difference) / sqrt( 2 n ).
+// A partial assignment is discarded if this lower bound is worse than the best error so far by more than
+// the ambiguity distance: no completion of it could change the best matching or the ambiguity flag.
+// The best error so far is the lower of the best error of this search and the shared best error
+// (found by any search running in parallel), if there is one.
+struct vtkPointMatcher::PointAssignmentSearch
+{
+  vtkPoints* SourceSubset;
+  vtkPoints* TargetSubset;
+  int NumberOfPoints;
+  const double* SourceDistances; // row-major, NumberOfPoints x NumberOfPoints
+  const double* TargetDistances; // row-major, NumberOfPoints x NumberOfPoints
+  std::vector< int > AssignedTargetIndices; // target index for each source index
+  std::vector< bool > TargetIndexAssigned;
+  vtkSmartPointer< vtkPoints > PermutedTargetSubset;
+
+  double AmbiguityDistanceError;
+  bool* MatchingAmbiguous;
+  double* CurrentBestDistanceError;
+  std::atomic< double >* SharedBestDistanceError; // may be NULL
+  vtkIdType* NumberOfEvaluatedPermutations;
+  vtkPoints* OutputMatchedSourcePoints;
+  vtkPoints* OutputMatchedTargetPoints;
+
+  void AssignNextPoint( int sourcePointIndex, double maximumDistanceDifference )
+  {
+    if ( sourcePointIndex == this->NumberOfPoints )
+    {
+      this->EvaluateCompleteAssignment();
+      return;
+    }
+
+    double bestDistanceError = *this->CurrentBestDistanceError;
+    if ( this->SharedBestDistanceError != NULL )
+    {
+      bestDistanceError = vtkMath::Min( bestDistanceError, this->SharedBestDistanceError->load() );
+    }
+    const double maximumAllowedDistanceDifference =
+      sqrt( 2.0 * this->NumberOfPoints ) * ( bestDistanceError + this->AmbiguityDistanceError );
+    for ( int targetPointIndex = 0; targetPointIndex < this->NumberOfPoints; targetPointIndex++ )
+    {
+      if ( this->TargetIndexAssigned[ targetPointIndex ] )
+      {
+        continue;
+      }
+
+      // compare distances to the points that are already assigned
+      double newMaximumDistanceDifference = maximumDistanceDifference;
+      for ( int assignedSourcePointIndex = 0; assignedSourcePointIndex < sourcePointIndex; assignedSourcePointIndex++ )
+      {
+        int assignedTargetPointIndex = this->AssignedTargetIndices[ assignedSourcePointIndex ];
+        double sourceDistance = this->SourceDistances[ sourcePointIndex * this->NumberOfPoints + assignedSourcePointIndex ];
+        double targetDistance = this->TargetDistances[ targetPointIndex * this->NumberOfPoints + assignedTargetPointIndex ];
+        newMaximumDistanceDifference = vtkMath::Max( newMaximumDistanceDifference, fabs( sourceDistance - targetDistance ) );
+      }
+      if ( newMaximumDistanceDifference > maximumAllowedDistanceDifference )
+      {
+        continue;
+      }
+
+      this->AssignedTargetIndices[ sourcePointIndex ] = targetPointIndex;
+      this->TargetIndexAssigned[ targetPointIndex ] = true;
+      this->AssignNextPoint( sourcePointIndex + 1, newMaximumDistanceDifference );
+      this->TargetIndexAssigned[ targetPointIndex ] = false;
+    }
+  }
+
+  void EvaluateCompleteAssignment()
+  {
+    // fill PermutedTargetSubset with points from TargetSubset, in the assigned order
+    for ( int pointIndex = 0; pointIndex < this->NumberOfPoints; pointIndex++ )
+    {
+      double* permutedPoint = this->TargetSubset->GetPoint( this->AssignedTargetIndices[ pointIndex ] );
+      this->PermutedTargetSubset->SetPoint( pointIndex, permutedPoint );
+    }
+    double distanceError = vtkPointMatcher::ComputeRegistrationRootMeanSquareError( this->SourceSubset, this->PermutedTargetSubset );
+    ( *this->NumberOfEvaluatedPermutations )++;
+
+    if ( this->SharedBestDistanceError != NULL )
+    {
+      // lower the shared best error, unless another search has already found a better one
+      double sharedBestDistanceError = this->SharedBestDistanceError->load();
+      while ( distanceError < sharedBestDistanceError &&
+              !this->SharedBestDistanceError->compare_exchange_weak( sharedBestDistanceError, distanceError ) )
+      {
+      }
+    }
+
+    vtkPointMatcher::UpdateAmbiguityFlag( distanceError, *this->CurrentBestDistanceError, this->AmbiguityDistanceError, *this->MatchingAmbiguous );
+    if ( distanceError == *this->CurrentBestDistanceError )
+    {
+      this->OutputMatchedSourcePoints->DeepCopy( this->SourceSubset );
+      this->OutputMatchedTargetPoints->DeepCopy( this->PermutedTargetSubset );
+    }
+  }
+};
+
 //------------------------------------------------------------------------------
 // point pair matching will be based on the distances between each pair of ordered points.
 // we have two input point lists. We want to reorder the second list such that the 
 // point-to-point distances are as close as possible to those in the first.
-// We will permute over all possibilities (and only ever keep the best result.)
+// All orderings are considered (and only ever keep the best result), but orderings whose
+// pairwise distances already differ too much are discarded without computing a registration.
 void vtkPointMatcher::UpdateBestMatchingForSubsetOfPoints(
   vtkPoints* sourceSubset, 
   vtkPoints* targetSubset,
+  const double* sourceSubsetDistances,
+  const double* targetSubsetDistances,
   double ambiguityDistanceError,
   bool& matchingAmbiguous,
   double& currentBestDistanceError,
+  std::atomic< double >* sharedBestDistanceError,
+  vtkIdType& numberOfEvaluatedPermutations,
   vtkPoints* outputMatchedSourcePoints,
   vtkPoints* outputMatchedTargetPoints )
 {
@@ -819,45 +1418,33 @@ void vtkPointMatcher::UpdateBestMatchingForSubsetOfPoints(
     return;
   }
 
-  // compute the permutations, store them in a vtkIntArray.
-  vtkSmartPointer< vtkCombinatoricGenerator > combinatoricGenerator = vtkSmartPointer< vtkCombinatoricGenerator >::New();
-  combinatoricGenerator->SetCombinatoricToPermutation();
-  combinatoricGenerator->SetSubsetSize( numberOfPoints );
-  combinatoricGenerator->SetNumberOfInputSets( 1 );
-  for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+  if ( sourceSubsetDistances == NULL || targetSubsetDistances == NULL )
   {
-    combinatoricGenerator->AddInputElement( 0, pointIndex );
+    vtkGenericWarningMacro( "Subset distances are null." );
+    return;
   }
-  combinatoricGenerator->Update();
-  std::vector< std::vector< int > > targetSubsetIndexPermutations = combinatoricGenerator->GetOutputSets();
-
-  // iterate over all permutations - look for the most 'suitable'
-  // point matching that gives distances most similar to the reference
 
+  PointAssignmentSearch search;
+  search.SourceSubset = sourceSubset;
+  search.TargetSubset = targetSubset;
+  search.NumberOfPoints = numberOfPoints;
+  search.SourceDistances = sourceSubsetDistances;
+  search.TargetDistances = targetSubsetDistances;
+  search.AssignedTargetIndices.resize( numberOfPoints, -1 );
+  search.TargetIndexAssigned.resize( numberOfPoints, false );
   // create + allocate the permuted compare list once outside
-  // the loop to avoid allocation/deallocation time costs.
-  vtkSmartPointer< vtkPoints > permutedTargetSubset = vtkSmartPointer< vtkPoints >::New();
-  permutedTargetSubset->SetNumberOfPoints( numberOfPoints );
-  int numberOfPermutations = targetSubsetIndexPermutations.size();
-  for ( int permutationIndex = 0; permutationIndex < numberOfPermutations; permutationIndex++ )
-  {
-    // fill permutedTargetSubset with points from targetSubset,
-    // in the order indicate by the permuted indices
-    for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
-    {
-      int permutedPointIndex = targetSubsetIndexPermutations[ permutationIndex][ pointIndex ];
-      double* permutedPoint = targetSubset->GetPoint( permutedPointIndex );
-      permutedTargetSubset->SetPoint( pointIndex, permutedPoint );
-    }
-    double distanceError = vtkPointMatcher::ComputeRegistrationRootMeanSquareError( sourceSubset, permutedTargetSubset );
-
-    vtkPointMatcher::UpdateAmbiguityFlag( distanceError, currentBestDistanceError, ambiguityDistanceError, matchingAmbiguous );
-    if ( distanceError == currentBestDistanceError )
-    {
-      outputMatchedSourcePoints->DeepCopy( sourceSubset );
-      outputMatchedTargetPoints->DeepCopy( permutedTargetSubset );
-    }
-  }
+  // the search to avoid allocation/deallocation time costs.
+  search.PermutedTargetSubset = vtkSmartPointer< vtkPoints >::New();
+  search.PermutedTargetSubset->SetNumberOfPoints( numberOfPoints );
+  search.AmbiguityDistanceError = ambiguityDistanceError;
+  search.MatchingAmbiguous = &matchingAmbiguous;
+  search.CurrentBestDistanceError = &currentBestDistanceError;
+  search.SharedBestDistanceError = sharedBestDistanceError;
+  search.NumberOfEvaluatedPermutations = &numberOfEvaluatedPermutations;
+  search.OutputMatchedSourcePoints = outputMatchedSourcePoints;
+  search.OutputMatchedTargetPoints = outputMatchedTargetPoints;
+
+  search.AssignNextPoint( 0, 0.0 );
 }
 
 //------------------------------------------------------------------------------
@@ -926,6 +1513,38 @@ double vtkPointMatcher::ComputeRegistrationRootMeanSquareError( vtkPoints* sourc
     return RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR;
   }
 
+  // small point sets are copied to the stack and evaluated without creating any VTK objects
+  int numberOfSourcePoints = sourcePoints->GetNumberOfPoints();
+  if ( numberOfSourcePoints > 0 && numberOfSourcePoints <= MAXIMUM_NUMBER_OF_POINTS_FOR_CLOSED_FORM_REGISTRATION_ERROR )
+  {
+    if ( targetPoints->GetNumberOfPoints() != numberOfSourcePoints )
+    {
+      vtkGenericWarningMacro( "Point lists are not of same size " << numberOfSourcePoints << " and " << targetPoints->GetNumberOfPoints() << ". Returning default value " << RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR << "." );
+      return RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR;
+    }
+    double sourceX[ MAXIMUM_NUMBER_OF_POINTS_FOR_CLOSED_FORM_REGISTRATION_ERROR ];
+    double sourceY[ MAXIMUM_NUMBER_OF_POINTS_FOR_CLOSED_FORM_REGISTRATION_ERROR ];
+    double sourceZ[ MAXIMUM_NUMBER_OF_POINTS_FOR_CLOSED_FORM_REGISTRATION_ERROR ];
+    double targetX[ MAXIMUM_NUMBER_OF_POINTS_FOR_CLOSED_FORM_REGISTRATION_ERROR ];
+    double targetY[ MAXIMUM_NUMBER_OF_POINTS_FOR_CLOSED_FORM_REGISTRATION_ERROR ];
+    double targetZ[ MAXIMUM_NUMBER_OF_POINTS_FOR_CLOSED_FORM_REGISTRATION_ERROR ];
+    for ( int pointIndex = 0; pointIndex < numberOfSourcePoints; pointIndex++ )
+    {
+      double point[ 3 ];
+      sourcePoints->GetPoint( pointIndex, point );
+      sourceX[ pointIndex ] = point[ 0 ];
+      sourceY[ pointIndex ] = point[ 1 ];
+      sourceZ[ pointIndex ] = point[ 2 ];
+      targetPoints->GetPoint( pointIndex, point );
+      targetX[ pointIndex ] = point[ 0 ];
+      targetY[ pointIndex ] = point[ 1 ];
+      targetZ[ pointIndex ] = point[ 2 ];
+    }
+    return vtkPointMatcher::ComputeRigidRegistrationRootMeanSquareError( numberOfSourcePoints,
+                                                                          sourceX, sourceY, sourceZ,
+                                                                          targetX, targetY, targetZ );
+  }
+
   vtkSmartPointer< vtkLandmarkTransform > landmarkTransform = vtkSmartPointer< vtkLandmarkTransform >::New();
   landmarkTransform->SetSourceLandmarks( sourcePoints );
   landmarkTransform->SetTargetLandmarks( targetPoints );
@@ -976,6 +1595,116 @@ double vtkPointMatcher::ComputeRegistrationRootMeanSquareError( vtkPoints* sourc
   return rootMeanSquareistanceErrors;
 }
 
+//------------------------------------------------------------------------------
+double vtkPointMatcher::ComputeRigidRegistrationRootMeanSquareError( int numberOfPoints,
+                                                                     const double* sourceX, const double* sourceY, const double* sourceZ,
+                                                                     const double* targetX, const double* targetY, const double* targetZ )
+{
+  if ( numberOfPoints <= 0 )
+  {
+    vtkGenericWarningMacro( "Point lists are empty. Returning default value " << RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR << "." );
+    return RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR;
+  }
+
+  // centroids
+  double sourceSumX = 0.0, sourceSumY = 0.0, sourceSumZ = 0.0;
+  double targetSumX = 0.0, targetSumY = 0.0, targetSumZ = 0.0;
+  for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+  {
+    sourceSumX += sourceX[ pointIndex ];
+    sourceSumY += sourceY[ pointIndex ];
+    sourceSumZ += sourceZ[ pointIndex ];
+    targetSumX += targetX[ pointIndex ];
+    targetSumY += targetY[ pointIndex ];
+    targetSumZ += targetZ[ pointIndex ];
+  }
+  const double sourceCentroidX = sourceSumX / numberOfPoints;
+  const double sourceCentroidY = sourceSumY / numberOfPoints;
+  const double sourceCentroidZ = sourceSumZ / numberOfPoints;
+  const double targetCentroidX = targetSumX / numberOfPoints;
+  const double targetCentroidY = targetSumY / numberOfPoints;
+  const double targetCentroidZ = targetSumZ / numberOfPoints;
+
+  // cross-covariance of the centered point sets. Each element is accumulated in a separate scalar
+  // in a single loop over the coordinate arrays, which the compiler can vectorize.
+  double mXX = 0.0, mXY = 0.0, mXZ = 0.0;
+  double mYX = 0.0, mYY = 0.0, mYZ = 0.0;
+  double mZX = 0.0, mZY = 0.0, mZZ = 0.0;
+  for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+  {
+    const double sX = sourceX[ pointIndex ] - sourceCentroidX;
+    const double sY = sourceY[ pointIndex ] - sourceCentroidY;
+    const double sZ = sourceZ[ pointIndex ] - sourceCentroidZ;
+    const double tX = targetX[ pointIndex ] - targetCentroidX;
+    const double tY = targetY[ pointIndex ] - targetCentroidY;
+    const double tZ = targetZ[ pointIndex ] - targetCentroidZ;
+    mXX += sX * tX; mXY += sX * tY; mXZ += sX * tZ;
+    mYX += sY * tX; mYY += sY * tY; mYZ += sY * tZ;
+    mZX += sZ * tX; mZY += sZ * tY; mZZ += sZ * tZ;
+  }
+
+  double crossCovariance[ 3 ][ 3 ] = { { mXX, mXY, mXZ }, { mYX, mYY, mYZ }, { mZX, mZY, mZZ } };
+  double rotation[ 3 ][ 3 ];
+  if ( !vtkPointMatcher::ComputeRotationFromCrossCovariance( crossCovariance, rotation ) )
+  {
+    return RESET_VALUE_COMPUTED_ROOT_MEAN_DISTANCE_ERROR;
+  }
+
+  // residuals are computed explicitly (instead of from the eigenvalue) to avoid cancellation errors for good fits
+  double sumOfSquaredDistances = 0.0;
+  for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+  {
+    const double sX = sourceX[ pointIndex ] - sourceCentroidX;
+    const double sY = sourceY[ pointIndex ] - sourceCentroidY;
+    const double sZ = sourceZ[ pointIndex ] - sourceCentroidZ;
+    const double dX = rotation[ 0 ][ 0 ] * sX + rotation[ 0 ][ 1 ] * sY + rotation[ 0 ][ 2 ] * sZ - ( targetX[ pointIndex ] - targetCentroidX );
+    const double dY = rotation[ 1 ][ 0 ] * sX + rotation[ 1 ][ 1 ] * sY + rotation[ 1 ][ 2 ] * sZ - ( targetY[ pointIndex ] - targetCentroidY );
+    const double dZ = rotation[ 2 ][ 0 ] * sX + rotation[ 2 ][ 1 ] * sY + rotation[ 2 ][ 2 ] * sZ - ( targetZ[ pointIndex ] - targetCentroidZ );
+    sumOfSquaredDistances += dX * dX + dY * dY + dZ * dZ;
+  }
+  return sqrt( sumOfSquaredDistances / numberOfPoints );
+}
+
+//------------------------------------------------------------------------------
+bool vtkPointMatcher::ComputeRotationFromCrossCovariance( const double crossCovariance[ 3 ][ 3 ], double rotation[ 3 ][ 3 ] )
+{
+  // Horn's symmetric 4x4 matrix, the eigenvector of its largest eigenvalue is the rotation quaternion
+  double n[ 4 ][ 4 ];
+  n[ 0 ][ 0 ] = crossCovariance[ 0 ][ 0 ] + crossCovariance[ 1 ][ 1 ] + crossCovariance[ 2 ][ 2 ];
+  n[ 0 ][ 1 ] = crossCovariance[ 1 ][ 2 ] - crossCovariance[ 2 ][ 1 ];
+  n[ 0 ][ 2 ] = crossCovariance[ 2 ][ 0 ] - crossCovariance[ 0 ][ 2 ];
+  n[ 0 ][ 3 ] = crossCovariance[ 0 ][ 1 ] - crossCovariance[ 1 ][ 0 ];
+  n[ 1 ][ 1 ] = crossCovariance[ 0 ][ 0 ] - crossCovariance[ 1 ][ 1 ] - crossCovariance[ 2 ][ 2 ];
+  n[ 1 ][ 2 ] = crossCovariance[ 0 ][ 1 ] + crossCovariance[ 1 ][ 0 ];
+  n[ 1 ][ 3 ] = crossCovariance[ 2 ][ 0 ] + crossCovariance[ 0 ][ 2 ];
+  n[ 2 ][ 2 ] = -crossCovariance[ 0 ][ 0 ] + crossCovariance[ 1 ][ 1 ] - crossCovariance[ 2 ][ 2 ];
+  n[ 2 ][ 3 ] = crossCovariance[ 1 ][ 2 ] + crossCovariance[ 2 ][ 1 ];
+  n[ 3 ][ 3 ] = -crossCovariance[ 0 ][ 0 ] - crossCovariance[ 1 ][ 1 ] + crossCovariance[ 2 ][ 2 ];
+  for ( int row = 1; row < 4; row++ )
+  {
+    for ( int column = 0; column < row; column++ )
+    {
+      n[ row ][ column ] = n[ column ][ row ];
+    }
+  }
+
+  // vtkMath::JacobiN does not allocate memory for matrices of this size
+  double eigenvectors[ 4 ][ 4 ];
+  double eigenvalues[ 4 ];
+  double* nRows[ 4 ] = { n[ 0 ], n[ 1 ], n[ 2 ], n[ 3 ] };
+  double* eigenvectorRows[ 4 ] = { eigenvectors[ 0 ], eigenvectors[ 1 ], eigenvectors[ 2 ], eigenvectors[ 3 ] };
+  if ( !vtkMath::JacobiN( nRows, 4, eigenvalues, eigenvectorRows ) )
+  {
+    vtkGenericWarningMacro( "Eigenvector computation did not converge." );
+    return false;
+  }
+
+  // eigenvalues are sorted in decreasing order, eigenvectors are stored in columns
+  double quaternion[ 4 ] = { eigenvectors[ 0 ][ 0 ], eigenvectors[ 1 ][ 0 ], eigenvectors[ 2 ][ 0 ], eigenvectors[ 3 ][ 0 ] };
+  vtkMath::QuaternionToMatrix3x3( quaternion, rotation );
+  return true;
+}
+
 //------------------------------------------------------------------------------
 bool vtkPointMatcher::ComputePointMatchingBasedOnRegistration( vtkAbstractTransform* registration,
                                                                vtkPoints* unmatchedSourcePoints,
@@ -1090,8 +1819,15 @@ bool vtkPointMatcher::ComputePointMatchingBasedOnRegistration( vtkAbstractTransf
 }
 
 //------------------------------------------------------------------------------
-double vtkPointMatcher::ComputeMaximumDistanceInPointSet( vtkPoints* points )
+double vtkPointMatcher::ComputeMaximumDistanceInPointSet( vtkPointDistanceMatrix* pointDistanceMatrix )
 {
+  if ( pointDistanceMatrix == NULL )
+  {
+    vtkGenericWarningMacro( "Point distance matrix is null. Returning 0." );
+    return 0.0;
+  }
+
+  vtkPoints* points = pointDistanceMatrix->GetPointList1();
   if ( points == NULL )
   {
     vtkGenericWarningMacro( "Points are null. Returning 0." );
@@ -1105,9 +1841,6 @@ double vtkPointMatcher::ComputeMaximumDistanceInPointSet( vtkPoints* points )
     return 0.0;
   }
 
-  vtkSmartPointer< vtkPointDistanceMatrix > pointDistanceMatrix = vtkSmartPointer< vtkPointDistanceMatrix >::New();
-  pointDistanceMatrix->SetPointList1( points );
-  pointDistanceMatrix->SetPointList2( points );
   pointDistanceMatrix->Update();
   double maximumDistance = pointDistanceMatrix->GetMaximumDistance();
   return maximumDistance;
@@ -1145,8 +1878,15 @@ void vtkPointMatcher::CopyFirstNPoints( vtkPoints* inputList, vtkPoints* outputL
 }
 
 //------------------------------------------------------------------------------
-void vtkPointMatcher::ReorderPointsAccordingToUniqueGeometry( vtkPoints* inputUnsortedPointList, vtkPoints* outputSortedPointList )
+void vtkPointMatcher::ReorderPointsAccordingToUniqueGeometry( vtkPointDistanceMatrix* inputPointDistanceMatrix, vtkPoints* outputSortedPointList )
 {
+  if ( inputPointDistanceMatrix == NULL )
+  {
+    vtkGenericWarningMacro( "Input point distance matrix is null." );
+    return;
+  }
+
+  vtkPoints* inputUnsortedPointList = inputPointDistanceMatrix->GetPointList1();
   if ( inputUnsortedPointList == NULL )
   {
     vtkGenericWarningMacro( "Input point list is null." );
@@ -1161,7 +1901,7 @@ void vtkPointMatcher::ReorderPointsAccordingToUniqueGeometry( vtkPoints* inputUn
 
   // Figure out which points are the most 'unique'
   vtkSmartPointer< vtkDoubleArray > pointUniquenesses = vtkSmartPointer< vtkDoubleArray >::New();
-  vtkPointMatcher::ComputeUniquenessesForPoints( inputUnsortedPointList, pointUniquenesses );
+  vtkPointMatcher::ComputeUniquenessesForPoints( inputPointDistanceMatrix, pointUniquenesses );
 
   // sanity check
   int numberOfPoints = inputUnsortedPointList->GetNumberOfPoints();
@@ -1198,8 +1938,15 @@ void vtkPointMatcher::ReorderPointsAccordingToUniqueGeometry( vtkPoints* inputUn
 }
 
 //------------------------------------------------------------------------------
-void vtkPointMatcher::ComputeUniquenessesForPoints( vtkPoints* points, vtkDoubleArray* uniquenesses )
+void vtkPointMatcher::ComputeUniquenessesForPoints( vtkPointDistanceMatrix* pointDistanceMatrix, vtkDoubleArray* uniquenesses )
 {
+  if ( pointDistanceMatrix == NULL )
+  {
+    vtkGenericWarningMacro( "Point distance matrix is null." );
+    return;
+  }
+
+  vtkPoints* points = pointDistanceMatrix->GetPointList1(); // distances to self
   if ( points == NULL )
   {
     vtkGenericWarningMacro( "Points are null." );
@@ -1212,9 +1959,6 @@ void vtkPointMatcher::ComputeUniquenessesForPoints( vtkPoints* points, vtkDouble
     return;
   }
 
-  vtkSmartPointer< vtkPointDistanceMatrix > pointDistanceMatrix = vtkSmartPointer< vtkPointDistanceMatrix >::New();
-  pointDistanceMatrix->SetPointList1( points );
-  pointDistanceMatrix->SetPointList2( points ); // distances to self
   pointDistanceMatrix->Update();
 
   vtkSmartPointer< vtkDoubleArray > allDistancesArray = vtkSmartPointer< vtkDoubleArray >::New();
@@ -1275,6 +2019,107 @@ bool vtkPointMatcher::UpdateNeeded()
   return ( this->GetMTime() > this->OutputChangedTime );
 }
 
+//------------------------------------------------------------------------------
+// Descriptor of each point: distances to its nearest neighbors, in increasing order.
+// Each tuple of the output array is the descriptor of the point with the same index.
+void vtkPointMatcher::ComputeNeighborDistanceDescriptors( vtkPoints* points, int numberOfNeighbors, vtkDoubleArray* descriptors )
+{
+  if ( points == NULL )
+  {
+    vtkGenericWarningMacro( "Points are null." );
+    return;
+  }
+
+  if ( descriptors == NULL )
+  {
+    vtkGenericWarningMacro( "Descriptors are null." );
+    return;
+  }
+
+  int numberOfPoints = points->GetNumberOfPoints();
+  descriptors->Reset();
+  descriptors->SetNumberOfComponents( numberOfNeighbors );
+  descriptors->SetNumberOfTuples( numberOfPoints );
+
+  vtkSmartPointer< vtkPolyData > pointsPolyData = vtkSmartPointer< vtkPolyData >::New();
+  vtkPointMatcher::GeneratePolyDataFromPoints( points, pointsPolyData );
+  vtkSmartPointer< vtkPointLocator > pointLocator = vtkSmartPointer< vtkPointLocator >::New();
+  pointLocator->SetDataSet( pointsPolyData );
+  pointLocator->BuildLocator();
+
+  vtkSmartPointer< vtkIdList > neighborPointIds = vtkSmartPointer< vtkIdList >::New();
+  std::vector< double > neighborDistances;
+  for ( int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++ )
+  {
+    double point[ 3 ];
+    points->GetPoint( pointIndex, point );
+    // the closest point is the point itself
+    pointLocator->FindClosestNPoints( numberOfNeighbors + 1, point, neighborPointIds );
+    neighborDistances.clear();
+    for ( vtkIdType neighborIndex = 0; neighborIndex < neighborPointIds->GetNumberOfIds(); neighborIndex++ )
+    {
+      vtkIdType neighborPointId = neighborPointIds->GetId( neighborIndex );
+      if ( neighborPointId == pointIndex )
+      {
+        continue;
+      }
+      double neighborPoint[ 3 ];
+      points->GetPoint( neighborPointId, neighborPoint );
+      neighborDistances.push_back( sqrt( vtkMath::Distance2BetweenPoints( point, neighborPoint ) ) );
+    }
+    std::sort( neighborDistances.begin(), neighborDistances.end() );
+    neighborDistances.resize( numberOfNeighbors, 0.0 );
+    descriptors->SetTypedTuple( pointIndex, neighborDistances.data() );
+  }
+}
+
+//------------------------------------------------------------------------------
+// For each source point, find the target points with the most similar descriptors (smallest sum of absolute differences).
+// Output contains numberOfCandidatesPerPoint target indices for each source point, best candidate first.
+void vtkPointMatcher::FindCandidateMatchesUsingDescriptors( vtkDoubleArray* sourceDescriptors, vtkDoubleArray* targetDescriptors,
+                                                             int numberOfCandidatesPerPoint, std::vector< int >& candidateTargetIndices )
+{
+  if ( sourceDescriptors == NULL || targetDescriptors == NULL )
+  {
+    vtkGenericWarningMacro( "Descriptors are null." );
+    return;
+  }
+
+  int numberOfSourcePoints = sourceDescriptors->GetNumberOfTuples();
+  int numberOfTargetPoints = targetDescriptors->GetNumberOfTuples();
+  int numberOfComponents = sourceDescriptors->GetNumberOfComponents();
+  if ( targetDescriptors->GetNumberOfComponents() != numberOfComponents )
+  {
+    vtkGenericWarningMacro( "Source and target descriptors are of different sizes." );
+    return;
+  }
+  numberOfCandidatesPerPoint = vtkMath::Min( numberOfCandidatesPerPoint, numberOfTargetPoints );
+
+  const double* sourceDescriptorValues = sourceDescriptors->GetPointer( 0 );
+  const double* targetDescriptorValues = targetDescriptors->GetPointer( 0 );
+  candidateTargetIndices.resize( numberOfSourcePoints * numberOfCandidatesPerPoint );
+  std::vector< std::pair< double, int > > descriptorDifferences( numberOfTargetPoints );
+  for ( int sourcePointIndex = 0; sourcePointIndex < numberOfSourcePoints; sourcePointIndex++ )
+  {
+    const double* sourceDescriptor = sourceDescriptorValues + sourcePointIndex * numberOfComponents;
+    for ( int targetPointIndex = 0; targetPointIndex < numberOfTargetPoints; targetPointIndex++ )
+    {
+      const double* targetDescriptor = targetDescriptorValues + targetPointIndex * numberOfComponents;
+      double descriptorDifference = 0.0;
+      for ( int component = 0; component < numberOfComponents; component++ )
+      {
+        descriptorDifference += fabs( sourceDescriptor[ component ] - targetDescriptor[ component ] );
+      }
+      descriptorDifferences[ targetPointIndex ] = std::make_pair( descriptorDifference, targetPointIndex );
+    }
+    std::partial_sort( descriptorDifferences.begin(), descriptorDifferences.begin() + numberOfCandidatesPerPoint, descriptorDifferences.end() );
+    for ( int candidateIndex = 0; candidateIndex < numberOfCandidatesPerPoint; candidateIndex++ )
+    {
+      candidateTargetIndices[ sourcePointIndex * numberOfCandidatesPerPoint + candidateIndex ] = descriptorDifferences[ candidateIndex ].second;
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 bool vtkPointMatcher::GeneratePolyDataFromPoints( vtkPoints* points, vtkPolyData* polyData )
 {
@@ -1348,8 +2193,15 @@ bool vtkPointMatcher::ComputeCentroidOfPoints( vtkPoints* points, double centroi
 }
 
 //------------------------------------------------------------------------------
-bool vtkPointMatcher::ExtractMaximumDistanceAndCentroidFeatures( vtkPoints* points, vtkPoints* features )
+bool vtkPointMatcher::ExtractMaximumDistanceAndCentroidFeatures( vtkPointDistanceMatrix* pointDistanceMatrix, vtkPoints* features )
 {
+  if ( pointDistanceMatrix == NULL )
+  {
+    vtkGenericWarningMacro( "Point distance matrix is null." );
+    return false;
+  }
+
+  vtkPoints* points = pointDistanceMatrix->GetPointList1();
   if ( points == NULL )
   {
     vtkGenericWarningMacro( "Points are null." );
@@ -1369,9 +2221,6 @@ bool vtkPointMatcher::ExtractMaximumDistanceAndCentroidFeatures( vtkPoints* poin
     return false;
   }
 
-  vtkSmartPointer< vtkPointDistanceMatrix > pointDistanceMatrix = vtkSmartPointer< vtkPointDistanceMatrix >::New();
-  pointDistanceMatrix->SetPointList1( points );
-  pointDistanceMatrix->SetPointList2( points );
   pointDistanceMatrix->Update();
   
   // first pair of distances
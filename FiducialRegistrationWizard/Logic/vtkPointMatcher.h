@@ -5,8 +5,12 @@
 #include <vtkTimeStamp.h>
 #include <vtkSmartPointer.h>
 
+#include <atomic>
+#include <vector>
+
 class vtkAbstractTransform;
 class vtkDoubleArray;
+class vtkPointDistanceMatrix;
 class vtkPoints;
 class vtkPolyData;
 
@@ -66,9 +70,27 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkPointMatcher
     bool IsMatchingAmbiguous();
     double GetAmbiguityDistanceError();
 
+    // Number of point orderings for which a registration was computed in the combinatorial search
+    // during the last update. For diagnostics and benchmarking.
+    vtkGetMacro( NumberOfEvaluatedPermutations, vtkIdType );
+
     // Logic
     void Update();
 
+    // Root mean square distance error between the target points and the source points after rigid registration.
+    // Points are paired by index, coordinates are passed as separate x, y, z arrays.
+    // The registration is computed in closed form, using Horn's quaternion method (same as vtkLandmarkTransform
+    // in rigid body mode), without any memory allocation. Intended for scoring of small candidate point sets.
+    // Returns VTK_DOUBLE_MAX if the registration cannot be computed.
+    static double ComputeRigidRegistrationRootMeanSquareError( int numberOfPoints,
+                                                               const double* sourceX, const double* sourceY, const double* sourceZ,
+                                                               const double* targetX, const double* targetY, const double* targetZ );
+
+    // Rotation that best aligns centered source points with centered target points (Horn's quaternion method),
+    // computed from their cross-covariance: crossCovariance[ i ][ j ] = sum of source_i * target_j.
+    // Returns false if the eigenvector computation fails.
+    static bool ComputeRotationFromCrossCovariance( const double crossCovariance[ 3 ][ 3 ], double rotation[ 3 ][ 3 ] );
+
   protected:
     vtkPointMatcher();
     ~vtkPointMatcher();
@@ -77,6 +99,11 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkPointMatcher
     vtkPoints* InputSourcePoints;
     vtkPoints* InputTargetPoints;
 
+    // distances within each input point list, shared by all matching methods.
+    // Kept between updates, so that only distances of changed points need to be recomputed.
+    vtkSmartPointer< vtkPointDistanceMatrix > InputSourceDistanceMatrix;
+    vtkSmartPointer< vtkPointDistanceMatrix > InputTargetDistanceMatrix;
+
     unsigned int MaximumDifferenceInNumberOfPoints;
 
     double TolerableDistanceErrorMultiple; // input by user
@@ -87,6 +114,7 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkPointMatcher
     bool MatchingAmbiguous;
 
     double ComputedDistanceError;
+    vtkIdType NumberOfEvaluatedPermutations;
 
     vtkSmartPointer< vtkPoints > OutputSourcePoints;
     vtkSmartPointer< vtkPoints > OutputTargetPoints;
@@ -107,6 +135,7 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkPointMatcher
     bool MatchPointsGenerallyUsingMaximumDistancesAndCentroid();
     bool MatchPointsGenerallyUsingSubsample( vtkPoints* unmatchedReducedSourcePoints, vtkPoints* unmatchedReducedTargetPoints ); // helper to the functions above
     bool MatchPointsGenerallyUsingICP();
+    bool MatchPointsGenerallyUsingDescriptors(); // for large point sets
 
     void HandleMatchFailure(); // copies input point list to output point list. Used when matching is otherwise impossible.
 
@@ -116,30 +145,40 @@ class VTK_SLICER_FIDUCIALREGISTRATIONWIZARD_MODULE_LOGIC_EXPORT vtkPointMatcher
                                                       vtkPoints* unmatchedPointList1, vtkPoints* unmatchedPointList2,
                                                       double ambiguityDistance, bool& matchingAmbiguous, 
                                                       double& computedDistanceError, double tolerableDistanceError,
+                                                      vtkIdType& numberOfEvaluatedPermutations,
                                                       vtkPoints* outputMatchedPointList1, vtkPoints* outputMatchedPointList2 );
     static void UpdateBestMatchingForNSizedSubsetsOfPoints( int subsetSize,
                                                             vtkPoints* unmatchedPointList1, vtkPoints* unmatchedPointList2,
                                                             double ambiguityDistance, bool& matchingAmbiguous, 
                                                             double& computedDistanceError,
+                                                            vtkIdType& numberOfEvaluatedPermutations,
                                                             vtkPoints* outputMatchedPointList1, vtkPoints* outputMatchedPointList2 );
+    // Distances between the points of each subset are row-major, subset size x subset size
     static void UpdateBestMatchingForSubsetOfPoints( vtkPoints* unmatchedPointList1, vtkPoints* unmatchedPointList2,
+                                                     const double* pointList1Distances, const double* pointList2Distances,
                                                      double ambiguityDistance, bool& matchingAmbiguous, 
                                                      double& computedDistanceError,
+                                                     std::atomic< double >* sharedBestDistanceError, // may be NULL
+                                                     vtkIdType& numberOfEvaluatedPermutations,
                                                      vtkPoints* outputMatchedPointList1, vtkPoints* outputMatchedPointList2 );
+    struct PointAssignmentSearch; // helper for UpdateBestMatchingForSubsetOfPoints
     static void UpdateAmbiguityFlag( double currentDistance, double& bestDistance, double ambiguityDistance, bool& ambiguityFlag );
     static double ComputeRegistrationRootMeanSquareError( vtkPoints* sourcePoints, vtkPoints* targetPoints );
     static bool ComputePointMatchingBasedOnRegistration( vtkAbstractTransform* registration,
                                                          vtkPoints* unmatchedSourcePoints, vtkPoints* unmatchedTargetPoints,
                                                          double thresholdDistance2ForOutlier, unsigned int maximumOutlierCount,
                                                          vtkPoints* matchedSourcePoints, vtkPoints* matchedTargetPoints );
-    static double ComputeMaximumDistanceInPointSet( vtkPoints* points );
+    static double ComputeMaximumDistanceInPointSet( vtkPointDistanceMatrix* pointDistanceMatrix );
     static void CopyFirstNPoints( vtkPoints* inputList, vtkPoints* outputList, int n );
-    static void ReorderPointsAccordingToUniqueGeometry( vtkPoints* inputUnsortedPointList, vtkPoints* outputSortedPointList );
-    static void ComputeUniquenessesForPoints( vtkPoints* points, vtkDoubleArray* uniquenesses );
+    static void ReorderPointsAccordingToUniqueGeometry( vtkPointDistanceMatrix* inputPointDistanceMatrix, vtkPoints* outputSortedPointList );
+    static void ComputeUniquenessesForPoints( vtkPointDistanceMatrix* pointDistanceMatrix, vtkDoubleArray* uniquenesses );
     static double ComputeUniquenessForDistance( double distance, double maximumDistance, vtkDoubleArray* allDistancesArray );
     static bool GeneratePolyDataFromPoints( vtkPoints*, vtkPolyData* );
     static bool ComputeCentroidOfPoints( vtkPoints*, double* centroid );
-    static bool ExtractMaximumDistanceAndCentroidFeatures( vtkPoints* points, vtkPoints* features );
+    static bool ExtractMaximumDistanceAndCentroidFeatures( vtkPointDistanceMatrix* pointDistanceMatrix, vtkPoints* features );
+    static void ComputeNeighborDistanceDescriptors( vtkPoints* points, int numberOfNeighbors, vtkDoubleArray* descriptors );
+    static void FindCandidateMatchesUsingDescriptors( vtkDoubleArray* sourceDescriptors, vtkDoubleArray* targetDescriptors,
+                                                      int numberOfCandidatesPerPoint, std::vector< int >& candidateTargetIndices );
 
     // Not implemented:
 		vtkPointMatcher(const vtkPointMatcher&);
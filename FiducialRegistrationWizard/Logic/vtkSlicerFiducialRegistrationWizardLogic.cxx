@@ -29,28 +29,45 @@
 #include "vtkMRMLTransformNode.h"
 #include "vtkMRMLMarkupsFiducialNode.h"
 #include "vtkMRMLScene.h"
+#include "vtkOrientedGridTransform.h"
 
 // VTK includes
+#include <vtkCollection.h>
 #include <vtkDoubleArray.h>
+#include <vtkGeneralTransform.h>
+#include <vtkImageData.h>
 #include <vtkMath.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
-#include <vtkPCAStatistics.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
-#include <vtkTable.h>
+#include <vtkStringArray.h>
 #include <vtkThinPlateSplineTransform.h>
 #include <vtkTransform.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
 #include <sstream>
+#include <vector>
 
 
 // Helper methods -------------------------------------------------------------------
 
 double EIGENVALUE_THRESHOLD = 1e-4;
 
+// Limits memory usage of warping displacement grids (3 doubles per grid point)
+const vtkIdType MAXIMUM_NUMBER_OF_WARPING_GRID_POINTS = 200 * 200 * 200;
+
+// Automatic point matching parameters
+// Point sets of more than 30 points are matched using local descriptors, which scales well,
+// the maximum number of points only prevents accidentally starting matching of huge point sets.
+const int MAX_NUMBER_OF_POINTS_FOR_POINT_MATCHING_AUTOMATIC = 1000;
+const unsigned int POINT_MATCHING_MAXIMUM_DIFFERENCE_IN_NUMBER_OF_POINTS = 2;
+const double POINT_MATCHING_TOLERABLE_DISTANCE_ERROR_MULTIPLE = 0.05;
+const double POINT_MATCHING_AMBIGUITY_DISTANCE_ERROR_MULTIPLE = 0.025;
+
 //------------------------------------------------------------------------------
 void MarkupsFiducialNodeToVTKPoints(vtkMRMLMarkupsFiducialNode* markupsFiducialNode, vtkPoints* points)
 {
@@ -64,6 +81,82 @@ void MarkupsFiducialNodeToVTKPoints(vtkMRMLMarkupsFiducialNode* markupsFiducialN
 }
 
 
+//------------------------------------------------------------------------------
+// Returns true if the points are collinear or singular:
+// at most one eigenvalue of the sample covariance matrix is above the threshold.
+bool IsCovarianceCollinear(int numberOfPoints, const double sum[3], const double sumOfProducts[3][3])
+{
+  double covariance[3][3];
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      covariance[i][j] = (sumOfProducts[i][j] - sum[i] * sum[j] / numberOfPoints) / (numberOfPoints - 1);
+    }
+  }
+  double eigenvalues[3];
+  double eigenvectors[3][3];
+  vtkMath::Diagonalize3x3(covariance, eigenvalues, eigenvectors);
+  int goodEigenvalues = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    if (fabs(eigenvalues[i]) > EIGENVALUE_THRESHOLD)
+    {
+      goodEigenvalues++;
+    }
+  }
+  return (goodEigenvalues <= 1);
+}
+
+//------------------------------------------------------------------------------
+// Computes the affine component of a thin-plate spline transform with R basis.
+// The non-affine part of the spline (sum of w_i * |x - p_i|, where the sum of w_i and of w_i * p_i is zero)
+// cancels out in the difference of two points that are placed symmetrically at a large distance D
+// from the landmarks, up to an O(1/D^3) error, so the linear part is computed from such differences.
+// The translation is computed from the mean of the same points, its error is O(1/D).
+void ComputeThinPlateSplineAffineComponent(vtkThinPlateSplineTransform* tpsTransform, vtkMatrix4x4* affineMatrix)
+{
+  double bounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  tpsTransform->GetSourceLandmarks()->GetBounds(bounds);
+  double center[3] = { 0.0, 0.0, 0.0 };
+  double size = 0.0;
+  for (int i = 0; i < 3; i++)
+  {
+    center[i] = 0.5 * (bounds[2 * i] + bounds[2 * i + 1]);
+    size = std::max(size, bounds[2 * i + 1] - bounds[2 * i]);
+  }
+  const double distance = 1.0e6 * (size + 1.0);
+
+  affineMatrix->Identity();
+  double transformedCenter[3] = { 0.0, 0.0, 0.0 };
+  for (int axis = 0; axis < 3; axis++)
+  {
+    double positivePoint[3] = { center[0], center[1], center[2] };
+    double negativePoint[3] = { center[0], center[1], center[2] };
+    positivePoint[axis] += distance;
+    negativePoint[axis] -= distance;
+    double transformedPositivePoint[3] = { 0.0, 0.0, 0.0 };
+    double transformedNegativePoint[3] = { 0.0, 0.0, 0.0 };
+    tpsTransform->TransformPoint(positivePoint, transformedPositivePoint);
+    tpsTransform->TransformPoint(negativePoint, transformedNegativePoint);
+    for (int row = 0; row < 3; row++)
+    {
+      affineMatrix->SetElement(row, axis, (transformedPositivePoint[row] - transformedNegativePoint[row]) / (2.0 * distance));
+      transformedCenter[row] += (transformedPositivePoint[row] + transformedNegativePoint[row]) / 6.0;
+    }
+  }
+  for (int row = 0; row < 3; row++)
+  {
+    double translation = transformedCenter[row];
+    for (int column = 0; column < 3; column++)
+    {
+      translation -= affineMatrix->GetElement(row, column) * center[column];
+    }
+    affineMatrix->SetElement(row, 3, translation);
+  }
+}
+
+
 // Slicer methods -------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkSlicerFiducialRegistrationWizardLogic);
@@ -71,6 +164,8 @@ vtkStandardNewMacro(vtkSlicerFiducialRegistrationWizardLogic);
 //------------------------------------------------------------------------------
 vtkSlicerFiducialRegistrationWizardLogic::vtkSlicerFiducialRegistrationWizardLogic()
   : MarkupsLogic(NULL)
+  , NumberOfIncrementalCalibrationUpdates(0)
+  , NumberOfCompleteCalibrationUpdates(0)
 {
 }
 
@@ -83,6 +178,8 @@ vtkSlicerFiducialRegistrationWizardLogic::~vtkSlicerFiducialRegistrationWizardLo
 void vtkSlicerFiducialRegistrationWizardLogic::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfIncrementalCalibrationUpdates: " << this->NumberOfIncrementalCalibrationUpdates << std::endl;
+  os << indent << "NumberOfCompleteCalibrationUpdates: " << this->NumberOfCompleteCalibrationUpdates << std::endl;
 }
 
 //------------------------------------------------------------------------------
@@ -150,6 +247,7 @@ void vtkSlicerFiducialRegistrationWizardLogic::OnMRMLSceneNodeRemoved(vtkMRMLNod
   {
     vtkDebugMacro("OnMRMLSceneNodeRemoved");
     vtkUnObserveMRMLNodeMacro(node);
+    this->IncrementalRegistrationStates.erase(vtkMRMLFiducialRegistrationWizardNode::SafeDownCast(node));
   }
 }
 
@@ -249,8 +347,13 @@ bool vtkSlicerFiducialRegistrationWizardLogic::UpdateCalibration(vtkMRMLNode* no
     return false;
   }
 
-  // if we get up to here without errors, clear the status message to prepare it for future contents:
-  fiducialRegistrationWizardNode->ClearCalibrationStatusMessage();
+  // if only a single point pair is changed since the last registration then there is no need to recompute everything
+  if (this->UpdateCalibrationIncrementally(fiducialRegistrationWizardNode))
+  {
+    this->NumberOfIncrementalCalibrationUpdates++;
+    return true;
+  }
+  this->NumberOfCompleteCalibrationUpdates++;
 
   // Convert the markupsfiducial nodes into vtk points
   vtkSmartPointer< vtkPoints > fromPointsUnordered = vtkSmartPointer< vtkPoints >::New();
@@ -258,223 +361,736 @@ bool vtkSlicerFiducialRegistrationWizardLogic::UpdateCalibration(vtkMRMLNode* no
   vtkSmartPointer< vtkPoints > toPointsUnordered = vtkSmartPointer< vtkPoints >::New();
   MarkupsFiducialNodeToVTKPoints(toMarkupsFiducialNode, toPointsUnordered);
 
-  // Determine the order of points and store an "ordered" version of the "To" list
-  vtkSmartPointer< vtkPoints > fromPointsOrdered = NULL; // temporary value
-  vtkSmartPointer< vtkPoints > toPointsOrdered = NULL; // temporary value
-  int pointMatching = fiducialRegistrationWizardNode->GetPointMatching();
-  if (pointMatching == vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_MANUAL)
+  // Determine the order of points and check that the ordered point lists can be registered
+  int registrationMode = fiducialRegistrationWizardNode->GetRegistrationMode();
+  vtkSmartPointer< vtkPoints > fromPointsOrdered;
+  vtkSmartPointer< vtkPoints > toPointsOrdered;
+  std::string statusMessage;
+  bool pointsOrdered = vtkSlicerFiducialRegistrationWizardLogic::ComputeOrderedPoints(fromPointsUnordered, toPointsUnordered,
+    registrationMode, fiducialRegistrationWizardNode->GetPointMatching(), fromPointsOrdered, toPointsOrdered, statusMessage);
+  fiducialRegistrationWizardNode->SetCalibrationStatusMessage(statusMessage);
+  if (!pointsOrdered)
   {
-    if (fromMarkupsFiducialNode->GetNumberOfControlPoints() != toMarkupsFiducialNode->GetNumberOfControlPoints())
-    {
-      std::string msg = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-        "Fiducial lists have unequal number of fiducials ('From' has %1, 'To' has %2)."
-        " Either adjust the lists, or use automatic point matching. Aborting registration."),
-        std::to_string(fromMarkupsFiducialNode->GetNumberOfControlPoints()).c_str(),
-        std::to_string(toMarkupsFiducialNode->GetNumberOfControlPoints()).c_str());
-      fiducialRegistrationWizardNode->SetCalibrationStatusMessage(msg);
-      return false;
-    }
-    fromPointsOrdered = fromPointsUnordered;
-    toPointsOrdered = toPointsUnordered;
+    return false;
   }
-  else if (pointMatching == vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_AUTOMATIC)
+
+  // compute registration
+  if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_RIGID ||
+    registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY)
   {
-    int registrationMode = fiducialRegistrationWizardNode->GetRegistrationMode();
-    if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY ||
-      registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_WARPING)
-    {
-      std::string msg = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-        "Automatic point matching is currently supported only for rigid registration."
-        " Currently %1 registration is being used. Unexpected results may occur."),
-        fiducialRegistrationWizardNode->RegistrationModeAsString(registrationMode).c_str());
-      fiducialRegistrationWizardNode->SetCalibrationStatusMessage(msg);
-    }
-    const int MAX_NUMBER_OF_POINTS_FOR_POINT_MATCHING_AUTOMATIC = 30; // more than this and it tends to take a long time. Algorithm is at least N!
-    int fromNumberOfPoints = fromPointsUnordered->GetNumberOfPoints();
-    int toNumberOfPoints = toPointsUnordered->GetNumberOfPoints();
-    int numberOfPointsToMatch = std::max(fromNumberOfPoints, toNumberOfPoints);
-    if (numberOfPointsToMatch > MAX_NUMBER_OF_POINTS_FOR_POINT_MATCHING_AUTOMATIC)
+    // Compute transformation matrix. We don't set the landmark transform in the node directly because
+    // vtkLandmarkTransform is not fully supported (e.g., it cannot be stored in file).
+    vtkNew< vtkMatrix4x4 > calculatedTransform;
+    vtkSlicerFiducialRegistrationWizardLogic::ComputeLandmarkRegistrationMatrix(fromPointsOrdered, toPointsOrdered,
+      registrationMode, calculatedTransform.GetPointer());
+    this->SetOutputTransformMatrix(outputTransformNode, calculatedTransform.GetPointer());
+  }
+  else if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_WARPING)
+  {
+    if (strcmp(outputTransformNode->GetClassName(), "vtkMRMLTransformNode") != 0)
     {
-      std::string msg = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-        "Too many points to compute point pairing %1."
-        " To avoid long computation time, there should be at most %2 points."
-        " Aborting registration."),
-        std::to_string(numberOfPointsToMatch).c_str(),
-        std::to_string(MAX_NUMBER_OF_POINTS_FOR_POINT_MATCHING_AUTOMATIC).c_str());
-      fiducialRegistrationWizardNode->AddToCalibrationStatusMessage(msg);
+      vtkErrorMacro("vtkSlicerFiducialRegistrationWizardLogic::UpdateCalibration failed to save vtkThinPlateSplineTransform into transform node type " << outputTransformNode->GetClassName());
+      fiducialRegistrationWizardNode->SetCalibrationStatusMessage(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
+        "Warping transform cannot be stored\nin linear transform node"));
       return false;
     }
-    vtkSmartPointer< vtkPointMatcher > pointMatcher = vtkSmartPointer< vtkPointMatcher >::New();
-    pointMatcher->SetInputSourcePoints(fromPointsUnordered);
-    pointMatcher->SetInputTargetPoints(toPointsUnordered);
-    pointMatcher->SetMaximumDifferenceInNumberOfPoints(2);
-    pointMatcher->SetTolerableDistanceErrorMultiple(0.05);
-    pointMatcher->SetAmbiguityDistanceErrorMultiple(0.025);
-    pointMatcher->Update();
-    if (!pointMatcher->IsMatchingWithinTolerance())
+
+    double warpingGridSpacing = fiducialRegistrationWizardNode->GetWarpingGridSpacing();
+    if (warpingGridSpacing > 0.0)
     {
-      std::string msg = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-        "Could not find a good mapping."
-        " Mean squared distance error was %1, but tolerance is %2."
-        " Results are not expected to be accurate."),
-        std::to_string(pointMatcher->GetComputedDistanceError()).c_str(),
-        std::to_string(pointMatcher->GetTolerableDistanceError()).c_str());
-      fiducialRegistrationWizardNode->AddToCalibrationStatusMessage(msg);
+      // Thin-plate spline is only used for computing the displacement grid, it is not stored in the node
+      vtkNew< vtkThinPlateSplineTransform > tpsTransform;
+      tpsTransform->SetBasisToR();
+      vtkNew< vtkGeneralTransform > warpingTransform;
+      if (fiducialRegistrationWizardNode->GetWarpingTransformFromParent())
+      {
+        tpsTransform->SetSourceLandmarks(toPointsOrdered);
+        tpsTransform->SetTargetLandmarks(fromPointsOrdered);
+      }
+      else
+      {
+        tpsTransform->SetSourceLandmarks(fromPointsOrdered);
+        tpsTransform->SetTargetLandmarks(toPointsOrdered);
+      }
+      if (!vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform(tpsTransform.GetPointer(),
+        warpingGridSpacing, fiducialRegistrationWizardNode->GetWarpingGridMargin(), warpingTransform.GetPointer()))
+      {
+        fiducialRegistrationWizardNode->SetCalibrationStatusMessage(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
+          "Failed to compute warping displacement grid. Increase the grid spacing or decrease the grid margin."));
+        return false;
+      }
+      if (fiducialRegistrationWizardNode->GetWarpingTransformFromParent())
+      {
+        outputTransformNode->SetAndObserveTransformFromParent(warpingTransform.GetPointer());
+      }
+      else
+      {
+        outputTransformNode->SetAndObserveTransformToParent(warpingTransform.GetPointer());
+      }
     }
-    if (pointMatcher->IsMatchingAmbiguous())
+    else
     {
-      std::string msg = vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-        "The 'best' point matching is reported as ambiguous and may be incorrect."
-        " This could happen because the point geometry is symmetric."
-        " Results are not necessarily expected to be accurate.");
-      fiducialRegistrationWizardNode->AddToCalibrationStatusMessage(msg);
+      // Setup the transform
+      // Warping transforms are usually defined using FromParent direction to make transformation of images faster and more accurate.
+      bool logErrorIfFails = false; // parameters from http://apidocs.slicer.org/master/classvtkMRMLTransformNode.html#a79e612958c341ea681ac84282df42261
+      bool modifiableOnly = true;
+      vtkThinPlateSplineTransform* tpsTransform = NULL;
+      if (fiducialRegistrationWizardNode->GetWarpingTransformFromParent())
+      {
+        tpsTransform = vtkThinPlateSplineTransform::SafeDownCast(
+          outputTransformNode->GetTransformFromParentAs("vtkThinPlateSplineTransform", logErrorIfFails, modifiableOnly));
+      }
+      else
+      {
+        tpsTransform = vtkThinPlateSplineTransform::SafeDownCast(
+          outputTransformNode->GetTransformToParentAs("vtkThinPlateSplineTransform", logErrorIfFails, modifiableOnly));
+      }
+      if (tpsTransform == NULL)
+      {
+        // we cannot reuse the existing transform, create a new one
+        vtkNew< vtkThinPlateSplineTransform > newTpsTransform;
+        newTpsTransform->SetBasisToR();
+        tpsTransform = newTpsTransform.GetPointer();
+        if (fiducialRegistrationWizardNode->GetWarpingTransformFromParent())
+        {
+          outputTransformNode->SetAndObserveTransformFromParent(tpsTransform);
+        }
+        else
+        {
+          outputTransformNode->SetAndObserveTransformToParent(tpsTransform);
+        }
+      }
+      // Set inputs
+      if (fiducialRegistrationWizardNode->GetWarpingTransformFromParent())
+      {
+        tpsTransform->SetSourceLandmarks(toPointsOrdered);
+        tpsTransform->SetTargetLandmarks(fromPointsOrdered);
+      }
+      else
+      {
+        tpsTransform->SetSourceLandmarks(fromPointsOrdered);
+        tpsTransform->SetTargetLandmarks(toPointsOrdered);
+      }
+      tpsTransform->Update();
     }
-    fromPointsOrdered = pointMatcher->GetOutputSourcePoints();
-    toPointsOrdered = pointMatcher->GetOutputTargetPoints();
   }
   else
   {
-    std::string msg = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-      "Unrecognized point matching method: %1. Aborting registration."),
-      vtkMRMLFiducialRegistrationWizardNode::PointMatchingAsString(pointMatching).c_str());
-    fiducialRegistrationWizardNode->AddToCalibrationStatusMessage(msg);
+    vtkErrorMacro("vtkSlicerFiducialRegistrationWizardLogic::UpdateCalibration failed to set transform type: " <<
+      "invalid registration mode: " << vtkMRMLFiducialRegistrationWizardNode::RegistrationModeAsString(registrationMode));
+    fiducialRegistrationWizardNode->SetCalibrationStatusMessage(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic","Invalid transform type."));
     return false;
   }
 
-  // error checking
-  if (this->CheckCollinear(fromPointsOrdered))
+  vtkAbstractTransform* outputTransform = outputTransformNode->GetTransformToParent();
+  if (outputTransform == NULL)
   {
+    vtkErrorMacro("Failed to retreive transform from node. RMS Error could not be evaluated");
     fiducialRegistrationWizardNode->SetCalibrationStatusMessage(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-      "'From' fiducial list has strictly collinear or singular points."));
+      "Failed to retreive transform from node. RMS Error could not be evaluated."));
     return false;
   }
 
-  if (this->CheckCollinear(toPointsOrdered))
+  double rmsError = vtkSlicerFiducialRegistrationWizardLogic::CalculateRegistrationError(fromPointsOrdered, toPointsOrdered, outputTransform);
+  std::string completeMessage = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "Registration Complete. RMS Error: %1."),
+    std::to_string(rmsError).c_str());
+
+  fiducialRegistrationWizardNode->AddToCalibrationStatusMessage(completeMessage);
+  fiducialRegistrationWizardNode->SetCalibrationError( rmsError );
+#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
+  outputTransformNode->SetNodeReferenceID(vtkMRMLTransformNode::GetMovingNodeReferenceRole(), fromMarkupsFiducialNode->GetID());
+  outputTransformNode->SetNodeReferenceID(vtkMRMLTransformNode::GetFixedNodeReferenceRole(), toMarkupsFiducialNode->GetID());
+#endif 
+  this->UpdateIncrementalRegistrationState(fiducialRegistrationWizardNode, fromPointsOrdered, toPointsOrdered);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerFiducialRegistrationWizardLogic::SetOutputTransformMatrix(vtkMRMLTransformNode* outputTransformNode, vtkMatrix4x4* matrix)
+{
+  // Copy the resulting transform into the outputTransformNode
+  if (!outputTransformNode->IsLinear())
+  {
+    // SetMatrix... only works on linear transforms, if we have a non-linear transform
+    // in the node then we have to manually place a linear transform into it
+    vtkNew< vtkTransform > newLinearTransform;
+    newLinearTransform->SetMatrix(matrix);
+    outputTransformNode->SetAndObserveTransformToParent(newLinearTransform.GetPointer());
+  }
+  else
+  {
+    outputTransformNode->SetMatrixTransformToParent(matrix);
+  }
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerFiducialRegistrationWizardLogic::AddPointPairToRegistrationState(IncrementalRegistrationState& state,
+  const double* fromPoint, const double* toPoint, double weight)
+{
+  double from[3] = { fromPoint[0] - state.FromOrigin[0], fromPoint[1] - state.FromOrigin[1], fromPoint[2] - state.FromOrigin[2] };
+  double to[3] = { toPoint[0] - state.ToOrigin[0], toPoint[1] - state.ToOrigin[1], toPoint[2] - state.ToOrigin[2] };
+  for (int i = 0; i < 3; i++)
+  {
+    state.FromSum[i] += weight * from[i];
+    state.ToSum[i] += weight * to[i];
+    for (int j = 0; j < 3; j++)
+    {
+      state.FromSumOfProducts[i][j] += weight * from[i] * from[j];
+      state.ToSumOfProducts[i][j] += weight * to[i] * to[j];
+      state.CrossSumOfProducts[i][j] += weight * from[i] * to[j];
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+void vtkSlicerFiducialRegistrationWizardLogic::UpdateIncrementalRegistrationState(vtkMRMLFiducialRegistrationWizardNode* fiducialRegistrationWizardNode,
+  vtkPoints* fromPointsOrdered, vtkPoints* toPointsOrdered)
+{
+  // further point modifications are tracked relative to the points of this registration
+  fiducialRegistrationWizardNode->ResetControlPointModifications();
+
+  int registrationMode = fiducialRegistrationWizardNode->GetRegistrationMode();
+  if (fiducialRegistrationWizardNode->GetPointMatching() != vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_MANUAL
+    || (registrationMode != vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_RIGID
+    && registrationMode != vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY))
+  {
+    // incremental update is not supported
+    this->IncrementalRegistrationStates.erase(fiducialRegistrationWizardNode);
+    return;
+  }
+
+  IncrementalRegistrationState& state = this->IncrementalRegistrationStates[fiducialRegistrationWizardNode];
+  state.FromFiducialListNode = fiducialRegistrationWizardNode->GetFromFiducialListNode();
+  state.ToFiducialListNode = fiducialRegistrationWizardNode->GetToFiducialListNode();
+  state.OutputTransformNode = fiducialRegistrationWizardNode->GetOutputTransformNode();
+  state.RegistrationMode = registrationMode;
+
+  int numberOfPoints = fromPointsOrdered->GetNumberOfPoints();
+  state.FromPoints.resize(3 * numberOfPoints);
+  state.ToPoints.resize(3 * numberOfPoints);
+  for (int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++)
+  {
+    fromPointsOrdered->GetPoint(pointIndex, &state.FromPoints[3 * pointIndex]);
+    toPointsOrdered->GetPoint(pointIndex, &state.ToPoints[3 * pointIndex]);
+  }
+
+  // recompute all sums (this also removes rounding errors accumulated during incremental updates)
+  for (int i = 0; i < 3; i++)
+  {
+    state.FromOrigin[i] = state.FromPoints[i];
+    state.ToOrigin[i] = state.ToPoints[i];
+    state.FromSum[i] = 0.0;
+    state.ToSum[i] = 0.0;
+    for (int j = 0; j < 3; j++)
+    {
+      state.FromSumOfProducts[i][j] = 0.0;
+      state.ToSumOfProducts[i][j] = 0.0;
+      state.CrossSumOfProducts[i][j] = 0.0;
+    }
+  }
+  for (int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++)
+  {
+    vtkSlicerFiducialRegistrationWizardLogic::AddPointPairToRegistrationState(state, &state.FromPoints[3 * pointIndex], &state.ToPoints[3 * pointIndex], 1.0);
+  }
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerFiducialRegistrationWizardLogic::UpdateCalibrationIncrementally(vtkMRMLFiducialRegistrationWizardNode* fiducialRegistrationWizardNode)
+{
+  std::map< vtkMRMLFiducialRegistrationWizardNode*, IncrementalRegistrationState >::iterator stateIt =
+    this->IncrementalRegistrationStates.find(fiducialRegistrationWizardNode);
+  if (stateIt == this->IncrementalRegistrationStates.end())
   {
-    fiducialRegistrationWizardNode->SetCalibrationStatusMessage(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-      "'To' fiducial list has strictly collinear or singular points."));
     return false;
   }
+  IncrementalRegistrationState& state = stateIt->second;
 
-  // compute registration
+  vtkMRMLMarkupsFiducialNode* fromMarkupsFiducialNode = fiducialRegistrationWizardNode->GetFromFiducialListNode();
+  vtkMRMLMarkupsFiducialNode* toMarkupsFiducialNode = fiducialRegistrationWizardNode->GetToFiducialListNode();
+  vtkMRMLTransformNode* outputTransformNode = fiducialRegistrationWizardNode->GetOutputTransformNode();
   int registrationMode = fiducialRegistrationWizardNode->GetRegistrationMode();
-  if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_RIGID ||
-    registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY)
+  if (fiducialRegistrationWizardNode->GetPointMatching() != vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_MANUAL
+    || registrationMode != state.RegistrationMode
+    || fromMarkupsFiducialNode != state.FromFiducialListNode
+    || toMarkupsFiducialNode != state.ToFiducialListNode
+    || outputTransformNode != state.OutputTransformNode)
   {
-    // Compute transformation matrix. We don't set the landmark transform in the node directly because
-    // vtkLandmarkTransform is not fully supported (e.g., it cannot be stored in file).
-    vtkNew<vtkLandmarkTransform> landmarkTransform;
-    landmarkTransform->SetSourceLandmarks(fromPointsOrdered);
-    landmarkTransform->SetTargetLandmarks(toPointsOrdered);
-    if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_RIGID)
+    return false;
+  }
+
+  // The node keeps track of which point pair is changed, so points do not need to be compared.
+  // Only a single modified or appended point pair can be handled incrementally.
+  int changedPointIndex = -1;
+  if (!fiducialRegistrationWizardNode->GetSingleModifiedControlPointIndex(changedPointIndex))
+  {
+    return false;
+  }
+  int previousNumberOfPoints = state.FromPoints.size() / 3;
+  int numberOfPoints = fromMarkupsFiducialNode->GetNumberOfControlPoints();
+  if (toMarkupsFiducialNode->GetNumberOfControlPoints() != numberOfPoints)
+  {
+    return false;
+  }
+  if (numberOfPoints == previousNumberOfPoints + 1)
+  {
+    if (changedPointIndex != previousNumberOfPoints)
+    {
+      return false;
+    }
+  }
+  else if (numberOfPoints != previousNumberOfPoints || changedPointIndex >= numberOfPoints)
+  {
+    return false;
+  }
+
+  // update the sums
+  if (changedPointIndex >= 0)
+  {
+    if (changedPointIndex < previousNumberOfPoints)
     {
-      landmarkTransform->SetModeToRigidBody();
+      vtkSlicerFiducialRegistrationWizardLogic::AddPointPairToRegistrationState(state,
+        &state.FromPoints[3 * changedPointIndex], &state.ToPoints[3 * changedPointIndex], -1.0);
     }
     else
     {
-      landmarkTransform->SetModeToSimilarity();
+      state.FromPoints.resize(3 * numberOfPoints);
+      state.ToPoints.resize(3 * numberOfPoints);
     }
-    landmarkTransform->Update();
-    vtkNew< vtkMatrix4x4 > calculatedTransform;
-    landmarkTransform->GetMatrix(calculatedTransform.GetPointer());
+    fromMarkupsFiducialNode->GetNthControlPointPosition(changedPointIndex, &state.FromPoints[3 * changedPointIndex]);
+    toMarkupsFiducialNode->GetNthControlPointPosition(changedPointIndex, &state.ToPoints[3 * changedPointIndex]);
+    vtkSlicerFiducialRegistrationWizardLogic::AddPointPairToRegistrationState(state,
+      &state.FromPoints[3 * changedPointIndex], &state.ToPoints[3 * changedPointIndex], 1.0);
+  }
+  fiducialRegistrationWizardNode->ResetControlPointModifications();
 
-    // Copy the resulting transform into the outputTransformNode
-    if (!outputTransformNode->IsLinear())
+  if (IsCovarianceCollinear(numberOfPoints, state.FromSum, state.FromSumOfProducts)
+    || IsCovarianceCollinear(numberOfPoints, state.ToSum, state.ToSumOfProducts))
+  {
+    // the complete update reports the problem
+    this->IncrementalRegistrationStates.erase(stateIt);
+    return false;
+  }
+
+  // centered sums
+  double fromCentroid[3] = { 0.0, 0.0, 0.0 };
+  double toCentroid[3] = { 0.0, 0.0, 0.0 };
+  for (int i = 0; i < 3; i++)
+  {
+    fromCentroid[i] = state.FromSum[i] / numberOfPoints;
+    toCentroid[i] = state.ToSum[i] / numberOfPoints;
+  }
+  double crossCovariance[3][3];
+  double fromSumOfSquares = 0.0;
+  double toSumOfSquares = 0.0;
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++)
     {
-      // SetMatrix... only works on linear transforms, if we have a non-linear transform
-      // in the node then we have to manually place a linear transform into it
-      vtkNew< vtkTransform > newLinearTransform;
-      newLinearTransform->SetMatrix(calculatedTransform.GetPointer());
-      outputTransformNode->SetAndObserveTransformToParent(newLinearTransform.GetPointer());
+      crossCovariance[i][j] = state.CrossSumOfProducts[i][j] - numberOfPoints * fromCentroid[i] * toCentroid[j];
     }
-    else
+    fromSumOfSquares += state.FromSumOfProducts[i][i] - numberOfPoints * fromCentroid[i] * fromCentroid[i];
+    toSumOfSquares += state.ToSumOfProducts[i][i] - numberOfPoints * toCentroid[i] * toCentroid[i];
+  }
+
+  // same solution as vtkLandmarkTransform
+  double rotation[3][3];
+  if (!vtkPointMatcher::ComputeRotationFromCrossCovariance(crossCovariance, rotation))
+  {
+    // the complete update reports the problem
+    this->IncrementalRegistrationStates.erase(stateIt);
+    return false;
+  }
+  double scale = 1.0;
+  if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY && fromSumOfSquares > 0.0)
+  {
+    scale = sqrt(toSumOfSquares / fromSumOfSquares);
+  }
+  vtkNew< vtkMatrix4x4 > calculatedTransform;
+  for (int i = 0; i < 3; i++)
+  {
+    double translation = state.ToOrigin[i] + toCentroid[i];
+    for (int j = 0; j < 3; j++)
     {
-      outputTransformNode->SetMatrixTransformToParent(calculatedTransform.GetPointer());
+      calculatedTransform->SetElement(i, j, scale * rotation[i][j]);
+      translation -= scale * rotation[i][j] * (state.FromOrigin[j] + fromCentroid[j]);
     }
+    calculatedTransform->SetElement(i, 3, translation);
   }
-  else if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_WARPING)
+
+  // sum of squared residuals: scale^2 * sum |from|^2 + sum |to|^2 - 2 * scale * sum( to . rotation * from ), for centered points
+  double rotatedCrossCovarianceTrace = 0.0;
+  for (int i = 0; i < 3; i++)
   {
-    if (strcmp(outputTransformNode->GetClassName(), "vtkMRMLTransformNode") != 0)
+    for (int j = 0; j < 3; j++)
     {
-      vtkErrorMacro("vtkSlicerFiducialRegistrationWizardLogic::UpdateCalibration failed to save vtkThinPlateSplineTransform into transform node type " << outputTransformNode->GetClassName());
-      fiducialRegistrationWizardNode->SetCalibrationStatusMessage(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-        "Warping transform cannot be stored\nin linear transform node"));
-      return false;
+      rotatedCrossCovarianceTrace += rotation[i][j] * crossCovariance[j][i];
     }
+  }
+  double sumOfSquaredErrors = scale * scale * fromSumOfSquares + toSumOfSquares - 2.0 * scale * rotatedCrossCovarianceTrace;
+  double rmsError = sqrt(std::max(sumOfSquaredErrors, 0.0) / numberOfPoints);
+
+  fiducialRegistrationWizardNode->ClearCalibrationStatusMessage();
+  this->SetOutputTransformMatrix(outputTransformNode, calculatedTransform.GetPointer());
+  std::string completeMessage = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "Registration Complete. RMS Error: %1."),
+    std::to_string(rmsError).c_str());
+  fiducialRegistrationWizardNode->AddToCalibrationStatusMessage(completeMessage);
+  fiducialRegistrationWizardNode->SetCalibrationError(rmsError);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform(vtkThinPlateSplineTransform* tpsTransform,
+  double gridSpacing, double gridMargin, vtkGeneralTransform* outputTransform)
+{
+  if (tpsTransform == NULL || outputTransform == NULL)
+  {
+    vtkGenericWarningMacro("vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform failed: invalid input or output transform");
+    return false;
+  }
+  vtkPoints* sourceLandmarks = tpsTransform->GetSourceLandmarks();
+  if (sourceLandmarks == NULL || sourceLandmarks->GetNumberOfPoints() == 0)
+  {
+    vtkGenericWarningMacro("vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform failed: no source landmarks");
+    return false;
+  }
+  if (gridSpacing <= 0.0)
+  {
+    vtkGenericWarningMacro("vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform failed: invalid grid spacing " << gridSpacing);
+    return false;
+  }
+  if (tpsTransform->GetBasis() != VTK_RBF_R)
+  {
+    // with other basis functions the spline does not converge to its affine component far from the landmarks
+    vtkGenericWarningMacro("vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform failed: only R basis is supported");
+    return false;
+  }
+
+  // The affine component is applied after the grid, so that it is also applied outside of the grid.
+  // The grid contains the displacement that remains after the inverse of the affine component is applied.
+  vtkNew< vtkMatrix4x4 > affineMatrix;
+  ComputeThinPlateSplineAffineComponent(tpsTransform, affineMatrix.GetPointer());
+  vtkNew< vtkMatrix4x4 > inverseAffineMatrix;
+  if (fabs(affineMatrix->Determinant()) < 1.0e-6)
+  {
+    vtkGenericWarningMacro("vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform failed: affine component of the spline is singular");
+    return false;
+  }
+  vtkMatrix4x4::Invert(affineMatrix.GetPointer(), inverseAffineMatrix.GetPointer());
+  double inverseAffineElements[16];
+  vtkMatrix4x4::DeepCopy(inverseAffineElements, inverseAffineMatrix.GetPointer());
+
+  // Grid covers the region around the source landmarks
+  double bounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  sourceLandmarks->GetBounds(bounds);
+  double origin[3] = { 0.0, 0.0, 0.0 };
+  int dimensions[3] = { 0, 0, 0 };
+  vtkIdType numberOfGridPoints = 1;
+  for (int i = 0; i < 3; i++)
+  {
+    origin[i] = bounds[2 * i] - gridMargin;
+    double size = bounds[2 * i + 1] - bounds[2 * i] + 2.0 * gridMargin;
+    dimensions[i] = static_cast<int>(ceil(std::max(size, 0.0) / gridSpacing)) + 1;
+    numberOfGridPoints *= dimensions[i];
+  }
+  if (numberOfGridPoints > MAXIMUM_NUMBER_OF_WARPING_GRID_POINTS)
+  {
+    vtkGenericWarningMacro("vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform failed: grid would contain "
+      << numberOfGridPoints << " points, maximum is " << MAXIMUM_NUMBER_OF_WARPING_GRID_POINTS << ". Increase grid spacing.");
+    return false;
+  }
 
-    // Setup the transform
-    // Warping transforms are usually defined using FromParent direction to make transformation of images faster and more accurate.
-    bool logErrorIfFails = false; // parameters from http://apidocs.slicer.org/master/classvtkMRMLTransformNode.html#a79e612958c341ea681ac84282df42261
-    bool modifiableOnly = true;
-    vtkThinPlateSplineTransform* tpsTransform = NULL;
-    if (fiducialRegistrationWizardNode->GetWarpingTransformFromParent())
+  vtkNew< vtkImageData > displacementGrid;
+  displacementGrid->SetOrigin(origin);
+  displacementGrid->SetSpacing(gridSpacing, gridSpacing, gridSpacing);
+  displacementGrid->SetDimensions(dimensions);
+  displacementGrid->AllocateScalars(VTK_DOUBLE, 3);
+  double* displacements = static_cast< double* >(displacementGrid->GetScalarPointer());
+
+  // Evaluation of the thin-plate spline takes time proportional to the number of landmarks,
+  // but grid points are independent from each other, so they are computed in parallel.
+  // InternalTransformPoint does not modify the transform, but it requires the transform to be up-to-date.
+  tpsTransform->Update();
+  vtkSMPTools::For(0, numberOfGridPoints, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType gridPointIndex = begin; gridPointIndex < end; gridPointIndex++)
     {
-      tpsTransform = vtkThinPlateSplineTransform::SafeDownCast(
-        outputTransformNode->GetTransformFromParentAs("vtkThinPlateSplineTransform", logErrorIfFails, modifiableOnly));
+      vtkIdType gridPointIndexInSlice = gridPointIndex % (static_cast<vtkIdType>(dimensions[0]) * dimensions[1]);
+      double gridPoint[3] =
+      {
+        origin[0] + (gridPointIndexInSlice % dimensions[0]) * gridSpacing,
+        origin[1] + (gridPointIndexInSlice / dimensions[0]) * gridSpacing,
+        origin[2] + (gridPointIndex / (static_cast<vtkIdType>(dimensions[0]) * dimensions[1])) * gridSpacing
+      };
+      double transformedGridPoint[4] = { 0.0, 0.0, 0.0, 1.0 };
+      tpsTransform->InternalTransformPoint(gridPoint, transformedGridPoint);
+      double nonAffineTransformedGridPoint[4] = { 0.0, 0.0, 0.0, 1.0 };
+      vtkMatrix4x4::MultiplyPoint(inverseAffineElements, transformedGridPoint, nonAffineTransformedGridPoint);
+      for (int i = 0; i < 3; i++)
+      {
+        displacements[3 * gridPointIndex + i] = nonAffineTransformedGridPoint[i] - gridPoint[i];
+      }
     }
-    else
+  });
+
+  vtkNew< vtkOrientedGridTransform > gridTransform;
+  gridTransform->SetDisplacementGridData(displacementGrid.GetPointer());
+  outputTransform->Identity();
+  outputTransform->PostMultiply();
+  outputTransform->Concatenate(gridTransform.GetPointer());
+  outputTransform->Concatenate(affineMatrix.GetPointer());
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerFiducialRegistrationWizardLogic::ComputeRegistrations(vtkCollection* fromPointsCollection, vtkCollection* toPointsCollection,
+  int registrationMode, int pointMatching,
+  vtkCollection* outputMatrices, vtkDoubleArray* outputErrors, vtkStringArray* outputStatusMessages)
+{
+  if (fromPointsCollection == NULL || toPointsCollection == NULL)
+  {
+    vtkGenericWarningMacro("vtkSlicerFiducialRegistrationWizardLogic::ComputeRegistrations failed: invalid input point collections");
+    return false;
+  }
+  if (outputMatrices == NULL || outputErrors == NULL || outputStatusMessages == NULL)
+  {
+    vtkGenericWarningMacro("vtkSlicerFiducialRegistrationWizardLogic::ComputeRegistrations failed: invalid outputs");
+    return false;
+  }
+  if (fromPointsCollection->GetNumberOfItems() != toPointsCollection->GetNumberOfItems())
+  {
+    vtkGenericWarningMacro("vtkSlicerFiducialRegistrationWizardLogic::ComputeRegistrations failed: number of 'From' ("
+      << fromPointsCollection->GetNumberOfItems() << ") and 'To' (" << toPointsCollection->GetNumberOfItems() << ") point lists differ");
+    return false;
+  }
+
+  // Collections cannot be accessed from multiple threads, so get all the inputs and create all the outputs first.
+  // The same point list may be used in several pairs (for example a template point list that is registered
+  // to many measured point lists), therefore each pair gets its own copy of the points and so no VTK object
+  // is accessed from multiple threads.
+  int numberOfPairs = fromPointsCollection->GetNumberOfItems();
+  std::vector< vtkSmartPointer< vtkPoints > > fromPointsList(numberOfPairs);
+  std::vector< vtkSmartPointer< vtkPoints > > toPointsList(numberOfPairs);
+  fromPointsCollection->InitTraversal();
+  toPointsCollection->InitTraversal();
+  for (int pairIndex = 0; pairIndex < numberOfPairs; pairIndex++)
+  {
+    vtkPoints* fromPoints = vtkPoints::SafeDownCast(fromPointsCollection->GetNextItemAsObject());
+    vtkPoints* toPoints = vtkPoints::SafeDownCast(toPointsCollection->GetNextItemAsObject());
+    if (fromPoints == NULL || toPoints == NULL)
     {
-      tpsTransform = vtkThinPlateSplineTransform::SafeDownCast(
-        outputTransformNode->GetTransformToParentAs("vtkThinPlateSplineTransform", logErrorIfFails, modifiableOnly));
+      continue;
     }
-    if (tpsTransform == NULL)
+    fromPointsList[pairIndex] = vtkSmartPointer< vtkPoints >::New();
+    fromPointsList[pairIndex]->DeepCopy(fromPoints);
+    toPointsList[pairIndex] = vtkSmartPointer< vtkPoints >::New();
+    toPointsList[pairIndex]->DeepCopy(toPoints);
+  }
+  std::vector< vtkSmartPointer< vtkMatrix4x4 > > matrices(numberOfPairs);
+  for (int pairIndex = 0; pairIndex < numberOfPairs; pairIndex++)
+  {
+    matrices[pairIndex] = vtkSmartPointer< vtkMatrix4x4 >::New();
+  }
+  std::vector< double > errors(numberOfPairs, VTK_DOUBLE_MAX);
+  std::vector< std::string > statusMessages(numberOfPairs);
+
+  // Pairs are independent from each other
+  vtkSMPTools::For(0, numberOfPairs, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType pairIndex = begin; pairIndex < end; pairIndex++)
     {
-      // we cannot reuse the existing transform, create a new one
-      vtkNew< vtkThinPlateSplineTransform > newTpsTransform;
-      newTpsTransform->SetBasisToR();
-      tpsTransform = newTpsTransform.GetPointer();
-      if (fiducialRegistrationWizardNode->GetWarpingTransformFromParent())
+      if (fromPointsList[pairIndex] == NULL || toPointsList[pairIndex] == NULL)
       {
-        outputTransformNode->SetAndObserveTransformFromParent(tpsTransform);
+        statusMessages[pairIndex] = vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "Point list is not defined.");
+        continue;
       }
-      else
+      double rmsError = VTK_DOUBLE_MAX;
+      if (vtkSlicerFiducialRegistrationWizardLogic::ComputeLinearRegistration(fromPointsList[pairIndex], toPointsList[pairIndex],
+        registrationMode, pointMatching, matrices[pairIndex], rmsError, statusMessages[pairIndex]))
       {
-        outputTransformNode->SetAndObserveTransformToParent(tpsTransform);
+        errors[pairIndex] = rmsError;
       }
     }
-    // Set inputs
-    if (fiducialRegistrationWizardNode->GetWarpingTransformFromParent())
+  });
+
+  outputMatrices->RemoveAllItems();
+  outputErrors->Reset();
+  outputErrors->SetNumberOfComponents(1);
+  outputErrors->SetNumberOfValues(numberOfPairs);
+  outputStatusMessages->Reset();
+  outputStatusMessages->SetNumberOfValues(numberOfPairs);
+  bool success = true;
+  for (int pairIndex = 0; pairIndex < numberOfPairs; pairIndex++)
+  {
+    outputMatrices->AddItem(matrices[pairIndex]);
+    outputErrors->SetValue(pairIndex, errors[pairIndex]);
+    outputStatusMessages->SetValue(pairIndex, statusMessages[pairIndex]);
+    if (errors[pairIndex] == VTK_DOUBLE_MAX)
     {
-      tpsTransform->SetSourceLandmarks(toPointsOrdered);
-      tpsTransform->SetTargetLandmarks(fromPointsOrdered);
+      success = false;
     }
-    else
+  }
+  return success;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerFiducialRegistrationWizardLogic::ComputeLinearRegistration(vtkPoints* fromPointsUnordered, vtkPoints* toPointsUnordered,
+  int registrationMode, int pointMatching, vtkMatrix4x4* outputMatrix, double& rmsError, std::string& statusMessage)
+{
+  outputMatrix->Identity();
+  rmsError = VTK_DOUBLE_MAX;
+
+  if (registrationMode != vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_RIGID &&
+    registrationMode != vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY)
+  {
+    // warping transform cannot be described by a matrix
+    statusMessage = vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "Invalid transform type.");
+    return false;
+  }
+  vtkSmartPointer< vtkPoints > fromPointsOrdered;
+  vtkSmartPointer< vtkPoints > toPointsOrdered;
+  if (!vtkSlicerFiducialRegistrationWizardLogic::ComputeOrderedPoints(fromPointsUnordered, toPointsUnordered,
+    registrationMode, pointMatching, fromPointsOrdered, toPointsOrdered, statusMessage))
+  {
+    return false;
+  }
+
+  vtkSlicerFiducialRegistrationWizardLogic::ComputeLandmarkRegistrationMatrix(fromPointsOrdered, toPointsOrdered, registrationMode, outputMatrix);
+  vtkNew< vtkTransform > outputTransform;
+  outputTransform->SetMatrix(outputMatrix);
+  rmsError = vtkSlicerFiducialRegistrationWizardLogic::CalculateRegistrationError(fromPointsOrdered, toPointsOrdered, outputTransform.GetPointer());
+
+  std::stringstream statusMessageStream;
+  statusMessageStream << statusMessage << vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "Registration Complete. RMS Error: %1."),
+    std::to_string(rmsError).c_str()) << std::endl;
+  statusMessage = statusMessageStream.str();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkSlicerFiducialRegistrationWizardLogic::ComputeOrderedPoints(vtkPoints* fromPointsUnordered, vtkPoints* toPointsUnordered,
+  int registrationMode, int pointMatching, vtkSmartPointer< vtkPoints >& fromPointsOrdered, vtkSmartPointer< vtkPoints >& toPointsOrdered,
+  std::string& statusMessage)
+{
+  statusMessage.clear();
+  std::stringstream statusMessageStream;
+
+  if (fromPointsUnordered->GetNumberOfPoints() < 3)
+  {
+    statusMessage = vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "'From' fiducial list has too few fiducials (minimum 3 required).");
+    return false;
+  }
+  if (toPointsUnordered->GetNumberOfPoints() < 3)
+  {
+    statusMessage = vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "'To' fiducial list has too few fiducials (minimum 3 required).");
+    return false;
+  }
+
+  // Determine the order of points
+  if (pointMatching == vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_MANUAL)
+  {
+    if (fromPointsUnordered->GetNumberOfPoints() != toPointsUnordered->GetNumberOfPoints())
     {
-      tpsTransform->SetSourceLandmarks(fromPointsOrdered);
-      tpsTransform->SetTargetLandmarks(toPointsOrdered);
+      statusMessage = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
+        "Fiducial lists have unequal number of fiducials ('From' has %1, 'To' has %2)."
+        " Either adjust the lists, or use automatic point matching. Aborting registration."),
+        std::to_string(fromPointsUnordered->GetNumberOfPoints()).c_str(),
+        std::to_string(toPointsUnordered->GetNumberOfPoints()).c_str());
+      return false;
     }
-    tpsTransform->Update();
+    fromPointsOrdered = fromPointsUnordered;
+    toPointsOrdered = toPointsUnordered;
+  }
+  else if (pointMatching == vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_AUTOMATIC)
+  {
+    if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY ||
+      registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_WARPING)
+    {
+      statusMessageStream << vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
+        "Automatic point matching is currently supported only for rigid registration."
+        " Currently %1 registration is being used. Unexpected results may occur."),
+        vtkMRMLFiducialRegistrationWizardNode::RegistrationModeAsString(registrationMode).c_str()) << std::endl;
+    }
+    int numberOfPointsToMatch = std::max(fromPointsUnordered->GetNumberOfPoints(), toPointsUnordered->GetNumberOfPoints());
+    if (numberOfPointsToMatch > MAX_NUMBER_OF_POINTS_FOR_POINT_MATCHING_AUTOMATIC)
+    {
+      statusMessageStream << vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
+        "Too many points to compute point pairing %1."
+        " To avoid long computation time, there should be at most %2 points."
+        " Aborting registration."),
+        std::to_string(numberOfPointsToMatch).c_str(),
+        std::to_string(MAX_NUMBER_OF_POINTS_FOR_POINT_MATCHING_AUTOMATIC).c_str()) << std::endl;
+      statusMessage = statusMessageStream.str();
+      return false;
+    }
+    vtkSmartPointer< vtkPointMatcher > pointMatcher = vtkSmartPointer< vtkPointMatcher >::New();
+    pointMatcher->SetInputSourcePoints(fromPointsUnordered);
+    pointMatcher->SetInputTargetPoints(toPointsUnordered);
+    pointMatcher->SetMaximumDifferenceInNumberOfPoints(POINT_MATCHING_MAXIMUM_DIFFERENCE_IN_NUMBER_OF_POINTS);
+    pointMatcher->SetTolerableDistanceErrorMultiple(POINT_MATCHING_TOLERABLE_DISTANCE_ERROR_MULTIPLE);
+    pointMatcher->SetAmbiguityDistanceErrorMultiple(POINT_MATCHING_AMBIGUITY_DISTANCE_ERROR_MULTIPLE);
+    pointMatcher->Update();
+    if (!pointMatcher->IsMatchingWithinTolerance())
+    {
+      statusMessageStream << vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
+        "Could not find a good mapping."
+        " Mean squared distance error was %1, but tolerance is %2."
+        " Results are not expected to be accurate."),
+        std::to_string(pointMatcher->GetComputedDistanceError()).c_str(),
+        std::to_string(pointMatcher->GetTolerableDistanceError()).c_str()) << std::endl;
+    }
+    if (pointMatcher->IsMatchingAmbiguous())
+    {
+      statusMessageStream << vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
+        "The 'best' point matching is reported as ambiguous and may be incorrect."
+        " This could happen because the point geometry is symmetric."
+        " Results are not necessarily expected to be accurate.") << std::endl;
+    }
+    fromPointsOrdered = pointMatcher->GetOutputSourcePoints();
+    toPointsOrdered = pointMatcher->GetOutputTargetPoints();
   }
   else
   {
-    vtkErrorMacro("vtkSlicerFiducialRegistrationWizardLogic::UpdateCalibration failed to set transform type: " <<
-      "invalid registration mode: " << vtkMRMLFiducialRegistrationWizardNode::RegistrationModeAsString(registrationMode));
-    fiducialRegistrationWizardNode->SetCalibrationStatusMessage(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic","Invalid transform type."));
+    statusMessage = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
+      "Unrecognized point matching method: %1. Aborting registration."),
+      vtkMRMLFiducialRegistrationWizardNode::PointMatchingAsString(pointMatching).c_str());
     return false;
   }
 
-  vtkAbstractTransform* outputTransform = outputTransformNode->GetTransformToParent();
-  if (outputTransform == NULL)
+  // error checking
+  if (vtkSlicerFiducialRegistrationWizardLogic::CheckCollinear(fromPointsOrdered))
   {
-    vtkErrorMacro("Failed to retreive transform from node. RMS Error could not be evaluated");
-    fiducialRegistrationWizardNode->SetCalibrationStatusMessage(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic",
-      "Failed to retreive transform from node. RMS Error could not be evaluated."));
+    statusMessage = vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "'From' fiducial list has strictly collinear or singular points.");
+    return false;
+  }
+  if (vtkSlicerFiducialRegistrationWizardLogic::CheckCollinear(toPointsOrdered))
+  {
+    statusMessage = vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "'To' fiducial list has strictly collinear or singular points.");
     return false;
   }
 
-  double rmsError = this->CalculateRegistrationError(fromPointsOrdered, toPointsOrdered, outputTransform);
-  std::string completeMessage = vtkMRMLI18N::Format(vtkMRMLTr("vtkSlicerFiducialRegistrationWizardLogic", "Registration Complete. RMS Error: %1."),
-    std::to_string(rmsError).c_str());
-
-  fiducialRegistrationWizardNode->AddToCalibrationStatusMessage(completeMessage);
-  fiducialRegistrationWizardNode->SetCalibrationError( rmsError );
-#if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
-  outputTransformNode->SetNodeReferenceID(vtkMRMLTransformNode::GetMovingNodeReferenceRole(), fromMarkupsFiducialNode->GetID());
-  outputTransformNode->SetNodeReferenceID(vtkMRMLTransformNode::GetFixedNodeReferenceRole(), toMarkupsFiducialNode->GetID());
-#endif 
+  statusMessage = statusMessageStream.str();
   return true;
 }
 
+//------------------------------------------------------------------------------
+void vtkSlicerFiducialRegistrationWizardLogic::ComputeLandmarkRegistrationMatrix(vtkPoints* fromPointsOrdered, vtkPoints* toPointsOrdered,
+  int registrationMode, vtkMatrix4x4* outputMatrix)
+{
+  vtkNew<vtkLandmarkTransform> landmarkTransform;
+  landmarkTransform->SetSourceLandmarks(fromPointsOrdered);
+  landmarkTransform->SetTargetLandmarks(toPointsOrdered);
+  if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY)
+  {
+    landmarkTransform->SetModeToSimilarity();
+  }
+  else
+  {
+    landmarkTransform->SetModeToRigidBody();
+  }
+  landmarkTransform->Update();
+  landmarkTransform->GetMatrix(outputMatrix);
+}
+
 //------------------------------------------------------------------------------
 double vtkSlicerFiducialRegistrationWizardLogic::CalculateRegistrationError(vtkPoints* fromPoints, vtkPoints* toPoints, vtkAbstractTransform* transform)
 {
@@ -500,60 +1116,30 @@ double vtkSlicerFiducialRegistrationWizardLogic::CalculateRegistrationError(vtkP
 //------------------------------------------------------------------------------
 bool vtkSlicerFiducialRegistrationWizardLogic::CheckCollinear(vtkPoints* points)
 {
-  // Initialize the x,y,z arrays for computing the PCA statistics
-  vtkSmartPointer< vtkDoubleArray > xArray = vtkSmartPointer< vtkDoubleArray >::New();
-  xArray->SetName("xArray");
-  vtkSmartPointer< vtkDoubleArray > yArray = vtkSmartPointer< vtkDoubleArray >::New();
-  yArray->SetName("yArray");
-  vtkSmartPointer< vtkDoubleArray > zArray = vtkSmartPointer< vtkDoubleArray >::New();
-  zArray->SetName("zArray");
-
-  // Put the fiducial position values into the arrays
-  double fiducialPosition[3] = { 0, 0, 0 };
-  for (int i = 0; i < points->GetNumberOfPoints(); i++)
-  {
-    points->GetPoint(i, fiducialPosition);
-    xArray->InsertNextValue(fiducialPosition[0]);
-    yArray->InsertNextValue(fiducialPosition[1]);
-    zArray->InsertNextValue(fiducialPosition[2]);
-  }
-
-  // Aggregate the arrays
-  vtkSmartPointer< vtkTable > arrayTable = vtkSmartPointer< vtkTable >::New();
-  arrayTable->AddColumn(xArray);
-  arrayTable->AddColumn(yArray);
-  arrayTable->AddColumn(zArray);
-
-  // Setup the principal component analysis
-  vtkSmartPointer< vtkPCAStatistics > pcaStatistics = vtkSmartPointer< vtkPCAStatistics >::New();
-  pcaStatistics->SetInputData(vtkStatisticsAlgorithm::INPUT_DATA, arrayTable);
-  pcaStatistics->SetColumnStatus("xArray", 1);
-  pcaStatistics->SetColumnStatus("yArray", 1);
-  pcaStatistics->SetColumnStatus("zArray", 1);
-  pcaStatistics->SetDeriveOption(true);
-  pcaStatistics->Update();
-
-  // Calculate the eigenvalues
-  vtkSmartPointer< vtkDoubleArray > eigenvalues = vtkSmartPointer< vtkDoubleArray >::New();
-  pcaStatistics->GetEigenvalues(eigenvalues); // Eigenvalues are largest to smallest
-
-  // Test that each eigenvalues is bigger than some threshold
-  int goodEigenvalues = 0;
-  for (int i = 0; i < eigenvalues->GetNumberOfTuples(); i++)
+  int numberOfPoints = points->GetNumberOfPoints();
+  if (numberOfPoints < 2)
   {
-    if (abs(eigenvalues->GetValue(i)) > EIGENVALUE_THRESHOLD)
-    {
-      goodEigenvalues++;
-    }
+    return true;
   }
-
-  if (goodEigenvalues <= 1)
+  // sums are computed relative to the first point, to reduce rounding errors
+  double origin[3] = { 0.0, 0.0, 0.0 };
+  points->GetPoint(0, origin);
+  double sum[3] = { 0.0, 0.0, 0.0 };
+  double sumOfProducts[3][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+  for (int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++)
   {
-    return true;
+    double point[3] = { 0.0, 0.0, 0.0 };
+    points->GetPoint(pointIndex, point);
+    for (int i = 0; i < 3; i++)
+    {
+      sum[i] += point[i] - origin[i];
+      for (int j = 0; j < 3; j++)
+      {
+        sumOfProducts[i][j] += (point[i] - origin[i]) * (point[j] - origin[j]);
+      }
+    }
   }
-
-  return false;
-
+  return IsCovarianceCollinear(numberOfPoints, sum, sumOfProducts);
 }
 
 //------------------------------------------------------------------------------
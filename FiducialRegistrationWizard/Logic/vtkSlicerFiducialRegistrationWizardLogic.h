@@ -22,7 +22,9 @@
 #define __vtkSlicerFiducialRegistrationWizardLogic_h
 
 
+#include <map>
 #include <string>
+#include <vector>
 
 // Slicer includes
 #include "vtkSlicerModuleLogic.h"
@@ -36,10 +38,16 @@
 #include <vtkLandmarkTransform.h>
 #include <vtkPoints.h>
 #include "vtkSmartPointer.h"
+#include "vtkWeakPointer.h"
 #include "vtkMRMLFiducialRegistrationWizardNode.h"
 
+class vtkCollection;
+class vtkGeneralTransform;
+class vtkMatrix4x4;
+class vtkThinPlateSplineTransform;
 class vtkMRMLMarkupsFiducialNode;
 class vtkMRMLTransformNode;
+class vtkStringArray;
 
 
 // STD includes
@@ -67,10 +75,34 @@ public:
 
   bool UpdateCalibration( vtkMRMLNode* node );
 
+  /// Number of registrations that UpdateCalibration computed from the changed point pair only (incremental update)
+  /// and from all the point pairs (complete update). Intended for testing and diagnostics.
+  vtkGetMacro(NumberOfIncrementalCalibrationUpdates, int);
+  vtkGetMacro(NumberOfCompleteCalibrationUpdates, int);
+
   vtkGetMacro(MarkupsLogic, vtkSlicerMarkupsLogic*);
   vtkSetMacro(MarkupsLogic, vtkSlicerMarkupsLogic*);
   
   std::string GetOutputMessage( std::string nodeID );
+
+  /// Approximate a thin-plate spline transform by a displacement grid, which is much faster to apply.
+  /// The output transform is the grid transform followed by the affine component of the thin-plate spline.
+  /// The grid covers the bounding box of the source landmarks, extended by gridMargin (in mm) on each side.
+  /// Outside of the grid only the affine component is applied, which the spline converges to far from the landmarks.
+  /// Only splines with R basis are supported. Grid points are computed in parallel. Returns false if the grid cannot be created.
+  static bool ConvertThinPlateSplineToGridTransform( vtkThinPlateSplineTransform* tpsTransform,
+    double gridSpacing, double gridMargin, vtkGeneralTransform* outputTransform );
+
+  /// Compute registrations of many pairs of point lists in one call, without creating MRML nodes.
+  /// fromPointsCollection and toPointsCollection contain vtkPoints objects, the i-th items of the two collections form a pair.
+  /// registrationMode (rigid or similarity) and pointMatching values are defined in vtkMRMLFiducialRegistrationWizardNode,
+  /// they are used for all pairs. Pairs are registered in parallel.
+  /// For each pair a vtkMatrix4x4 is added to outputMatrices, the RMS error to outputErrors (VTK_DOUBLE_MAX if registration failed),
+  /// and the status message (same as the one shown for a registration wizard node) to outputStatusMessages.
+  /// Returns true if all the registrations are successful.
+  static bool ComputeRegistrations( vtkCollection* fromPointsCollection, vtkCollection* toPointsCollection,
+    int registrationMode, int pointMatching,
+    vtkCollection* outputMatrices, vtkDoubleArray* outputErrors, vtkStringArray* outputStatusMessages );
   
 protected:
   vtkSlicerFiducialRegistrationWizardLogic();
@@ -101,14 +133,69 @@ private:
   // In a 'good' mapping, there will be little difference seen in the reference and test distances
   static double ComputeSuitabilityOfDistancesMetric( vtkPointDistanceMatrix* referenceDistanceMatrix, vtkPointDistanceMatrix* testDistanceMatrix );
 
-  double CalculateRegistrationError( vtkPoints* fromPoints, vtkPoints* toPoints, vtkAbstractTransform* transform );
-  bool CheckCollinear( vtkPoints* points );
+  static double CalculateRegistrationError( vtkPoints* fromPoints, vtkPoints* toPoints, vtkAbstractTransform* transform );
+  // Returns true if the points are collinear or singular. Does not use any VTK algorithms, so it can be called from multiple threads.
+  static bool CheckCollinear( vtkPoints* points );
+
+  // Compute a rigid or similarity registration between two point lists, used by ComputeRegistrations.
+  // Does not use any member variables, so it can be called from multiple threads.
+  // Returns false if the registration failed. statusMessage contains warnings and errors.
+  static bool ComputeLinearRegistration( vtkPoints* fromPointsUnordered, vtkPoints* toPointsUnordered,
+    int registrationMode, int pointMatching, vtkMatrix4x4* outputMatrix, double& rmsError, std::string& statusMessage );
+
+  // Determine the point pairs (using manual or automatic point matching) and check that they can be registered.
+  // Used by both UpdateCalibration and ComputeLinearRegistration, can be called from multiple threads.
+  // statusMessage contains the warnings, or the error if false is returned.
+  static bool ComputeOrderedPoints( vtkPoints* fromPointsUnordered, vtkPoints* toPointsUnordered,
+    int registrationMode, int pointMatching, vtkSmartPointer< vtkPoints >& fromPointsOrdered, vtkSmartPointer< vtkPoints >& toPointsOrdered,
+    std::string& statusMessage );
+
+  // Compute rigid or similarity transform matrix from point pairs
+  static void ComputeLandmarkRegistrationMatrix( vtkPoints* fromPointsOrdered, vtkPoints* toPointsOrdered,
+    int registrationMode, vtkMatrix4x4* outputMatrix );
+
+  // Copy the computed linear transform into the output transform node
+  void SetOutputTransformMatrix( vtkMRMLTransformNode* outputTransformNode, vtkMatrix4x4* matrix );
+
+  // Rigid and similarity registration with manual point matching can be updated incrementally,
+  // if only a single point pair is modified or appended since the last registration:
+  // the registration is computed from sums of coordinates and coordinate products of the point pairs,
+  // which are updated in constant time for each changed pair.
+  // Returns true if the registration is updated. Otherwise the complete registration has to be computed.
+  bool UpdateCalibrationIncrementally( vtkMRMLFiducialRegistrationWizardNode* fiducialRegistrationWizardNode );
+  // Store the point pairs of a completed registration, for incremental updates
+  void UpdateIncrementalRegistrationState( vtkMRMLFiducialRegistrationWizardNode* fiducialRegistrationWizardNode,
+    vtkPoints* fromPointsOrdered, vtkPoints* toPointsOrdered );
+
+  struct IncrementalRegistrationState
+  {
+    vtkWeakPointer< vtkMRMLMarkupsFiducialNode > FromFiducialListNode;
+    vtkWeakPointer< vtkMRMLMarkupsFiducialNode > ToFiducialListNode;
+    vtkWeakPointer< vtkMRMLTransformNode > OutputTransformNode;
+    int RegistrationMode;
+    std::vector< double > FromPoints; // x, y, z of each point pair
+    std::vector< double > ToPoints;
+    // sums are computed relative to the first point pair, to reduce rounding errors
+    double FromOrigin[ 3 ];
+    double ToOrigin[ 3 ];
+    double FromSum[ 3 ];
+    double ToSum[ 3 ];
+    double FromSumOfProducts[ 3 ][ 3 ]; // from_i * from_j
+    double ToSumOfProducts[ 3 ][ 3 ]; // to_i * to_j
+    double CrossSumOfProducts[ 3 ][ 3 ]; // from_i * to_j
+  };
+  std::map< vtkMRMLFiducialRegistrationWizardNode*, IncrementalRegistrationState > IncrementalRegistrationStates;
+  // Add (weight = 1) or remove (weight = -1) a point pair from the sums of an incremental registration state
+  static void AddPointPairToRegistrationState( IncrementalRegistrationState& state, const double* fromPoint, const double* toPoint, double weight );
 
   std::map< std::string, std::string > OutputMessages;
 
   void SetOutputMessage( std::string nodeID, std::string newOutputMessage ); // The modified event will tell the widget to   (only needs to update when transform is calculated)
 
   vtkSlicerMarkupsLogic* MarkupsLogic;
+
+  int NumberOfIncrementalCalibrationUpdates;
+  int NumberOfCompleteCalibrationUpdates;
 };
 
 #endif
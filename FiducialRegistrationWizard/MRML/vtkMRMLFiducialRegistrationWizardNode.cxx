@@ -68,7 +68,11 @@ vtkMRMLFiducialRegistrationWizardNode::vtkMRMLFiducialRegistrationWizardNode()
   this->UpdateMode = UPDATE_MODE_AUTOMATIC;
   this->PointMatching = POINT_MATCHING_MANUAL;
   this->WarpingTransformFromParent = true;
+  this->WarpingGridSpacing = 0.0;
+  this->WarpingGridMargin = 50.0;
   this->CalibrationError = VTK_DOUBLE_MAX;
+  this->ModifiedControlPointIndex = -1;
+  this->ControlPointModificationsUnknown = true;
 }
 
 //------------------------------------------------------------------------------
@@ -86,6 +90,8 @@ void vtkMRMLFiducialRegistrationWizardNode::WriteXML( ostream& of, int nIndent )
   of << indent << " RegistrationMode=\"" << RegistrationModeAsString( this->RegistrationMode ) << "\"";
   of << indent << " UpdateMode=\"" << UpdateModeAsString( this->UpdateMode ) << "\"";
   of << indent << " WarpingTransformFromParent=\"" << (this->WarpingTransformFromParent ? "true" : "false") << "\"";
+  of << indent << " WarpingGridSpacing=\"" << this->WarpingGridSpacing << "\"";
+  of << indent << " WarpingGridMargin=\"" << this->WarpingGridMargin << "\"";
 }
 
 //------------------------------------------------------------------------------
@@ -117,6 +123,18 @@ void vtkMRMLFiducialRegistrationWizardNode::ReadXMLAttributes( const char** atts
     {
       this->WarpingTransformFromParent = (strcmp(attValue,"true") ? false : true);
     }
+    else if (!strcmp(attName, "WarpingGridSpacing"))
+    {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->WarpingGridSpacing;
+    }
+    else if (!strcmp(attName, "WarpingGridMargin"))
+    {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->WarpingGridMargin;
+    }
   }
 
   this->Modified();
@@ -132,6 +150,8 @@ void vtkMRMLFiducialRegistrationWizardNode::Copy( vtkMRMLNode *anode )
   this->UpdateMode = node->UpdateMode;
   this->PointMatching = node->PointMatching;
   this->WarpingTransformFromParent = node->WarpingTransformFromParent;
+  this->WarpingGridSpacing = node->WarpingGridSpacing;
+  this->WarpingGridMargin = node->WarpingGridMargin;
   this->Modified();
 }
 
@@ -143,6 +163,8 @@ void vtkMRMLFiducialRegistrationWizardNode::PrintSelf( ostream& os, vtkIndent in
   os << indent << "RegistrationMode: " << RegistrationModeAsString( this->RegistrationMode ) << "\n";
   os << indent << "UpdateMode: " << UpdateModeAsString( this->UpdateMode ) << "\n";
   os << indent << "WarpingTransformFromParent: " << (this->WarpingTransformFromParent ? "true" : "false") << "\n";
+  os << indent << "WarpingGridSpacing: " << this->WarpingGridSpacing << "\n";
+  os << indent << "WarpingGridMargin: " << this->WarpingGridMargin << "\n";
 }
 
 //------------------------------------------------------------------------------
@@ -443,19 +465,79 @@ void vtkMRMLFiducialRegistrationWizardNode::ProcessMRMLEvents( vtkObject *caller
   {
 #if Slicer_VERSION_MAJOR >= 5 || (Slicer_VERSION_MAJOR >= 4 && Slicer_VERSION_MINOR >= 11)
     if ( event == vtkMRMLMarkupsNode::PointModifiedEvent ||
-         event == vtkMRMLMarkupsNode::PointAddedEvent ||
-         event == vtkMRMLMarkupsNode::PointRemovedEvent )
+         event == vtkMRMLMarkupsNode::PointAddedEvent )
+    {
+      this->AddControlPointModification( callData );
+      this->InvokeCustomModifiedEvent( InputDataModifiedEvent );
+    }
+    else if ( event == vtkMRMLMarkupsNode::PointRemovedEvent )
 #else
     if ( event == vtkMRMLMarkupsNode::PointModifiedEvent ||
          event == vtkMRMLMarkupsNode::MarkupAddedEvent ||
          event == vtkMRMLMarkupsNode::MarkupRemovedEvent )
 #endif
     {
+      // indices of other points may change
+      this->ControlPointModificationsUnknown = true;
       this->InvokeCustomModifiedEvent( InputDataModifiedEvent );
     }
   }
 }
 
+//------------------------------------------------------------------------------
+void vtkMRMLFiducialRegistrationWizardNode::AddControlPointModification( void* callData )
+{
+  int* pointIndexPtr = reinterpret_cast< int* >( callData );
+  if ( pointIndexPtr == NULL || *pointIndexPtr < 0 )
+  {
+    // all points may be modified
+    this->ControlPointModificationsUnknown = true;
+    return;
+  }
+  if ( this->ModifiedControlPointIndex >= 0 && this->ModifiedControlPointIndex != *pointIndexPtr )
+  {
+    this->ControlPointModificationsUnknown = true;
+    return;
+  }
+  this->ModifiedControlPointIndex = *pointIndexPtr;
+}
+
+//------------------------------------------------------------------------------
+bool vtkMRMLFiducialRegistrationWizardNode::GetSingleModifiedControlPointIndex( int& pointIndex )
+{
+  pointIndex = this->ModifiedControlPointIndex;
+  return !this->ControlPointModificationsUnknown;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLFiducialRegistrationWizardNode::ResetControlPointModifications()
+{
+  this->ModifiedControlPointIndex = -1;
+  this->ControlPointModificationsUnknown = false;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLFiducialRegistrationWizardNode::OnNodeReferenceAdded( vtkMRMLNodeReference* reference )
+{
+  Superclass::OnNodeReferenceAdded( reference );
+  // points of the newly referenced lists are not known
+  this->ControlPointModificationsUnknown = true;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLFiducialRegistrationWizardNode::OnNodeReferenceModified( vtkMRMLNodeReference* reference )
+{
+  Superclass::OnNodeReferenceModified( reference );
+  this->ControlPointModificationsUnknown = true;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLFiducialRegistrationWizardNode::OnNodeReferenceRemoved( vtkMRMLNodeReference* reference )
+{
+  Superclass::OnNodeReferenceRemoved( reference );
+  this->ControlPointModificationsUnknown = true;
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLFiducialRegistrationWizardNode::SetWarpingTransformFromParent(bool warpingTransformFromParent)
 {
@@ -468,3 +550,29 @@ void vtkMRMLFiducialRegistrationWizardNode::SetWarpingTransformFromParent(bool w
   this->Modified();
   this->InvokeCustomModifiedEvent(InputDataModifiedEvent);
 }
+
+//------------------------------------------------------------------------------
+void vtkMRMLFiducialRegistrationWizardNode::SetWarpingGridSpacing(double warpingGridSpacing)
+{
+  if ( this->GetWarpingGridSpacing() == warpingGridSpacing )
+  {
+    // no change
+    return;
+  }
+  this->WarpingGridSpacing = warpingGridSpacing;
+  this->Modified();
+  this->InvokeCustomModifiedEvent(InputDataModifiedEvent);
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLFiducialRegistrationWizardNode::SetWarpingGridMargin(double warpingGridMargin)
+{
+  if ( this->GetWarpingGridMargin() == warpingGridMargin )
+  {
+    // no change
+    return;
+  }
+  this->WarpingGridMargin = warpingGridMargin;
+  this->Modified();
+  this->InvokeCustomModifiedEvent(InputDataModifiedEvent);
+}
@@ -157,8 +157,36 @@ public:
   vtkGetMacro(WarpingTransformFromParent, bool);
   vtkBooleanMacro(WarpingTransformFromParent, bool);
 
+  /// Get/Set grid spacing (in mm) of the warping transform.
+  /// If spacing is larger than 0 then the thin-plate spline transform is converted to a displacement grid
+  /// after fitting. Applying a grid transform takes constant time per point, while thin-plate spline
+  /// evaluation time is proportional to the number of landmarks, which is slow for hundreds of landmarks.
+  /// If spacing is 0 (this is the default) then the thin-plate spline transform is stored in the output.
+  void SetWarpingGridSpacing(double warpingGridSpacing);
+  vtkGetMacro(WarpingGridSpacing, double);
+
+  /// Get/Set size of the region (in mm) around the landmarks that is covered by the warping displacement grid.
+  /// Outside of the grid only the affine component of the thin-plate spline is applied.
+  void SetWarpingGridMargin(double warpingGridMargin);
+  vtkGetMacro(WarpingGridMargin, double);
+
   void ProcessMRMLEvents( vtkObject *caller, unsigned long event, void *callData ) override;
 
+  /// Get the index of the single control point pair (same index in 'From' and 'To' lists) that is
+  /// modified or added since the last ResetControlPointModifications() call. pointIndex is -1 if no point is modified.
+  /// Returns false if the modifications cannot be described by a single point index (more points are modified,
+  /// points are removed, or fiducial lists are replaced). Used by the logic for incremental registration update.
+  bool GetSingleModifiedControlPointIndex( int& pointIndex );
+  void ResetControlPointModifications();
+
+protected:
+  void OnNodeReferenceAdded( vtkMRMLNodeReference* reference ) override;
+  void OnNodeReferenceModified( vtkMRMLNodeReference* reference ) override;
+  void OnNodeReferenceRemoved( vtkMRMLNodeReference* reference ) override;
+
+  // Record modification of a control point. callData is the control point index, as provided in markups point events.
+  void AddControlPointModification( void* callData );
+
 private:
   // Three modes:
   // - Rigid (translation, orientation)
@@ -186,6 +214,10 @@ private:
   /// transformation speed is optimized for models and markups.
   bool WarpingTransformFromParent;
 
+  /// If larger than 0 then warping transform is stored as a displacement grid with this spacing
+  double WarpingGridSpacing;
+  double WarpingGridMargin;
+
   // The Calibration status message reports the RMS error,
   // as well as any warnings about how the registration
   // was set up.
@@ -193,6 +225,10 @@ private:
   std::string CalibrationStatusMessage;
   double CalibrationError;
 
+  // Control point modifications since the last ResetControlPointModifications() call
+  int ModifiedControlPointIndex; // -1 if no point is modified
+  bool ControlPointModificationsUnknown; // true if modifications are not limited to a single point index
+
 };
 
 #endif
@@ -0,0 +1,154 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// SlicerIGT includes
+#include <vtkCombinatoricGenerator.h>
+
+// VTK includes
+#include <vtkNew.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// Input elements are not equal to their positions, so that mixing up elements and positions is detected
+void SetUpGenerator(vtkCombinatoricGenerator* generator, int combinatoric, const std::vector<int>& inputSetSizes, unsigned int subsetSize)
+{
+  switch (combinatoric)
+  {
+    case vtkCombinatoricGenerator::COMBINATORIC_CARTESIAN_PRODUCT:
+      generator->SetCombinatoricToCartesianProduct();
+      break;
+    case vtkCombinatoricGenerator::COMBINATORIC_PERMUTATION:
+      generator->SetCombinatoricToPermutation();
+      generator->SetSubsetSize(subsetSize);
+      break;
+    default:
+      generator->SetCombinatoricToCombination();
+      generator->SetSubsetSize(subsetSize);
+      break;
+  }
+  generator->SetNumberOfInputSets(inputSetSizes.size());
+  for (unsigned int setIndex = 0; setIndex < inputSetSizes.size(); ++setIndex)
+  {
+    for (int elementIndex = 0; elementIndex < inputSetSizes[setIndex]; ++elementIndex)
+    {
+      generator->AddInputElement(setIndex, 100 * setIndex + 7 * elementIndex + 3);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+std::vector<std::vector<int> > GetTraversedOutputSets(vtkCombinatoricGenerator* generator, unsigned int firstOutputSetIndex)
+{
+  std::vector<std::vector<int> > outputSets;
+  std::vector<int> outputSet;
+  generator->InitTraversal(firstOutputSetIndex);
+  while (generator->GetNextOutputSet(outputSet))
+  {
+    outputSets.push_back(outputSet);
+  }
+  return outputSets;
+}
+
+//----------------------------------------------------------------------------
+// The lazy traversal must generate the same output sets as Update(). The order is the same
+// for cartesian products and combinations, but permutations are generated in a different order by Update().
+// Starting the traversal at an output set index must give the rest of the complete traversal.
+bool TestTraversal(int combinatoric, const std::vector<int>& inputSetSizes, unsigned int subsetSize)
+{
+  vtkNew<vtkCombinatoricGenerator> generator;
+  SetUpGenerator(generator, combinatoric, inputSetSizes, subsetSize);
+  std::string caseName = generator->GetCombinatoricAsString() + ", subset size " + std::to_string(subsetSize);
+
+  generator->Update();
+  std::vector<std::vector<int> > updatedOutputSets = generator->GetOutputSets();
+  std::vector<std::vector<int> > traversedOutputSets = GetTraversedOutputSets(generator, 0);
+
+  if (traversedOutputSets.size() != generator->ComputeNumberOfOutputSets())
+  {
+    std::cerr << "Number of traversed output sets mismatch (" << caseName << "). Expected: " << generator->ComputeNumberOfOutputSets()
+      << ", actual: " << traversedOutputSets.size() << std::endl;
+    return false;
+  }
+
+  std::vector<std::vector<int> > expectedOutputSets = updatedOutputSets;
+  std::vector<std::vector<int> > actualOutputSets = traversedOutputSets;
+  if (combinatoric == vtkCombinatoricGenerator::COMBINATORIC_PERMUTATION)
+  {
+    std::sort(expectedOutputSets.begin(), expectedOutputSets.end());
+    std::sort(actualOutputSets.begin(), actualOutputSets.end());
+    if (std::adjacent_find(actualOutputSets.begin(), actualOutputSets.end()) != actualOutputSets.end())
+    {
+      std::cerr << "Traversal generated a permutation more than once (" << caseName << ")." << std::endl;
+      return false;
+    }
+  }
+  if (actualOutputSets != expectedOutputSets)
+  {
+    std::cerr << "Traversed output sets differ from the output of Update() (" << caseName << ")." << std::endl;
+    return false;
+  }
+
+  // start at each output set index, including the end
+  for (unsigned int firstOutputSetIndex = 0; firstOutputSetIndex <= traversedOutputSets.size(); ++firstOutputSetIndex)
+  {
+    std::vector<std::vector<int> > remainingOutputSets = GetTraversedOutputSets(generator, firstOutputSetIndex);
+    if (!std::equal(remainingOutputSets.begin(), remainingOutputSets.end(), traversedOutputSets.begin() + firstOutputSetIndex, traversedOutputSets.end()))
+    {
+      std::cerr << "Traversal starting at output set " << firstOutputSetIndex << " does not match the complete traversal (" << caseName << ")." << std::endl;
+      return false;
+    }
+  }
+
+  // the traversal can be restarted after it is finished
+  std::vector<int> outputSet;
+  if (generator->GetNextOutputSet(outputSet))
+  {
+    std::cerr << "Finished traversal returned an output set (" << caseName << ")." << std::endl;
+    return false;
+  }
+  if (GetTraversedOutputSets(generator, 0) != traversedOutputSets)
+  {
+    std::cerr << "Restarted traversal does not match the first traversal (" << caseName << ")." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkCombinatoricGeneratorTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  bool success = true;
+  const std::vector<int> singleInputSetSize = { 6 };
+  for (unsigned int subsetSize = 1; subsetSize <= 6; ++subsetSize)
+  {
+    success &= TestTraversal(vtkCombinatoricGenerator::COMBINATORIC_COMBINATION, singleInputSetSize, subsetSize);
+    success &= TestTraversal(vtkCombinatoricGenerator::COMBINATORIC_PERMUTATION, singleInputSetSize, subsetSize);
+  }
+  success &= TestTraversal(vtkCombinatoricGenerator::COMBINATORIC_CARTESIAN_PRODUCT, { 3 }, 0);
+  success &= TestTraversal(vtkCombinatoricGenerator::COMBINATORIC_CARTESIAN_PRODUCT, { 3, 1, 4 }, 0);
+  success &= TestTraversal(vtkCombinatoricGenerator::COMBINATORIC_CARTESIAN_PRODUCT, { 2, 5, 3, 2 }, 0);
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  std::cout << "Combinatoric generator test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
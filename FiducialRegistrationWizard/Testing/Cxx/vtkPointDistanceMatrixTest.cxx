@@ -0,0 +1,177 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// SlicerIGT includes
+#include <vtkPointDistanceMatrix.h>
+#include "vtkSlicerFiducialRegistrationWizardTestingUtilities.h"
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+//----------------------------------------------------------------------------
+// Compare all matrix elements with distances computed directly from the points
+bool CheckDistanceMatrix(vtkPointDistanceMatrix* distanceMatrix, const std::string& caseName)
+{
+  vtkPoints* pointList1 = distanceMatrix->GetPointList1();
+  vtkPoints* pointList2 = distanceMatrix->GetPointList2();
+  double maximumDistance = 0.0;
+  double minimumDistance = VTK_DOUBLE_MAX;
+  for (int pointList1Index = 0; pointList1Index < pointList1->GetNumberOfPoints(); ++pointList1Index)
+  {
+    for (int pointList2Index = 0; pointList2Index < pointList2->GetNumberOfPoints(); ++pointList2Index)
+    {
+      double expectedDistance = sqrt(vtkMath::Distance2BetweenPoints(pointList1->GetPoint(pointList1Index), pointList2->GetPoint(pointList2Index)));
+      double actualDistance = distanceMatrix->GetDistance(pointList1Index, pointList2Index);
+      if (expectedDistance != actualDistance)
+      {
+        std::cerr << "Distance mismatch (" << caseName << ") at " << pointList1Index << ", " << pointList2Index
+          << ". Expected: " << expectedDistance << ", actual: " << actualDistance << std::endl;
+        return false;
+      }
+      maximumDistance = std::max(maximumDistance, expectedDistance);
+      minimumDistance = std::min(minimumDistance, expectedDistance);
+    }
+  }
+  if (distanceMatrix->GetMaximumDistance() != maximumDistance)
+  {
+    std::cerr << "Maximum distance mismatch (" << caseName << "). Expected: " << maximumDistance
+      << ", actual: " << distanceMatrix->GetMaximumDistance() << std::endl;
+    return false;
+  }
+  if (distanceMatrix->GetMinimumDistance() != minimumDistance)
+  {
+    std::cerr << "Minimum distance mismatch (" << caseName << "). Expected: " << minimumDistance
+      << ", actual: " << distanceMatrix->GetMinimumDistance() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool CheckNumberOfComputedDistances(vtkPointDistanceMatrix* distanceMatrix, vtkIdType expectedNumberOfComputedDistances, const std::string& caseName)
+{
+  if (distanceMatrix->GetNumberOfComputedDistances() != expectedNumberOfComputedDistances)
+  {
+    std::cerr << "Unexpected number of computed distances (" << caseName << "). Expected: " << expectedNumberOfComputedDistances
+      << ", actual: " << distanceMatrix->GetNumberOfComputedDistances() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkPointDistanceMatrixTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence randomSequence;
+
+  const int numberOfPoints = 20;
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkPoints> otherPoints;
+  for (int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    points->InsertNextPoint(randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-100.0, 100.0));
+    otherPoints->InsertNextPoint(randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-100.0, 100.0));
+  }
+
+  bool success = true;
+
+  // distances within a single list: packed storage
+  vtkNew<vtkPointDistanceMatrix> selfDistanceMatrix;
+  selfDistanceMatrix->SetPointList1(points);
+  selfDistanceMatrix->SetPointList2(points);
+  selfDistanceMatrix->Update();
+  if (!selfDistanceMatrix->IsSelfDistanceMatrix())
+  {
+    std::cerr << "Distance matrix of a single point list is not reported as self distance matrix." << std::endl;
+    success = false;
+  }
+  success &= CheckDistanceMatrix(selfDistanceMatrix, "self");
+  success &= CheckNumberOfComputedDistances(selfDistanceMatrix, numberOfPoints * (numberOfPoints - 1) / 2, "self");
+
+  // distances between two lists: full storage
+  vtkNew<vtkPointDistanceMatrix> crossDistanceMatrix;
+  crossDistanceMatrix->SetPointList1(points);
+  crossDistanceMatrix->SetPointList2(otherPoints);
+  crossDistanceMatrix->Update();
+  success &= CheckDistanceMatrix(crossDistanceMatrix, "cross");
+  success &= CheckNumberOfComputedDistances(crossDistanceMatrix, numberOfPoints * numberOfPoints, "cross");
+
+  // no modification since the last update: update is skipped
+  selfDistanceMatrix->Update();
+  success &= CheckNumberOfComputedDistances(selfDistanceMatrix, numberOfPoints * (numberOfPoints - 1) / 2, "self, not modified");
+
+  // unchanged points: nothing is computed
+  points->Modified();
+  selfDistanceMatrix->Update();
+  success &= CheckDistanceMatrix(selfDistanceMatrix, "self, unchanged");
+  success &= CheckNumberOfComputedDistances(selfDistanceMatrix, 0, "self, unchanged");
+
+  // appended point: only the new column is computed
+  points->InsertNextPoint(150.0, -20.0, 35.0);
+  points->Modified();
+  selfDistanceMatrix->Update();
+  success &= CheckDistanceMatrix(selfDistanceMatrix, "self, appended");
+  success &= CheckNumberOfComputedDistances(selfDistanceMatrix, numberOfPoints, "self, appended");
+  crossDistanceMatrix->Update();
+  success &= CheckDistanceMatrix(crossDistanceMatrix, "cross, appended");
+  success &= CheckNumberOfComputedDistances(crossDistanceMatrix, numberOfPoints, "cross, appended");
+
+  // moved point: only its row and column are computed
+  points->SetPoint(5, -30.0, 40.0, 250.0);
+  points->Modified();
+  selfDistanceMatrix->Update();
+  success &= CheckDistanceMatrix(selfDistanceMatrix, "self, moved");
+  success &= CheckNumberOfComputedDistances(selfDistanceMatrix, numberOfPoints, "self, moved");
+
+  // removed point: all remaining distances are reused
+  vtkNew<vtkPoints> reducedPoints;
+  for (int pointIndex = 0; pointIndex < points->GetNumberOfPoints(); ++pointIndex)
+  {
+    if (pointIndex != 3)
+    {
+      reducedPoints->InsertNextPoint(points->GetPoint(pointIndex));
+    }
+  }
+  selfDistanceMatrix->SetPointList1(reducedPoints);
+  selfDistanceMatrix->SetPointList2(reducedPoints);
+  selfDistanceMatrix->Update();
+  success &= CheckDistanceMatrix(selfDistanceMatrix, "self, removed");
+  success &= CheckNumberOfComputedDistances(selfDistanceMatrix, 0, "self, removed");
+
+  vtkNew<vtkDoubleArray> allDistances;
+  selfDistanceMatrix->GetDistances(allDistances);
+  if (allDistances->GetNumberOfTuples() != numberOfPoints * numberOfPoints)
+  {
+    std::cerr << "Unexpected number of distances: " << allDistances->GetNumberOfTuples() << ", expected: " << numberOfPoints * numberOfPoints << std::endl;
+    success = false;
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  std::cout << "Point distance matrix test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
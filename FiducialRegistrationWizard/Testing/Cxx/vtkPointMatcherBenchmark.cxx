@@ -0,0 +1,169 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// Benchmark of vtkPointMatcher on synthetic fiducial sets.
+// For each case it reports wall time, number of evaluated point orderings and whether the result is as expected.
+// Fails if any result is unexpected. Timing depends on the machine and its load, so it is only reported:
+// cases that take longer than the interactive time budget are marked as slow, but do not fail.
+
+// SlicerIGT includes
+#include <vtkPointMatcher.h>
+#include "vtkSlicerFiducialRegistrationWizardTestingUtilities.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct PointMatcherBenchmarkCase
+  {
+    std::string Name;
+    int NumberOfPoints;
+    int NumberOfMissingTargetPoints;
+    int NumberOfExtraTargetPoints;
+    double NoiseMm;
+    bool NearSymmetric; // points are evenly distributed on a circle, matching is expected to be ambiguous
+  };
+
+  const double MAXIMUM_PAIRING_ERROR_MM = 5.0;
+
+  // matching is interactive (it is recomputed when a fiducial is placed), so each case should be quick
+  const double INTERACTIVE_MATCHING_TIME_SEC = 1.0;
+}
+
+//----------------------------------------------------------------------------
+int vtkPointMatcherBenchmark(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence randomSequence;
+
+  std::vector<PointMatcherBenchmarkCase> benchmarkCases;
+  const int numbersOfPoints[] = { 4, 5, 6, 8, 10, 15, 20, 25, 30 };
+  for (int numberOfPoints : numbersOfPoints)
+  {
+    benchmarkCases.push_back({ "exact", numberOfPoints, 0, 0, 0.0, false });
+    benchmarkCases.push_back({ "noise", numberOfPoints, 0, 0, 0.5, false });
+    benchmarkCases.push_back({ "missing", numberOfPoints, std::min(2, numberOfPoints - 3), 0, 0.5, false });
+    benchmarkCases.push_back({ "extra", numberOfPoints, 0, 2, 0.5, false });
+    benchmarkCases.push_back({ "symmetric", numberOfPoints, 0, 0, 0.1, true });
+  }
+
+  vtkNew<vtkTransform> sourceToTargetTransform;
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::SetSourceToTargetTransform(sourceToTargetTransform);
+
+  std::cout << std::left << std::setw(12) << "Case" << std::right << std::setw(8) << "Points" << std::setw(9) << "Missing"
+    << std::setw(7) << "Extra" << std::setw(14) << "Time [s]" << std::setw(16) << "Permutations"
+    << std::setw(11) << "Ambiguous" << std::setw(12) << "Result" << std::endl;
+
+  int numberOfFailedCases = 0;
+  int numberOfSlowCases = 0;
+  for (const PointMatcherBenchmarkCase& benchmarkCase : benchmarkCases)
+  {
+    // source points, target points are the transformed source points in a different order
+    vtkNew<vtkPoints> sourcePoints;
+    for (int pointIndex = 0; pointIndex < benchmarkCase.NumberOfPoints; ++pointIndex)
+    {
+      if (benchmarkCase.NearSymmetric)
+      {
+        double angleRad = 2.0 * vtkMath::Pi() * pointIndex / benchmarkCase.NumberOfPoints;
+        sourcePoints->InsertNextPoint(80.0 * cos(angleRad), 80.0 * sin(angleRad), 0.0);
+      }
+      else
+      {
+        sourcePoints->InsertNextPoint(randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-50.0, 50.0));
+      }
+    }
+    std::vector<int> targetOrder = randomSequence.GetShuffledOrder(benchmarkCase.NumberOfPoints);
+    vtkNew<vtkPoints> targetPoints;
+    for (int pointIndex = 0; pointIndex < benchmarkCase.NumberOfPoints - benchmarkCase.NumberOfMissingTargetPoints; ++pointIndex)
+    {
+      double targetPoint[3] = { 0.0, 0.0, 0.0 };
+      sourceToTargetTransform->TransformPoint(sourcePoints->GetPoint(targetOrder[pointIndex]), targetPoint);
+      for (int i = 0; i < 3; ++i)
+      {
+        targetPoint[i] += randomSequence.GetNextValue(-benchmarkCase.NoiseMm, benchmarkCase.NoiseMm);
+      }
+      targetPoints->InsertNextPoint(targetPoint);
+    }
+    for (int pointIndex = 0; pointIndex < benchmarkCase.NumberOfExtraTargetPoints; ++pointIndex)
+    {
+      double extraSourcePoint[3] = { randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-50.0, 50.0) };
+      targetPoints->InsertNextPoint(sourceToTargetTransform->TransformPoint(extraSourcePoint));
+    }
+
+    vtkNew<vtkPointMatcher> pointMatcher;
+    pointMatcher->SetInputSourcePoints(sourcePoints);
+    pointMatcher->SetInputTargetPoints(targetPoints);
+
+    double startTimeSec = vtkTimerLog::GetUniversalTime();
+    pointMatcher->Update();
+    double elapsedTimeSec = vtkTimerLog::GetUniversalTime() - startTimeSec;
+
+    // all pairs must be correct, and all points that are present in both lists must be paired
+    bool pairingCorrect = pointMatcher->IsMatchingWithinTolerance();
+    vtkPoints* outputSourcePoints = pointMatcher->GetOutputSourcePoints();
+    vtkPoints* outputTargetPoints = pointMatcher->GetOutputTargetPoints();
+    int expectedNumberOfMatchedPoints = benchmarkCase.NumberOfPoints - benchmarkCase.NumberOfMissingTargetPoints;
+    if (outputSourcePoints->GetNumberOfPoints() != expectedNumberOfMatchedPoints
+      || outputTargetPoints->GetNumberOfPoints() != expectedNumberOfMatchedPoints)
+    {
+      pairingCorrect = false;
+    }
+    for (int pointIndex = 0; pairingCorrect && pointIndex < outputSourcePoints->GetNumberOfPoints(); ++pointIndex)
+    {
+      double expectedTargetPoint[3] = { 0.0, 0.0, 0.0 };
+      sourceToTargetTransform->TransformPoint(outputSourcePoints->GetPoint(pointIndex), expectedTargetPoint);
+      if (vtkMath::Distance2BetweenPoints(expectedTargetPoint, outputTargetPoints->GetPoint(pointIndex)) > MAXIMUM_PAIRING_ERROR_MM * MAXIMUM_PAIRING_ERROR_MM)
+      {
+        pairingCorrect = false;
+      }
+    }
+
+    // near-symmetric layouts cannot be paired reliably, they must be reported as ambiguous
+    bool ambiguous = pointMatcher->IsMatchingAmbiguous();
+    bool resultAsExpected = benchmarkCase.NearSymmetric ? ambiguous : (pairingCorrect && !ambiguous);
+    bool slow = (elapsedTimeSec > INTERACTIVE_MATCHING_TIME_SEC);
+    std::string result = !resultAsExpected ? "UNEXPECTED" : (slow ? "ok (slow)" : "ok");
+    if (!resultAsExpected)
+    {
+      numberOfFailedCases++;
+    }
+    if (slow)
+    {
+      numberOfSlowCases++;
+    }
+
+    std::cout << std::left << std::setw(12) << benchmarkCase.Name << std::right << std::setw(8) << benchmarkCase.NumberOfPoints
+      << std::setw(9) << benchmarkCase.NumberOfMissingTargetPoints << std::setw(7) << benchmarkCase.NumberOfExtraTargetPoints
+      << std::setw(14) << std::fixed << std::setprecision(4) << elapsedTimeSec
+      << std::setw(16) << pointMatcher->GetNumberOfEvaluatedPermutations()
+      << std::setw(11) << (ambiguous ? "yes" : "no") << std::setw(12) << result << std::endl;
+  }
+
+  std::cout << numberOfFailedCases << " of " << benchmarkCases.size() << " cases gave unexpected results." << std::endl;
+  std::cout << numberOfSlowCases << " of " << benchmarkCases.size() << " cases took longer than " << INTERACTIVE_MATCHING_TIME_SEC << " s." << std::endl;
+  return (numberOfFailedCases == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,115 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// SlicerIGT includes
+#include <vtkPointMatcher.h>
+#include "vtkSlicerFiducialRegistrationWizardTestingUtilities.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+const int NUMBER_OF_POINTS = 500;
+const int NUMBER_OF_MISSING_TARGET_POINTS = 2;
+const double NOISE_MM = 0.1;
+const double MAXIMUM_MATCHING_ERROR_MM = 1.0;
+
+//----------------------------------------------------------------------------
+int vtkPointMatcherLargeSetTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence randomSequence;
+
+  vtkNew<vtkTransform> sourceToTargetTransform;
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::SetSourceToTargetTransform(sourceToTargetTransform);
+
+  // source points are randomly distributed in a box, target points are the transformed source points
+  // with some noise, in a different order, and a few of them are missing
+  vtkNew<vtkPoints> sourcePoints;
+  for (int pointIndex = 0; pointIndex < NUMBER_OF_POINTS; ++pointIndex)
+  {
+    sourcePoints->InsertNextPoint(randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-100.0, 100.0), randomSequence.GetNextValue(-50.0, 50.0));
+  }
+  std::vector<int> targetOrder = randomSequence.GetShuffledOrder(NUMBER_OF_POINTS);
+  vtkNew<vtkPoints> targetPoints;
+  for (int pointIndex = 0; pointIndex < NUMBER_OF_POINTS - NUMBER_OF_MISSING_TARGET_POINTS; ++pointIndex)
+  {
+    double targetPoint[3] = { 0.0, 0.0, 0.0 };
+    sourceToTargetTransform->TransformPoint(sourcePoints->GetPoint(targetOrder[pointIndex]), targetPoint);
+    for (int i = 0; i < 3; ++i)
+    {
+      targetPoint[i] += randomSequence.GetNextValue(-NOISE_MM, NOISE_MM);
+    }
+    targetPoints->InsertNextPoint(targetPoint);
+  }
+
+  vtkNew<vtkPointMatcher> pointMatcher;
+  pointMatcher->SetInputSourcePoints(sourcePoints);
+  pointMatcher->SetInputTargetPoints(targetPoints);
+  pointMatcher->SetMaximumDifferenceInNumberOfPoints(NUMBER_OF_MISSING_TARGET_POINTS);
+  pointMatcher->SetTolerableDistanceErrorMultiple(0.05);
+  pointMatcher->SetAmbiguityDistanceErrorMultiple(0.025);
+
+  double startTimeSec = vtkTimerLog::GetUniversalTime();
+  pointMatcher->Update();
+  double elapsedTimeSec = vtkTimerLog::GetUniversalTime() - startTimeSec;
+  // timing depends on the machine and its load, it is only reported
+  std::cout << "Matching of " << NUMBER_OF_POINTS << " points took " << elapsedTimeSec << " s" << std::endl;
+
+  if (!pointMatcher->IsMatchingWithinTolerance())
+  {
+    std::cerr << "Matching is not within tolerance. Error: " << pointMatcher->GetComputedDistanceError()
+      << ", tolerance: " << pointMatcher->GetTolerableDistanceError() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (pointMatcher->IsMatchingAmbiguous())
+  {
+    std::cerr << "Matching is reported as ambiguous." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkPoints* outputSourcePoints = pointMatcher->GetOutputSourcePoints();
+  vtkPoints* outputTargetPoints = pointMatcher->GetOutputTargetPoints();
+  int expectedNumberOfMatchedPoints = NUMBER_OF_POINTS - NUMBER_OF_MISSING_TARGET_POINTS;
+  if (outputSourcePoints->GetNumberOfPoints() != expectedNumberOfMatchedPoints
+    || outputTargetPoints->GetNumberOfPoints() != expectedNumberOfMatchedPoints)
+  {
+    std::cerr << "Unexpected number of matched points: " << outputSourcePoints->GetNumberOfPoints()
+      << " source and " << outputTargetPoints->GetNumberOfPoints() << " target points, expected "
+      << expectedNumberOfMatchedPoints << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int pointIndex = 0; pointIndex < expectedNumberOfMatchedPoints; ++pointIndex)
+  {
+    double expectedTargetPoint[3] = { 0.0, 0.0, 0.0 };
+    sourceToTargetTransform->TransformPoint(outputSourcePoints->GetPoint(pointIndex), expectedTargetPoint);
+    double matchingErrorMm = sqrt(vtkMath::Distance2BetweenPoints(expectedTargetPoint, outputTargetPoints->GetPoint(pointIndex)));
+    if (matchingErrorMm > MAXIMUM_MATCHING_ERROR_MM)
+    {
+      std::cerr << "Point " << pointIndex << " is matched incorrectly, error: " << matchingErrorMm << " mm" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "Large point set matching test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,267 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// SlicerIGT includes
+#include <vtkPointMatcher.h>
+#include "vtkSlicerFiducialRegistrationWizardTestingUtilities.h"
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkTransform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const int NUMBER_OF_TRIALS = 20;
+const unsigned int MAXIMUM_DIFFERENCE_IN_NUMBER_OF_POINTS = 2;
+
+//----------------------------------------------------------------------------
+// Result of the reference search, which evaluates every ordering of every subset
+struct ExhaustiveSearchResult
+{
+  double DistanceError{ VTK_DOUBLE_MAX };
+  bool MatchingAmbiguous{ false };
+  vtkIdType NumberOfEvaluatedPermutations{ 0 };
+  std::vector<int> MatchedSourcePointIndices;
+  std::vector<int> MatchedTargetPointIndices;
+};
+
+//----------------------------------------------------------------------------
+// Returns false if there are no more combinations
+bool GetNextCombination(std::vector<int>& combination, int setSize)
+{
+  int subsetSize = static_cast<int>(combination.size());
+  for (int elementIndex = subsetSize - 1; elementIndex >= 0; --elementIndex)
+  {
+    if (combination[elementIndex] < setSize - subsetSize + elementIndex)
+    {
+      combination[elementIndex]++;
+      for (int followingElementIndex = elementIndex + 1; followingElementIndex < subsetSize; ++followingElementIndex)
+      {
+        combination[followingElementIndex] = combination[followingElementIndex - 1] + 1;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+// Candidates are evaluated in the same order as in vtkPointMatcher (subset sizes from largest to smallest,
+// source combinations, target combinations, target orderings, all in lexicographic order),
+// with the same registration error and ambiguity rules, but without discarding any candidate.
+void SearchExhaustively(vtkPoints* sourcePoints, vtkPoints* targetPoints, double tolerableDistanceError,
+  double ambiguityDistanceError, ExhaustiveSearchResult& result)
+{
+  int numberOfSourcePoints = sourcePoints->GetNumberOfPoints();
+  int numberOfTargetPoints = targetPoints->GetNumberOfPoints();
+  int maximumSubsetSize = std::min(numberOfSourcePoints, numberOfTargetPoints);
+  int minimumSubsetSize = std::max(maximumSubsetSize - static_cast<int>(MAXIMUM_DIFFERENCE_IN_NUMBER_OF_POINTS), 3);
+  for (int subsetSize = maximumSubsetSize; subsetSize >= minimumSubsetSize; --subsetSize)
+  {
+    std::vector<int> sourceCombination(subsetSize);
+    for (int elementIndex = 0; elementIndex < subsetSize; ++elementIndex)
+    {
+      sourceCombination[elementIndex] = elementIndex;
+    }
+    do
+    {
+      std::vector<int> targetCombination(subsetSize);
+      for (int elementIndex = 0; elementIndex < subsetSize; ++elementIndex)
+      {
+        targetCombination[elementIndex] = elementIndex;
+      }
+      do
+      {
+        std::vector<int> targetOrdering = targetCombination;
+        do
+        {
+          std::vector<double> sourceX(subsetSize), sourceY(subsetSize), sourceZ(subsetSize);
+          std::vector<double> targetX(subsetSize), targetY(subsetSize), targetZ(subsetSize);
+          for (int elementIndex = 0; elementIndex < subsetSize; ++elementIndex)
+          {
+            double* sourcePoint = sourcePoints->GetPoint(sourceCombination[elementIndex]);
+            sourceX[elementIndex] = sourcePoint[0];
+            sourceY[elementIndex] = sourcePoint[1];
+            sourceZ[elementIndex] = sourcePoint[2];
+            double* targetPoint = targetPoints->GetPoint(targetOrdering[elementIndex]);
+            targetX[elementIndex] = targetPoint[0];
+            targetY[elementIndex] = targetPoint[1];
+            targetZ[elementIndex] = targetPoint[2];
+          }
+          double distanceError = vtkPointMatcher::ComputeRigidRegistrationRootMeanSquareError(subsetSize,
+            &sourceX[0], &sourceY[0], &sourceZ[0], &targetX[0], &targetY[0], &targetZ[0]);
+          result.NumberOfEvaluatedPermutations++;
+
+          bool withinAmbiguityError = (fabs(result.DistanceError - distanceError) <= ambiguityDistanceError);
+          if (distanceError < result.DistanceError)
+          {
+            result.MatchingAmbiguous = withinAmbiguityError;
+            result.DistanceError = distanceError;
+          }
+          else if (withinAmbiguityError)
+          {
+            result.MatchingAmbiguous = true;
+          }
+          if (distanceError == result.DistanceError)
+          {
+            result.MatchedSourcePointIndices = sourceCombination;
+            result.MatchedTargetPointIndices = targetOrdering;
+          }
+        } while (std::next_permutation(targetOrdering.begin(), targetOrdering.end()));
+      } while (GetNextCombination(targetCombination, numberOfTargetPoints));
+    } while (GetNextCombination(sourceCombination, numberOfSourcePoints));
+
+    if (result.DistanceError <= tolerableDistanceError)
+    {
+      break;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool TestPrunedSearch(vtkPoints* sourcePoints, vtkPoints* targetPoints, const std::string& caseName)
+{
+  vtkNew<vtkPointMatcher> pointMatcher;
+  pointMatcher->SetInputSourcePoints(sourcePoints);
+  pointMatcher->SetInputTargetPoints(targetPoints);
+  pointMatcher->SetMaximumDifferenceInNumberOfPoints(MAXIMUM_DIFFERENCE_IN_NUMBER_OF_POINTS);
+  pointMatcher->Update();
+
+  ExhaustiveSearchResult expected;
+  SearchExhaustively(sourcePoints, targetPoints, pointMatcher->GetTolerableDistanceError(),
+    pointMatcher->GetAmbiguityDistanceError(), expected);
+
+  if (pointMatcher->GetComputedDistanceError() != expected.DistanceError)
+  {
+    std::cerr << "Distance error mismatch (" << caseName << "). Exhaustive search: " << expected.DistanceError
+      << ", pruned search: " << pointMatcher->GetComputedDistanceError() << std::endl;
+    return false;
+  }
+  if (pointMatcher->IsMatchingAmbiguous() != expected.MatchingAmbiguous)
+  {
+    std::cerr << "Ambiguity flag mismatch (" << caseName << "). Exhaustive search: " << expected.MatchingAmbiguous
+      << ", pruned search: " << pointMatcher->IsMatchingAmbiguous() << std::endl;
+    return false;
+  }
+  if (pointMatcher->GetNumberOfEvaluatedPermutations() > expected.NumberOfEvaluatedPermutations)
+  {
+    std::cerr << "Pruned search evaluated more orderings (" << pointMatcher->GetNumberOfEvaluatedPermutations()
+      << ") than the exhaustive search (" << expected.NumberOfEvaluatedPermutations << ") (" << caseName << ")." << std::endl;
+    return false;
+  }
+
+  vtkPoints* outputSourcePoints = pointMatcher->GetOutputSourcePoints();
+  vtkPoints* outputTargetPoints = pointMatcher->GetOutputTargetPoints();
+  int numberOfMatchedPoints = static_cast<int>(expected.MatchedSourcePointIndices.size());
+  if (outputSourcePoints->GetNumberOfPoints() != numberOfMatchedPoints || outputTargetPoints->GetNumberOfPoints() != numberOfMatchedPoints)
+  {
+    std::cerr << "Number of matched points mismatch (" << caseName << "). Exhaustive search: " << numberOfMatchedPoints
+      << ", pruned search: " << outputSourcePoints->GetNumberOfPoints() << std::endl;
+    return false;
+  }
+  for (int pointIndex = 0; pointIndex < numberOfMatchedPoints; ++pointIndex)
+  {
+    double* expectedSourcePoint = sourcePoints->GetPoint(expected.MatchedSourcePointIndices[pointIndex]);
+    double* expectedTargetPoint = targetPoints->GetPoint(expected.MatchedTargetPointIndices[pointIndex]);
+    double* outputSourcePoint = outputSourcePoints->GetPoint(pointIndex);
+    double* outputTargetPoint = outputTargetPoints->GetPoint(pointIndex);
+    for (int i = 0; i < 3; ++i)
+    {
+      if (outputSourcePoint[i] != expectedSourcePoint[i] || outputTargetPoint[i] != expectedTargetPoint[i])
+      {
+        std::cerr << "Matched point pair " << pointIndex << " differs from the exhaustive search (" << caseName << ")." << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// The pruned search of point orderings in vtkPointMatcher must give the same assignment
+// as evaluating all orderings, also if points are missing from either list
+int vtkPointMatcherPrunedSearchTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence randomSequence;
+
+  // number of source and target points in each case, at most 5 points are matched by the exhaustive search
+  const int numbersOfPoints[][2] = { { 5, 5 }, { 5, 4 }, { 4, 5 }, { 5, 3 }, { 3, 5 }, { 4, 4 } };
+
+  bool success = true;
+  for (int trialIndex = 0; trialIndex < NUMBER_OF_TRIALS; ++trialIndex)
+  {
+    vtkNew<vtkTransform> sourceToTargetTransform;
+    randomSequence.ConcatenateRandomRigidTransform(sourceToTargetTransform);
+    for (const int* numberOfPoints : numbersOfPoints)
+    {
+      int numberOfSourcePoints = numberOfPoints[0];
+      int numberOfTargetPoints = numberOfPoints[1];
+
+      // points that are not in both lists are different, random points
+      int numberOfCommonPoints = std::min(numberOfSourcePoints, numberOfTargetPoints);
+      vtkNew<vtkPoints> sourcePoints;
+      vtkNew<vtkPoints> targetPoints;
+      std::vector<int> targetOrder = randomSequence.GetShuffledOrder(numberOfTargetPoints);
+      targetPoints->SetNumberOfPoints(numberOfTargetPoints);
+      for (int pointIndex = 0; pointIndex < std::max(numberOfSourcePoints, numberOfTargetPoints); ++pointIndex)
+      {
+        double sourcePoint[3] = { 0.0, 0.0, 0.0 };
+        for (int i = 0; i < 3; ++i)
+        {
+          sourcePoint[i] = randomSequence.GetNextValue(-50.0, 50.0);
+        }
+        double targetPoint[3] = { 0.0, 0.0, 0.0 };
+        sourceToTargetTransform->TransformPoint(sourcePoint, targetPoint);
+        for (int i = 0; i < 3; ++i)
+        {
+          targetPoint[i] += randomSequence.GetNextValue(-1.0, 1.0);
+        }
+        if (pointIndex < numberOfSourcePoints)
+        {
+          sourcePoints->InsertNextPoint(sourcePoint);
+        }
+        if (pointIndex < numberOfTargetPoints)
+        {
+          if (pointIndex >= numberOfCommonPoints)
+          {
+            for (int i = 0; i < 3; ++i)
+            {
+              targetPoint[i] = randomSequence.GetNextValue(-100.0, 100.0);
+            }
+          }
+          targetPoints->SetPoint(targetOrder[pointIndex], targetPoint);
+        }
+      }
+
+      std::string caseName = "trial " + std::to_string(trialIndex) + ", " + std::to_string(numberOfSourcePoints)
+        + " source and " + std::to_string(numberOfTargetPoints) + " target points";
+      success &= TestPrunedSearch(sourcePoints, targetPoints, caseName);
+    }
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  std::cout << "Point matcher pruned search test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
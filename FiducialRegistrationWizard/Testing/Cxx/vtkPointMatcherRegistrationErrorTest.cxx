@@ -0,0 +1,170 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// SlicerIGT includes
+#include <vtkPointMatcher.h>
+#include "vtkSlicerFiducialRegistrationWizardTestingUtilities.h"
+
+// VTK includes
+#include <vtkLandmarkTransform.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkTransform.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+double epsilon = 1.0e-6;
+
+//----------------------------------------------------------------------------
+// Reference implementation: register the points using vtkLandmarkTransform and compute the residuals
+double ComputeReferenceRootMeanSquareError(vtkPoints* sourcePoints, vtkPoints* targetPoints)
+{
+  vtkNew<vtkLandmarkTransform> landmarkTransform;
+  landmarkTransform->SetSourceLandmarks(sourcePoints);
+  landmarkTransform->SetTargetLandmarks(targetPoints);
+  landmarkTransform->SetModeToRigidBody();
+  landmarkTransform->Update();
+
+  double sumOfSquaredDistances = 0.0;
+  int numberOfPoints = sourcePoints->GetNumberOfPoints();
+  for (int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    double sourcePoint[3] = { 0.0, 0.0, 0.0 };
+    sourcePoints->GetPoint(pointIndex, sourcePoint);
+    double transformedSourcePoint[3] = { 0.0, 0.0, 0.0 };
+    landmarkTransform->TransformPoint(sourcePoint, transformedSourcePoint);
+    double targetPoint[3] = { 0.0, 0.0, 0.0 };
+    targetPoints->GetPoint(pointIndex, targetPoint);
+    sumOfSquaredDistances += vtkMath::Distance2BetweenPoints(transformedSourcePoint, targetPoint);
+  }
+  return sqrt(sumOfSquaredDistances / numberOfPoints);
+}
+
+//----------------------------------------------------------------------------
+double ComputeKernelRootMeanSquareError(vtkPoints* sourcePoints, vtkPoints* targetPoints)
+{
+  int numberOfPoints = sourcePoints->GetNumberOfPoints();
+  std::vector<double> sourceX(numberOfPoints), sourceY(numberOfPoints), sourceZ(numberOfPoints);
+  std::vector<double> targetX(numberOfPoints), targetY(numberOfPoints), targetZ(numberOfPoints);
+  for (int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    double point[3] = { 0.0, 0.0, 0.0 };
+    sourcePoints->GetPoint(pointIndex, point);
+    sourceX[pointIndex] = point[0];
+    sourceY[pointIndex] = point[1];
+    sourceZ[pointIndex] = point[2];
+    targetPoints->GetPoint(pointIndex, point);
+    targetX[pointIndex] = point[0];
+    targetY[pointIndex] = point[1];
+    targetZ[pointIndex] = point[2];
+  }
+  return vtkPointMatcher::ComputeRigidRegistrationRootMeanSquareError(numberOfPoints,
+    sourceX.data(), sourceY.data(), sourceZ.data(), targetX.data(), targetY.data(), targetZ.data());
+}
+
+//----------------------------------------------------------------------------
+bool CompareWithReference(vtkPoints* sourcePoints, vtkPoints* targetPoints, const std::string& caseName)
+{
+  double expectedError = ComputeReferenceRootMeanSquareError(sourcePoints, targetPoints);
+  double actualError = ComputeKernelRootMeanSquareError(sourcePoints, targetPoints);
+  if (fabs(expectedError - actualError) > epsilon)
+  {
+    std::cerr << "Registration error mismatch (" << caseName << ", " << sourcePoints->GetNumberOfPoints() << " points)."
+      << " Expected: " << expectedError << ", actual: " << actualError << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkPointMatcherRegistrationErrorTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence randomSequence;
+
+  bool success = true;
+  for (int numberOfPoints = 3; numberOfPoints <= 12; ++numberOfPoints)
+  {
+    vtkNew<vtkTransform> sourceToTargetTransform;
+    randomSequence.ConcatenateRandomRigidTransform(sourceToTargetTransform);
+
+    vtkNew<vtkPoints> sourcePoints;
+    vtkNew<vtkPoints> exactTargetPoints;
+    vtkNew<vtkPoints> noisyTargetPoints;
+    vtkNew<vtkPoints> mirroredTargetPoints;
+    for (int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      double sourcePoint[3] = { 0.0, 0.0, 0.0 };
+      for (int i = 0; i < 3; ++i)
+      {
+        sourcePoint[i] = randomSequence.GetNextValue(-50.0, 50.0);
+      }
+      sourcePoints->InsertNextPoint(sourcePoint);
+
+      double targetPoint[3] = { 0.0, 0.0, 0.0 };
+      sourceToTargetTransform->TransformPoint(sourcePoint, targetPoint);
+      exactTargetPoints->InsertNextPoint(targetPoint);
+      for (int i = 0; i < 3; ++i)
+      {
+        targetPoint[i] += randomSequence.GetNextValue(-2.0, 2.0);
+      }
+      noisyTargetPoints->InsertNextPoint(targetPoint);
+      // a mirror image cannot be matched by a rotation, so it results in large residuals
+      mirroredTargetPoints->InsertNextPoint(-targetPoint[0], targetPoint[1], targetPoint[2]);
+    }
+
+    double exactError = ComputeKernelRootMeanSquareError(sourcePoints, exactTargetPoints);
+    if (exactError > epsilon)
+    {
+      std::cerr << "Registration error of exactly transformed points is not zero (" << numberOfPoints << " points): " << exactError << std::endl;
+      success = false;
+    }
+    success &= CompareWithReference(sourcePoints, noisyTargetPoints, "noisy");
+    success &= CompareWithReference(sourcePoints, mirroredTargetPoints, "mirrored");
+  }
+
+  // degenerate configuration: collinear points, rotation around the line is undetermined
+  vtkNew<vtkPoints> collinearSourcePoints;
+  vtkNew<vtkPoints> collinearTargetPoints;
+  for (int pointIndex = 0; pointIndex < 4; ++pointIndex)
+  {
+    collinearSourcePoints->InsertNextPoint(10.0 * pointIndex, 0.0, 0.0);
+    collinearTargetPoints->InsertNextPoint(5.0, 10.0 * pointIndex + 0.5 * (pointIndex % 2), 3.0);
+  }
+  success &= CompareWithReference(collinearSourcePoints, collinearTargetPoints, "collinear");
+
+  // invalid coordinates: the eigenvector computation does not converge, the error value must be returned
+  vtkNew<vtkPoints> invalidTargetPoints;
+  invalidTargetPoints->DeepCopy(collinearTargetPoints);
+  invalidTargetPoints->SetPoint(1, std::nan(""), 0.0, 0.0);
+  double invalidError = ComputeKernelRootMeanSquareError(collinearSourcePoints, invalidTargetPoints);
+  if (invalidError != VTK_DOUBLE_MAX)
+  {
+    std::cerr << "Registration error of invalid points is expected to be VTK_DOUBLE_MAX, actual: " << invalidError << std::endl;
+    success = false;
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  std::cout << "Rigid registration error kernel matches vtkLandmarkTransform." << std::endl;
+  return EXIT_SUCCESS;
+}
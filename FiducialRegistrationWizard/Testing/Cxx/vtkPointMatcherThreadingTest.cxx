@@ -0,0 +1,150 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// SlicerIGT includes
+#include <vtkPointMatcher.h>
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkTransform.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+const int NUMBER_OF_THREADS = 4;
+
+//----------------------------------------------------------------------------
+struct MatchingResult
+{
+  vtkNew<vtkPoints> OutputSourcePoints;
+  vtkNew<vtkPoints> OutputTargetPoints;
+  double ComputedDistanceError;
+  bool MatchingAmbiguous;
+};
+
+//----------------------------------------------------------------------------
+void ComputeMatching(vtkPoints* sourcePoints, vtkPoints* targetPoints, int numberOfThreads, MatchingResult& result)
+{
+  vtkSMPTools::Initialize(numberOfThreads);
+  vtkNew<vtkPointMatcher> pointMatcher;
+  pointMatcher->SetInputSourcePoints(sourcePoints);
+  pointMatcher->SetInputTargetPoints(targetPoints);
+  pointMatcher->SetMaximumDifferenceInNumberOfPoints(2);
+  pointMatcher->Update();
+  result.OutputSourcePoints->DeepCopy(pointMatcher->GetOutputSourcePoints());
+  result.OutputTargetPoints->DeepCopy(pointMatcher->GetOutputTargetPoints());
+  result.ComputedDistanceError = pointMatcher->GetComputedDistanceError();
+  result.MatchingAmbiguous = pointMatcher->IsMatchingAmbiguous();
+}
+
+//----------------------------------------------------------------------------
+// The result must be exactly the same, regardless of how the candidates are split between threads
+bool TestSameResultWithAnyNumberOfThreads(vtkPoints* sourcePoints, vtkPoints* targetPoints, const std::string& caseName)
+{
+  MatchingResult singleThreadResult;
+  ComputeMatching(sourcePoints, targetPoints, 1, singleThreadResult);
+  MatchingResult multiThreadResult;
+  ComputeMatching(sourcePoints, targetPoints, NUMBER_OF_THREADS, multiThreadResult);
+
+  if (multiThreadResult.ComputedDistanceError != singleThreadResult.ComputedDistanceError)
+  {
+    std::cerr << "Distance error mismatch (" << caseName << "). Single thread: " << singleThreadResult.ComputedDistanceError
+      << ", multiple threads: " << multiThreadResult.ComputedDistanceError << std::endl;
+    return false;
+  }
+  if (multiThreadResult.MatchingAmbiguous != singleThreadResult.MatchingAmbiguous)
+  {
+    std::cerr << "Ambiguity flag mismatch (" << caseName << "). Single thread: " << singleThreadResult.MatchingAmbiguous
+      << ", multiple threads: " << multiThreadResult.MatchingAmbiguous << std::endl;
+    return false;
+  }
+  vtkIdType numberOfMatchedPoints = singleThreadResult.OutputSourcePoints->GetNumberOfPoints();
+  if (multiThreadResult.OutputSourcePoints->GetNumberOfPoints() != numberOfMatchedPoints
+    || multiThreadResult.OutputTargetPoints->GetNumberOfPoints() != numberOfMatchedPoints
+    || singleThreadResult.OutputTargetPoints->GetNumberOfPoints() != numberOfMatchedPoints)
+  {
+    std::cerr << "Number of matched points mismatch (" << caseName << ")." << std::endl;
+    return false;
+  }
+  for (vtkIdType pointIndex = 0; pointIndex < numberOfMatchedPoints; ++pointIndex)
+  {
+    double* singleThreadSourcePoint = singleThreadResult.OutputSourcePoints->GetPoint(pointIndex);
+    double* multiThreadSourcePoint = multiThreadResult.OutputSourcePoints->GetPoint(pointIndex);
+    double* singleThreadTargetPoint = singleThreadResult.OutputTargetPoints->GetPoint(pointIndex);
+    double* multiThreadTargetPoint = multiThreadResult.OutputTargetPoints->GetPoint(pointIndex);
+    for (int i = 0; i < 3; ++i)
+    {
+      if (multiThreadSourcePoint[i] != singleThreadSourcePoint[i] || multiThreadTargetPoint[i] != singleThreadTargetPoint[i])
+      {
+        std::cerr << "Matched point " << pointIndex << " mismatch (" << caseName << ")." << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkPointMatcherThreadingTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkTransform> sourceToTargetTransform;
+  sourceToTargetTransform->Translate(-20.0, 15.0, 60.0);
+  sourceToTargetTransform->RotateWXYZ(35.0, 0.2, 0.9, -0.4);
+
+  // irregular point set, target points are in a different order and two of them are missing
+  const double irregularSourceCoordinates[8][3] = {
+    { 0.0, 0.0, 0.0 }, { 42.0, 3.0, -5.0 }, { 7.0, 61.0, 2.0 }, { -18.0, 25.0, 33.0 },
+    { 55.0, 48.0, 12.0 }, { -30.0, -22.0, 8.0 }, { 20.0, -40.0, -25.0 }, { 65.0, -15.0, 40.0 } };
+  const int irregularTargetOrder[6] = { 4, 0, 7, 2, 6, 3 };
+  vtkNew<vtkPoints> irregularSourcePoints;
+  for (int pointIndex = 0; pointIndex < 8; ++pointIndex)
+  {
+    irregularSourcePoints->InsertNextPoint(irregularSourceCoordinates[pointIndex]);
+  }
+  vtkNew<vtkPoints> irregularTargetPoints;
+  for (int pointIndex = 0; pointIndex < 6; ++pointIndex)
+  {
+    irregularTargetPoints->InsertNextPoint(sourceToTargetTransform->TransformPoint(irregularSourceCoordinates[irregularTargetOrder[pointIndex]]));
+  }
+
+  // corners of a rectangular box: many orderings have the same error, so the result depends on
+  // which of the equally good candidates is kept, and the matching is ambiguous
+  vtkNew<vtkPoints> boxSourcePoints;
+  vtkNew<vtkPoints> boxTargetPoints;
+  for (int cornerIndex = 0; cornerIndex < 8; ++cornerIndex)
+  {
+    double corner[3] = { (cornerIndex & 1) ? 40.0 : 0.0, (cornerIndex & 2) ? 25.0 : 0.0, (cornerIndex & 4) ? 10.0 : 0.0 };
+    boxSourcePoints->InsertNextPoint(corner);
+    if (cornerIndex != 5)
+    {
+      boxTargetPoints->InsertNextPoint(sourceToTargetTransform->TransformPoint(corner));
+    }
+  }
+
+  bool success = true;
+  success &= TestSameResultWithAnyNumberOfThreads(irregularSourcePoints, irregularTargetPoints, "irregular points");
+  success &= TestSameResultWithAnyNumberOfThreads(boxSourcePoints, boxTargetPoints, "box corners");
+  vtkSMPTools::Initialize(0);
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  std::cout << "Point matcher threading test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
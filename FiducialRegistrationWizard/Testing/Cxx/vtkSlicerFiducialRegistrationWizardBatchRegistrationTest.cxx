@@ -0,0 +1,262 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// SlicerIGT includes
+#include <vtkMRMLFiducialRegistrationWizardNode.h>
+#include <vtkSlicerFiducialRegistrationWizardLogic.h>
+#include "vtkSlicerFiducialRegistrationWizardTestingUtilities.h"
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkDoubleArray.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTransform.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+const int NUMBER_OF_BATCH_REGISTRATION_PAIRS = 20;
+const int NUMBER_OF_POINTS_PER_PAIR = 6;
+const double MAXIMUM_MATRIX_ELEMENT_ERROR = 1.0e-6;
+const double MAXIMUM_RMS_ERROR_MM = 1.0e-6;
+
+//----------------------------------------------------------------------------
+// Register the pairs, the last pair is collinear, therefore its registration is expected to fail
+bool TestBatchRegistration(int pointMatching)
+{
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence randomSequence;
+
+  vtkNew<vtkCollection> fromPointsCollection;
+  vtkNew<vtkCollection> toPointsCollection;
+  std::vector< vtkSmartPointer<vtkTransform> > expectedTransforms;
+  for (int pairIndex = 0; pairIndex < NUMBER_OF_BATCH_REGISTRATION_PAIRS; ++pairIndex)
+  {
+    vtkSmartPointer<vtkTransform> fromToTransform = vtkSmartPointer<vtkTransform>::New();
+    randomSequence.ConcatenateRandomRigidTransform(fromToTransform);
+    expectedTransforms.push_back(fromToTransform);
+
+    vtkNew<vtkPoints> fromPoints;
+    for (int pointIndex = 0; pointIndex < NUMBER_OF_POINTS_PER_PAIR; ++pointIndex)
+    {
+      if (pairIndex == NUMBER_OF_BATCH_REGISTRATION_PAIRS - 1)
+      {
+        fromPoints->InsertNextPoint(10.0 * pointIndex, 0.0, 0.0);
+      }
+      else
+      {
+        fromPoints->InsertNextPoint(randomSequence.GetNextValue(-50.0, 50.0), randomSequence.GetNextValue(-50.0, 50.0), randomSequence.GetNextValue(-50.0, 50.0));
+      }
+    }
+    vtkNew<vtkPoints> toPoints;
+    for (int pointIndex = 0; pointIndex < NUMBER_OF_POINTS_PER_PAIR; ++pointIndex)
+    {
+      // automatic point matching has to find the pairs, so the points are in reverse order
+      int fromPointIndex = pointIndex;
+      if (pointMatching == vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_AUTOMATIC)
+      {
+        fromPointIndex = NUMBER_OF_POINTS_PER_PAIR - 1 - pointIndex;
+      }
+      double toPoint[3] = { 0.0, 0.0, 0.0 };
+      fromToTransform->TransformPoint(fromPoints->GetPoint(fromPointIndex), toPoint);
+      toPoints->InsertNextPoint(toPoint);
+    }
+    fromPointsCollection->AddItem(fromPoints);
+    toPointsCollection->AddItem(toPoints);
+  }
+
+  vtkNew<vtkCollection> outputMatrices;
+  vtkNew<vtkDoubleArray> outputErrors;
+  vtkNew<vtkStringArray> outputStatusMessages;
+  bool allSuccessful = vtkSlicerFiducialRegistrationWizardLogic::ComputeRegistrations(fromPointsCollection, toPointsCollection,
+    vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_RIGID, pointMatching,
+    outputMatrices, outputErrors, outputStatusMessages);
+  std::string pointMatchingName = vtkMRMLFiducialRegistrationWizardNode::PointMatchingAsString(pointMatching);
+  if (allSuccessful)
+  {
+    std::cerr << "Registration of collinear points is expected to fail (" << pointMatchingName << " point matching)" << std::endl;
+    return false;
+  }
+  if (outputMatrices->GetNumberOfItems() != NUMBER_OF_BATCH_REGISTRATION_PAIRS
+    || outputErrors->GetNumberOfValues() != NUMBER_OF_BATCH_REGISTRATION_PAIRS
+    || outputStatusMessages->GetNumberOfValues() != NUMBER_OF_BATCH_REGISTRATION_PAIRS)
+  {
+    std::cerr << "Unexpected number of outputs (" << pointMatchingName << " point matching)" << std::endl;
+    return false;
+  }
+
+  bool success = true;
+  for (int pairIndex = 0; pairIndex < NUMBER_OF_BATCH_REGISTRATION_PAIRS; ++pairIndex)
+  {
+    if (outputStatusMessages->GetValue(pairIndex).empty())
+    {
+      std::cerr << "Status message of pair " << pairIndex << " is empty (" << pointMatchingName << " point matching)" << std::endl;
+      success = false;
+    }
+    if (pairIndex == NUMBER_OF_BATCH_REGISTRATION_PAIRS - 1)
+    {
+      if (outputErrors->GetValue(pairIndex) != VTK_DOUBLE_MAX)
+      {
+        std::cerr << "Registration of collinear points is expected to fail (" << pointMatchingName << " point matching)" << std::endl;
+        success = false;
+      }
+      continue;
+    }
+    if (outputErrors->GetValue(pairIndex) > MAXIMUM_RMS_ERROR_MM)
+    {
+      std::cerr << "Registration of pair " << pairIndex << " failed (" << pointMatchingName << " point matching), error: "
+        << outputErrors->GetValue(pairIndex) << ", message: " << outputStatusMessages->GetValue(pairIndex) << std::endl;
+      success = false;
+      continue;
+    }
+    vtkMatrix4x4* computedMatrix = vtkMatrix4x4::SafeDownCast(outputMatrices->GetItemAsObject(pairIndex));
+    vtkMatrix4x4* expectedMatrix = expectedTransforms[pairIndex]->GetMatrix();
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        if (fabs(computedMatrix->GetElement(row, column) - expectedMatrix->GetElement(row, column)) > MAXIMUM_MATRIX_ELEMENT_ERROR)
+        {
+          std::cerr << "Computed matrix of pair " << pairIndex << " does not match the expected matrix ("
+            << pointMatchingName << " point matching)" << std::endl;
+          success = false;
+          row = 4;
+          break;
+        }
+      }
+    }
+  }
+  return success;
+}
+
+//----------------------------------------------------------------------------
+// Register the same template point list to many point lists, all registrations are computed in parallel
+// from the same 'From' vtkPoints object.
+bool TestBatchRegistrationSharedTemplate(int pointMatching)
+{
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence randomSequence;
+
+  vtkNew<vtkPoints> templatePoints;
+  for (int pointIndex = 0; pointIndex < NUMBER_OF_POINTS_PER_PAIR; ++pointIndex)
+  {
+    templatePoints->InsertNextPoint(randomSequence.GetNextValue(-50.0, 50.0), randomSequence.GetNextValue(-50.0, 50.0), randomSequence.GetNextValue(-50.0, 50.0));
+  }
+  vtkNew<vtkPoints> originalTemplatePoints;
+  originalTemplatePoints->DeepCopy(templatePoints);
+
+  vtkNew<vtkCollection> fromPointsCollection;
+  vtkNew<vtkCollection> toPointsCollection;
+  std::vector< vtkSmartPointer<vtkTransform> > expectedTransforms;
+  for (int pairIndex = 0; pairIndex < NUMBER_OF_BATCH_REGISTRATION_PAIRS; ++pairIndex)
+  {
+    vtkSmartPointer<vtkTransform> fromToTransform = vtkSmartPointer<vtkTransform>::New();
+    randomSequence.ConcatenateRandomRigidTransform(fromToTransform);
+    expectedTransforms.push_back(fromToTransform);
+
+    vtkNew<vtkPoints> toPoints;
+    for (int pointIndex = 0; pointIndex < NUMBER_OF_POINTS_PER_PAIR; ++pointIndex)
+    {
+      // automatic point matching has to find the pairs, so the points are in reverse order
+      int fromPointIndex = pointIndex;
+      if (pointMatching == vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_AUTOMATIC)
+      {
+        fromPointIndex = NUMBER_OF_POINTS_PER_PAIR - 1 - pointIndex;
+      }
+      double toPoint[3] = { 0.0, 0.0, 0.0 };
+      fromToTransform->TransformPoint(templatePoints->GetPoint(fromPointIndex), toPoint);
+      toPoints->InsertNextPoint(toPoint);
+    }
+    fromPointsCollection->AddItem(templatePoints);
+    toPointsCollection->AddItem(toPoints);
+  }
+
+  vtkNew<vtkCollection> outputMatrices;
+  vtkNew<vtkDoubleArray> outputErrors;
+  vtkNew<vtkStringArray> outputStatusMessages;
+  bool allSuccessful = vtkSlicerFiducialRegistrationWizardLogic::ComputeRegistrations(fromPointsCollection, toPointsCollection,
+    vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_RIGID, pointMatching,
+    outputMatrices, outputErrors, outputStatusMessages);
+  std::string pointMatchingName = vtkMRMLFiducialRegistrationWizardNode::PointMatchingAsString(pointMatching);
+  if (!allSuccessful)
+  {
+    std::cerr << "Registration to shared template failed (" << pointMatchingName << " point matching)" << std::endl;
+    return false;
+  }
+  if (outputMatrices->GetNumberOfItems() != NUMBER_OF_BATCH_REGISTRATION_PAIRS)
+  {
+    std::cerr << "Unexpected number of outputs (" << pointMatchingName << " point matching, shared template)" << std::endl;
+    return false;
+  }
+
+  bool success = true;
+  for (int pointIndex = 0; pointIndex < NUMBER_OF_POINTS_PER_PAIR; ++pointIndex)
+  {
+    if (vtkMath::Distance2BetweenPoints(templatePoints->GetPoint(pointIndex), originalTemplatePoints->GetPoint(pointIndex)) != 0.0)
+    {
+      std::cerr << "Template point " << pointIndex << " is modified by the registration (" << pointMatchingName << " point matching)" << std::endl;
+      success = false;
+    }
+  }
+  for (int pairIndex = 0; pairIndex < NUMBER_OF_BATCH_REGISTRATION_PAIRS; ++pairIndex)
+  {
+    if (outputErrors->GetValue(pairIndex) > MAXIMUM_RMS_ERROR_MM)
+    {
+      std::cerr << "Registration of pair " << pairIndex << " to shared template failed (" << pointMatchingName << " point matching), error: "
+        << outputErrors->GetValue(pairIndex) << ", message: " << outputStatusMessages->GetValue(pairIndex) << std::endl;
+      success = false;
+      continue;
+    }
+    vtkMatrix4x4* computedMatrix = vtkMatrix4x4::SafeDownCast(outputMatrices->GetItemAsObject(pairIndex));
+    vtkMatrix4x4* expectedMatrix = expectedTransforms[pairIndex]->GetMatrix();
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        if (fabs(computedMatrix->GetElement(row, column) - expectedMatrix->GetElement(row, column)) > MAXIMUM_MATRIX_ELEMENT_ERROR)
+        {
+          std::cerr << "Computed matrix of pair " << pairIndex << " does not match the expected matrix ("
+            << pointMatchingName << " point matching, shared template)" << std::endl;
+          success = false;
+          row = 4;
+          break;
+        }
+      }
+    }
+  }
+  return success;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerFiducialRegistrationWizardBatchRegistrationTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  bool success = true;
+  success &= TestBatchRegistration(vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_MANUAL);
+  success &= TestBatchRegistration(vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_AUTOMATIC);
+  success &= TestBatchRegistrationSharedTemplate(vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_MANUAL);
+  success &= TestBatchRegistrationSharedTemplate(vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_AUTOMATIC);
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  std::cout << "Batch registration test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,262 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// SlicerIGT includes
+#include <vtkMRMLFiducialRegistrationWizardNode.h>
+#include <vtkSlicerFiducialRegistrationWizardLogic.h>
+#include "vtkSlicerFiducialRegistrationWizardTestingUtilities.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLMarkupsFiducialNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkDoubleArray.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkStringArray.h>
+#include <vtkTransform.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+const int NUMBER_OF_INITIAL_POINT_PAIRS = 4;
+const int NUMBER_OF_APPENDED_POINT_PAIRS = 6;
+const double MAXIMUM_MATRIX_ELEMENT_DIFFERENCE = 1.0e-6;
+const double MAXIMUM_RMS_ERROR_DIFFERENCE_MM = 1.0e-6;
+
+//----------------------------------------------------------------------------
+// Compare the registration stored in the node with a registration that is computed from all the points
+bool CheckRegistration(vtkMRMLFiducialRegistrationWizardNode* frwNode, const std::string& caseName)
+{
+  vtkNew<vtkPoints> fromPoints;
+  vtkNew<vtkPoints> toPoints;
+  for (int pointIndex = 0; pointIndex < frwNode->GetFromFiducialListNode()->GetNumberOfControlPoints(); ++pointIndex)
+  {
+    double point[3] = { 0.0, 0.0, 0.0 };
+    frwNode->GetFromFiducialListNode()->GetNthControlPointPosition(pointIndex, point);
+    fromPoints->InsertNextPoint(point);
+    frwNode->GetToFiducialListNode()->GetNthControlPointPosition(pointIndex, point);
+    toPoints->InsertNextPoint(point);
+  }
+  vtkNew<vtkCollection> fromPointsCollection;
+  fromPointsCollection->AddItem(fromPoints);
+  vtkNew<vtkCollection> toPointsCollection;
+  toPointsCollection->AddItem(toPoints);
+  vtkNew<vtkCollection> expectedMatrices;
+  vtkNew<vtkDoubleArray> expectedErrors;
+  vtkNew<vtkStringArray> expectedStatusMessages;
+  if (!vtkSlicerFiducialRegistrationWizardLogic::ComputeRegistrations(fromPointsCollection, toPointsCollection,
+    frwNode->GetRegistrationMode(), vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_MANUAL,
+    expectedMatrices, expectedErrors, expectedStatusMessages))
+  {
+    std::cerr << "Complete registration failed (" << caseName << "): " << expectedStatusMessages->GetValue(0) << std::endl;
+    return false;
+  }
+
+  if (fabs(frwNode->GetCalibrationError() - expectedErrors->GetValue(0)) > MAXIMUM_RMS_ERROR_DIFFERENCE_MM)
+  {
+    std::cerr << "RMS error mismatch (" << caseName << "). Expected: " << expectedErrors->GetValue(0)
+      << ", actual: " << frwNode->GetCalibrationError() << std::endl;
+    return false;
+  }
+  vtkNew<vtkMatrix4x4> actualMatrix;
+  frwNode->GetOutputTransformNode()->GetMatrixTransformToParent(actualMatrix);
+  vtkMatrix4x4* expectedMatrix = vtkMatrix4x4::SafeDownCast(expectedMatrices->GetItemAsObject(0));
+  for (int row = 0; row < 4; ++row)
+  {
+    for (int column = 0; column < 4; ++column)
+    {
+      if (fabs(actualMatrix->GetElement(row, column) - expectedMatrix->GetElement(row, column)) > MAXIMUM_MATRIX_ELEMENT_DIFFERENCE)
+      {
+        std::cerr << "Matrix mismatch (" << caseName << ") at (" << row << ", " << column << "). Expected: "
+          << expectedMatrix->GetElement(row, column) << ", actual: " << actualMatrix->GetElement(row, column) << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+struct CalibrationUpdateCounts
+{
+  int Incremental{ 0 };
+  int Complete{ 0 };
+};
+
+//----------------------------------------------------------------------------
+CalibrationUpdateCounts GetCalibrationUpdateCounts(vtkSlicerFiducialRegistrationWizardLogic* logic)
+{
+  CalibrationUpdateCounts counts;
+  counts.Incremental = logic->GetNumberOfIncrementalCalibrationUpdates();
+  counts.Complete = logic->GetNumberOfCompleteCalibrationUpdates();
+  return counts;
+}
+
+//----------------------------------------------------------------------------
+// Check that the registrations since countsBefore were all computed incrementally or all completely
+bool CheckUpdatePath(vtkSlicerFiducialRegistrationWizardLogic* logic, const CalibrationUpdateCounts& countsBefore,
+  bool incrementalUpdateExpected, const std::string& caseName)
+{
+  CalibrationUpdateCounts countsAfter = GetCalibrationUpdateCounts(logic);
+  int numberOfIncrementalUpdates = countsAfter.Incremental - countsBefore.Incremental;
+  int numberOfCompleteUpdates = countsAfter.Complete - countsBefore.Complete;
+  bool pathAsExpected = incrementalUpdateExpected
+    ? (numberOfIncrementalUpdates > 0 && numberOfCompleteUpdates == 0)
+    : (numberOfCompleteUpdates > 0 && numberOfIncrementalUpdates == 0);
+  if (!pathAsExpected)
+  {
+    std::cerr << "Unexpected update path (" << caseName << "). Expected: " << (incrementalUpdateExpected ? "incremental" : "complete")
+      << ", number of incremental updates: " << numberOfIncrementalUpdates
+      << ", number of complete updates: " << numberOfCompleteUpdates << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Points are appended and edited one by one, with automatic update, therefore most registrations must be computed incrementally.
+// Editing several points between updates or removing points requires a complete update.
+bool TestIncrementalUpdate(int registrationMode)
+{
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence randomSequence;
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerFiducialRegistrationWizardLogic> logic;
+  logic->SetMRMLScene(scene);
+
+  vtkNew<vtkMRMLMarkupsFiducialNode> fromNode;
+  scene->AddNode(fromNode);
+  vtkNew<vtkMRMLMarkupsFiducialNode> toNode;
+  scene->AddNode(toNode);
+  vtkNew<vtkMRMLLinearTransformNode> outputTransformNode;
+  scene->AddNode(outputTransformNode);
+
+  vtkNew<vtkMRMLFiducialRegistrationWizardNode> frwNode;
+  frwNode->SetRegistrationMode(registrationMode);
+  frwNode->SetPointMatching(vtkMRMLFiducialRegistrationWizardNode::POINT_MATCHING_MANUAL);
+  frwNode->SetUpdateMode(vtkMRMLFiducialRegistrationWizardNode::UPDATE_MODE_AUTOMATIC);
+  scene->AddNode(frwNode);
+  frwNode->SetAndObserveFromFiducialListNodeId(fromNode->GetID());
+  frwNode->SetAndObserveToFiducialListNodeId(toNode->GetID());
+  frwNode->SetOutputTransformNodeId(outputTransformNode->GetID());
+
+  vtkNew<vtkTransform> fromToTransform;
+  randomSequence.ConcatenateRandomRigidTransform(fromToTransform);
+  if (registrationMode == vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY)
+  {
+    fromToTransform->Scale(1.3, 1.3, 1.3);
+  }
+  // 'To' points are displaced by noise, so that the registration error is not zero
+  auto getToPoint = [&](const double fromPoint[3], double toPoint[3])
+  {
+    fromToTransform->TransformPoint(fromPoint, toPoint);
+    for (int i = 0; i < 3; ++i)
+    {
+      toPoint[i] += randomSequence.GetNextValue(-2.0, 2.0);
+    }
+  };
+
+  std::string registrationModeName = vtkMRMLFiducialRegistrationWizardNode::RegistrationModeAsString(registrationMode);
+  bool success = true;
+
+  // append point pairs, 'From' point first, then 'To' point
+  for (int pointIndex = 0; pointIndex < NUMBER_OF_INITIAL_POINT_PAIRS + NUMBER_OF_APPENDED_POINT_PAIRS; ++pointIndex)
+  {
+    double fromPoint[3] = { randomSequence.GetNextValue(-50.0, 50.0), randomSequence.GetNextValue(-50.0, 50.0), randomSequence.GetNextValue(-50.0, 50.0) };
+    double toPoint[3] = { 0.0, 0.0, 0.0 };
+    getToPoint(fromPoint, toPoint);
+    fromNode->AddFiducialFromArray(fromPoint);
+    CalibrationUpdateCounts countsBefore = GetCalibrationUpdateCounts(logic);
+    toNode->AddFiducialFromArray(toPoint);
+    if (pointIndex >= 2)
+    {
+      std::string caseName = registrationModeName + ", appended point " + std::to_string(pointIndex);
+      // the first registration has nothing to start from
+      success &= CheckUpdatePath(logic, countsBefore, pointIndex > 2, caseName);
+      success &= CheckRegistration(frwNode, caseName);
+    }
+  }
+
+  // edit existing points
+  for (int editIndex = 0; editIndex < 5; ++editIndex)
+  {
+    int pointIndex = (3 * editIndex + 1) % fromNode->GetNumberOfControlPoints();
+    double fromPoint[3] = { randomSequence.GetNextValue(-50.0, 50.0), randomSequence.GetNextValue(-50.0, 50.0), randomSequence.GetNextValue(-50.0, 50.0) };
+    std::string caseName = registrationModeName + ", edited 'From' point " + std::to_string(pointIndex);
+    CalibrationUpdateCounts countsBefore = GetCalibrationUpdateCounts(logic);
+    fromNode->SetNthControlPointPosition(pointIndex, fromPoint[0], fromPoint[1], fromPoint[2]);
+    success &= CheckUpdatePath(logic, countsBefore, true, caseName);
+    success &= CheckRegistration(frwNode, caseName);
+    double toPoint[3] = { 0.0, 0.0, 0.0 };
+    getToPoint(fromPoint, toPoint);
+    caseName = registrationModeName + ", edited 'To' point " + std::to_string(pointIndex);
+    countsBefore = GetCalibrationUpdateCounts(logic);
+    toNode->SetNthControlPointPosition(pointIndex, toPoint[0], toPoint[1], toPoint[2]);
+    success &= CheckUpdatePath(logic, countsBefore, true, caseName);
+    success &= CheckRegistration(frwNode, caseName);
+  }
+
+  // edit points while updates are paused: more than one point pair changes between updates
+  frwNode->SetUpdateMode(vtkMRMLFiducialRegistrationWizardNode::UPDATE_MODE_MANUAL);
+  CalibrationUpdateCounts countsBefore = GetCalibrationUpdateCounts(logic);
+  fromNode->SetNthControlPointPosition(0, 12.0, -7.0, 30.0);
+  toNode->SetNthControlPointPosition(2, -25.0, 14.0, 8.0);
+  logic->UpdateCalibration(frwNode);
+  success &= CheckUpdatePath(logic, countsBefore, false, registrationModeName + ", multiple edited points");
+  success &= CheckRegistration(frwNode, registrationModeName + ", multiple edited points");
+
+  // remove a point pair
+  countsBefore = GetCalibrationUpdateCounts(logic);
+  fromNode->RemoveNthControlPoint(1);
+  toNode->RemoveNthControlPoint(1);
+  logic->UpdateCalibration(frwNode);
+  success &= CheckUpdatePath(logic, countsBefore, false, registrationModeName + ", removed point");
+  success &= CheckRegistration(frwNode, registrationModeName + ", removed point");
+  frwNode->SetUpdateMode(vtkMRMLFiducialRegistrationWizardNode::UPDATE_MODE_AUTOMATIC);
+
+  // append after removal
+  double fromPoint[3] = { 40.0, 35.0, -20.0 };
+  double toPoint[3] = { 0.0, 0.0, 0.0 };
+  getToPoint(fromPoint, toPoint);
+  fromNode->AddFiducialFromArray(fromPoint);
+  countsBefore = GetCalibrationUpdateCounts(logic);
+  toNode->AddFiducialFromArray(toPoint);
+  success &= CheckUpdatePath(logic, countsBefore, true, registrationModeName + ", appended point after removal");
+  success &= CheckRegistration(frwNode, registrationModeName + ", appended point after removal");
+
+  return success;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerFiducialRegistrationWizardIncrementalUpdateTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  bool success = true;
+  success &= TestIncrementalUpdate(vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_RIGID);
+  success &= TestIncrementalUpdate(vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_SIMILARITY);
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+  std::cout << "Incremental update test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerFiducialRegistrationWizardTestingUtilities_h
+#define __vtkSlicerFiducialRegistrationWizardTestingUtilities_h
+
+// VTK includes
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkNew.h>
+#include <vtkTransform.h>
+
+#include <algorithm>
+#include <vector>
+
+// Helpers for generating reproducible test data in the Fiducial registration wizard tests
+namespace vtkSlicerFiducialRegistrationWizardTestingUtilities
+{
+  // All tests use the same seed, so that their input data is the same in every run
+  const int RANDOM_SEED = 12345;
+
+  //----------------------------------------------------------------------------
+  class RandomSequence
+  {
+  public:
+    RandomSequence()
+    {
+      this->Sequence->SetSeed(RANDOM_SEED);
+    }
+
+    double GetNextValue(double rangeMin, double rangeMax)
+    {
+      this->Sequence->Next();
+      return this->Sequence->GetRangeValue(rangeMin, rangeMax);
+    }
+
+    // Returns the indices 0..numberOfElements-1 in random order (Fisher-Yates shuffle)
+    std::vector<int> GetShuffledOrder(int numberOfElements)
+    {
+      std::vector<int> order(numberOfElements);
+      for (int index = 0; index < numberOfElements; ++index)
+      {
+        order[index] = index;
+      }
+      for (int index = numberOfElements - 1; index > 0; --index)
+      {
+        int otherIndex = std::min(static_cast<int>(this->GetNextValue(0.0, index + 1)), index);
+        std::swap(order[index], order[otherIndex]);
+      }
+      return order;
+    }
+
+    // Appends a random translation (within +/-100 mm) and a random rotation to the transform
+    void ConcatenateRandomRigidTransform(vtkTransform* transform)
+    {
+      double translation[3] = { 0.0, 0.0, 0.0 };
+      for (int i = 0; i < 3; ++i)
+      {
+        translation[i] = this->GetNextValue(-100.0, 100.0);
+      }
+      double angleDeg = this->GetNextValue(-180.0, 180.0);
+      double axis[3] = { 0.0, 0.0, 0.0 };
+      for (int i = 0; i < 3; ++i)
+      {
+        axis[i] = this->GetNextValue(-1.0, 1.0);
+      }
+      transform->Translate(translation);
+      transform->RotateWXYZ(angleDeg, axis);
+    }
+
+  private:
+    vtkNew<vtkMinimalStandardRandomSequence> Sequence;
+  };
+
+  //----------------------------------------------------------------------------
+  // Fixed rigid transform between the source and target point sets of the point matching tests
+  inline void SetSourceToTargetTransform(vtkTransform* transform)
+  {
+    transform->Identity();
+    transform->Translate(30.0, -120.0, 45.0);
+    transform->RotateWXYZ(70.0, 0.3, -0.5, 0.8);
+  }
+}
+
+#endif
@@ -0,0 +1,251 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// SlicerIGT includes
+#include <vtkMRMLFiducialRegistrationWizardNode.h>
+#include <vtkSlicerFiducialRegistrationWizardLogic.h>
+#include "vtkSlicerFiducialRegistrationWizardTestingUtilities.h"
+
+// MRML includes
+#include <vtkMRMLMarkupsFiducialNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLTransformNode.h>
+
+// VTK includes
+#include <vtkAbstractTransform.h>
+#include <vtkGeneralTransform.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkThinPlateSplineTransform.h>
+#include <vtkTransform.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+const int NUMBER_OF_LANDMARKS = 30;
+const double GRID_SPACING_MM = 2.0;
+const double GRID_MARGIN_MM = 10.0;
+
+// Within the landmarks the grid transform approximates the thin-plate spline
+const double MAXIMUM_APPROXIMATION_ERROR_MM = 0.25;
+
+// Far from the landmarks the non-affine part of the thin-plate spline is negligible
+const double FAR_POINT_DISTANCE_MM = 1000.0;
+const double MAXIMUM_FAR_POINT_ERROR_MM = 1.0;
+
+//----------------------------------------------------------------------------
+// Compare the approximating transform with the thin-plate spline at random points within the landmarks
+// and at random points far away from them (outside of the grid)
+bool CheckApproximation(vtkThinPlateSplineTransform* tpsTransform, vtkAbstractTransform* approximatingTransform,
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence& randomSequence, const std::string& caseName)
+{
+  double bounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  tpsTransform->GetSourceLandmarks()->GetBounds(bounds);
+  double center[3] = { 0.0, 0.0, 0.0 };
+  for (int i = 0; i < 3; ++i)
+  {
+    center[i] = 0.5 * (bounds[2 * i] + bounds[2 * i + 1]);
+  }
+
+  for (int pointIndex = 0; pointIndex < 1000; ++pointIndex)
+  {
+    bool farPoint = (pointIndex % 2 == 1);
+    double point[3] = { 0.0, 0.0, 0.0 };
+    if (farPoint)
+    {
+      double direction[3] = { randomSequence.GetNextValue(-1.0, 1.0), randomSequence.GetNextValue(-1.0, 1.0), randomSequence.GetNextValue(-1.0, 1.0) };
+      vtkMath::Normalize(direction);
+      for (int i = 0; i < 3; ++i)
+      {
+        point[i] = center[i] + FAR_POINT_DISTANCE_MM * direction[i];
+      }
+    }
+    else
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        point[i] = randomSequence.GetNextValue(bounds[2 * i], bounds[2 * i + 1]);
+      }
+    }
+    double tpsTransformedPoint[3] = { 0.0, 0.0, 0.0 };
+    tpsTransform->TransformPoint(point, tpsTransformedPoint);
+    double approximatedTransformedPoint[3] = { 0.0, 0.0, 0.0 };
+    approximatingTransform->TransformPoint(point, approximatedTransformedPoint);
+    double approximationErrorMm = sqrt(vtkMath::Distance2BetweenPoints(tpsTransformedPoint, approximatedTransformedPoint));
+    if (approximationErrorMm > (farPoint ? MAXIMUM_FAR_POINT_ERROR_MM : MAXIMUM_APPROXIMATION_ERROR_MM))
+    {
+      std::cerr << "Grid transform differs from thin-plate spline transform (" << caseName << ") by " << approximationErrorMm << " mm at ("
+        << point[0] << ", " << point[1] << ", " << point[2] << ")" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Warping registration computed by the logic from a registration wizard node, with grid spacing and margin set in the node
+bool TestWarpingGridNode(vtkThinPlateSplineTransform* tpsTransform,
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence& randomSequence)
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerFiducialRegistrationWizardLogic> logic;
+  logic->SetMRMLScene(scene);
+
+  vtkNew<vtkMRMLMarkupsFiducialNode> fromNode;
+  scene->AddNode(fromNode);
+  vtkNew<vtkMRMLMarkupsFiducialNode> toNode;
+  scene->AddNode(toNode);
+  for (int landmarkIndex = 0; landmarkIndex < NUMBER_OF_LANDMARKS; ++landmarkIndex)
+  {
+    fromNode->AddFiducialFromArray(tpsTransform->GetSourceLandmarks()->GetPoint(landmarkIndex));
+    toNode->AddFiducialFromArray(tpsTransform->GetTargetLandmarks()->GetPoint(landmarkIndex));
+  }
+  vtkNew<vtkMRMLTransformNode> outputTransformNode;
+  scene->AddNode(outputTransformNode);
+
+  vtkNew<vtkMRMLFiducialRegistrationWizardNode> frwNode;
+  frwNode->SetRegistrationMode(vtkMRMLFiducialRegistrationWizardNode::REGISTRATION_MODE_WARPING);
+  frwNode->SetUpdateMode(vtkMRMLFiducialRegistrationWizardNode::UPDATE_MODE_MANUAL);
+  // 'From' to 'To' direction, so that the output can be compared to the thin-plate spline directly
+  frwNode->SetWarpingTransformFromParent(false);
+  frwNode->SetWarpingGridSpacing(GRID_SPACING_MM);
+  frwNode->SetWarpingGridMargin(GRID_MARGIN_MM);
+  scene->AddNode(frwNode);
+  frwNode->SetAndObserveFromFiducialListNodeId(fromNode->GetID());
+  frwNode->SetAndObserveToFiducialListNodeId(toNode->GetID());
+  frwNode->SetOutputTransformNodeId(outputTransformNode->GetID());
+
+  if (!logic->UpdateCalibration(frwNode))
+  {
+    std::cerr << "Warping registration failed: " << frwNode->GetCalibrationStatusMessage() << std::endl;
+    return false;
+  }
+  vtkAbstractTransform* outputTransform = outputTransformNode->GetTransformToParent();
+  if (vtkGeneralTransform::SafeDownCast(outputTransform) == nullptr)
+  {
+    std::cerr << "Output of the warping registration is not a grid transform, spacing is ignored." << std::endl;
+    return false;
+  }
+  if (!CheckApproximation(tpsTransform, outputTransform, randomSequence, "registration wizard node"))
+  {
+    return false;
+  }
+
+  // grid parameters are saved in the scene
+  vtkNew<vtkMRMLScene> savedScene;
+  vtkNew<vtkMRMLFiducialRegistrationWizardNode> savedNode;
+  savedNode->SetWarpingGridSpacing(GRID_SPACING_MM);
+  savedNode->SetWarpingGridMargin(GRID_MARGIN_MM);
+  savedScene->AddNode(savedNode);
+  savedScene->SetSaveToXMLString(1);
+  savedScene->Commit();
+
+  vtkNew<vtkMRMLScene> loadedScene;
+  vtkNew<vtkMRMLFiducialRegistrationWizardNode> nodeClass;
+  loadedScene->RegisterNodeClass(nodeClass);
+  loadedScene->SetLoadFromXMLString(1);
+  loadedScene->SetSceneXMLString(savedScene->GetSceneXMLString());
+  loadedScene->Import();
+  vtkMRMLFiducialRegistrationWizardNode* loadedNode = vtkMRMLFiducialRegistrationWizardNode::SafeDownCast(
+    loadedScene->GetFirstNodeByClass("vtkMRMLFiducialRegistrationWizardNode"));
+  if (loadedNode == nullptr)
+  {
+    std::cerr << "Registration wizard node is not found in the loaded scene." << std::endl;
+    return false;
+  }
+  if (loadedNode->GetWarpingGridSpacing() != GRID_SPACING_MM || loadedNode->GetWarpingGridMargin() != GRID_MARGIN_MM)
+  {
+    std::cerr << "Grid parameters are not restored from the scene. Spacing: " << loadedNode->GetWarpingGridSpacing()
+      << ", margin: " << loadedNode->GetWarpingGridMargin() << std::endl;
+    return false;
+  }
+
+  vtkNew<vtkMRMLFiducialRegistrationWizardNode> copiedNode;
+  copiedNode->Copy(frwNode);
+  if (copiedNode->GetWarpingGridSpacing() != GRID_SPACING_MM || copiedNode->GetWarpingGridMargin() != GRID_MARGIN_MM)
+  {
+    std::cerr << "Grid parameters are not copied. Spacing: " << copiedNode->GetWarpingGridSpacing()
+      << ", margin: " << copiedNode->GetWarpingGridMargin() << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerFiducialRegistrationWizardWarpingGridTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkSlicerFiducialRegistrationWizardTestingUtilities::RandomSequence randomSequence;
+
+  // landmarks are scaled, rotated, translated and randomly displaced by a few millimeters,
+  // so that the thin-plate spline has a significant affine component
+  vtkNew<vtkTransform> affineTransform;
+  affineTransform->Translate(20.0, -10.0, 5.0);
+  affineTransform->RotateZ(20.0);
+  affineTransform->Scale(1.1, 1.1, 1.1);
+  vtkNew<vtkPoints> sourceLandmarks;
+  vtkNew<vtkPoints> targetLandmarks;
+  for (int landmarkIndex = 0; landmarkIndex < NUMBER_OF_LANDMARKS; ++landmarkIndex)
+  {
+    double sourceLandmark[3] = { 0.0, 0.0, 0.0 };
+    double displacement[3] = { 0.0, 0.0, 0.0 };
+    for (int i = 0; i < 3; ++i)
+    {
+      sourceLandmark[i] = randomSequence.GetNextValue(-50.0, 50.0);
+      displacement[i] = randomSequence.GetNextValue(-3.0, 3.0);
+    }
+    double targetLandmark[3] = { 0.0, 0.0, 0.0 };
+    affineTransform->TransformPoint(sourceLandmark, targetLandmark);
+    vtkMath::Add(targetLandmark, displacement, targetLandmark);
+    sourceLandmarks->InsertNextPoint(sourceLandmark);
+    targetLandmarks->InsertNextPoint(targetLandmark);
+  }
+
+  vtkNew<vtkThinPlateSplineTransform> tpsTransform;
+  tpsTransform->SetBasisToR();
+  tpsTransform->SetSourceLandmarks(sourceLandmarks);
+  tpsTransform->SetTargetLandmarks(targetLandmarks);
+  tpsTransform->Update();
+
+  vtkNew<vtkGeneralTransform> gridTransform;
+  if (!vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform(tpsTransform, GRID_SPACING_MM, GRID_MARGIN_MM, gridTransform))
+  {
+    std::cerr << "Failed to convert thin-plate spline transform to grid transform." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!CheckApproximation(tpsTransform, gridTransform, randomSequence, "conversion"))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // too many grid points
+  if (vtkSlicerFiducialRegistrationWizardLogic::ConvertThinPlateSplineToGridTransform(tpsTransform, 0.01, GRID_MARGIN_MM, gridTransform))
+  {
+    std::cerr << "Conversion to a grid with too small spacing was expected to fail." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!TestWarpingGridNode(tpsTransform, randomSequence))
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Warping grid test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
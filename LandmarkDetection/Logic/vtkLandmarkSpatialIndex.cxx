@@ -0,0 +1,118 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkLandmarkSpatialIndex.h"
+
+// MRML includes
+#include <vtkMRMLMarkupsFiducialNode.h>
+
+// VTK includes
+#include <vtkMath.h>
+
+// STD includes
+#include <cmath>
+
+//----------------------------------------------------------------------------
+void vtkLandmarkSpatialIndex::Initialize(vtkMRMLMarkupsFiducialNode* markupsNode, double minimumDistanceMm)
+{
+  this->Cells.clear();
+  this->MarkupsNode = markupsNode;
+  this->MinimumDistanceMm = minimumDistanceMm;
+  this->Modified = false;
+  if (!markupsNode)
+  {
+    return;
+  }
+  for (int i = 0; i < markupsNode->GetNumberOfControlPoints(); ++i)
+  {
+    if (markupsNode->GetNthControlPointPositionStatus(i) != vtkMRMLMarkupsNode::PositionDefined)
+    {
+      continue;
+    }
+    this->AddPoint(markupsNode->GetNthControlPointPosition(i));
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkLandmarkSpatialIndex::IsInitializationRequired(vtkMRMLMarkupsFiducialNode* markupsNode, double minimumDistanceMm) const
+{
+  return this->Modified || this->MarkupsNode != markupsNode || this->MinimumDistanceMm != minimumDistanceMm;
+}
+
+//----------------------------------------------------------------------------
+void vtkLandmarkSpatialIndex::SetModified()
+{
+  this->Modified = true;
+}
+
+//----------------------------------------------------------------------------
+void vtkLandmarkSpatialIndex::AddPoint(const double position[3])
+{
+  if (this->MinimumDistanceMm <= 0.0)
+  {
+    // No proximity check, points are not needed
+    return;
+  }
+  std::array<double, 3> point = { { position[0], position[1], position[2] } };
+  this->Cells[this->GetCellIndex(position)].push_back(point);
+}
+
+//----------------------------------------------------------------------------
+bool vtkLandmarkSpatialIndex::IsPointNearby(const double position[3]) const
+{
+  if (this->MinimumDistanceMm <= 0.0 || this->Cells.empty())
+  {
+    return false;
+  }
+  const double minimumDistance2 = this->MinimumDistanceMm * this->MinimumDistanceMm;
+  std::array<int, 3> cellIndex = this->GetCellIndex(position);
+  std::array<int, 3> neighborCellIndex;
+  for (int i = -1; i <= 1; ++i)
+  {
+    neighborCellIndex[0] = cellIndex[0] + i;
+    for (int j = -1; j <= 1; ++j)
+    {
+      neighborCellIndex[1] = cellIndex[1] + j;
+      for (int k = -1; k <= 1; ++k)
+      {
+        neighborCellIndex[2] = cellIndex[2] + k;
+        auto cellIt = this->Cells.find(neighborCellIndex);
+        if (cellIt == this->Cells.end())
+        {
+          continue;
+        }
+        for (const std::array<double, 3>& point : cellIt->second)
+        {
+          if (vtkMath::Distance2BetweenPoints(point.data(), position) < minimumDistance2)
+          {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+std::array<int, 3> vtkLandmarkSpatialIndex::GetCellIndex(const double position[3]) const
+{
+  std::array<int, 3> cellIndex = { {
+    static_cast<int>(std::floor(position[0] / this->MinimumDistanceMm)),
+    static_cast<int>(std::floor(position[1] / this->MinimumDistanceMm)),
+    static_cast<int>(std::floor(position[2] / this->MinimumDistanceMm)) } };
+  return cellIndex;
+}
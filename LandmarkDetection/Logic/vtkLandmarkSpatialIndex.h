@@ -0,0 +1,63 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkLandmarkSpatialIndex_h
+#define __vtkLandmarkSpatialIndex_h
+
+// VTK includes
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <array>
+#include <map>
+#include <vector>
+
+#include "vtkSlicerLandmarkDetectionModuleLogicExport.h"
+
+class vtkMRMLMarkupsFiducialNode;
+
+/// \ingroup Slicer_QtModules_LandmarkDetection
+/// Spatial index of the defined landmarks of an output markups node.
+/// Points are stored in a uniform grid with cell size equal to the minimum distance between landmarks,
+/// therefore all points that are closer than the minimum distance to a position are in the 27 neighbor cells.
+class VTK_SLICER_LANDMARKDETECTION_MODULE_LOGIC_EXPORT vtkLandmarkSpatialIndex
+{
+public:
+  /// Remove all points and add the defined control points of the markups node.
+  /// If markupsNode is nullptr then the index is initialized empty.
+  void Initialize(vtkMRMLMarkupsFiducialNode* markupsNode, double minimumDistanceMm);
+
+  /// Returns true if the index has to be initialized again (markups or minimum distance changed)
+  bool IsInitializationRequired(vtkMRMLMarkupsFiducialNode* markupsNode, double minimumDistanceMm) const;
+
+  /// Indicate that points of the markups node were modified and so the index has to be initialized again
+  void SetModified();
+
+  void AddPoint(const double position[3]);
+
+  /// Returns true if there is a point closer than the minimum distance to the specified position
+  bool IsPointNearby(const double position[3]) const;
+
+private:
+  std::array<int, 3> GetCellIndex(const double position[3]) const;
+
+  std::map< std::array<int, 3>, std::vector< std::array<double, 3> > > Cells;
+  vtkWeakPointer<vtkMRMLMarkupsFiducialNode> MarkupsNode;
+  double MinimumDistanceMm{ 0.0 };
+  bool Modified{ true };
+};
+
+#endif
@@ -20,16 +20,30 @@
 
 // LandmarkDetection Logic includes
 #include "vtkSlicerLandmarkDetectionLogic.h"
+#include "vtkLandmarkSpatialIndex.h"
 
 // MRML includes
 #include <vtkMRMLScene.h>
 #include <vtkMRMLTransformNode.h>
 #include <vtkMRMLMarkupsFiducialNode.h>
 
+// Sequences MRML includes
+#include <vtkMRMLSequenceNode.h>
+
 // VTK includes
 #include <vtkIntArray.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <vector>
 
 // Landmark Detection MRML includes
 #include <vtkMRMLLandmarkDetectionNode.h>
@@ -42,6 +56,348 @@ vtkStandardNewMacro(vtkSlicerLandmarkDetectionLogic);
 
 typedef std::map<vtkSmartPointer<vtkMRMLLandmarkDetectionNode>, vtkSmartPointer<vtkIGSIOLandmarkDetectionAlgo>> LandmarkDetectionAlgoMap;
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Mean and covariance of the 3D points that were added in a sliding time window.
+  // Points are stored in a ring buffer, with each coordinate in a separate contiguous array.
+  // Sums are updated when a point is added or removed, therefore statistics are available in constant time.
+  class vtkSlidingWindowPointStatistics
+  {
+  public:
+    void Clear()
+    {
+      this->FirstIndex = 0;
+      this->NumberOfPoints = 0;
+      this->ResetSums();
+    }
+
+    void AddPoint(double timeSec, const double point[3])
+    {
+      if (this->NumberOfPoints == 0)
+      {
+        // Sums are computed relative to the first point to avoid loss of precision when coordinates are large
+        for (int i = 0; i < 3; ++i)
+        {
+          this->Origin[i] = point[i];
+        }
+        this->ResetSums();
+      }
+      if (this->NumberOfPoints == static_cast<int>(this->TimesSec.size()))
+      {
+        this->Reallocate(std::max(INITIAL_CAPACITY, 2 * this->NumberOfPoints));
+      }
+      int index = (this->FirstIndex + this->NumberOfPoints) % static_cast<int>(this->TimesSec.size());
+      this->TimesSec[index] = timeSec;
+      for (int i = 0; i < 3; ++i)
+      {
+        this->Coordinates[i][index] = point[i];
+      }
+      this->NumberOfPoints++;
+      this->AddToSums(point, 1.0);
+    }
+
+    /// Remove all points that were added before the specified time
+    void RemovePointsBefore(double timeSec)
+    {
+      while (this->NumberOfPoints > 0 && this->TimesSec[this->FirstIndex] < timeSec)
+      {
+        double point[3] = { 0.0, 0.0, 0.0 };
+        for (int i = 0; i < 3; ++i)
+        {
+          point[i] = this->Coordinates[i][this->FirstIndex];
+        }
+        this->FirstIndex = (this->FirstIndex + 1) % static_cast<int>(this->TimesSec.size());
+        this->NumberOfPoints--;
+        this->AddToSums(point, -1.0);
+        this->NumberOfRemovalsSinceRecompute++;
+      }
+      if (this->NumberOfPoints == 0)
+      {
+        this->Clear();
+      }
+      else if (this->NumberOfRemovalsSinceRecompute >= static_cast<int>(this->TimesSec.size()))
+      {
+        // Rounding errors accumulate when points are subtracted from the sums, recompute them from time to time
+        this->RecomputeSums();
+      }
+    }
+
+    int GetNumberOfPoints() const
+    {
+      return this->NumberOfPoints;
+    }
+
+    void GetMean(double mean[3]) const
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        mean[i] = this->Origin[i] + (this->NumberOfPoints > 0 ? this->Sum[i] / this->NumberOfPoints : 0.0);
+      }
+    }
+
+    /// Covariance matrix of the points, (xx, xy, xz, yy, yz, zz) elements
+    void GetCovariance(double covariance[6]) const
+    {
+      if (this->NumberOfPoints == 0)
+      {
+        std::fill(covariance, covariance + 6, 0.0);
+        return;
+      }
+      double mean[3] = { 0.0, 0.0, 0.0 };
+      for (int i = 0; i < 3; ++i)
+      {
+        mean[i] = this->Sum[i] / this->NumberOfPoints;
+      }
+      int element = 0;
+      for (int i = 0; i < 3; ++i)
+      {
+        for (int j = i; j < 3; ++j, ++element)
+        {
+          covariance[element] = this->SumOfProducts[element] / this->NumberOfPoints - mean[i] * mean[j];
+        }
+      }
+    }
+
+    /// Mean squared distance of the points from their mean (trace of the covariance matrix)
+    double GetTotalVariance() const
+    {
+      double covariance[6] = { 0.0 };
+      this->GetCovariance(covariance);
+      return std::max(0.0, covariance[0] + covariance[3] + covariance[5]);
+    }
+
+  private:
+    enum
+    {
+      INITIAL_CAPACITY = 64
+    };
+
+    void Reallocate(int capacity)
+    {
+      int oldCapacity = static_cast<int>(this->TimesSec.size());
+      std::vector<double> timesSec(capacity);
+      std::vector<double> coordinates[3] = { std::vector<double>(capacity), std::vector<double>(capacity), std::vector<double>(capacity) };
+      for (int pointIndex = 0; pointIndex < this->NumberOfPoints; ++pointIndex)
+      {
+        int oldIndex = (this->FirstIndex + pointIndex) % oldCapacity;
+        timesSec[pointIndex] = this->TimesSec[oldIndex];
+        for (int i = 0; i < 3; ++i)
+        {
+          coordinates[i][pointIndex] = this->Coordinates[i][oldIndex];
+        }
+      }
+      this->TimesSec.swap(timesSec);
+      for (int i = 0; i < 3; ++i)
+      {
+        this->Coordinates[i].swap(coordinates[i]);
+      }
+      this->FirstIndex = 0;
+    }
+
+    void ResetSums()
+    {
+      std::fill(this->Sum, this->Sum + 3, 0.0);
+      std::fill(this->SumOfProducts, this->SumOfProducts + 6, 0.0);
+      this->NumberOfRemovalsSinceRecompute = 0;
+    }
+
+    void AddToSums(const double point[3], double weight)
+    {
+      double p[3] = { point[0] - this->Origin[0], point[1] - this->Origin[1], point[2] - this->Origin[2] };
+      int element = 0;
+      for (int i = 0; i < 3; ++i)
+      {
+        this->Sum[i] += weight * p[i];
+        for (int j = i; j < 3; ++j, ++element)
+        {
+          this->SumOfProducts[element] += weight * p[i] * p[j];
+        }
+      }
+    }
+
+    void RecomputeSums()
+    {
+      this->ResetSums();
+      int capacity = static_cast<int>(this->TimesSec.size());
+      for (int pointIndex = 0; pointIndex < this->NumberOfPoints; ++pointIndex)
+      {
+        int index = (this->FirstIndex + pointIndex) % capacity;
+        double point[3] = { this->Coordinates[0][index], this->Coordinates[1][index], this->Coordinates[2][index] };
+        this->AddToSums(point, 1.0);
+      }
+    }
+
+    std::vector<double> TimesSec;
+    std::vector<double> Coordinates[3];
+    int FirstIndex{ 0 };
+    int NumberOfPoints{ 0 };
+
+    double Origin[3]{ 0.0, 0.0, 0.0 };
+    double Sum[3]{ 0.0, 0.0, 0.0 };
+    double SumOfProducts[6]{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    int NumberOfRemovalsSinceRecompute{ 0 };
+  };
+
+  //----------------------------------------------------------------------------
+  // Detects landmarks from stylus tip poses: a landmark is detected when the filtered stylus tip position
+  // is static while the stylus shaft is pivoting during the detection time.
+  // Windows are defined by the time of the samples, therefore samples can be added at any rate.
+  // The extent of the tip and shaft positions is estimated as twice the root mean square distance from their mean
+  // (equal to the bounding box diagonal for two points) and compared to the displacement thresholds.
+  class vtkLandmarkStillnessDetector
+  {
+  public:
+    void SetParameters(const vtkSlicerLandmarkDetectionLogic::DetectionParameters& parameters)
+    {
+      this->FilterWindowTimeSec = parameters.FilterWindowTimeSec;
+      this->DetectionTimeSec = parameters.DetectionTimeSec;
+      this->StylusTipMaximumDisplacementThresholdMm = parameters.StylusTipMaximumDisplacementThresholdMm;
+      this->StylusShaftMinimumDisplacementThresholdMm = parameters.StylusShaftMinimumDisplacementThresholdMm;
+      for (int i = 0; i < 3; ++i)
+      {
+        this->StylusShaft_StylusTip[i] = parameters.StylusShaftPoint_StylusTip[i];
+      }
+    }
+
+    void Reset()
+    {
+      this->FilterWindowTip.Clear();
+      this->DetectionWindowTip.Clear();
+      this->DetectionWindowShaft.Clear();
+      this->StartTimeSec = -1.0;
+      this->LastTimeSec = -1.0;
+    }
+
+    /// Add the next stylus tip pose. Returns true and the position of the landmark if a new landmark is detected.
+    bool AddStylusTipToReferenceTransform(double timeSec, vtkMatrix4x4* stylusTipToReferenceMatrix, double landmarkPosition[3])
+    {
+      if (this->StartTimeSec < 0.0 || timeSec < this->LastTimeSec || timeSec - this->LastTimeSec > this->DetectionTimeSec)
+      {
+        // First sample, the clock was reset, or no samples were received for a long time: start a new detection
+        this->Reset();
+        this->StartTimeSec = timeSec;
+      }
+      this->LastTimeSec = timeSec;
+
+      // Any point that is not at the stylus tip moves when the stylus is pivoting, a point along the shaft is used
+      double stylusTip_Reference[4] = { 0.0, 0.0, 0.0, 1.0 };
+      double stylusShaft_Reference[4] = { 0.0, 0.0, 0.0, 1.0 };
+      const double stylusTip_StylusTip[4] = { 0.0, 0.0, 0.0, 1.0 };
+      stylusTipToReferenceMatrix->MultiplyPoint(stylusTip_StylusTip, stylusTip_Reference);
+      stylusTipToReferenceMatrix->MultiplyPoint(this->StylusShaft_StylusTip, stylusShaft_Reference);
+
+      this->FilterWindowTip.AddPoint(timeSec, stylusTip_Reference);
+      this->FilterWindowTip.RemovePointsBefore(timeSec - this->FilterWindowTimeSec);
+      double filteredStylusTip_Reference[3] = { 0.0, 0.0, 0.0 };
+      this->FilterWindowTip.GetMean(filteredStylusTip_Reference);
+
+      this->DetectionWindowTip.AddPoint(timeSec, filteredStylusTip_Reference);
+      this->DetectionWindowShaft.AddPoint(timeSec, stylusShaft_Reference);
+      this->DetectionWindowTip.RemovePointsBefore(timeSec - this->DetectionTimeSec);
+      this->DetectionWindowShaft.RemovePointsBefore(timeSec - this->DetectionTimeSec);
+
+      if (timeSec - this->StartTimeSec < this->DetectionTimeSec || this->DetectionWindowTip.GetNumberOfPoints() < MINIMUM_NUMBER_OF_SAMPLES)
+      {
+        // Not enough samples for detection yet
+        return false;
+      }
+
+      double stylusTipExtentMm = 2.0 * std::sqrt(this->DetectionWindowTip.GetTotalVariance());
+      double stylusShaftExtentMm = 2.0 * std::sqrt(this->DetectionWindowShaft.GetTotalVariance());
+      if (stylusTipExtentMm > this->StylusTipMaximumDisplacementThresholdMm
+        || stylusShaftExtentMm < this->StylusShaftMinimumDisplacementThresholdMm)
+      {
+        return false;
+      }
+
+      this->DetectionWindowTip.GetMean(landmarkPosition);
+      // Start a new detection, so that the same landmark is not detected again for each sample
+      this->Reset();
+      return true;
+    }
+
+  private:
+    enum
+    {
+      MINIMUM_NUMBER_OF_SAMPLES = 3
+    };
+    vtkSlidingWindowPointStatistics FilterWindowTip;
+    vtkSlidingWindowPointStatistics DetectionWindowTip;
+    vtkSlidingWindowPointStatistics DetectionWindowShaft;
+    double StartTimeSec{ -1.0 };
+    double LastTimeSec{ -1.0 };
+
+    double FilterWindowTimeSec{ 0.2 };
+    double DetectionTimeSec{ 1.0 };
+    double StylusTipMaximumDisplacementThresholdMm{ 1.5 };
+    double StylusShaftMinimumDisplacementThresholdMm{ 30.0 };
+    double StylusShaft_StylusTip[4]{ 100.0, 0.0, 0.0, 1.0 };
+  };
+
+  //----------------------------------------------------------------------------
+  void ConfigureLandmarkDetectionAlgo(vtkIGSIOLandmarkDetectionAlgo* algo, const vtkSlicerLandmarkDetectionLogic::DetectionParameters& parameters)
+  {
+    algo->SetAcquisitionRate(parameters.AcquisitionRateHz);
+    algo->SetFilterWindowTimeSec(parameters.FilterWindowTimeSec);
+    algo->SetDetectionTimeSec(parameters.DetectionTimeSec);
+    algo->SetStylusShaftMinimumDisplacementThresholdMm(parameters.StylusShaftMinimumDisplacementThresholdMm);
+    algo->SetStylusTipMaximumDisplacementThresholdMm(parameters.StylusTipMaximumDisplacementThresholdMm);
+    // Proximity to existing landmarks is checked by the logic, using the spatial index of the defined landmarks
+    algo->SetMinimumDistanceBetweenLandmarksMm(0.0);
+  }
+
+  //----------------------------------------------------------------------------
+  // Detect landmarks in stylus tip to reference matrices (4x4 row-major arrays, stored contiguously).
+  // Uses its own detector instances, therefore it can be called from multiple threads.
+  void DetectLandmarksInMatrices(const std::vector<double>& stylusTipToReferenceMatrices, const std::vector<double>& timestampsSec,
+    const vtkSlicerLandmarkDetectionLogic::DetectionParameters& parameters,
+    std::vector<vtkSlicerLandmarkDetectionLogic::DetectedLandmark>& detectedLandmarks)
+  {
+    detectedLandmarks.clear();
+
+    vtkNew<vtkIGSIOLandmarkDetectionAlgo> algo;
+    ConfigureLandmarkDetectionAlgo(algo, parameters);
+    vtkLandmarkStillnessDetector detector;
+    detector.SetParameters(parameters);
+    vtkLandmarkSpatialIndex landmarkIndex;
+    landmarkIndex.Initialize(nullptr, parameters.MinimumDistanceBetweenLandmarksMm);
+
+    vtkNew<vtkMatrix4x4> stylusTipToReferenceMatrix;
+    const int numberOfItems = static_cast<int>(timestampsSec.size());
+    for (int itemIndex = 0; itemIndex < numberOfItems; itemIndex++)
+    {
+      stylusTipToReferenceMatrix->DeepCopy(stylusTipToReferenceMatrices.data() + 16 * itemIndex);
+      vtkSlicerLandmarkDetectionLogic::DetectedLandmark landmark;
+      bool newLandmarkDetected = false;
+      if (parameters.FullRateDetectionEnabled)
+      {
+        newLandmarkDetected = detector.AddStylusTipToReferenceTransform(timestampsSec[itemIndex], stylusTipToReferenceMatrix, landmark.Position_Reference);
+      }
+      else
+      {
+        int newLandmarkDetectedByAlgo = 0;
+        if (algo->InsertNextStylusTipToReferenceTransform(stylusTipToReferenceMatrix, newLandmarkDetectedByAlgo) == IGSIO_SUCCESS
+          && newLandmarkDetectedByAlgo > 0)
+        {
+          vtkPoints* detectedLandmarkPoints = algo->GetDetectedLandmarkPoints_Reference();
+          detectedLandmarkPoints->GetPoint(detectedLandmarkPoints->GetNumberOfPoints() - 1, landmark.Position_Reference);
+          detectedLandmarkPoints->Reset();
+          newLandmarkDetected = true;
+        }
+      }
+      if (!newLandmarkDetected || landmarkIndex.IsPointNearby(landmark.Position_Reference))
+      {
+        continue;
+      }
+      landmark.TimestampSec = timestampsSec[itemIndex];
+      landmark.ItemIndex = itemIndex;
+      landmarkIndex.AddPoint(landmark.Position_Reference);
+      detectedLandmarks.push_back(landmark);
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 class vtkSlicerLandmarkDetectionLogic::vtkInternal
 {
@@ -53,6 +409,13 @@ public:
   vtkIGSIOLandmarkDetectionAlgo* GetLandmarkDetectionAlgoFromNode(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode);
 
   LandmarkDetectionAlgoMap LandmarkDetectionMap;
+
+  // Defined landmarks of the output markups node of each landmark detection node
+  std::map<vtkMRMLLandmarkDetectionNode*, vtkLandmarkSpatialIndex> LandmarkIndexMap;
+  // Detectors used instead of the IGSIO algorithm if full rate detection is enabled
+  std::map<vtkMRMLLandmarkDetectionNode*, vtkLandmarkStillnessDetector> StillnessDetectorMap;
+  // Markups modified events are ignored while the logic adds detected landmarks, as those are added to the index directly
+  bool UpdatingDetectedLandmarks{ false };
 };
 
 //----------------------------------------------------------------------------
@@ -140,6 +503,7 @@ void vtkSlicerLandmarkDetectionLogic::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
   events->InsertNextValue(vtkCommand::ModifiedEvent);
   events->InsertNextValue(vtkMRMLLandmarkDetectionNode::InputTransformModifiedEvent);
   events->InsertNextValue(vtkMRMLLandmarkDetectionNode::ResetDetectionEvent);
+  events->InsertNextValue(vtkMRMLLandmarkDetectionNode::OutputMarkupsModifiedEvent);
   vtkObserveMRMLNodeEventsMacro(landmarkDetectionNode, events);
 
   vtkNew<vtkIGSIOLandmarkDetectionAlgo> landmarkDetectionAlgo;
@@ -156,6 +520,8 @@ void vtkSlicerLandmarkDetectionLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
   }
   vtkUnObserveMRMLNodeMacro(landmarkDetectionNode);
   this->Internal->LandmarkDetectionMap.erase(landmarkDetectionNode);
+  this->Internal->LandmarkIndexMap.erase(landmarkDetectionNode);
+  this->Internal->StillnessDetectorMap.erase(landmarkDetectionNode);
 }
 
 //---------------------------------------------------------------------------
@@ -179,6 +545,11 @@ void vtkSlicerLandmarkDetectionLogic::ProcessMRMLNodesEvents(vtkObject* caller,
   {
     this->ResetDetectionForNode(landmarkDetectionNode);
   }
+  else if (event == vtkMRMLLandmarkDetectionNode::OutputMarkupsModifiedEvent && !this->Internal->UpdatingDetectedLandmarks)
+  {
+    // Control points may have been removed or moved, the index is rebuilt when it is needed next time
+    this->Internal->LandmarkIndexMap[landmarkDetectionNode].SetModified();
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -188,8 +559,10 @@ void vtkSlicerLandmarkDetectionLogic::ResetDetectionForNode(vtkMRMLLandmarkDetec
   if (!algo)
   {
     vtkErrorMacro("ResetDetectionForNode: Could not find algorithm for specified node");
+    return;
   }
   algo->ResetDetection();
+  this->Internal->StillnessDetectorMap[landmarkDetectionNode].Reset();
 }
 
 //----------------------------------------------------------------------------
@@ -221,40 +594,17 @@ void vtkSlicerLandmarkDetectionLogic::UpdateLandmarkDetectionAlgo(vtkMRMLLandmar
   if (!algo)
   {
     vtkErrorMacro("UpdateLandmarkDetectionAlgo: Could not find algorithm for specified node");
+    return;
   }
-  algo->SetAcquisitionRate(landmarkDetectionNode->GetAcquisitionRateHz());
-  algo->SetFilterWindowTimeSec(landmarkDetectionNode->GetFilterWindowTimeSec());
-  algo->SetDetectionTimeSec(landmarkDetectionNode->GetDetectionTimeSec());
-  algo->SetStylusShaftMinimumDisplacementThresholdMm(landmarkDetectionNode->GetStylusShaftMinimumDisplacementThresholdMm());
-  algo->SetStylusTipMaximumDisplacementThresholdMm(landmarkDetectionNode->GetStylusTipMaximumDisplacementThresholdMm());
-  algo->SetMinimumDistanceBetweenLandmarksMm(landmarkDetectionNode->GetMinimumDistanceBetweenLandmarksMm());
+  DetectionParameters parameters;
+  vtkSlicerLandmarkDetectionLogic::GetDetectionParametersFromNode(landmarkDetectionNode, parameters);
+  ConfigureLandmarkDetectionAlgo(algo, parameters);
 }
 
 //----------------------------------------------------------------------------
 void vtkSlicerLandmarkDetectionLogic::AddTransformToAlgo(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode)
 {
-  vtkIGSIOLandmarkDetectionAlgo* algo = this->Internal->GetLandmarkDetectionAlgoFromNode(landmarkDetectionNode);
-  if (!algo)
-  {
-    vtkErrorMacro("AddTransformToAlgo: Could not find algorithm for specified node");
-    return;
-  }
-
   vtkMRMLMarkupsFiducialNode* outputFiducials = landmarkDetectionNode->GetOutputMarkupsNode();
-  if (outputFiducials)
-  {
-    // Copy existing landmarks to the algorithm so that we reject the points that are near to existing ones.
-    vtkNew<vtkPoints> definedControlPoints;
-    for (int i = 0; i < outputFiducials->GetNumberOfControlPoints(); ++i)
-    {
-      if (outputFiducials->GetNthControlPointPositionStatus(i) != vtkMRMLMarkupsNode::PositionDefined)
-      {
-        continue;
-      }
-      definedControlPoints->InsertNextPoint(outputFiducials->GetNthControlPointPosition(i));
-    }
-    algo->GetDetectedLandmarkPoints_Reference()->DeepCopy(definedControlPoints);
-  }
 
   // Get a matrix from the stylus tip position to the markups node coordinate system.
   vtkNew<vtkMatrix4x4> stylusTipToReferenceMatrix;
@@ -267,31 +617,97 @@ void vtkSlicerLandmarkDetectionLogic::AddTransformToAlgo(vtkMRMLLandmarkDetectio
   }
   vtkMRMLTransformNode::GetMatrixTransformBetweenNodes(transformNode, referenceTransformNode, stylusTipToReferenceMatrix);
 
-  int newLandmarkDetected = 0;
-  if (algo->InsertNextStylusTipToReferenceTransform(stylusTipToReferenceMatrix, newLandmarkDetected) != IGSIO_SUCCESS)
+  this->AddStylusTipToReferenceTransform(landmarkDetectionNode, stylusTipToReferenceMatrix, vtkTimerLog::GetUniversalTime());
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerLandmarkDetectionLogic::AddStylusTipToReferenceTransform(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode,
+  vtkMatrix4x4* stylusTipToReferenceMatrix, double timestampSec)
+{
+  if (!landmarkDetectionNode || !stylusTipToReferenceMatrix)
+  {
+    vtkErrorMacro("AddStylusTipToReferenceTransform: Invalid input");
+    return;
+  }
+  if (!landmarkDetectionNode->GetLandmarkDetectionInProgress())
   {
-    vtkErrorMacro("AddTransformToAlgo: Could not add StylusTipToReferenceTransform");
     return;
   }
 
-  if (newLandmarkDetected > 0)
+  bool newLandmarkDetected = false;
+  double newLandmarkPosition[3] = { 0.0, 0.0, 0.0 };
+  if (landmarkDetectionNode->GetFullRateDetectionEnabled())
   {
-    this->UpdateDetectedLandmarks(landmarkDetectionNode);
+    DetectionParameters parameters;
+    vtkSlicerLandmarkDetectionLogic::GetDetectionParametersFromNode(landmarkDetectionNode, parameters);
+    vtkLandmarkStillnessDetector& detector = this->Internal->StillnessDetectorMap[landmarkDetectionNode];
+    detector.SetParameters(parameters);
+    newLandmarkDetected = detector.AddStylusTipToReferenceTransform(timestampSec, stylusTipToReferenceMatrix, newLandmarkPosition);
+  }
+  else
+  {
+    vtkIGSIOLandmarkDetectionAlgo* algo = this->Internal->GetLandmarkDetectionAlgoFromNode(landmarkDetectionNode);
+    if (!algo)
+    {
+      vtkErrorMacro("AddStylusTipToReferenceTransform: Could not find algorithm for specified node");
+      return;
+    }
+    int newLandmarkDetectedByAlgo = 0;
+    if (algo->InsertNextStylusTipToReferenceTransform(stylusTipToReferenceMatrix, newLandmarkDetectedByAlgo) != IGSIO_SUCCESS)
+    {
+      vtkErrorMacro("AddStylusTipToReferenceTransform: Could not add StylusTipToReferenceTransform");
+      return;
+    }
+    if (newLandmarkDetectedByAlgo > 0)
+    {
+      vtkPoints* detectedLandmarkPoints = algo->GetDetectedLandmarkPoints_Reference();
+      detectedLandmarkPoints->GetPoint(detectedLandmarkPoints->GetNumberOfPoints() - 1, newLandmarkPosition);
+      // Only the latest detected point is used, the defined landmarks are stored in the index
+      detectedLandmarkPoints->Reset();
+      newLandmarkDetected = true;
+    }
+  }
+
+  if (!newLandmarkDetected)
+  {
+    return;
+  }
+
+  // Reject the points that are near to existing landmarks
+  vtkMRMLMarkupsFiducialNode* outputFiducials = landmarkDetectionNode->GetOutputMarkupsNode();
+  vtkLandmarkSpatialIndex& landmarkIndex = this->Internal->LandmarkIndexMap[landmarkDetectionNode];
+  double minimumDistanceMm = landmarkDetectionNode->GetMinimumDistanceBetweenLandmarksMm();
+  if (landmarkIndex.IsInitializationRequired(outputFiducials, minimumDistanceMm))
+  {
+    landmarkIndex.Initialize(outputFiducials, minimumDistanceMm);
+  }
+  if (!landmarkIndex.IsPointNearby(newLandmarkPosition))
+  {
+    this->UpdateDetectedLandmarks(landmarkDetectionNode, newLandmarkPosition);
   }
 }
 
 //----------------------------------------------------------------------------
-void vtkSlicerLandmarkDetectionLogic::UpdateDetectedLandmarks(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode)
+void vtkSlicerLandmarkDetectionLogic::UpdateDetectedLandmarks(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode, double newLandmarkPosition[3])
 {
-  vtkIGSIOLandmarkDetectionAlgo* algo = this->Internal->GetLandmarkDetectionAlgoFromNode(landmarkDetectionNode);
-  if (!algo)
+  vtkMRMLMarkupsFiducialNode* outputFiducials = landmarkDetectionNode->GetOutputMarkupsNode();
+  if (!outputFiducials)
   {
-    vtkErrorMacro("UpdateDetectedLandmarks: Could not find algorithm for specified node");
     return;
   }
 
+  this->Internal->UpdatingDetectedLandmarks = true;
+  {
+    MRMLNodeModifyBlocker blocker(outputFiducials);
+    this->AddDetectedLandmarkToMarkups(landmarkDetectionNode, newLandmarkPosition);
+  }
+  this->Internal->UpdatingDetectedLandmarks = false;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerLandmarkDetectionLogic::AddDetectedLandmarkToMarkups(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode, double newLandmarkPosition[3])
+{
   vtkMRMLMarkupsFiducialNode* outputFiducials = landmarkDetectionNode->GetOutputMarkupsNode();
-  MRMLNodeModifyBlocker blocker(outputFiducials);
 
   int nextLandmarkIndex = -1;
   char* nextLandmarkLabel = landmarkDetectionNode->GetNextLandmarkLabel();
@@ -325,19 +741,99 @@ void vtkSlicerLandmarkDetectionLogic::UpdateDetectedLandmarks(vtkMRMLLandmarkDet
     }
   }
 
-  vtkPoints* detectedLandmarkPoints = algo->GetDetectedLandmarkPoints_Reference();
-  double* newLandmarkPosition = detectedLandmarkPoints->GetPoint(detectedLandmarkPoints->GetNumberOfPoints() - 1);
+  vtkLandmarkSpatialIndex& landmarkIndex = this->Internal->LandmarkIndexMap[landmarkDetectionNode];
   if (nextLandmarkIndex >= 0)
   {
+    if (outputFiducials->GetNthControlPointPositionStatus(nextLandmarkIndex) == vtkMRMLMarkupsNode::PositionDefined)
+    {
+      // A defined landmark is moved, it cannot be updated in the index incrementally
+      landmarkIndex.SetModified();
+    }
     outputFiducials->SetNthControlPointPosition(nextLandmarkIndex, newLandmarkPosition);
   }
   else
   {
     outputFiducials->AddControlPoint(newLandmarkPosition);
   }
+  landmarkIndex.AddPoint(newLandmarkPosition);
 
-  if (detectedLandmarkPoints->GetNumberOfPoints() == outputFiducials->GetMaximumNumberOfControlPoints())
+  if (outputFiducials->GetNumberOfDefinedControlPoints() == outputFiducials->GetMaximumNumberOfControlPoints())
   {
     landmarkDetectionNode->LandmarkDetectionInProgressOff();
   }
 }
+
+//----------------------------------------------------------------------------
+void vtkSlicerLandmarkDetectionLogic::GetDetectionParametersFromNode(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode, DetectionParameters& parameters)
+{
+  if (!landmarkDetectionNode)
+  {
+    return;
+  }
+  parameters.FullRateDetectionEnabled = landmarkDetectionNode->GetFullRateDetectionEnabled();
+  parameters.AcquisitionRateHz = landmarkDetectionNode->GetAcquisitionRateHz();
+  parameters.FilterWindowTimeSec = landmarkDetectionNode->GetFilterWindowTimeSec();
+  parameters.DetectionTimeSec = landmarkDetectionNode->GetDetectionTimeSec();
+  parameters.StylusShaftMinimumDisplacementThresholdMm = landmarkDetectionNode->GetStylusShaftMinimumDisplacementThresholdMm();
+  landmarkDetectionNode->GetStylusShaftPoint_StylusTip(parameters.StylusShaftPoint_StylusTip);
+  parameters.StylusTipMaximumDisplacementThresholdMm = landmarkDetectionNode->GetStylusTipMaximumDisplacementThresholdMm();
+  parameters.MinimumDistanceBetweenLandmarksMm = landmarkDetectionNode->GetMinimumDistanceBetweenLandmarksMm();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerLandmarkDetectionLogic::DetectLandmarksInSequence(vtkMRMLSequenceNode* stylusTipToReferenceSequenceNode,
+  const DetectionParameters& parameters, std::vector<DetectedLandmark>& detectedLandmarks)
+{
+  std::vector<DetectionParameters> parameterSets(1, parameters);
+  std::vector< std::vector<DetectedLandmark> > detectedLandmarksForEachParameterSet;
+  bool success = this->DetectLandmarksInSequence(stylusTipToReferenceSequenceNode, parameterSets, detectedLandmarksForEachParameterSet);
+  detectedLandmarks = detectedLandmarksForEachParameterSet[0];
+  return success;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerLandmarkDetectionLogic::DetectLandmarksInSequence(vtkMRMLSequenceNode* stylusTipToReferenceSequenceNode,
+  const std::vector<DetectionParameters>& parameterSets, std::vector< std::vector<DetectedLandmark> >& detectedLandmarksForEachParameterSet)
+{
+  detectedLandmarksForEachParameterSet.clear();
+  detectedLandmarksForEachParameterSet.resize(parameterSets.size());
+  if (!stylusTipToReferenceSequenceNode)
+  {
+    vtkErrorMacro("DetectLandmarksInSequence: Invalid sequence node");
+    return false;
+  }
+
+  // Copy all matrices and timestamps into contiguous arrays, as MRML nodes must not be accessed from worker threads
+  const int numberOfItems = stylusTipToReferenceSequenceNode->GetNumberOfDataNodes();
+  std::vector<double> stylusTipToReferenceMatrices(16 * numberOfItems);
+  std::vector<double> timestampsSec(numberOfItems);
+  vtkNew<vtkMatrix4x4> matrix;
+  for (int itemIndex = 0; itemIndex < numberOfItems; itemIndex++)
+  {
+    vtkMRMLTransformNode* transformNode = vtkMRMLTransformNode::SafeDownCast(stylusTipToReferenceSequenceNode->GetNthDataNode(itemIndex));
+    if (!transformNode || !transformNode->IsLinear())
+    {
+      vtkErrorMacro("DetectLandmarksInSequence: item " << itemIndex << " of the sequence is not a linear transform");
+      return false;
+    }
+    transformNode->GetMatrixTransformToParent(matrix);
+    std::copy(&matrix->Element[0][0], &matrix->Element[0][0] + 16, stylusTipToReferenceMatrices.begin() + 16 * itemIndex);
+    std::istringstream convertedStream(stylusTipToReferenceSequenceNode->GetNthIndexValue(itemIndex));
+    if (!(convertedStream >> timestampsSec[itemIndex]))
+    {
+      vtkErrorMacro("DetectLandmarksInSequence: index value of item " << itemIndex << " is not a number");
+      return false;
+    }
+  }
+
+  const int numberOfParameterSets = static_cast<int>(parameterSets.size());
+  vtkSMPTools::For(0, numberOfParameterSets, [&](vtkIdType beginParameterSetIndex, vtkIdType endParameterSetIndex)
+  {
+    for (vtkIdType parameterSetIndex = beginParameterSetIndex; parameterSetIndex < endParameterSetIndex; parameterSetIndex++)
+    {
+      DetectLandmarksInMatrices(stylusTipToReferenceMatrices, timestampsSec, parameterSets[parameterSetIndex],
+        detectedLandmarksForEachParameterSet[parameterSetIndex]);
+    }
+  });
+  return true;
+}
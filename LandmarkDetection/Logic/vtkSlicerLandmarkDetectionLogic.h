@@ -34,12 +34,15 @@
 
 // STD includes
 #include <cstdlib>
+#include <vector>
 
 #include "vtkSlicerLandmarkDetectionModuleLogicExport.h"
 
+class vtkMatrix4x4;
 class vtkMRMLLandmarkDetectionNode;
 class vtkMRMLTransformNode;
 class vtkMRMLMarkupsFiducialNode;
+class vtkMRMLSequenceNode;
 
 /// \ingroup Slicer_QtModules_ExtensionTemplate
 class VTK_SLICER_LANDMARKDETECTION_MODULE_LOGIC_EXPORT vtkSlicerLandmarkDetectionLogic :
@@ -59,6 +62,53 @@ public:
   /// TODO: Kyle
   void ResetDetectionForNode(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode);
 
+  /// Add a stylus tip pose to the landmark detection of the node.
+  /// Input transform changes of the node are added automatically, with the current time as timestamp.
+  /// This method can be used for adding poses that were acquired earlier (for example, by processing recorded data).
+  /// The timestamp is only used if full rate detection is enabled in the node.
+  /// The pose is ignored if landmark detection is not in progress in the node.
+  void AddStylusTipToReferenceTransform(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode, vtkMatrix4x4* stylusTipToReferenceMatrix, double timestampSec);
+
+  /// Landmark detection parameters, see vtkMRMLLandmarkDetectionNode for description of each parameter
+  struct DetectionParameters
+  {
+    bool FullRateDetectionEnabled{ false };
+    double AcquisitionRateHz{ 20.0 };
+    double FilterWindowTimeSec{ 0.2 };
+    double DetectionTimeSec{ 1.0 };
+    double StylusShaftMinimumDisplacementThresholdMm{ 30.0 };
+    double StylusShaftPoint_StylusTip[3]{ 100.0, 0.0, 0.0 };
+    double StylusTipMaximumDisplacementThresholdMm{ 1.5 };
+    double MinimumDistanceBetweenLandmarksMm{ 15.0 };
+  };
+
+  /// Get the detection parameters of a landmark detection node
+  static void GetDetectionParametersFromNode(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode, DetectionParameters& parameters);
+
+  /// Landmark detected in a recorded sequence
+  struct DetectedLandmark
+  {
+    double Position_Reference[3]{ 0.0, 0.0, 0.0 };
+    /// Index value of the sequence item that completed the detection, converted to seconds
+    double TimestampSec{ 0.0 };
+    /// Index of the sequence item that completed the detection
+    int ItemIndex{ -1 };
+  };
+
+  //@{
+  /// Detect landmarks in a recorded sequence of stylus tip to reference transforms.
+  /// Matrices are processed directly, without modifying any nodes in the scene, therefore the state of the logic is not changed.
+  /// Index values of the sequence are used as timestamps (in seconds).
+  /// All detected landmarks are returned in the order of detection. Landmarks are not limited in number,
+  /// but a landmark is rejected if it is closer than the minimum distance to a landmark detected earlier in the same sequence.
+  /// If multiple parameter sets are specified then detection is performed for each parameter set in parallel.
+  /// Returns with false if the sequence could not be processed.
+  bool DetectLandmarksInSequence(vtkMRMLSequenceNode* stylusTipToReferenceSequenceNode, const DetectionParameters& parameters,
+    std::vector<DetectedLandmark>& detectedLandmarks);
+  bool DetectLandmarksInSequence(vtkMRMLSequenceNode* stylusTipToReferenceSequenceNode, const std::vector<DetectionParameters>& parameterSets,
+    std::vector< std::vector<DetectedLandmark> >& detectedLandmarksForEachParameterSet);
+  //@}
+
 protected:
   vtkSlicerLandmarkDetectionLogic();
   ~vtkSlicerLandmarkDetectionLogic() override;
@@ -74,7 +124,8 @@ protected:
 
   void UpdateLandmarkDetectionAlgo(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode);
   void AddTransformToAlgo(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode);
-  void UpdateDetectedLandmarks(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode);
+  void UpdateDetectedLandmarks(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode, double newLandmarkPosition[3]);
+  void AddDetectedLandmarkToMarkups(vtkMRMLLandmarkDetectionNode* landmarkDetectionNode, double newLandmarkPosition[3]);
 
 private:
 
@@ -34,7 +34,11 @@ vtkMRMLLandmarkDetectionNode::vtkMRMLLandmarkDetectionNode()
   vtkNew<vtkIntArray> inputTransformEvents;
   inputTransformEvents->InsertNextTuple1(vtkMRMLTransformNode::TransformModifiedEvent);
   this->AddNodeReferenceRole(this->GetInputTransformNodeReferenceRole(), this->GetInputTransformNodeReferenceMRMLAttributeName(), inputTransformEvents);
-  this->AddNodeReferenceRole(this->GetOutputMarkupsNodeReferenceRole(), this->GetOutputMarkupsNodeReferenceMRMLAttributeName());
+  vtkNew<vtkIntArray> outputMarkupsEvents;
+  outputMarkupsEvents->InsertNextTuple1(vtkMRMLMarkupsNode::PointAddedEvent);
+  outputMarkupsEvents->InsertNextTuple1(vtkMRMLMarkupsNode::PointRemovedEvent);
+  outputMarkupsEvents->InsertNextTuple1(vtkMRMLMarkupsNode::PointModifiedEvent);
+  this->AddNodeReferenceRole(this->GetOutputMarkupsNodeReferenceRole(), this->GetOutputMarkupsNodeReferenceMRMLAttributeName(), outputMarkupsEvents);
 }
 
 //----------------------------------------------------------------------------
@@ -47,10 +51,12 @@ void vtkMRMLLandmarkDetectionNode::WriteXML(ostream& of, int nIndent)
   vtkMRMLWriteXMLBeginMacro(of);
   vtkMRMLWriteXMLBooleanMacro(landmarkDetectionInProgress, LandmarkDetectionInProgress);
   vtkMRMLWriteXMLBooleanMacro(useMarkupsCoordinatesForOutput, UseMarkupsCoordinatesForOutput);
+  vtkMRMLWriteXMLBooleanMacro(fullRateDetectionEnabled, FullRateDetectionEnabled);
   vtkMRMLWriteXMLFloatMacro(acquisitionRateHz, AcquisitionRateHz);
   vtkMRMLWriteXMLFloatMacro(filterWindowTimeSec, FilterWindowTimeSec);
   vtkMRMLWriteXMLFloatMacro(detectionTimeSec, DetectionTimeSec);
   vtkMRMLWriteXMLFloatMacro(stylusShaftMinimumDisplacementThresholdMm, StylusShaftMinimumDisplacementThresholdMm);
+  vtkMRMLWriteXMLVectorMacro(stylusShaftPoint_StylusTip, StylusShaftPoint_StylusTip, double, 3);
   vtkMRMLWriteXMLFloatMacro(stylusTipMaximumDisplacementThresholdMm, StylusTipMaximumDisplacementThresholdMm);
   vtkMRMLWriteXMLFloatMacro(minimumDistanceBetweenLandmarksMm, MinimumDistanceBetweenLandmarksMm);
   vtkMRMLWriteXMLStringMacro(nextLandmarkLabel, NextLandmarkLabel);
@@ -65,10 +71,12 @@ void vtkMRMLLandmarkDetectionNode::ReadXMLAttributes(const char** atts)
   vtkMRMLReadXMLBeginMacro(atts);
   vtkMRMLReadXMLBooleanMacro(landmarkDetectionInProgress, LandmarkDetectionInProgress);
   vtkMRMLReadXMLBooleanMacro(useMarkupsCoordinatesForOutput, UseMarkupsCoordinatesForOutput);
+  vtkMRMLReadXMLBooleanMacro(fullRateDetectionEnabled, FullRateDetectionEnabled);
   vtkMRMLReadXMLFloatMacro(acquisitionRateHz, AcquisitionRateHz);
   vtkMRMLReadXMLFloatMacro(filterWindowTimeSec, FilterWindowTimeSec);
   vtkMRMLReadXMLFloatMacro(detectionTimeSec, DetectionTimeSec);
   vtkMRMLReadXMLFloatMacro(stylusShaftMinimumDisplacementThresholdMm, StylusShaftMinimumDisplacementThresholdMm);
+  vtkMRMLReadXMLVectorMacro(stylusShaftPoint_StylusTip, StylusShaftPoint_StylusTip, double, 3);
   vtkMRMLReadXMLFloatMacro(stylusTipMaximumDisplacementThresholdMm, StylusTipMaximumDisplacementThresholdMm);
   vtkMRMLReadXMLFloatMacro(minimumDistanceBetweenLandmarksMm, MinimumDistanceBetweenLandmarksMm);
   vtkMRMLReadXMLStringMacro(nextLandmarkLabel, NextLandmarkLabel);
@@ -83,10 +91,12 @@ void vtkMRMLLandmarkDetectionNode::Copy(vtkMRMLNode* anode)
   vtkMRMLCopyBeginMacro(anode);
   vtkMRMLCopyBooleanMacro(LandmarkDetectionInProgress);
   vtkMRMLCopyBooleanMacro(UseMarkupsCoordinatesForOutput);
+  vtkMRMLCopyBooleanMacro(FullRateDetectionEnabled);
   vtkMRMLCopyFloatMacro(AcquisitionRateHz);
   vtkMRMLCopyFloatMacro(FilterWindowTimeSec);
   vtkMRMLCopyFloatMacro(DetectionTimeSec);
   vtkMRMLCopyFloatMacro(StylusShaftMinimumDisplacementThresholdMm);
+  vtkMRMLCopyVectorMacro(StylusShaftPoint_StylusTip, double, 3);
   vtkMRMLCopyFloatMacro(StylusTipMaximumDisplacementThresholdMm);
   vtkMRMLCopyFloatMacro(MinimumDistanceBetweenLandmarksMm);
   vtkMRMLCopyStringMacro(NextLandmarkLabel);
@@ -100,10 +110,12 @@ void vtkMRMLLandmarkDetectionNode::PrintSelf(ostream& os, vtkIndent indent)
   vtkMRMLPrintBeginMacro(os, indent);
   vtkMRMLPrintBooleanMacro(LandmarkDetectionInProgress);
   vtkMRMLPrintBooleanMacro(UseMarkupsCoordinatesForOutput);
+  vtkMRMLPrintBooleanMacro(FullRateDetectionEnabled);
   vtkMRMLPrintFloatMacro(AcquisitionRateHz);
   vtkMRMLPrintFloatMacro(FilterWindowTimeSec);
   vtkMRMLPrintFloatMacro(DetectionTimeSec);
   vtkMRMLPrintFloatMacro(StylusShaftMinimumDisplacementThresholdMm);
+  vtkMRMLPrintVectorMacro(StylusShaftPoint_StylusTip, double, 3);
   vtkMRMLPrintFloatMacro(StylusTipMaximumDisplacementThresholdMm);
   vtkMRMLPrintFloatMacro(MinimumDistanceBetweenLandmarksMm);
   vtkMRMLPrintStringMacro(NextLandmarkLabel);
@@ -125,6 +137,12 @@ void vtkMRMLLandmarkDetectionNode::ProcessMRMLEvents(vtkObject* caller, unsigned
   {
     this->InvokeCustomModifiedEvent(InputTransformModifiedEvent, transformNode);
   }
+
+  vtkMRMLMarkupsFiducialNode* markupsNode = vtkMRMLMarkupsFiducialNode::SafeDownCast(caller);
+  if (markupsNode && markupsNode == this->GetOutputMarkupsNode())
+  {
+    this->InvokeCustomModifiedEvent(OutputMarkupsModifiedEvent, markupsNode);
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -67,6 +67,7 @@ public:
     InputTransformModifiedEvent,
     LandmarkDetectedEvent,
     ResetDetectionEvent,
+    OutputMarkupsModifiedEvent,
   };
 
   //@{
@@ -79,6 +80,7 @@ public:
 
   //@{
   /// OutputMarkupsNode is the transform node that is used for landmark detection
+  /// OutputMarkupsModifiedEvent is invoked when control points are added, removed or modified in the output markups node.
   const char* GetOutputMarkupsNodeReferenceRole() { return "outputMarkupsNode"; };
   const char* GetOutputMarkupsNodeReferenceMRMLAttributeName() { return "outputMarkupsNodeRef"; };
   vtkMRMLMarkupsFiducialNode* GetOutputMarkupsNode();
@@ -113,6 +115,18 @@ public:
   //@}
   
 
+  //@{
+  /// If enabled, landmarks are detected from every update of the input transform, using sliding time windows
+  /// of FilterWindowTimeSec and DetectionTimeSec length, based on the time when each sample was received.
+  /// Mean and covariance of the stylus tip and shaft positions are updated in constant time for each sample,
+  /// therefore detection can run at the full rate of the tracker. AcquisitionRateHz is not used in this mode.
+  /// If disabled, samples are processed by vtkIGSIOLandmarkDetectionAlgo, which assumes that samples are received at AcquisitionRateHz.
+  /// Off by default.
+  vtkSetMacro(FullRateDetectionEnabled, bool);
+  vtkGetMacro(FullRateDetectionEnabled, bool);
+  vtkBooleanMacro(FullRateDetectionEnabled, bool);
+  //@}
+
   //@{
   /// Device acquisition rate([samples/sec]).
   /// This is required to determine the minimum number of stylus tip poses required for detecting a point.
@@ -146,6 +160,14 @@ public:
   vtkGetMacro(StylusShaftMinimumDisplacementThresholdMm, double);
   //@}
 
+  //@{
+  /// Position of a point on the stylus shaft in the stylus tip coordinate system, used in full rate detection.
+  /// The point moves when the stylus is pivoting, its motion is compared to StylusShaftMinimumDisplacementThresholdMm.
+  /// It should be along the shaft axis, far from the tip. Default value is (100, 0, 0) [mm].
+  vtkSetVector3Macro(StylusShaftPoint_StylusTip, double);
+  vtkGetVector3Macro(StylusShaftPoint_StylusTip, double);
+  //@}
+
   //@{
   /// A landmark position will be detected if the filtered stylus tip position moves during detection time inside a bounding box
   /// with lengths norm smaller than StylusTipMaximumMotionThresholdMm.
@@ -172,11 +194,13 @@ protected:
   bool LandmarkDetectionInProgress{ false };
 
   bool UseMarkupsCoordinatesForOutput{ true };
+  bool FullRateDetectionEnabled{ false };
 
   double AcquisitionRateHz{ 20.0 };
   double FilterWindowTimeSec{ 0.2 };
   double DetectionTimeSec{ 1.0 };
   double StylusShaftMinimumDisplacementThresholdMm{ 30.0 };
+  double StylusShaftPoint_StylusTip[3]{ 100.0, 0.0, 0.0 };
   double StylusTipMaximumDisplacementThresholdMm{ 1.5 };
   double MinimumDistanceBetweenLandmarksMm{ 15.0 };
 
@@ -19,6 +19,7 @@
 ==============================================================================*/
 
 // SlicerIGT includes
+#include <vtkLandmarkSpatialIndex.h>
 #include <vtkSlicerLandmarkDetectionLogic.h>
 
 // Slicer MRML includes
@@ -27,8 +28,12 @@
 #include <vtkMRMLScene.h>
 
 #include <vtkMRMLLandmarkDetectionNode.h>
+#include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLMarkupsFiducialNode.h>
 
+// Sequences MRML includes
+#include <vtkMRMLSequenceNode.h>
+
 // VTK includes
 #include <vtkTransform.h>
 
@@ -64,6 +69,230 @@ int TestControlPointPosition(vtkMRMLMarkupsFiducialNode* landmarkNode, int point
   return EXIT_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+int TestFullRateLandmarkDetection(vtkSlicerLandmarkDetectionLogic* logic, vtkMRMLScene* scene)
+{
+  vtkMRMLTransformNode* markerToReferenceTransform = vtkMRMLTransformNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLTransformNode"));
+  vtkMRMLMarkupsFiducialNode* landmarkNode = vtkMRMLMarkupsFiducialNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLMarkupsFiducialNode"));
+  vtkMRMLLandmarkDetectionNode* landmarkDetectionNode = vtkMRMLLandmarkDetectionNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLLandmarkDetectionNode"));
+  landmarkDetectionNode->SetAndObserveInputTransformNode(markerToReferenceTransform);
+  landmarkDetectionNode->SetAndObserveOutputMarkupsNode(landmarkNode);
+  landmarkDetectionNode->FullRateDetectionEnabledOn();
+  landmarkDetectionNode->LandmarkDetectionInProgressOn();
+
+  // Samples are added at tracker rate, much higher than the acquisition rate of the node
+  const double trackerRateHz = 500.0;
+  const int numberOfSamplesInDetectionTime = static_cast<int>(landmarkDetectionNode->GetDetectionTimeSec() * trackerRateHz);
+  double landmark_RAS[3] = { -30.0, 20.0, 40.0 };
+  double timeSec = 0.0;
+
+  // Test that no landmark is detected while the stylus tip is moving
+  for (int i = 0; i < 2 * numberOfSamplesInDetectionTime; ++i)
+  {
+    vtkNew<vtkTransform> stylusPosition;
+    stylusPosition->PostMultiply();
+    stylusPosition->RotateX(vtkMath::Random() * 360.0);
+    stylusPosition->RotateY(vtkMath::Random() * 360.0);
+    stylusPosition->RotateZ(vtkMath::Random() * 360.0);
+    stylusPosition->Translate(landmark_RAS[0] + 0.1 * i, landmark_RAS[1], landmark_RAS[2]);
+    logic->AddStylusTipToReferenceTransform(landmarkDetectionNode, stylusPosition->GetMatrix(), timeSec);
+    timeSec += 1.0 / trackerRateHz;
+  }
+  CHECK_INT(landmarkNode->GetNumberOfControlPoints(), 0);
+
+  // Test that the landmark is detected as soon as the stylus is pivoting around the tip for the detection time
+  landmarkDetectionNode->ResetDetection();
+  for (int i = 0; i <= numberOfSamplesInDetectionTime + 1; ++i)
+  {
+    if (i <= numberOfSamplesInDetectionTime)
+    {
+      // Samples added so far span less than the detection time
+      CHECK_INT(landmarkNode->GetNumberOfControlPoints(), 0);
+    }
+    vtkNew<vtkTransform> stylusPosition;
+    stylusPosition->PostMultiply();
+    stylusPosition->RotateX(vtkMath::Random() * 360.0);
+    stylusPosition->RotateY(vtkMath::Random() * 360.0);
+    stylusPosition->RotateZ(vtkMath::Random() * 360.0);
+    stylusPosition->Translate(landmark_RAS);
+    logic->AddStylusTipToReferenceTransform(landmarkDetectionNode, stylusPosition->GetMatrix(), timeSec);
+    timeSec += 1.0 / trackerRateHz;
+  }
+  CHECK_INT(landmarkNode->GetNumberOfControlPoints(), 1);
+  CHECK_EXIT_SUCCESS(TestControlPointPosition(landmarkNode, 0, landmark_RAS));
+
+  // Test that poses are ignored if landmark detection is not in progress
+  landmarkDetectionNode->LandmarkDetectionInProgressOff();
+  double landmark2_RAS[3] = { 30.0, 20.0, 40.0 };
+  for (int i = 0; i <= numberOfSamplesInDetectionTime + 1; ++i)
+  {
+    vtkNew<vtkTransform> stylusPosition;
+    stylusPosition->PostMultiply();
+    stylusPosition->RotateX(vtkMath::Random() * 360.0);
+    stylusPosition->RotateY(vtkMath::Random() * 360.0);
+    stylusPosition->Translate(landmark2_RAS);
+    logic->AddStylusTipToReferenceTransform(landmarkDetectionNode, stylusPosition->GetMatrix(), timeSec);
+    timeSec += 1.0 / trackerRateHz;
+  }
+  CHECK_INT(landmarkNode->GetNumberOfControlPoints(), 1);
+
+  // Test that the stylus shaft point is used for detecting pivoting:
+  // rotation around the X axis does not move the default shaft point, which is on the X axis.
+  landmarkDetectionNode->LandmarkDetectionInProgressOn();
+  for (int shaftPointIndex = 0; shaftPointIndex < 2; ++shaftPointIndex)
+  {
+    if (shaftPointIndex == 1)
+    {
+      landmarkDetectionNode->SetStylusShaftPoint_StylusTip(0.0, 0.0, 100.0);
+      landmarkDetectionNode->ResetDetection();
+    }
+    for (int i = 0; i <= numberOfSamplesInDetectionTime + 1; ++i)
+    {
+      vtkNew<vtkTransform> stylusPosition;
+      stylusPosition->PostMultiply();
+      stylusPosition->RotateX(vtkMath::Random() * 360.0);
+      stylusPosition->Translate(landmark2_RAS);
+      logic->AddStylusTipToReferenceTransform(landmarkDetectionNode, stylusPosition->GetMatrix(), timeSec);
+      timeSec += 1.0 / trackerRateHz;
+    }
+    CHECK_INT(landmarkNode->GetNumberOfControlPoints(), shaftPointIndex + 1);
+  }
+  CHECK_EXIT_SUCCESS(TestControlPointPosition(landmarkNode, 1, landmark2_RAS));
+
+  landmarkDetectionNode->LandmarkDetectionInProgressOff();
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void AddStylusPosesToSequence(vtkMRMLSequenceNode* sequenceNode, int numberOfPoses, double acquisitionRateHz,
+  double stylusTipPosition_RAS[3], double stylusTipMotionPerPose_RAS[3])
+{
+  for (int i = 0; i < numberOfPoses; ++i)
+  {
+    vtkNew<vtkTransform> stylusPosition;
+    stylusPosition->PostMultiply();
+    stylusPosition->RotateX(vtkMath::Random() * 360.0);
+    stylusPosition->RotateY(vtkMath::Random() * 360.0);
+    stylusPosition->RotateZ(vtkMath::Random() * 360.0);
+    stylusPosition->Translate(
+      stylusTipPosition_RAS[0] + i * stylusTipMotionPerPose_RAS[0],
+      stylusTipPosition_RAS[1] + i * stylusTipMotionPerPose_RAS[1],
+      stylusTipPosition_RAS[2] + i * stylusTipMotionPerPose_RAS[2]);
+    vtkNew<vtkMRMLLinearTransformNode> transformNode;
+    transformNode->SetMatrixTransformToParent(stylusPosition->GetMatrix());
+    std::string indexValue = std::to_string(sequenceNode->GetNumberOfDataNodes() / acquisitionRateHz);
+    sequenceNode->SetDataNodeAtValue(transformNode, indexValue);
+  }
+}
+
+//----------------------------------------------------------------------------
+int TestSequenceLandmarkDetection(vtkSlicerLandmarkDetectionLogic* logic)
+{
+  // Recorded sequence: pivoting at two landmarks, with the stylus moving between them
+  const double acquisitionRateHz = 20.0;
+  const int numberOfPivotingPoses = 100;
+  double landmark0_RAS[3] = { 10.0, -20.0, 30.0 };
+  double landmark1_RAS[3] = { 80.0, -20.0, 30.0 };
+  double motionStart_RAS[3] = { 150.0, 60.0, 30.0 };
+  double noMotion_RAS[3] = { 0.0, 0.0, 0.0 };
+  double motion_RAS[3] = { 5.0, 5.0, 0.0 };
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  AddStylusPosesToSequence(sequenceNode, numberOfPivotingPoses, acquisitionRateHz, landmark0_RAS, noMotion_RAS);
+  AddStylusPosesToSequence(sequenceNode, 40, acquisitionRateHz, motionStart_RAS, motion_RAS);
+  const int landmark1StartItemIndex = sequenceNode->GetNumberOfDataNodes();
+  AddStylusPosesToSequence(sequenceNode, numberOfPivotingPoses, acquisitionRateHz, landmark1_RAS, noMotion_RAS);
+
+  std::vector<vtkSlicerLandmarkDetectionLogic::DetectionParameters> parameterSets;
+  vtkSlicerLandmarkDetectionLogic::DetectionParameters parameters;
+  parameters.AcquisitionRateHz = acquisitionRateHz;
+  parameterSets.push_back(parameters);
+  parameters.FullRateDetectionEnabled = true;
+  parameterSets.push_back(parameters);
+  // Detection time is longer than the time spent at each landmark
+  parameters.DetectionTimeSec = 2.0 * numberOfPivotingPoses / acquisitionRateHz;
+  parameterSets.push_back(parameters);
+
+  std::vector< std::vector<vtkSlicerLandmarkDetectionLogic::DetectedLandmark> > detectedLandmarksForEachParameterSet;
+  CHECK_BOOL(logic->DetectLandmarksInSequence(sequenceNode, parameterSets, detectedLandmarksForEachParameterSet), true);
+  CHECK_INT(detectedLandmarksForEachParameterSet.size(), parameterSets.size());
+
+  for (int parameterSetIndex = 0; parameterSetIndex < 2; ++parameterSetIndex)
+  {
+    const std::vector<vtkSlicerLandmarkDetectionLogic::DetectedLandmark>& detectedLandmarks = detectedLandmarksForEachParameterSet[parameterSetIndex];
+    CHECK_INT(detectedLandmarks.size(), 2);
+    CHECK_BOOL(detectedLandmarks[0].ItemIndex < landmark1StartItemIndex, true);
+    CHECK_BOOL(detectedLandmarks[1].ItemIndex >= landmark1StartItemIndex, true);
+    for (int i = 0; i < 3; ++i)
+    {
+      CHECK_DOUBLE_TOLERANCE(detectedLandmarks[0].Position_Reference[i], landmark0_RAS[i], epsilon);
+      CHECK_DOUBLE_TOLERANCE(detectedLandmarks[1].Position_Reference[i], landmark1_RAS[i], epsilon);
+    }
+  }
+
+  // Full rate detection uses the timestamps: the first landmark is detected exactly after the detection time
+  const std::vector<vtkSlicerLandmarkDetectionLogic::DetectedLandmark>& fullRateLandmarks = detectedLandmarksForEachParameterSet[1];
+  CHECK_DOUBLE_TOLERANCE(fullRateLandmarks[0].TimestampSec, parameterSets[1].DetectionTimeSec, epsilon);
+  CHECK_DOUBLE_TOLERANCE(fullRateLandmarks[1].TimestampSec, std::stod(sequenceNode->GetNthIndexValue(fullRateLandmarks[1].ItemIndex)), epsilon);
+
+  CHECK_INT(detectedLandmarksForEachParameterSet[2].size(), 0);
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int TestLandmarkSpatialIndex()
+{
+  const double minimumDistanceMm = 10.0;
+  vtkLandmarkSpatialIndex landmarkIndex;
+  landmarkIndex.Initialize(nullptr, minimumDistanceMm);
+  double origin[3] = { 0.0, 0.0, 0.0 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(origin), false);
+  landmarkIndex.AddPoint(origin);
+
+  // Points at exactly the minimum distance are accepted, points closer than that are rejected
+  double atMinimumDistance[3] = { 6.0, 8.0, 0.0 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(atMinimumDistance), false);
+  double justInsideMinimumDistance[3] = { 6.0, 7.999, 0.0 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(justInsideMinimumDistance), true);
+  double justOutsideMinimumDistance[3] = { 0.0, 0.0, -10.001 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(justOutsideMinimumDistance), false);
+  double diagonalInside[3] = { 5.77, 5.77, 5.77 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(diagonalInside), true);
+  double diagonalOutside[3] = { -5.78, -5.78, -5.78 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(diagonalOutside), false);
+
+  // Nearby points in neighbor cells are found, including cells with negative index
+  double nearCellBoundary[3] = { 19.9, -0.1, 0.0 };
+  landmarkIndex.AddPoint(nearCellBoundary);
+  double inNeighborCell[3] = { 20.1, -0.1, 0.0 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(inNeighborCell), true);
+  double insideInNegativeNeighborCell[3] = { 19.9, -10.05, 0.0 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(insideInNegativeNeighborCell), true);
+  double outsideInNegativeNeighborCell[3] = { 19.9, -10.2, 0.0 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(outsideInNegativeNeighborCell), false);
+
+  // Proximity check is disabled if the minimum distance is 0
+  landmarkIndex.Initialize(nullptr, 0.0);
+  landmarkIndex.AddPoint(origin);
+  CHECK_BOOL(landmarkIndex.IsPointNearby(origin), false);
+
+  // Only defined control points of the markups node are added
+  vtkNew<vtkMRMLMarkupsFiducialNode> markupsNode;
+  markupsNode->AddControlPoint(vtkVector3d(origin));
+  markupsNode->AddControlPoint(vtkVector3d(50.0, 0.0, 0.0));
+  markupsNode->SetNthControlPointPosition(1, 50.0, 0.0, 0.0, vtkMRMLMarkupsNode::PositionUndefined);
+  CHECK_BOOL(landmarkIndex.IsInitializationRequired(markupsNode, minimumDistanceMm), true);
+  landmarkIndex.Initialize(markupsNode, minimumDistanceMm);
+  CHECK_BOOL(landmarkIndex.IsInitializationRequired(markupsNode, minimumDistanceMm), false);
+  CHECK_BOOL(landmarkIndex.IsInitializationRequired(markupsNode, 2.0 * minimumDistanceMm), true);
+  CHECK_BOOL(landmarkIndex.IsPointNearby(justInsideMinimumDistance), true);
+  double nearUndefinedPoint[3] = { 51.0, 0.0, 0.0 };
+  CHECK_BOOL(landmarkIndex.IsPointNearby(nearUndefinedPoint), false);
+  landmarkIndex.SetModified();
+  CHECK_BOOL(landmarkIndex.IsInitializationRequired(markupsNode, minimumDistanceMm), true);
+
+  return EXIT_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 int vtkLandmarkDetectionTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
 {
@@ -175,5 +404,9 @@ int vtkLandmarkDetectionTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
     CHECK_EXIT_SUCCESS(TestControlPointPosition(landmarkNode, 2, point2_RAS));
   }
 
+  CHECK_EXIT_SUCCESS(TestLandmarkSpatialIndex());
+  CHECK_EXIT_SUCCESS(TestFullRateLandmarkDetection(logic, scene));
+  CHECK_EXIT_SUCCESS(TestSequenceLandmarkDetection(logic));
+
   return EXIT_SUCCESS;
 }
@@ -22,46 +22,1514 @@
 #include <vtkMRMLTransformNode.h>
 #include "vtkMRMLScene.h"
 
+// Sequences MRML includes
+#include <vtkMRMLSequenceNode.h>
+
 // vtkIGSIOCalibration includes
 #include <vtkIGSIOPivotCalibrationAlgo.h>
 #include <vtkIGSIOSpinCalibrationAlgo.h>
 
-// VTK includes
-#include <vtkNew.h>
-#include <vtkSmartPointer.h>
-#include <vtkCommand.h>
-#include <vtkMatrix4x4.h>
+// VTK includes
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkCommand.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkSMPTools.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+const int DEFAULT_RECORDING_BUFFER_CAPACITY = 4096;
+
+//----------------------------------------------------------------------------
+namespace
+{
+  // First 3 rows of a tool to reference 4x4 matrix: R(row,column) = pose[row*4+column], p(row) = pose[row*4+3]
+  typedef std::array<double, 12> PoseType;
+
+  //----------------------------------------------------------------------------
+  void GetPoseFromMatrix(vtkMatrix4x4* toolToReferenceMatrix, PoseType& pose)
+  {
+    for (int row = 0; row < 3; row++)
+    {
+      for (int column = 0; column < 4; column++)
+      {
+        pose[row * 4 + column] = toolToReferenceMatrix->GetElement(row, column);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void GetMatrixFromPose(const PoseType& pose, vtkMatrix4x4* toolToReferenceMatrix)
+  {
+    toolToReferenceMatrix->Identity();
+    for (int row = 0; row < 3; row++)
+    {
+      for (int column = 0; column < 4; column++)
+      {
+        toolToReferenceMatrix->SetElement(row, column, pose[row * 4 + column]);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Distance of the shaft direction computed from the pose and the shaft direction in the reference coordinate system
+  double GetSpinResidual(const PoseType& pose, const double shaftDirection_Tool[3], const double shaftDirection_Reference[3])
+  {
+    double residual2 = 0.0;
+    for (int row = 0; row < 3; row++)
+    {
+      double d = pose[row * 4 + 0] * shaftDirection_Tool[0] + pose[row * 4 + 1] * shaftDirection_Tool[1]
+        + pose[row * 4 + 2] * shaftDirection_Tool[2] - shaftDirection_Reference[row];
+      residual2 += d * d;
+    }
+    return sqrt(residual2);
+  }
+
+  //----------------------------------------------------------------------------
+  // Shaft direction of a spin calibration from the weighted sum of the rotation matrices of the poses (S = sum(w * R)).
+  // Minimizing sum(w * |R * a - d|^2) for unit vectors a and d means maximizing d^T * S * a,
+  // therefore a is the eigenvector of S^T * S with the largest eigenvalue and d is the normalized S * a.
+  // Returns false if the direction cannot be computed.
+  bool SolveShaftDirection(const double sumRotation[3][3], double shaftDirection_Tool[3], double shaftDirection_Reference[3])
+  {
+    double sts[3][3];
+    double* stsRows[3] = { sts[0], sts[1], sts[2] };
+    for (int i = 0; i < 3; i++)
+    {
+      for (int j = 0; j < 3; j++)
+      {
+        sts[i][j] = sumRotation[0][i] * sumRotation[0][j] + sumRotation[1][i] * sumRotation[1][j] + sumRotation[2][i] * sumRotation[2][j];
+      }
+    }
+    double eigenvalues[3] = { 0.0, 0.0, 0.0 };
+    double eigenvectors[3][3];
+    double* eigenvectorsRows[3] = { eigenvectors[0], eigenvectors[1], eigenvectors[2] };
+    if (vtkMath::Jacobi(stsRows, eigenvalues, eigenvectorsRows) == 0 || eigenvalues[0] <= 0.0)
+    {
+      return false;
+    }
+    // eigenvectors are in columns, sorted by decreasing eigenvalue
+    for (int i = 0; i < 3; i++)
+    {
+      shaftDirection_Tool[i] = eigenvectors[i][0];
+    }
+    vtkMath::Multiply3x3(sumRotation, shaftDirection_Tool, shaftDirection_Reference);
+    return vtkMath::Normalize(shaftDirection_Reference) > 0.0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Fixed-capacity buffer of timestamped poses, stored contiguously. When full, the oldest pose is overwritten.
+  class PoseRingBuffer
+  {
+  public:
+    struct TimestampedPose
+    {
+      double TimestampSec;
+      PoseType Pose;
+    };
+
+    void SetCapacity(int capacity)
+    {
+      std::vector<TimestampedPose> items;
+      int numberOfItemsToKeep = std::min(capacity, this->NumberOfItems);
+      items.reserve(capacity);
+      for (int i = this->NumberOfItems - numberOfItemsToKeep; i < this->NumberOfItems; i++)
+      {
+        items.push_back(this->GetItem(i));
+      }
+      items.resize(capacity);
+      this->Items.swap(items);
+      this->NumberOfItems = numberOfItemsToKeep;
+      this->OldestItemIndex = 0;
+    }
+    int GetCapacity() { return static_cast<int>(this->Items.size()); }
+    int GetNumberOfItems() { return this->NumberOfItems; }
+
+    void Clear()
+    {
+      this->NumberOfItems = 0;
+      this->OldestItemIndex = 0;
+    }
+
+    void Add(double timestampSec, const PoseType& pose)
+    {
+      if (this->Items.empty())
+      {
+        return;
+      }
+      int capacity = this->GetCapacity();
+      TimestampedPose* item = nullptr;
+      if (this->NumberOfItems < capacity)
+      {
+        item = &this->Items[(this->OldestItemIndex + this->NumberOfItems) % capacity];
+        this->NumberOfItems++;
+      }
+      else
+      {
+        item = &this->Items[this->OldestItemIndex];
+        this->OldestItemIndex = (this->OldestItemIndex + 1) % capacity;
+      }
+      item->TimestampSec = timestampSec;
+      item->Pose = pose;
+    }
+
+    // Index 0 is the oldest item
+    const TimestampedPose& GetItem(int index)
+    {
+      return this->Items[(this->OldestItemIndex + index) % this->Items.size()];
+    }
+
+  private:
+    std::vector<TimestampedPose> Items;
+    int NumberOfItems{ 0 };
+    int OldestItemIndex{ 0 };
+  };
+}
+
+//----------------------------------------------------------------------------
+// Least-squares pivot calibration from accumulated normal equations.
+// Each pose (rotation R, translation p) gives 3 equations for the unknown tip position in the
+// tool coordinate system (t) and the pivot point position in the reference coordinate system (c):
+//   R * t + p = c   =>   [R -I] * [t; c] = -p
+// The normal equations (A^T*A, A^T*b) and b^T*b are accumulated, which is enough for computing
+// both the solution and the residual error without iterating through the poses.
+// The sum of the rotation matrices is accumulated as well, for computing the orientation spread of the poses.
+class vtkPivotCalibrationLeastSquares
+{
+public:
+  vtkPivotCalibrationLeastSquares()
+  {
+    this->Reset();
+  }
+
+  void Reset()
+  {
+    for (int i = 0; i < 6; i++)
+    {
+      for (int j = 0; j < 6; j++)
+      {
+        this->AtA[i][j] = 0.0;
+      }
+      this->Atb[i] = 0.0;
+    }
+    for (int i = 0; i < 9; i++)
+    {
+      this->SumRotation[i] = 0.0;
+    }
+    this->btb = 0.0;
+    this->SumWeights = 0.0;
+  }
+
+  void Accumulate(const PoseType& pose, double weight = 1.0)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      for (int j = 0; j < 3; j++)
+      {
+        double rtr = 0.0;
+        for (int k = 0; k < 3; k++)
+        {
+          rtr += pose[k * 4 + i] * pose[k * 4 + j];
+        }
+        this->AtA[i][j] += weight * rtr;                  // R^T*R
+        this->AtA[i][3 + j] -= weight * pose[j * 4 + i];  // -R^T
+        this->AtA[3 + i][j] -= weight * pose[i * 4 + j];  // -R
+      }
+      this->AtA[3 + i][3 + i] += weight;                  // I
+
+      double rtp = 0.0;
+      for (int k = 0; k < 3; k++)
+      {
+        rtp += pose[k * 4 + i] * pose[k * 4 + 3];
+      }
+      this->Atb[i] -= weight * rtp;                       // -R^T*p
+      this->Atb[3 + i] += weight * pose[i * 4 + 3];       // p
+      this->btb += weight * pose[i * 4 + 3] * pose[i * 4 + 3];
+      for (int j = 0; j < 3; j++)
+      {
+        this->SumRotation[i * 3 + j] += weight * pose[i * 4 + j];
+      }
+    }
+    this->SumWeights += weight;
+  }
+
+  // Computes tool tip position (in tool coordinate system) and pivot point position (in reference coordinate system)
+  // and the weighted root-mean-square of the pose residuals.
+  // Returns false if the system cannot be solved (not enough poses or not enough variation in orientation).
+  bool Solve(double toolTipPosition_Tool[3], double pivotPosition_Reference[3], double& rmseMm) const
+  {
+    if (this->SumWeights <= 0.0)
+    {
+      return false;
+    }
+    double ata[6][6];
+    double* ataRows[6];
+    double x[6];
+    for (int i = 0; i < 6; i++)
+    {
+      for (int j = 0; j < 6; j++)
+      {
+        ata[i][j] = this->AtA[i][j];
+      }
+      ataRows[i] = ata[i];
+      x[i] = this->Atb[i];
+    }
+    if (vtkMath::SolveLinearSystem(ataRows, x, 6) == 0)
+    {
+      return false;
+    }
+
+    // Sum of squared residuals: x^T*A^T*A*x - 2*x^T*A^T*b + b^T*b
+    double sumSquaredResiduals = this->btb;
+    for (int i = 0; i < 6; i++)
+    {
+      double ataX = 0.0;
+      for (int j = 0; j < 6; j++)
+      {
+        ataX += this->AtA[i][j] * x[j];
+      }
+      sumSquaredResiduals += x[i] * ataX - 2.0 * x[i] * this->Atb[i];
+    }
+    rmseMm = sqrt(std::max(0.0, sumSquaredResiduals) / this->SumWeights);
+
+    for (int i = 0; i < 3; i++)
+    {
+      toolTipPosition_Tool[i] = x[i];
+      pivotPosition_Reference[i] = x[3 + i];
+    }
+    return true;
+  }
+
+  // Computes the condition number of A^T*A (ratio of its largest and smallest eigenvalue, VTK_DOUBLE_MAX if singular)
+  // and the uncertainty of the tool tip position: root of the sum of the variances of the tool tip position coordinates,
+  // estimated from the residual error of the solution (rmseMm, as returned by Solve).
+  // The uncertainty is negative if there are not enough poses for estimating it.
+  // Returns false if the eigenvalues cannot be computed.
+  bool GetQualityMetrics(double rmseMm, double& conditionNumber, double& toolTipUncertaintyMm) const
+  {
+    double ata[6][6];
+    double eigenvectors[6][6];
+    double* ataRows[6];
+    double* eigenvectorRows[6];
+    double eigenvalues[6];
+    for (int i = 0; i < 6; i++)
+    {
+      for (int j = 0; j < 6; j++)
+      {
+        ata[i][j] = this->AtA[i][j];
+      }
+      ataRows[i] = ata[i];
+      eigenvectorRows[i] = eigenvectors[i];
+    }
+    // Eigenvalues are sorted in decreasing order
+    if (vtkMath::JacobiN(ataRows, 6, eigenvalues, eigenvectorRows) == 0)
+    {
+      return false;
+    }
+    const double singularEigenvalueTolerance = 1e-12;
+    if (eigenvalues[5] <= singularEigenvalueTolerance * std::max(1.0, eigenvalues[0]))
+    {
+      conditionNumber = VTK_DOUBLE_MAX;
+      toolTipUncertaintyMm = -1.0;
+      return true;
+    }
+    conditionNumber = eigenvalues[0] / eigenvalues[5];
+
+    // Covariance of the solution is sigma^2 * (A^T*A)^-1, sigma^2 is estimated from the sum of squared residuals
+    // (3 equations per pose, 6 unknowns).
+    double degreesOfFreedom = 3.0 * this->SumWeights - 6.0;
+    if (degreesOfFreedom <= 0.0)
+    {
+      toolTipUncertaintyMm = -1.0;
+      return true;
+    }
+    double residualVariance = rmseMm * rmseMm * this->SumWeights / degreesOfFreedom;
+    // Trace of the tool tip block of (A^T*A)^-1 = V * diag(1/eigenvalues) * V^T
+    double toolTipVarianceFactor = 0.0;
+    for (int k = 0; k < 6; k++)
+    {
+      double toolTipComponent2 = 0.0;
+      for (int i = 0; i < 3; i++)
+      {
+        toolTipComponent2 += eigenvectors[i][k] * eigenvectors[i][k];
+      }
+      toolTipVarianceFactor += toolTipComponent2 / eigenvalues[k];
+    }
+    toolTipUncertaintyMm = sqrt(residualVariance * toolTipVarianceFactor);
+    return true;
+  }
+
+  // Root-mean-square rotation angle between the poses and their mean orientation.
+  // Computed from the chordal distance: the mean of |R_i - M|^2 (M = mean of the rotation matrices)
+  // is 3 - |M|^2, and |R_i - M|^2 = 4 * (1 - cos(angle)) if M is a rotation.
+  double GetOrientationSpreadDegrees() const
+  {
+    if (this->SumWeights <= 0.0)
+    {
+      return 0.0;
+    }
+    double meanRotationNorm2 = 0.0;
+    for (int i = 0; i < 9; i++)
+    {
+      double meanRotationElement = this->SumRotation[i] / this->SumWeights;
+      meanRotationNorm2 += meanRotationElement * meanRotationElement;
+    }
+    double cosAngle = 1.0 - std::max(0.0, 3.0 - meanRotationNorm2) / 4.0;
+    return vtkMath::DegreesFromRadians(acos(std::max(-1.0, std::min(1.0, cosAngle))));
+  }
+
+  // Distance between the pivot point and the tool tip position computed from the pose
+  static double GetResidual(const PoseType& pose, const double toolTipPosition_Tool[3], const double pivotPosition_Reference[3])
+  {
+    double residual2 = 0.0;
+    for (int row = 0; row < 3; row++)
+    {
+      double d = pose[row * 4 + 0] * toolTipPosition_Tool[0] + pose[row * 4 + 1] * toolTipPosition_Tool[1]
+        + pose[row * 4 + 2] * toolTipPosition_Tool[2] + pose[row * 4 + 3] - pivotPosition_Reference[row];
+      residual2 += d * d;
+    }
+    return sqrt(residual2);
+  }
+
+private:
+  double AtA[6][6];
+  double Atb[6];
+  double btb;
+  double SumWeights;
+  double SumRotation[9];
+};
+
+//----------------------------------------------------------------------------
+// Least-squares accumulators of a pivot pose buffer, used for incremental calibration and quality metrics
+struct vtkIncrementalPivotCalibrationState
+{
+  vtkPivotCalibrationLeastSquares Solver;
+  // Orientation of the tool tip is only computed by the full pivot calibration
+  bool FullSolveRequired{ true };
+  // Direction of the shaft axis relative to the tool tip position, as oriented by the last full pivot calibration
+  bool ShaftAxisAlongToolTip{ false };
+
+  void Reset()
+  {
+    this->Solver.Reset();
+    this->FullSolveRequired = true;
+  }
+
+  // Update the accumulators after the newest pose is added to the pose buffer
+  void Update(const std::deque<PoseType>& poses, bool posesRemoved)
+  {
+    if (posesRemoved)
+    {
+      // Removing poses requires accumulating all the remaining poses again
+      // (subtracting them from the accumulators would make the solution drift due to rounding errors).
+      this->Solver.Reset();
+      for (const PoseType& pose : poses)
+      {
+        this->Solver.Accumulate(pose);
+      }
+      this->FullSolveRequired = true;
+    }
+    else if (!poses.empty())
+    {
+      this->Solver.Accumulate(poses.back());
+    }
+  }
+
+  // Remember the orientation of the result of a full pivot calibration
+  void SetFullCalibrationResult(vtkMatrix4x4* toolTipToToolMatrix)
+  {
+    double shaftAxis_Tool[3] = { toolTipToToolMatrix->GetElement(0, 2), toolTipToToolMatrix->GetElement(1, 2),
+      toolTipToToolMatrix->GetElement(2, 2) };
+    double toolTipPosition_Tool[3] = { toolTipToToolMatrix->GetElement(0, 3), toolTipToToolMatrix->GetElement(1, 3),
+      toolTipToToolMatrix->GetElement(2, 3) };
+    this->ShaftAxisAlongToolTip = (vtkMath::Dot(shaftAxis_Tool, toolTipPosition_Tool) >= 0.0);
+    this->FullSolveRequired = false;
+  }
+
+  // Update the result the same way as the full calibration: the orientation of the current result is kept
+  // and the shaft direction is flipped if it is inconsistent with the new tool tip position.
+  void UpdateCalibrationResult(vtkMatrix4x4* toolTipToToolMatrix, const double toolTipPosition_Tool[3])
+  {
+    for (int row = 0; row < 3; row++)
+    {
+      toolTipToToolMatrix->SetElement(row, 3, toolTipPosition_Tool[row]);
+    }
+    double shaftAxis_Tool[3] = { toolTipToToolMatrix->GetElement(0, 2), toolTipToToolMatrix->GetElement(1, 2),
+      toolTipToToolMatrix->GetElement(2, 2) };
+    if ((vtkMath::Dot(shaftAxis_Tool, toolTipPosition_Tool) >= 0.0) != this->ShaftAxisAlongToolTip)
+    {
+      vtkIGSIOAbstractStylusCalibrationAlgo::FlipShaftDirection(toolTipToToolMatrix);
+    }
+  }
+
+  // Estimated standard deviation of the tool tip position (negative if not available)
+  double GetToolTipUncertaintyMm(int numberOfPoses) const
+  {
+    double toolTipPosition_Tool[3] = { 0.0, 0.0, 0.0 };
+    double pivotPosition_Reference[3] = { 0.0, 0.0, 0.0 };
+    double rmseMm = -1.0;
+    double conditionNumber = -1.0;
+    double toolTipUncertaintyMm = -1.0;
+    if (numberOfPoses < 2 || !this->Solver.Solve(toolTipPosition_Tool, pivotPosition_Reference, rmseMm)
+      || !this->Solver.GetQualityMetrics(rmseMm, conditionNumber, toolTipUncertaintyMm))
+    {
+      return -1.0;
+    }
+    return toolTipUncertaintyMm;
+  }
+};
+
+//----------------------------------------------------------------------------
+// Poses of a calibration. The calibration algorithm only rejects input poses that are too similar to the previous pose
+// and computes the calibration, the poses to keep are decided here. Therefore the poses used by the logic
+// (incremental and robust calibration, quality metrics) are always the same as the poses in the algorithm.
+// Poses are grouped into buckets of PoseBucketSize poses (of the algorithm), starting from the oldest pose.
+// If validation is enabled then a bucket is discarded when it is filled and the calibration error computed from
+// the bucket alone is above MaximumPoseBucketError (of the algorithm). If there are more buckets than the maximum
+// then the oldest buckets are discarded.
+class vtkCalibrationPoseBuffer
+{
+public:
+  enum CalibrationType
+  {
+    PIVOT_CALIBRATION,
+    SPIN_CALIBRATION
+  };
+
+  vtkCalibrationPoseBuffer(CalibrationType calibrationType)
+    : Type(calibrationType)
+  {
+  }
+
+  // Add a pose to the calibration algorithm and to the buffer.
+  // Returns true if the buffer has changed, false if the pose was rejected by the algorithm.
+  bool AddPose(vtkIGSIOAbstractStylusCalibrationAlgo* algo, vtkMatrix4x4* toolToReferenceMatrix, int maximumNumberOfBuckets,
+    bool validationEnabled)
+  {
+    this->NumberOfDiscardedOldestPoses = 0;
+    this->NumberOfDiscardedNewestPoses = 0;
+    const int bucketSize = std::max(1, algo->GetPoseBucketSize());
+
+    int numberOfPosesBefore = algo->GetNumberOfCalibrationPoints();
+    // The algorithm must not discard poses by itself
+    algo->SetMaximumNumberOfPoseBuckets(numberOfPosesBefore / bucketSize + 2);
+    algo->InsertNextCalibrationPoint(toolToReferenceMatrix);
+    int numberOfPosesAfter = algo->GetNumberOfCalibrationPoints();
+    if (numberOfPosesAfter == numberOfPosesBefore)
+    {
+      return false;
+    }
+    PoseType pose;
+    GetPoseFromMatrix(toolToReferenceMatrix, pose);
+    this->Poses.push_back(pose);
+    bool algorithmUpdateRequired = (numberOfPosesAfter != static_cast<int>(this->Poses.size()));
+
+    int numberOfPoses = static_cast<int>(this->Poses.size());
+    if (validationEnabled && numberOfPoses % bucketSize == 0
+      && this->GetBucketError(numberOfPoses - bucketSize, bucketSize) > algo->GetMaximumPoseBucketError())
+    {
+      // The tool was not moved as required while the bucket was filled
+      this->Poses.erase(this->Poses.end() - bucketSize, this->Poses.end());
+      this->NumberOfDiscardedNewestPoses = bucketSize;
+      algorithmUpdateRequired = true;
+    }
+
+    numberOfPoses = static_cast<int>(this->Poses.size());
+    int numberOfBuckets = (numberOfPoses + bucketSize - 1) / bucketSize;
+    int numberOfDiscardedBuckets = numberOfBuckets - std::max(1, maximumNumberOfBuckets);
+    if (numberOfDiscardedBuckets > 0)
+    {
+      this->NumberOfDiscardedOldestPoses = std::min(numberOfDiscardedBuckets * bucketSize, numberOfPoses);
+      this->Poses.erase(this->Poses.begin(), this->Poses.begin() + this->NumberOfDiscardedOldestPoses);
+      algorithmUpdateRequired = true;
+    }
+
+    if (algorithmUpdateRequired)
+    {
+      this->CopyPosesToAlgorithm(algo);
+    }
+    return true;
+  }
+
+  void Clear()
+  {
+    this->Poses.clear();
+    this->NumberOfDiscardedOldestPoses = 0;
+    this->NumberOfDiscardedNewestPoses = 0;
+  }
+
+  // Returns true if the last AddPose call discarded poses
+  bool ArePosesDiscarded() const
+  {
+    return this->NumberOfDiscardedOldestPoses > 0 || this->NumberOfDiscardedNewestPoses > 0;
+  }
+
+  std::deque<PoseType> Poses;
+  // Number of poses discarded from the beginning of the buffer by the last AddPose call
+  int NumberOfDiscardedOldestPoses{ 0 };
+  // Number of poses discarded from the end of the buffer by the last AddPose call, including the added pose
+  int NumberOfDiscardedNewestPoses{ 0 };
+
+private:
+  // Root-mean-square error of the calibration computed from the specified poses (negative if it cannot be computed)
+  double GetBucketError(int firstPoseIndex, int numberOfPoses) const
+  {
+    if (this->Type == PIVOT_CALIBRATION)
+    {
+      vtkPivotCalibrationLeastSquares leastSquares;
+      for (int i = firstPoseIndex; i < firstPoseIndex + numberOfPoses; i++)
+      {
+        leastSquares.Accumulate(this->Poses[i]);
+      }
+      double toolTipPosition_Tool[3] = { 0.0, 0.0, 0.0 };
+      double pivotPosition_Reference[3] = { 0.0, 0.0, 0.0 };
+      double rmseMm = -1.0;
+      if (numberOfPoses < 2 || !leastSquares.Solve(toolTipPosition_Tool, pivotPosition_Reference, rmseMm))
+      {
+        return -1.0;
+      }
+      return rmseMm;
+    }
+
+    double sumRotation[3][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+    for (int poseIndex = firstPoseIndex; poseIndex < firstPoseIndex + numberOfPoses; poseIndex++)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        for (int j = 0; j < 3; j++)
+        {
+          sumRotation[i][j] += this->Poses[poseIndex][i * 4 + j];
+        }
+      }
+    }
+    double shaftDirection_Tool[3] = { 0.0, 0.0, 0.0 };
+    double shaftDirection_Reference[3] = { 0.0, 0.0, 0.0 };
+    if (numberOfPoses < 2 || !SolveShaftDirection(sumRotation, shaftDirection_Tool, shaftDirection_Reference))
+    {
+      return -1.0;
+    }
+    double sumSquaredResiduals = 0.0;
+    for (int poseIndex = firstPoseIndex; poseIndex < firstPoseIndex + numberOfPoses; poseIndex++)
+    {
+      double residual = GetSpinResidual(this->Poses[poseIndex], shaftDirection_Tool, shaftDirection_Reference);
+      sumSquaredResiduals += residual * residual;
+    }
+    return sqrt(sumSquaredResiduals / numberOfPoses);
+  }
+
+  // Replace the poses of the algorithm by the poses of the buffer. Input filtering is disabled meanwhile,
+  // as all the poses have already been accepted by the algorithm.
+  void CopyPosesToAlgorithm(vtkIGSIOAbstractStylusCalibrationAlgo* algo) const
+  {
+    double positionDifferenceThresholdMm = algo->GetPositionDifferenceThresholdMm();
+    double orientationDifferenceThresholdDegrees = algo->GetOrientationDifferenceThresholdDegrees();
+    algo->SetPositionDifferenceThresholdMm(0.0);
+    algo->SetOrientationDifferenceThresholdDegrees(0.0);
+    algo->SetMaximumNumberOfPoseBuckets(static_cast<int>(this->Poses.size()) / std::max(1, algo->GetPoseBucketSize()) + 2);
+    algo->RemoveAllCalibrationPoints();
+    vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+    for (const PoseType& pose : this->Poses)
+    {
+      GetMatrixFromPose(pose, toolToReferenceMatrix);
+      algo->InsertNextCalibrationPoint(toolToReferenceMatrix);
+    }
+    algo->SetPositionDifferenceThresholdMm(positionDifferenceThresholdMm);
+    algo->SetOrientationDifferenceThresholdDegrees(orientationDifferenceThresholdDegrees);
+  }
+
+  CalibrationType Type;
+};
+
+//----------------------------------------------------------------------------
+// State of the recording decimation and rate limit of a transform
+struct vtkRecordingRateLimitState
+{
+  int NumberOfSkippedPoses{ 0 };
+  double LastRecordedPoseTimestampSec{ 0.0 };
+  bool LastRecordedPoseTimestampValid{ false };
+
+  void Reset()
+  {
+    this->NumberOfSkippedPoses = 0;
+    this->LastRecordedPoseTimestampValid = false;
+  }
+
+  void SetPoseRecorded(double timestampSec)
+  {
+    this->NumberOfSkippedPoses = 0;
+    this->LastRecordedPoseTimestampSec = timestampSec;
+    this->LastRecordedPoseTimestampValid = true;
+  }
+};
+
+//----------------------------------------------------------------------------
+class vtkSlicerPivotCalibrationLogic::vtkInternal
+{
+public:
+  vtkInternal(vtkSlicerPivotCalibrationLogic* external)
+  {
+    this->External = external;
+    this->RecordedPoses.SetCapacity(DEFAULT_RECORDING_BUFFER_CAPACITY);
+  }
+  ~vtkInternal() = default;
+
+  // Add a pose to the pivot calibration. Returns true if the pose buffer has changed.
+  bool AddPivotPose(vtkMatrix4x4* toolToReferenceMatrix)
+  {
+    if (!this->PivotPoses.AddPose(this->PivotCalibrationAlgo, toolToReferenceMatrix,
+      this->External->PivotMaximumNumberOfPoseBuckets, this->External->PivotAutoCalibrationEnabled))
+    {
+      return false;
+    }
+    this->PivotIncremental.Update(this->PivotPoses.Poses, this->PivotPoses.ArePosesDiscarded());
+    this->UpdatePivotQualityMetrics();
+    return true;
+  }
+
+  void ClearPivotPoses()
+  {
+    this->PivotPoses.Clear();
+    this->PivotIncremental.Reset();
+    this->PivotLivePoseResiduals.clear();
+    this->ResetPivotQualityMetrics();
+  }
+
+  void ResetPivotQualityMetrics()
+  {
+    this->External->PivotLatestPoseResidualMm = -1.0;
+    this->External->PivotConditionNumber = -1.0;
+    this->External->PivotOrientationSpreadDegrees = -1.0;
+    this->External->PivotToolTipUncertaintyMm = -1.0;
+  }
+
+  // Update quality metrics from the accumulators after a pose is added to the pose buffer
+  // (the new pose is the last one, unless it was discarded)
+  void UpdatePivotQualityMetrics();
+
+  // Returns true if the tool tip uncertainty of a pivot calibration is below the target uncertainty
+  // and there are enough poses with enough rotation for reliably estimating it
+  bool IsPivotCalibrationConverged(double toolTipUncertaintyMm, double orientationSpreadDegrees, int numberOfPoses);
+
+  // Returns true if a pose received at the specified time should be recorded (according to decimation and rate limit).
+  // Poses that are dropped by decimation are counted, therefore it must be called only once for each received pose.
+  bool IsRecordedPoseDue(vtkRecordingRateLimitState& rateLimit, double timestampSec);
+
+  // Robust estimation of the pivot point. Returns false if no solution is found.
+  bool ComputeRobustPivot(double toolTipPosition_Tool[3], double pivotPosition_Reference[3], std::vector<bool>& inliers);
+  // Robust estimation of the shaft direction. Returns false if no solution is found.
+  bool ComputeRobustSpin(double shaftDirection_Tool[3], double shaftDirection_Reference[3], std::vector<bool>& inliers);
+
+  // Calibrate a tool from a complete set of poses, using the current calibration settings.
+  // The state of the logic is not changed, therefore it can be called from multiple threads.
+  void ComputeCalibrationFromPoses(const std::vector<PoseType>& pivotPoses, const std::vector<PoseType>& spinPoses,
+    bool autoOrient, ToolCalibrationResult& result);
+
+  // Calibration state of a tool in multi-tool calibration
+  struct ToolState
+  {
+    // Observed node, the reference is held by the observer manager
+    vtkMRMLTransformNode* TransformNode{ nullptr };
+    vtkNew<vtkIGSIOPivotCalibrationAlgo> PivotCalibrationAlgo;
+    vtkNew<vtkIGSIOSpinCalibrationAlgo> SpinCalibrationAlgo;
+    // Poses received since the last processing
+    std::vector<PoseType> QueuedPoses;
+    vtkRecordingRateLimitState RecordingRateLimit;
+    vtkCalibrationPoseBuffer PivotPoses{ vtkCalibrationPoseBuffer::PIVOT_CALIBRATION };
+    vtkCalibrationPoseBuffer SpinPoses{ vtkCalibrationPoseBuffer::SPIN_CALIBRATION };
+    vtkIncrementalPivotCalibrationState PivotIncremental;
+    ToolCalibrationResult Result;
+    bool PivotCalibrationComplete{ false };
+    bool SpinCalibrationComplete{ false };
+    // Completion events are invoked on the main thread, after the worker threads are finished
+    bool PivotCalibrationCompleteEventPending{ false };
+    bool SpinCalibrationCompleteEventPending{ false };
+  };
+
+  ToolState* GetToolState(vtkMRMLTransformNode* transformNode);
+  bool AllToolsHaveQueuedPoses();
+  void ClearToolState(ToolState* tool);
+  // Copy the current calibration settings of the logic to the calibration algorithms of the tool
+  void UpdateToolAlgorithmSettings(ToolState* tool);
+  // Add queued poses to the calibration algorithms and perform auto-calibration.
+  // Only accesses the state of the specified tool, therefore tools can be processed in parallel.
+  void ProcessToolPoses(ToolState* tool);
+  bool ComputeToolPivotCalibration(ToolState* tool, bool autoOrient);
+  bool ComputeToolPivotCalibrationIncremental(ToolState* tool);
+  bool ComputeToolSpinCalibration(ToolState* tool, bool autoOrient);
+  void UpdateToolErrorText(ToolState* tool);
+
+  vtkSlicerPivotCalibrationLogic* External;
+  vtkNew<vtkIGSIOPivotCalibrationAlgo> PivotCalibrationAlgo;
+  vtkNew<vtkIGSIOSpinCalibrationAlgo> SpinCalibrationAlgo;
+
+  // Poses stored in the calibration algorithms
+  vtkCalibrationPoseBuffer PivotPoses{ vtkCalibrationPoseBuffer::PIVOT_CALIBRATION };
+  vtkCalibrationPoseBuffer SpinPoses{ vtkCalibrationPoseBuffer::SPIN_CALIBRATION };
+
+  vtkIncrementalPivotCalibrationState PivotIncremental;
+
+  // Residual of each pose in the pivot pose buffer, computed when the pose was added
+  std::deque<double> PivotLivePoseResiduals;
+
+  // Results of the last robust calibration
+  std::vector<double> PivotPoseResiduals;
+  std::vector<double> SpinPoseResiduals;
+
+  // Multi-tool calibration
+  std::vector< std::unique_ptr<ToolState> > ToolStates;
+
+  // Recorded poses and state of the recording rate limit
+  PoseRingBuffer RecordedPoses;
+  vtkRecordingRateLimitState RecordingRateLimit;
+};
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerPivotCalibrationLogic);
+
+const int DEFAULT_POSE_BUCKET_SIZE = 10;
+
+const double DEFAULT_PIVOT_POSE_BUCKET_ERROR_MM = 3.0;
+const double DEFAULT_PIVOT_INPUT_ORIENTATION_THRESHOLD_DEGREES = 5.0;
+const double DEFAULT_PIVOT_INPUT_POSITION_THRESHOLD_MM = 3.0;
+
+const double DEFAULT_SPIN_POSE_BUCKET_ERROR_MM = 0.05;
+const double DEFAULT_SPIN_INPUT_ORIENTATION_THRESHOLD_DEGREES = 5.0;
+const double DEFAULT_SPIN_INPUT_POSITION_THRESHOLD_MM = 0.0; // No default position threshold for spin. Origin may be on stylus shaft.
+
+const char* TOOL_VALID_ATTRIBUTE_NAME = "OpenIGTLink.TransformValid";
+
+// Robust calibration
+const int ROBUST_PIVOT_MINIMAL_SUBSET_SIZE = 3;
+const int ROBUST_SPIN_MINIMAL_SUBSET_SIZE = 2;
+const int ROBUST_NUMBER_OF_REFINEMENT_ITERATIONS = 10;
+// Hypotheses are scored in parallel in batches of this size, the required number of hypotheses is updated after each batch
+const int ROBUST_HYPOTHESIS_BATCH_SIZE = 64;
+// Pairs of poses with less rotation between them do not define the shaft direction accurately enough
+const double ROBUST_SPIN_MINIMUM_SINE_OF_ROTATION_ANGLE = 0.05;
+
+//----------------------------------------------------------------------------
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Tukey biweight: inliers are weighted by their residual, outliers are ignored
+  double GetRobustWeight(double residual, double inlierThreshold)
+  {
+    if (residual >= inlierThreshold)
+    {
+      return 0.0;
+    }
+    double u = residual / inlierThreshold;
+    return (1.0 - u * u) * (1.0 - u * u);
+  }
+
+  //----------------------------------------------------------------------------
+  // Generate random subsets of pose indices. Generated sequentially so that results are reproducible.
+  // Each subset contains distinct poses (sampled without replacement by a partial Fisher-Yates shuffle),
+  // therefore subsetSize must not be larger than numberOfPoses.
+  void GetRandomSubsets(int numberOfPoses, int numberOfSubsets, int subsetSize, int randomSeed, std::vector<int>& subsets)
+  {
+    vtkNew<vtkMinimalStandardRandomSequence> randomSequence;
+    randomSequence->SetSeed(randomSeed);
+    subsets.resize(numberOfSubsets * subsetSize);
+    std::vector<int> poseIndices(numberOfPoses);
+    for (int i = 0; i < numberOfPoses; i++)
+    {
+      poseIndices[i] = i;
+    }
+    for (int subsetIndex = 0; subsetIndex < numberOfSubsets; subsetIndex++)
+    {
+      // The first i elements of poseIndices are already selected, choose the next one from the rest
+      for (int i = 0; i < subsetSize; i++)
+      {
+        int selectedIndex = i + std::min(static_cast<int>(randomSequence->GetNextValue() * (numberOfPoses - i)), numberOfPoses - i - 1);
+        std::swap(poseIndices[i], poseIndices[selectedIndex]);
+        subsets[subsetIndex * subsetSize + i] = poseIndices[i];
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Number of random subsets that must be evaluated for finding a subset that contains only inliers
+  // with the specified confidence (probability), if inlierRatio of the poses are inliers.
+  int GetRequiredNumberOfHypotheses(double inlierRatio, int subsetSize, double confidence, int maximumNumberOfHypotheses)
+  {
+    double allInliersProbability = pow(inlierRatio, subsetSize);
+    if (allInliersProbability <= 0.0 || confidence >= 1.0)
+    {
+      return maximumNumberOfHypotheses;
+    }
+    if (allInliersProbability >= 1.0 || confidence <= 0.0)
+    {
+      return 1;
+    }
+    double requiredNumberOfHypotheses = ceil(log(1.0 - confidence) / log(1.0 - allInliersProbability));
+    return static_cast<int>(std::max(1.0, std::min(requiredNumberOfHypotheses, static_cast<double>(maximumNumberOfHypotheses))));
+  }
+
+  //----------------------------------------------------------------------------
+  // Score hypotheses in parallel until the number of evaluated hypotheses is enough for finding a hypothesis
+  // computed from inliers only, with the specified confidence (estimating the inlier ratio from the best hypothesis so far).
+  // scoreHypothesis(hypothesis, numberOfInliers) returns the score of the hypothesis (lower is better, VTK_DOUBLE_MAX if invalid).
+  // Returns the index of the best hypothesis (-1 if no valid hypothesis is found).
+  template<typename ScoreFunctionType>
+  int FindBestHypothesis(int numberOfPoses, int subsetSize, double confidence, int maximumNumberOfHypotheses,
+    ScoreFunctionType scoreHypothesis, int& numberOfEvaluatedHypotheses)
+  {
+    std::vector<double> scores(maximumNumberOfHypotheses, VTK_DOUBLE_MAX);
+    std::vector<int> numberOfInliers(maximumNumberOfHypotheses, 0);
+    int bestHypothesis = -1;
+    int requiredNumberOfHypotheses = maximumNumberOfHypotheses;
+    numberOfEvaluatedHypotheses = 0;
+    while (numberOfEvaluatedHypotheses < requiredNumberOfHypotheses)
+    {
+      int beginBatch = numberOfEvaluatedHypotheses;
+      int endBatch = std::min(beginBatch + ROBUST_HYPOTHESIS_BATCH_SIZE, requiredNumberOfHypotheses);
+      vtkSMPTools::For(beginBatch, endBatch, [&](vtkIdType beginHypothesis, vtkIdType endHypothesis)
+      {
+        for (vtkIdType hypothesis = beginHypothesis; hypothesis < endHypothesis; hypothesis++)
+        {
+          scores[hypothesis] = scoreHypothesis(hypothesis, numberOfInliers[hypothesis]);
+        }
+      });
+      numberOfEvaluatedHypotheses = endBatch;
+      for (int hypothesis = beginBatch; hypothesis < endBatch; hypothesis++)
+      {
+        if (scores[hypothesis] < VTK_DOUBLE_MAX && (bestHypothesis < 0 || scores[hypothesis] < scores[bestHypothesis]))
+        {
+          bestHypothesis = hypothesis;
+        }
+      }
+      if (bestHypothesis >= 0)
+      {
+        double inlierRatio = static_cast<double>(numberOfInliers[bestHypothesis]) / numberOfPoses;
+        requiredNumberOfHypotheses = GetRequiredNumberOfHypotheses(inlierRatio, subsetSize, confidence, maximumNumberOfHypotheses);
+      }
+    }
+    return bestHypothesis;
+  }
+
+  //----------------------------------------------------------------------------
+  // Configure an algorithm with the same pose bucket and input filtering settings as the source algorithm.
+  // If numberOfPoses >= 0 then all poses are available at once: enough pose buckets are allocated to store all of them,
+  // otherwise the maximum number of pose buckets is copied from the source algorithm.
+  // The algorithm never discards poses by validating its input buffer (pose buckets are validated by vtkCalibrationPoseBuffer),
+  // maximumCalibrationError is the maximum calibration error of the result (disabled if negative).
+  // If inputFilteringEnabled is false then the position and orientation difference thresholds are disabled,
+  // so that all poses are accepted.
+  void CopyAlgorithmSettings(vtkIGSIOAbstractStylusCalibrationAlgo* algo, vtkIGSIOAbstractStylusCalibrationAlgo* sourceAlgo,
+    int numberOfPoses, double maximumCalibrationError, bool inputFilteringEnabled)
+  {
+    algo->SetPoseBucketSize(sourceAlgo->GetPoseBucketSize());
+    algo->SetMaximumNumberOfPoseBuckets(numberOfPoses >= 0 ?
+      numberOfPoses / std::max(1, sourceAlgo->GetPoseBucketSize()) + 1 : sourceAlgo->GetMaximumNumberOfPoseBuckets());
+    algo->SetMaximumPoseBucketError(sourceAlgo->GetMaximumPoseBucketError());
+    algo->SetValidateInputBufferEnabled(false);
+    algo->SetMaximumCalibrationErrorMm(maximumCalibrationError >= 0.0 ? maximumCalibrationError : -1.0);
+    algo->SetPositionDifferenceThresholdMm(inputFilteringEnabled ? sourceAlgo->GetPositionDifferenceThresholdMm() : 0.0);
+    algo->SetOrientationDifferenceThresholdDegrees(inputFilteringEnabled ? sourceAlgo->GetOrientationDifferenceThresholdDegrees() : 0.0);
+    algo->SetMinimumOrientationDifferenceDegrees(sourceAlgo->GetMinimumOrientationDifferenceDegrees());
+  }
+
+  //----------------------------------------------------------------------------
+  // Get tool to reference poses from a sequence of transform nodes. Returns false if a sequence item is not a transform.
+  bool GetPosesFromSequence(vtkMRMLSequenceNode* sequenceNode, std::vector<PoseType>& poses)
+  {
+    poses.clear();
+    if (!sequenceNode)
+    {
+      return true;
+    }
+    int numberOfItems = sequenceNode->GetNumberOfDataNodes();
+    poses.reserve(numberOfItems);
+    vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+    for (int itemIndex = 0; itemIndex < numberOfItems; itemIndex++)
+    {
+      vtkMRMLTransformNode* transformNode = vtkMRMLTransformNode::SafeDownCast(sequenceNode->GetNthDataNode(itemIndex));
+      if (!transformNode || !transformNode->IsLinear())
+      {
+        return false;
+      }
+      transformNode->GetMatrixTransformToParent(toolToReferenceMatrix);
+      PoseType pose;
+      GetPoseFromMatrix(toolToReferenceMatrix, pose);
+      poses.push_back(pose);
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsToolValid(vtkMRMLTransformNode* transformNode)
+  {
+    const char* toolValidValue = transformNode->GetAttribute(TOOL_VALID_ATTRIBUTE_NAME);
+    // If the attribute is not present, assume the tool is valid.
+    return !toolValidValue || strcmp(toolValidValue, "1") == 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::vtkInternal::UpdatePivotQualityMetrics()
+{
+  // Remove the residuals of the discarded poses (the added pose does not have a residual yet)
+  bool newPoseDiscarded = this->PivotPoses.NumberOfDiscardedNewestPoses > 0;
+  for (int i = 1; i < this->PivotPoses.NumberOfDiscardedNewestPoses && !this->PivotLivePoseResiduals.empty(); i++)
+  {
+    this->PivotLivePoseResiduals.pop_back();
+  }
+  for (int i = 0; i < this->PivotPoses.NumberOfDiscardedOldestPoses && !this->PivotLivePoseResiduals.empty(); i++)
+  {
+    this->PivotLivePoseResiduals.pop_front();
+  }
+
+  this->ResetPivotQualityMetrics();
+  this->External->PivotOrientationSpreadDegrees = this->PivotIncremental.Solver.GetOrientationSpreadDegrees();
+
+  double toolTipPosition_Tool[3] = { 0.0, 0.0, 0.0 };
+  double pivotPosition_Reference[3] = { 0.0, 0.0, 0.0 };
+  double rmseMm = -1.0;
+  if (this->PivotPoses.Poses.size() < 2
+    || !this->PivotIncremental.Solver.Solve(toolTipPosition_Tool, pivotPosition_Reference, rmseMm))
+  {
+    // not enough variation yet
+    if (!newPoseDiscarded)
+    {
+      this->PivotLivePoseResiduals.push_back(-1.0);
+    }
+    return;
+  }
+  if (!newPoseDiscarded)
+  {
+    double residualMm = vtkPivotCalibrationLeastSquares::GetResidual(this->PivotPoses.Poses.back(), toolTipPosition_Tool, pivotPosition_Reference);
+    this->PivotLivePoseResiduals.push_back(residualMm);
+    this->External->PivotLatestPoseResidualMm = residualMm;
+  }
+
+  double conditionNumber = -1.0;
+  double toolTipUncertaintyMm = -1.0;
+  if (this->PivotIncremental.Solver.GetQualityMetrics(rmseMm, conditionNumber, toolTipUncertaintyMm))
+  {
+    this->External->PivotConditionNumber = conditionNumber;
+    this->External->PivotToolTipUncertaintyMm = toolTipUncertaintyMm;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::vtkInternal::IsPivotCalibrationConverged(double toolTipUncertaintyMm,
+  double orientationSpreadDegrees, int numberOfPoses)
+{
+  if (this->External->PivotAutoCalibrationTargetToolTipUncertaintyMm <= 0.0 || toolTipUncertaintyMm < 0.0)
+  {
+    return false;
+  }
+  if (numberOfPoses < this->PivotCalibrationAlgo->GetPoseBucketSize()
+    || orientationSpreadDegrees < this->PivotCalibrationAlgo->GetMinimumOrientationDifferenceDegrees() / 2.0)
+  {
+    // Too few poses or too little rotation to be a reliable estimate of the uncertainty
+    return false;
+  }
+  return toolTipUncertaintyMm <= this->External->PivotAutoCalibrationTargetToolTipUncertaintyMm;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::vtkInternal::IsRecordedPoseDue(vtkRecordingRateLimitState& rateLimit, double timestampSec)
+{
+  if (this->External->RecordingMaximumRateHz > 0.0 && rateLimit.LastRecordedPoseTimestampValid
+    && timestampSec - rateLimit.LastRecordedPoseTimestampSec < 1.0 / this->External->RecordingMaximumRateHz)
+  {
+    return false;
+  }
+  // Only poses that are dropped by decimation are counted
+  if (rateLimit.NumberOfSkippedPoses + 1 < this->External->RecordingDecimationFactor)
+  {
+    rateLimit.NumberOfSkippedPoses++;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::vtkInternal::ComputeRobustPivot(double toolTipPosition_Tool[3], double pivotPosition_Reference[3],
+  std::vector<bool>& inliers)
+{
+  const int numberOfPoses = static_cast<int>(this->PivotPoses.Poses.size());
+  if (numberOfPoses < ROBUST_PIVOT_MINIMAL_SUBSET_SIZE)
+  {
+    return false;
+  }
+  const double inlierThreshold = this->External->PivotRobustInlierThresholdMm;
+  const int maximumNumberOfHypotheses = std::max(1, this->External->RobustMaximumNumberOfHypotheses);
+  std::vector<int> subsets;
+  GetRandomSubsets(numberOfPoses, maximumNumberOfHypotheses, ROBUST_PIVOT_MINIMAL_SUBSET_SIZE, this->External->RobustRandomSeed, subsets);
+
+  // Score hypotheses (truncated quadratic cost, lower is better)
+  auto scoreHypothesis = [&](vtkIdType hypothesis, int& numberOfInliers)
+  {
+    vtkPivotCalibrationLeastSquares leastSquares;
+    for (int i = 0; i < ROBUST_PIVOT_MINIMAL_SUBSET_SIZE; i++)
+    {
+      leastSquares.Accumulate(this->PivotPoses.Poses[subsets[hypothesis * ROBUST_PIVOT_MINIMAL_SUBSET_SIZE + i]]);
+    }
+    double tip[3] = { 0.0, 0.0, 0.0 };
+    double pivot[3] = { 0.0, 0.0, 0.0 };
+    double rmse = 0.0;
+    if (!leastSquares.Solve(tip, pivot, rmse))
+    {
+      return VTK_DOUBLE_MAX;
+    }
+    double score = 0.0;
+    for (const PoseType& pose : this->PivotPoses.Poses)
+    {
+      double residual = vtkPivotCalibrationLeastSquares::GetResidual(pose, tip, pivot);
+      score += std::min(residual * residual, inlierThreshold * inlierThreshold);
+      if (residual < inlierThreshold)
+      {
+        numberOfInliers++;
+      }
+    }
+    return score;
+  };
+  int bestHypothesis = FindBestHypothesis(numberOfPoses, ROBUST_PIVOT_MINIMAL_SUBSET_SIZE, this->External->RobustConfidence,
+    maximumNumberOfHypotheses, scoreHypothesis, this->External->PivotNumberOfEvaluatedHypotheses);
+  if (bestHypothesis < 0)
+  {
+    return false;
+  }
+
+  vtkPivotCalibrationLeastSquares leastSquares;
+  for (int i = 0; i < ROBUST_PIVOT_MINIMAL_SUBSET_SIZE; i++)
+  {
+    leastSquares.Accumulate(this->PivotPoses.Poses[subsets[bestHypothesis * ROBUST_PIVOT_MINIMAL_SUBSET_SIZE + i]]);
+  }
+  double rmse = 0.0;
+  leastSquares.Solve(toolTipPosition_Tool, pivotPosition_Reference, rmse);
+
+  // Refine using iteratively reweighted least squares
+  for (int iteration = 0; iteration < ROBUST_NUMBER_OF_REFINEMENT_ITERATIONS; iteration++)
+  {
+    leastSquares.Reset();
+    for (const PoseType& pose : this->PivotPoses.Poses)
+    {
+      double residual = vtkPivotCalibrationLeastSquares::GetResidual(pose, toolTipPosition_Tool, pivotPosition_Reference);
+      double weight = GetRobustWeight(residual, inlierThreshold);
+      if (weight > 0.0)
+      {
+        leastSquares.Accumulate(pose, weight);
+      }
+    }
+    double refinedTip[3] = { 0.0, 0.0, 0.0 };
+    double refinedPivot[3] = { 0.0, 0.0, 0.0 };
+    if (!leastSquares.Solve(refinedTip, refinedPivot, rmse))
+    {
+      break;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+      toolTipPosition_Tool[i] = refinedTip[i];
+      pivotPosition_Reference[i] = refinedPivot[i];
+    }
+  }
+
+  inliers.resize(numberOfPoses);
+  for (int i = 0; i < numberOfPoses; i++)
+  {
+    inliers[i] = (vtkPivotCalibrationLeastSquares::GetResidual(this->PivotPoses.Poses[i], toolTipPosition_Tool, pivotPosition_Reference) < inlierThreshold);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::vtkInternal::ComputeCalibrationFromPoses(const std::vector<PoseType>& pivotPoses,
+  const std::vector<PoseType>& spinPoses, bool autoOrient, ToolCalibrationResult& result)
+{
+  // Each call uses its own algorithm instances, so that tools can be calibrated in parallel
+  vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+  if (!pivotPoses.empty())
+  {
+    vtkNew<vtkIGSIOPivotCalibrationAlgo> pivotCalibrationAlgo;
+    CopyAlgorithmSettings(pivotCalibrationAlgo, this->PivotCalibrationAlgo, static_cast<int>(pivotPoses.size()), -1.0, true);
+    for (const PoseType& pose : pivotPoses)
+    {
+      GetMatrixFromPose(pose, toolToReferenceMatrix);
+      pivotCalibrationAlgo->InsertNextCalibrationPoint(toolToReferenceMatrix);
+    }
+    pivotCalibrationAlgo->SetPivotPointToMarkerTransformMatrix(result.ToolTipToToolMatrix);
+    bool success = pivotCalibrationAlgo->DoPivotCalibration(nullptr, autoOrient) == IGSIO_SUCCESS;
+    result.PivotErrorCode = pivotCalibrationAlgo->GetErrorCode();
+    if (success)
+    {
+      result.PivotRMSE = pivotCalibrationAlgo->GetPivotCalibrationErrorMm();
+      result.ToolTipToToolMatrix->DeepCopy(pivotCalibrationAlgo->GetPivotPointToMarkerTransformMatrix());
+    }
+    else
+    {
+      result.ErrorText = "Pivot calibration: " + vtkSlicerPivotCalibrationLogic::GetErrorCodeAsString(result.PivotErrorCode);
+    }
+  }
+  if (!spinPoses.empty())
+  {
+    vtkNew<vtkIGSIOSpinCalibrationAlgo> spinCalibrationAlgo;
+    CopyAlgorithmSettings(spinCalibrationAlgo, this->SpinCalibrationAlgo, static_cast<int>(spinPoses.size()), -1.0, true);
+    for (const PoseType& pose : spinPoses)
+    {
+      GetMatrixFromPose(pose, toolToReferenceMatrix);
+      spinCalibrationAlgo->InsertNextCalibrationPoint(toolToReferenceMatrix);
+    }
+    // Spin calibration keeps the tool tip position computed by pivot calibration
+    spinCalibrationAlgo->SetPivotPointToMarkerTransformMatrix(result.ToolTipToToolMatrix);
+    bool success = spinCalibrationAlgo->DoSpinCalibration(nullptr, false, autoOrient) == IGSIO_SUCCESS;
+    result.SpinErrorCode = spinCalibrationAlgo->GetErrorCode();
+    if (success)
+    {
+      result.SpinRMSE = spinCalibrationAlgo->GetSpinCalibrationErrorMm();
+      result.ToolTipToToolMatrix->DeepCopy(spinCalibrationAlgo->GetPivotPointToMarkerTransformMatrix());
+    }
+    else
+    {
+      if (!result.ErrorText.empty())
+      {
+        result.ErrorText += "; ";
+      }
+      result.ErrorText += "Spin calibration: " + vtkSlicerPivotCalibrationLogic::GetErrorCodeAsString(result.SpinErrorCode);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerPivotCalibrationLogic::vtkInternal::ToolState* vtkSlicerPivotCalibrationLogic::vtkInternal::GetToolState(
+  vtkMRMLTransformNode* transformNode)
+{
+  if (!transformNode)
+  {
+    return nullptr;
+  }
+  for (std::unique_ptr<ToolState>& tool : this->ToolStates)
+  {
+    if (tool->TransformNode == transformNode)
+    {
+      return tool.get();
+    }
+  }
+  return nullptr;
+}
 
 //----------------------------------------------------------------------------
-class vtkSlicerPivotCalibrationLogic::vtkInternal
+bool vtkSlicerPivotCalibrationLogic::vtkInternal::AllToolsHaveQueuedPoses()
 {
-public:
-  vtkInternal(vtkSlicerPivotCalibrationLogic* external)
+  for (std::unique_ptr<ToolState>& tool : this->ToolStates)
   {
-    this->External = external;
+    if (tool->QueuedPoses.empty())
+    {
+      return false;
+    }
   }
-  ~vtkInternal() = default;
+  return true;
+}
 
-  vtkSlicerPivotCalibrationLogic* External;
-  vtkNew<vtkIGSIOPivotCalibrationAlgo> PivotCalibrationAlgo;
-  vtkNew<vtkIGSIOSpinCalibrationAlgo> SpinCalibrationAlgo;
-};
+//----------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::vtkInternal::ClearToolState(ToolState* tool)
+{
+  tool->PivotCalibrationAlgo->RemoveAllCalibrationPoints();
+  tool->SpinCalibrationAlgo->RemoveAllCalibrationPoints();
+  tool->QueuedPoses.clear();
+  tool->RecordingRateLimit.Reset();
+  tool->PivotPoses.Clear();
+  tool->SpinPoses.Clear();
+  tool->PivotIncremental.Reset();
+  if (!tool->Result.ToolTipToToolMatrix)
+  {
+    tool->Result.ToolTipToToolMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  }
+  tool->Result.ToolTipToToolMatrix->Identity();
+  tool->Result.PivotRMSE = -1.0;
+  tool->Result.SpinRMSE = -1.0;
+  tool->Result.PivotErrorCode = CALIBRATION_NOT_STARTED;
+  tool->Result.SpinErrorCode = CALIBRATION_NOT_STARTED;
+  tool->Result.ErrorText.clear();
+  tool->PivotCalibrationComplete = false;
+  tool->SpinCalibrationComplete = false;
+  tool->PivotCalibrationCompleteEventPending = false;
+  tool->SpinCalibrationCompleteEventPending = false;
+}
 
 //----------------------------------------------------------------------------
-vtkStandardNewMacro(vtkSlicerPivotCalibrationLogic);
+void vtkSlicerPivotCalibrationLogic::vtkInternal::UpdateToolAlgorithmSettings(ToolState* tool)
+{
+  CopyAlgorithmSettings(tool->PivotCalibrationAlgo, this->PivotCalibrationAlgo, -1,
+    this->External->PivotAutoCalibrationEnabled ? this->External->PivotAutoCalibrationTargetError : -1.0, true);
+  CopyAlgorithmSettings(tool->SpinCalibrationAlgo, this->SpinCalibrationAlgo, -1,
+    this->External->SpinAutoCalibrationEnabled ? this->External->SpinAutoCalibrationTargetError : -1.0, true);
+}
 
-const int DEFAULT_NUMBER_OF_POSE_BUCKETS = 10;
-const int DEFAULT_POSE_BUCKET_SIZE = 10;
+//----------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::vtkInternal::ProcessToolPoses(ToolState* tool)
+{
+  vtkSlicerPivotCalibrationLogic* external = this->External;
+  bool pivotEnabled = external->PivotCalibrationEnabled
+    && !(tool->PivotCalibrationComplete && external->PivotAutoCalibrationStopWhenComplete);
+  bool spinEnabled = external->SpinCalibrationEnabled
+    && !(tool->SpinCalibrationComplete && external->SpinAutoCalibrationStopWhenComplete);
+
+  vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+  for (const PoseType& pose : tool->QueuedPoses)
+  {
+    GetMatrixFromPose(pose, toolToReferenceMatrix);
+    if (pivotEnabled && tool->PivotPoses.AddPose(tool->PivotCalibrationAlgo, toolToReferenceMatrix,
+      external->PivotMaximumNumberOfPoseBuckets, external->PivotAutoCalibrationEnabled))
+    {
+      tool->PivotIncremental.Update(tool->PivotPoses.Poses, tool->PivotPoses.ArePosesDiscarded());
+    }
+    if (spinEnabled)
+    {
+      tool->SpinPoses.AddPose(tool->SpinCalibrationAlgo, toolToReferenceMatrix,
+        external->SpinMaximumNumberOfPoseBuckets, external->SpinAutoCalibrationEnabled);
+    }
+  }
+  tool->QueuedPoses.clear();
 
-const double DEFAULT_PIVOT_POSE_BUCKET_ERROR_MM = 3.0;
-const double DEFAULT_PIVOT_INPUT_ORIENTATION_THRESHOLD_DEGREES = 5.0;
-const double DEFAULT_PIVOT_INPUT_POSITION_THRESHOLD_MM = 3.0;
+  if (pivotEnabled && external->PivotAutoCalibrationEnabled)
+  {
+    int numberOfPoses = static_cast<int>(tool->PivotPoses.Poses.size());
+    bool calibrationDue = numberOfPoses >= external->PivotAutoCalibrationTargetNumberOfPoints;
+    if (!calibrationDue && external->PivotAutoCalibrationTargetToolTipUncertaintyMm > 0.0)
+    {
+      calibrationDue = this->IsPivotCalibrationConverged(tool->PivotIncremental.GetToolTipUncertaintyMm(numberOfPoses),
+        tool->PivotIncremental.Solver.GetOrientationSpreadDegrees(), numberOfPoses);
+    }
+    bool calibrationSuccessful = calibrationDue && (external->PivotIncrementalCalibrationEnabled ?
+      this->ComputeToolPivotCalibrationIncremental(tool) : this->ComputeToolPivotCalibration(tool, true));
+    if (calibrationSuccessful && tool->Result.PivotRMSE <= external->PivotAutoCalibrationTargetError)
+    {
+      tool->PivotCalibrationComplete = true;
+      tool->PivotCalibrationCompleteEventPending = true;
+    }
+  }
+  if (spinEnabled && external->SpinAutoCalibrationEnabled
+    && static_cast<int>(tool->SpinPoses.Poses.size()) >= external->SpinAutoCalibrationTargetNumberOfPoints)
+  {
+    if (this->ComputeToolSpinCalibration(tool, true) && tool->Result.SpinRMSE <= external->SpinAutoCalibrationTargetError)
+    {
+      tool->SpinCalibrationComplete = true;
+      tool->SpinCalibrationCompleteEventPending = true;
+    }
+  }
+}
 
-const double DEFAULT_SPIN_POSE_BUCKET_ERROR_MM = 0.05;
-const double DEFAULT_SPIN_INPUT_ORIENTATION_THRESHOLD_DEGREES = 5.0;
-const double DEFAULT_SPIN_INPUT_POSITION_THRESHOLD_MM = 0.0; // No default position threshold for spin. Origin may be on stylus shaft.
+//----------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::vtkInternal::ComputeToolPivotCalibration(ToolState* tool, bool autoOrient)
+{
+  vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+  toolTipToToolMatrix->DeepCopy(tool->Result.ToolTipToToolMatrix);
+  tool->PivotCalibrationAlgo->SetPivotPointToMarkerTransformMatrix(toolTipToToolMatrix);
+  bool success = tool->PivotCalibrationAlgo->DoPivotCalibration(nullptr, autoOrient) == IGSIO_SUCCESS;
+  tool->Result.PivotErrorCode = tool->PivotCalibrationAlgo->GetErrorCode();
+  if (success)
+  {
+    tool->Result.PivotRMSE = tool->PivotCalibrationAlgo->GetPivotCalibrationErrorMm();
+    tool->Result.ToolTipToToolMatrix->DeepCopy(tool->PivotCalibrationAlgo->GetPivotPointToMarkerTransformMatrix());
+  }
+  else
+  {
+    tool->Result.PivotRMSE = -1.0;
+  }
+  this->UpdateToolErrorText(tool);
+  return success;
+}
 
-const char* TOOL_VALID_ATTRIBUTE_NAME = "OpenIGTLink.TransformValid";
+//----------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::vtkInternal::ComputeToolPivotCalibrationIncremental(ToolState* tool)
+{
+  double toolTipPosition_Tool[3] = { 0.0, 0.0, 0.0 };
+  double pivotPosition_Reference[3] = { 0.0, 0.0, 0.0 };
+  double rmseMm = -1.0;
+  if (tool->PivotPoses.Poses.size() < 2
+    || !tool->PivotIncremental.Solver.Solve(toolTipPosition_Tool, pivotPosition_Reference, rmseMm))
+  {
+    tool->Result.PivotRMSE = -1.0;
+    tool->Result.PivotErrorCode = vtkIGSIOAbstractStylusCalibrationAlgo::CALIBRATION_NOT_ENOUGH_VARIATION;
+    this->UpdateToolErrorText(tool);
+    return false;
+  }
+
+  if (tool->PivotIncremental.FullSolveRequired
+    && (!this->External->PivotAutoCalibrationEnabled || rmseMm <= this->External->PivotAutoCalibrationTargetError))
+  {
+    // Compute the full calibration (including the tool tip orientation) once, the same way as for the observed transform
+    if (!this->ComputeToolPivotCalibration(tool, true))
+    {
+      return false;
+    }
+    tool->PivotIncremental.SetFullCalibrationResult(tool->Result.ToolTipToToolMatrix);
+    return true;
+  }
+
+  tool->Result.PivotRMSE = rmseMm;
+  tool->Result.PivotErrorCode = vtkIGSIOAbstractStylusCalibrationAlgo::CALIBRATION_NO_ERROR;
+  this->UpdateToolErrorText(tool);
+  tool->PivotIncremental.UpdateCalibrationResult(tool->Result.ToolTipToToolMatrix, toolTipPosition_Tool);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::vtkInternal::ComputeToolSpinCalibration(ToolState* tool, bool autoOrient)
+{
+  vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+  toolTipToToolMatrix->DeepCopy(tool->Result.ToolTipToToolMatrix);
+  tool->SpinCalibrationAlgo->SetPivotPointToMarkerTransformMatrix(toolTipToToolMatrix);
+  bool success = tool->SpinCalibrationAlgo->DoSpinCalibration(nullptr, false, autoOrient) == IGSIO_SUCCESS;
+  tool->Result.SpinErrorCode = tool->SpinCalibrationAlgo->GetErrorCode();
+  if (success)
+  {
+    tool->Result.SpinRMSE = tool->SpinCalibrationAlgo->GetSpinCalibrationErrorMm();
+    tool->Result.ToolTipToToolMatrix->DeepCopy(tool->SpinCalibrationAlgo->GetPivotPointToMarkerTransformMatrix());
+  }
+  else
+  {
+    tool->Result.SpinRMSE = -1.0;
+  }
+  this->UpdateToolErrorText(tool);
+  return success;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::vtkInternal::UpdateToolErrorText(ToolState* tool)
+{
+  std::string pivotErrorText = vtkSlicerPivotCalibrationLogic::GetErrorCodeAsString(tool->Result.PivotErrorCode);
+  std::string spinErrorText = vtkSlicerPivotCalibrationLogic::GetErrorCodeAsString(tool->Result.SpinErrorCode);
+  tool->Result.ErrorText.clear();
+  if (!pivotErrorText.empty())
+  {
+    tool->Result.ErrorText = "Pivot calibration: " + pivotErrorText;
+  }
+  if (!spinErrorText.empty())
+  {
+    if (!tool->Result.ErrorText.empty())
+    {
+      tool->Result.ErrorText += "; ";
+    }
+    tool->Result.ErrorText += "Spin calibration: " + spinErrorText;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::vtkInternal::ComputeRobustSpin(double shaftDirection_Tool[3], double shaftDirection_Reference[3],
+  std::vector<bool>& inliers)
+{
+  // During spin calibration the tool rotates around its shaft, therefore the shaft direction is the same in all poses:
+  //   R * shaftDirection_Tool = shaftDirection_Reference
+  const int numberOfPoses = static_cast<int>(this->SpinPoses.Poses.size());
+  if (numberOfPoses < ROBUST_SPIN_MINIMAL_SUBSET_SIZE)
+  {
+    return false;
+  }
+  const double inlierThreshold = this->External->SpinRobustInlierThreshold;
+  const int maximumNumberOfHypotheses = std::max(1, this->External->RobustMaximumNumberOfHypotheses);
+  std::vector<int> subsets;
+  GetRandomSubsets(numberOfPoses, maximumNumberOfHypotheses, ROBUST_SPIN_MINIMAL_SUBSET_SIZE, this->External->RobustRandomSeed, subsets);
+
+  // Each hypothesis is the rotation axis of the relative rotation between two poses
+  std::vector<double> hypotheses(maximumNumberOfHypotheses * 6, 0.0);
+  auto scoreHypothesis = [&](vtkIdType hypothesis, int& numberOfInliers)
+  {
+    const PoseType& poseA = this->SpinPoses.Poses[subsets[hypothesis * ROBUST_SPIN_MINIMAL_SUBSET_SIZE]];
+    const PoseType& poseB = this->SpinPoses.Poses[subsets[hypothesis * ROBUST_SPIN_MINIMAL_SUBSET_SIZE + 1]];
+    // relative rotation = RA^T * RB
+    double relativeRotation[3][3];
+    for (int i = 0; i < 3; i++)
+    {
+      for (int j = 0; j < 3; j++)
+      {
+        relativeRotation[i][j] = poseA[0 * 4 + i] * poseB[0 * 4 + j] + poseA[1 * 4 + i] * poseB[1 * 4 + j] + poseA[2 * 4 + i] * poseB[2 * 4 + j];
+      }
+    }
+    double* axis_Tool = &hypotheses[hypothesis * 6];
+    double* axis_Reference = &hypotheses[hypothesis * 6 + 3];
+    axis_Tool[0] = relativeRotation[2][1] - relativeRotation[1][2];
+    axis_Tool[1] = relativeRotation[0][2] - relativeRotation[2][0];
+    axis_Tool[2] = relativeRotation[1][0] - relativeRotation[0][1];
+    // norm of the axis is 2 * sin(rotation angle)
+    if (vtkMath::Normalize(axis_Tool) < 2.0 * ROBUST_SPIN_MINIMUM_SINE_OF_ROTATION_ANGLE)
+    {
+      return VTK_DOUBLE_MAX;
+    }
+    for (int row = 0; row < 3; row++)
+    {
+      axis_Reference[row] = poseA[row * 4 + 0] * axis_Tool[0] + poseA[row * 4 + 1] * axis_Tool[1] + poseA[row * 4 + 2] * axis_Tool[2];
+    }
+    double score = 0.0;
+    for (const PoseType& pose : this->SpinPoses.Poses)
+    {
+      double residual = GetSpinResidual(pose, axis_Tool, axis_Reference);
+      score += std::min(residual * residual, inlierThreshold * inlierThreshold);
+      if (residual < inlierThreshold)
+      {
+        numberOfInliers++;
+      }
+    }
+    return score;
+  };
+  int bestHypothesis = FindBestHypothesis(numberOfPoses, ROBUST_SPIN_MINIMAL_SUBSET_SIZE, this->External->RobustConfidence,
+    maximumNumberOfHypotheses, scoreHypothesis, this->External->SpinNumberOfEvaluatedHypotheses);
+  if (bestHypothesis < 0)
+  {
+    return false;
+  }
+  for (int i = 0; i < 3; i++)
+  {
+    shaftDirection_Tool[i] = hypotheses[bestHypothesis * 6 + i];
+    shaftDirection_Reference[i] = hypotheses[bestHypothesis * 6 + 3 + i];
+  }
+
+  // Refine using iteratively reweighted least squares
+  for (int iteration = 0; iteration < ROBUST_NUMBER_OF_REFINEMENT_ITERATIONS; iteration++)
+  {
+    double sumRotation[3][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+    for (const PoseType& pose : this->SpinPoses.Poses)
+    {
+      double weight = GetRobustWeight(GetSpinResidual(pose, shaftDirection_Tool, shaftDirection_Reference), inlierThreshold);
+      for (int i = 0; i < 3; i++)
+      {
+        for (int j = 0; j < 3; j++)
+        {
+          sumRotation[i][j] += weight * pose[i * 4 + j];
+        }
+      }
+    }
+    double refinedDirection_Tool[3] = { 0.0, 0.0, 0.0 };
+    double refinedDirection_Reference[3] = { 0.0, 0.0, 0.0 };
+    if (!SolveShaftDirection(sumRotation, refinedDirection_Tool, refinedDirection_Reference))
+    {
+      break;
+    }
+    if (vtkMath::Dot(refinedDirection_Tool, shaftDirection_Tool) < 0.0)
+    {
+      vtkMath::MultiplyScalar(refinedDirection_Tool, -1.0);
+      vtkMath::MultiplyScalar(refinedDirection_Reference, -1.0);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+      shaftDirection_Tool[i] = refinedDirection_Tool[i];
+      shaftDirection_Reference[i] = refinedDirection_Reference[i];
+    }
+  }
+
+  inliers.resize(numberOfPoses);
+  for (int i = 0; i < numberOfPoses; i++)
+  {
+    inliers[i] = (GetSpinResidual(this->SpinPoses.Poses[i], shaftDirection_Tool, shaftDirection_Reference) < inlierThreshold);
+  }
+  return true;
+}
 
 //----------------------------------------------------------------------------
 vtkSlicerPivotCalibrationLogic::vtkSlicerPivotCalibrationLogic()
@@ -69,58 +1537,269 @@ vtkSlicerPivotCalibrationLogic::vtkSlicerPivotCalibrationLogic()
   this->Internal = new vtkInternal(this);
   this->ToolTipToToolMatrix = vtkMatrix4x4::New();
 
-  this->Internal->PivotCalibrationAlgo->SetMaximumNumberOfPoseBuckets(DEFAULT_NUMBER_OF_POSE_BUCKETS);
   this->Internal->PivotCalibrationAlgo->SetPoseBucketSize(DEFAULT_POSE_BUCKET_SIZE);
   this->Internal->PivotCalibrationAlgo->SetMaximumPoseBucketError(DEFAULT_PIVOT_POSE_BUCKET_ERROR_MM);
   this->Internal->PivotCalibrationAlgo->SetMaximumCalibrationErrorMm(-1.0);
+  this->Internal->PivotCalibrationAlgo->SetValidateInputBufferEnabled(false); // pose buckets are validated by the logic
   this->Internal->PivotCalibrationAlgo->SetOrientationDifferenceThresholdDegrees(DEFAULT_PIVOT_INPUT_ORIENTATION_THRESHOLD_DEGREES);
   this->Internal->PivotCalibrationAlgo->SetPositionDifferenceThresholdMm(DEFAULT_PIVOT_INPUT_POSITION_THRESHOLD_MM);
 
-  this->Internal->SpinCalibrationAlgo->SetMaximumNumberOfPoseBuckets(DEFAULT_NUMBER_OF_POSE_BUCKETS);
   this->Internal->SpinCalibrationAlgo->SetPoseBucketSize(DEFAULT_POSE_BUCKET_SIZE);
   this->Internal->SpinCalibrationAlgo->SetMaximumPoseBucketError(DEFAULT_SPIN_POSE_BUCKET_ERROR_MM);
   this->Internal->SpinCalibrationAlgo->SetMaximumCalibrationErrorMm(-1.0);
+  this->Internal->SpinCalibrationAlgo->SetValidateInputBufferEnabled(false); // pose buckets are validated by the logic
   this->Internal->SpinCalibrationAlgo->SetOrientationDifferenceThresholdDegrees(DEFAULT_SPIN_INPUT_ORIENTATION_THRESHOLD_DEGREES);
   this->Internal->SpinCalibrationAlgo->SetPositionDifferenceThresholdMm(DEFAULT_SPIN_INPUT_POSITION_THRESHOLD_MM);
 
   this->UpdateMaximumCalibrationError();
 }
 
-//----------------------------------------------------------------------------
-vtkSlicerPivotCalibrationLogic::~vtkSlicerPivotCalibrationLogic()
+//----------------------------------------------------------------------------
+vtkSlicerPivotCalibrationLogic::~vtkSlicerPivotCalibrationLogic()
+{
+  this->RemoveAllToolTransformNodes(); // Remove the observers
+  delete this->Internal;
+  this->ToolTipToToolMatrix->Delete();
+  this->SetAndObserveTransformNode(NULL); // Remove the observer
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* vtkNotUsed(callData))
+{
+  if (caller == NULL || event != vtkMRMLTransformNode::TransformModifiedEvent || !this->RecordingState)
+  {
+    return;
+  }
+
+  if (!this->Internal->ToolStates.empty())
+  {
+    vtkInternal::ToolState* tool = this->Internal->GetToolState(vtkMRMLTransformNode::SafeDownCast(caller));
+    double timestampSec = vtkTimerLog::GetUniversalTime();
+    if (tool && this->Internal->IsRecordedPoseDue(tool->RecordingRateLimit, timestampSec) && IsToolValid(tool->TransformNode))
+    {
+      if (!this->ToolPoseBatchProcessingEnabled && !tool->QueuedPoses.empty())
+      {
+        // A new pose of this tool arrived before all the other tools were updated, process the poses received so far
+        this->ProcessQueuedToolPoses();
+      }
+      tool->RecordingRateLimit.SetPoseRecorded(timestampSec);
+      vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+      tool->TransformNode->GetMatrixTransformToParent(toolToReferenceMatrix);
+      PoseType pose;
+      GetPoseFromMatrix(toolToReferenceMatrix, pose);
+      tool->QueuedPoses.push_back(pose);
+      if (!this->ToolPoseBatchProcessingEnabled && this->Internal->AllToolsHaveQueuedPoses())
+      {
+        // All tools are updated, process them in parallel
+        this->ProcessQueuedToolPoses();
+      }
+    }
+  }
+
+  if (caller != this->ObservedTransformNode)
+  {
+    return;
+  }
+  vtkMRMLTransformNode* transformNode = this->ObservedTransformNode;
+
+  // Check rate limit and decimation before anything else, as events may come at a very high rate
+  double timestampSec = vtkTimerLog::GetUniversalTime();
+  if (!this->IsRecordedPoseDue(timestampSec))
+  {
+    return;
+  }
+  if (!IsToolValid(transformNode))
+  {
+    // Tool is not valid, do not use it for calibration
+    return;
+  }
+
+  vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+  transformNode->GetMatrixTransformToParent(toolToReferenceMatrix);
+  this->RecordToolToReferenceMatrix(toolToReferenceMatrix, timestampSec);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::IsRecordedPoseDue(double timestampSec)
+{
+  return this->Internal->IsRecordedPoseDue(this->Internal->RecordingRateLimit, timestampSec);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::RecordToolToReferenceMatrix(vtkMatrix4x4* toolToReferenceMatrix, double timestampSec)
+{
+  if (!toolToReferenceMatrix)
+  {
+    vtkErrorMacro("vtkSlicerPivotCalibrationLogic::RecordToolToReferenceMatrix failed: invalid toolToReferenceMatrix");
+    return;
+  }
+  this->Internal->RecordingRateLimit.SetPoseRecorded(timestampSec);
+
+  PoseType pose;
+  GetPoseFromMatrix(toolToReferenceMatrix, pose);
+  this->Internal->RecordedPoses.Add(timestampSec, pose);
+
+  this->AddToolToReferenceMatrix(toolToReferenceMatrix);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::SetRecordingBufferCapacity(int capacity)
+{
+  if (capacity < 1)
+  {
+    vtkErrorMacro("SetRecordingBufferCapacity failed: capacity must be positive");
+    return;
+  }
+  if (capacity == this->Internal->RecordedPoses.GetCapacity())
+  {
+    return;
+  }
+  this->Internal->RecordedPoses.SetCapacity(capacity);
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPivotCalibrationLogic::GetRecordingBufferCapacity()
+{
+  return this->Internal->RecordedPoses.GetCapacity();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPivotCalibrationLogic::GetNumberOfRecordedPoses()
+{
+  return this->Internal->RecordedPoses.GetNumberOfItems();
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerPivotCalibrationLogic::GetRecordedPose(int index, vtkMatrix4x4* toolToReferenceMatrix)
+{
+  if (index < 0 || index >= this->Internal->RecordedPoses.GetNumberOfItems())
+  {
+    vtkErrorMacro("GetRecordedPose failed: index " << index << " is out of range");
+    return -1.0;
+  }
+  const PoseRingBuffer::TimestampedPose& item = this->Internal->RecordedPoses.GetItem(index);
+  if (toolToReferenceMatrix)
+  {
+    GetMatrixFromPose(item.Pose, toolToReferenceMatrix);
+  }
+  return item.TimestampSec;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::ClearRecordedPoses()
+{
+  this->Internal->RecordedPoses.Clear();
+  this->Internal->RecordingRateLimit.Reset();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::SaveRecordedPoses(const std::string& filePath)
+{
+  std::ofstream file(filePath.c_str());
+  if (!file.is_open())
+  {
+    vtkErrorMacro("SaveRecordedPoses failed: cannot open file " << filePath << " for writing");
+    return false;
+  }
+  file << "# TimestampSec ToolToReferenceMatrix(first 3 rows, row by row)" << std::endl;
+  file.precision(17);
+  for (int i = 0; i < this->Internal->RecordedPoses.GetNumberOfItems(); i++)
+  {
+    const PoseRingBuffer::TimestampedPose& item = this->Internal->RecordedPoses.GetItem(i);
+    file << item.TimestampSec;
+    for (double element : item.Pose)
+    {
+      file << " " << element;
+    }
+    file << std::endl;
+  }
+  if (!file.good())
+  {
+    vtkErrorMacro("SaveRecordedPoses failed: error writing file " << filePath);
+    return false;
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::LoadRecordedPoses(const std::string& filePath)
 {
-  delete this->Internal;
-  this->ToolTipToToolMatrix->Delete();
-  this->SetAndObserveTransformNode(NULL); // Remove the observer
+  std::ifstream file(filePath.c_str());
+  if (!file.is_open())
+  {
+    vtkErrorMacro("LoadRecordedPoses failed: cannot open file " << filePath << " for reading");
+    return false;
+  }
+  this->ClearRecordedPoses();
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line))
+  {
+    lineNumber++;
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+    std::istringstream lineStream(line);
+    double timestampSec = 0.0;
+    PoseType pose;
+    lineStream >> timestampSec;
+    for (double& element : pose)
+    {
+      lineStream >> element;
+    }
+    if (lineStream.fail())
+    {
+      vtkErrorMacro("LoadRecordedPoses failed: invalid pose in line " << lineNumber << " of file " << filePath);
+      this->ClearRecordedPoses();
+      return false;
+    }
+    this->Internal->RecordedPoses.Add(timestampSec, pose);
+  }
+  return true;
 }
 
-//----------------------------------------------------------------------------
-void vtkSlicerPivotCalibrationLogic::PrintSelf(ostream& os, vtkIndent indent)
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::ReplayRecordedPoses()
 {
-  this->Superclass::PrintSelf(os, indent);
+  // Copy the poses, as observers of the calibration events may modify the recording buffer
+  std::vector<PoseRingBuffer::TimestampedPose> recordedPoses;
+  recordedPoses.reserve(this->Internal->RecordedPoses.GetNumberOfItems());
+  for (int i = 0; i < this->Internal->RecordedPoses.GetNumberOfItems(); i++)
+  {
+    recordedPoses.push_back(this->Internal->RecordedPoses.GetItem(i));
+  }
+
+  // Decimation and rate limit were already applied when the poses were recorded
+  vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+  for (const PoseRingBuffer::TimestampedPose& item : recordedPoses)
+  {
+    GetMatrixFromPose(item.Pose, toolToReferenceMatrix);
+    this->AddToolToReferenceMatrix(toolToReferenceMatrix);
+  }
 }
 
 //---------------------------------------------------------------------------
-void vtkSlicerPivotCalibrationLogic::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* vtkNotUsed(callData))
+void vtkSlicerPivotCalibrationLogic::SetRecordingState(bool recordingState)
 {
-  if (caller != NULL)
+  if (this->RecordingState == recordingState)
   {
-    vtkMRMLTransformNode* transformNode = vtkMRMLTransformNode::SafeDownCast(caller);
-    if (event == vtkMRMLTransformNode::TransformModifiedEvent && this->RecordingState == true && strcmp(transformNode->GetID(), this->ObservedTransformNode->GetID()) == 0)
-    {
-      const char* toolValidValue = transformNode->GetAttribute(TOOL_VALID_ATTRIBUTE_NAME);
-      // If the attribute is not present, assume the tool is valid.
-      if (toolValidValue && strcmp(toolValidValue, "1") != 0)
-      {
-        // Tool is not valid, do not use it for calibration
-        return;
-      }
-
-      vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
-      transformNode->GetMatrixTransformToParent(toolToReferenceMatrix);
-      this->AddToolToReferenceMatrix(toolToReferenceMatrix);
-    }
+    return;
+  }
+  this->RecordingState = recordingState;
+  if (!recordingState)
+  {
+    // Process the tool poses that are waiting for the other tools to be updated
+    this->ProcessQueuedToolPoses();
   }
+  this->Modified();
 }
 
 //---------------------------------------------------------------------------
@@ -146,11 +1825,17 @@ void vtkSlicerPivotCalibrationLogic::AddToolToReferenceMatrix(vtkMatrix4x4* tran
 
   if (this->PivotCalibrationEnabled)
   {
-    this->Internal->PivotCalibrationAlgo->InsertNextCalibrationPoint(transformMatrix);
+    if (this->Internal->AddPivotPose(transformMatrix))
+    {
+      this->InvokeEvent(vtkSlicerPivotCalibrationLogic::PivotQualityMetricsUpdatedEvent);
+    }
     this->InvokeEvent(PivotInputTransformAdded);
-    if (this->PivotAutoCalibrationEnabled && this->GetPivotNumberOfPoses() >= this->PivotAutoCalibrationTargetNumberOfPoints)
+    if (this->PivotAutoCalibrationEnabled && (this->GetPivotNumberOfPoses() >= this->PivotAutoCalibrationTargetNumberOfPoints
+      || this->IsPivotCalibrationConverged()))
     {
-      if (this->ComputePivotCalibration() && this->PivotRMSE <= this->PivotAutoCalibrationTargetError)
+      bool calibrationSuccessful = (this->PivotIncrementalCalibrationEnabled ?
+        this->ComputePivotCalibrationIncremental() : this->ComputePivotCalibration());
+      if (calibrationSuccessful && this->PivotRMSE <= this->PivotAutoCalibrationTargetError)
       {
         if (this->PivotAutoCalibrationStopWhenComplete)
         {
@@ -171,7 +1856,8 @@ void vtkSlicerPivotCalibrationLogic::AddToolToReferenceMatrix(vtkMatrix4x4* tran
 
   if (this->SpinCalibrationEnabled)
   {
-    this->Internal->SpinCalibrationAlgo->InsertNextCalibrationPoint(transformMatrix);
+    this->Internal->SpinPoses.AddPose(this->Internal->SpinCalibrationAlgo, transformMatrix,
+      this->SpinMaximumNumberOfPoseBuckets, this->SpinAutoCalibrationEnabled);
     this->InvokeEvent(vtkSlicerPivotCalibrationLogic::SpinInputTransformAdded);
     if (this->SpinAutoCalibrationEnabled && this->GetSpinNumberOfPoses() >= this->SpinAutoCalibrationTargetNumberOfPoints)
     {
@@ -203,18 +1889,23 @@ void vtkSlicerPivotCalibrationLogic::ClearToolToReferenceMatrices()
 {
   this->Internal->PivotCalibrationAlgo->RemoveAllCalibrationPoints();
   this->Internal->SpinCalibrationAlgo->RemoveAllCalibrationPoints();
+  this->Internal->ClearPivotPoses();
+  this->Internal->SpinPoses.Clear();
+  this->ClearToolPoses();
 }
 
 //---------------------------------------------------------------------------
 void vtkSlicerPivotCalibrationLogic::ClearPivotToolToReferenceMatrices()
 {
   this->Internal->PivotCalibrationAlgo->RemoveAllCalibrationPoints();
+  this->Internal->ClearPivotPoses();
 }
 
 //---------------------------------------------------------------------------
 void vtkSlicerPivotCalibrationLogic::ClearSpinToolToReferenceMatrices()
 {
   this->Internal->SpinCalibrationAlgo->RemoveAllCalibrationPoints();
+  this->Internal->SpinPoses.Clear();
 }
 
 //---------------------------------------------------------------------------
@@ -282,6 +1973,40 @@ bool vtkSlicerPivotCalibrationLogic::ComputePivotCalibration(bool autoOrient /*=
   return true;
 }
 
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::ComputePivotCalibrationIncremental()
+{
+  double toolTipPosition_Tool[3] = { 0.0, 0.0, 0.0 };
+  double pivotPosition_Reference[3] = { 0.0, 0.0, 0.0 };
+  double rmseMm = -1.0;
+  if (this->Internal->PivotPoses.Poses.size() < 2
+    || !this->Internal->PivotIncremental.Solver.Solve(toolTipPosition_Tool, pivotPosition_Reference, rmseMm))
+  {
+    this->SetPivotRMSE(-1.0);
+    this->ErrorText = this->GetErrorCodeAsString(vtkIGSIOAbstractStylusCalibrationAlgo::CALIBRATION_NOT_ENOUGH_VARIATION);
+    vtkErrorMacro("ComputePivotCalibrationIncremental: " << this->GetErrorText());
+    return false;
+  }
+
+  if (this->Internal->PivotIncremental.FullSolveRequired
+    && (!this->PivotAutoCalibrationEnabled || rmseMm <= this->PivotAutoCalibrationTargetError))
+  {
+    // The calibration is probably acceptable: compute the full calibration (including the tool tip orientation) once,
+    // then update the result incrementally until poses are discarded.
+    if (!this->ComputePivotCalibration())
+    {
+      return false;
+    }
+    this->Internal->PivotIncremental.SetFullCalibrationResult(this->ToolTipToToolMatrix);
+    return true;
+  }
+
+  this->ErrorText.clear();
+  this->SetPivotRMSE(rmseMm);
+  this->Internal->PivotIncremental.UpdateCalibrationResult(this->ToolTipToToolMatrix, toolTipPosition_Tool);
+  return true;
+}
+
 //---------------------------------------------------------------------------
 bool vtkSlicerPivotCalibrationLogic::ComputeSpinCalibration(bool snapRotation /*=false*/, bool autoOrient /*=true*/)
 {
@@ -309,6 +2034,395 @@ bool vtkSlicerPivotCalibrationLogic::ComputeSpinCalibration(bool snapRotation /*
   return true;
 }
 
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::ComputePivotCalibrationRobust(bool autoOrient /*=true*/)
+{
+  this->PivotNumberOfInliers = 0;
+  this->PivotNumberOfEvaluatedHypotheses = 0;
+  this->Internal->PivotPoseResiduals.clear();
+
+  double toolTipPosition_Tool[3] = { 0.0, 0.0, 0.0 };
+  double pivotPosition_Reference[3] = { 0.0, 0.0, 0.0 };
+  std::vector<bool> inliers;
+  if (!this->Internal->ComputeRobustPivot(toolTipPosition_Tool, pivotPosition_Reference, inliers))
+  {
+    this->SetPivotRMSE(-1.0);
+    this->ErrorText = this->GetErrorCodeAsString(static_cast<int>(this->Internal->PivotPoses.Poses.size()) < ROBUST_PIVOT_MINIMAL_SUBSET_SIZE ?
+      vtkIGSIOAbstractStylusCalibrationAlgo::CALIBRATION_NOT_ENOUGH_POINTS : vtkIGSIOAbstractStylusCalibrationAlgo::CALIBRATION_NOT_ENOUGH_VARIATION);
+    vtkErrorMacro("ComputePivotCalibrationRobust: " << this->GetErrorText());
+    return false;
+  }
+
+  // Compute the final result from the inlier poses using the standard algorithm,
+  // to get the tool tip orientation and the calibration error the same way as in ComputePivotCalibration.
+  vtkNew<vtkIGSIOPivotCalibrationAlgo> inlierPivotCalibrationAlgo;
+  CopyAlgorithmSettings(inlierPivotCalibrationAlgo, this->Internal->PivotCalibrationAlgo, static_cast<int>(inliers.size()), -1.0, false);
+  vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+  for (size_t i = 0; i < inliers.size(); i++)
+  {
+    this->Internal->PivotPoseResiduals.push_back(vtkPivotCalibrationLeastSquares::GetResidual(
+      this->Internal->PivotPoses.Poses[i], toolTipPosition_Tool, pivotPosition_Reference));
+    if (inliers[i])
+    {
+      GetMatrixFromPose(this->Internal->PivotPoses.Poses[i], toolToReferenceMatrix);
+      inlierPivotCalibrationAlgo->InsertNextCalibrationPoint(toolToReferenceMatrix);
+      this->PivotNumberOfInliers++;
+    }
+  }
+
+  vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+  toolTipToToolMatrix->DeepCopy(this->ToolTipToToolMatrix);
+  inlierPivotCalibrationAlgo->SetPivotPointToMarkerTransformMatrix(toolTipToToolMatrix);
+
+  bool success = inlierPivotCalibrationAlgo->DoPivotCalibration(nullptr, autoOrient) == IGSIO_SUCCESS;
+  this->ErrorText = this->GetErrorCodeAsString(inlierPivotCalibrationAlgo->GetErrorCode());
+  if (!success)
+  {
+    this->SetPivotRMSE(-1.0);
+    vtkErrorMacro("ComputePivotCalibrationRobust: " << this->GetErrorText());
+    return false;
+  }
+
+  this->SetPivotRMSE(inlierPivotCalibrationAlgo->GetPivotCalibrationErrorMm());
+  this->ToolTipToToolMatrix->DeepCopy(inlierPivotCalibrationAlgo->GetPivotPointToMarkerTransformMatrix());
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::ComputeSpinCalibrationRobust(bool snapRotation /*=false*/, bool autoOrient /*=true*/)
+{
+  this->SpinNumberOfInliers = 0;
+  this->SpinNumberOfEvaluatedHypotheses = 0;
+  this->Internal->SpinPoseResiduals.clear();
+
+  double shaftDirection_Tool[3] = { 0.0, 0.0, 0.0 };
+  double shaftDirection_Reference[3] = { 0.0, 0.0, 0.0 };
+  std::vector<bool> inliers;
+  if (!this->Internal->ComputeRobustSpin(shaftDirection_Tool, shaftDirection_Reference, inliers))
+  {
+    this->SetSpinRMSE(-1.0);
+    this->ErrorText = this->GetErrorCodeAsString(static_cast<int>(this->Internal->SpinPoses.Poses.size()) < ROBUST_SPIN_MINIMAL_SUBSET_SIZE ?
+      vtkIGSIOAbstractStylusCalibrationAlgo::CALIBRATION_NOT_ENOUGH_POINTS : vtkIGSIOAbstractStylusCalibrationAlgo::CALIBRATION_NOT_ENOUGH_VARIATION);
+    vtkErrorMacro("ComputeSpinCalibrationRobust: " << this->GetErrorText());
+    return false;
+  }
+
+  vtkNew<vtkIGSIOSpinCalibrationAlgo> inlierSpinCalibrationAlgo;
+  CopyAlgorithmSettings(inlierSpinCalibrationAlgo, this->Internal->SpinCalibrationAlgo, static_cast<int>(inliers.size()), -1.0, false);
+  vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+  for (size_t i = 0; i < inliers.size(); i++)
+  {
+    this->Internal->SpinPoseResiduals.push_back(GetSpinResidual(this->Internal->SpinPoses.Poses[i], shaftDirection_Tool, shaftDirection_Reference));
+    if (inliers[i])
+    {
+      GetMatrixFromPose(this->Internal->SpinPoses.Poses[i], toolToReferenceMatrix);
+      inlierSpinCalibrationAlgo->InsertNextCalibrationPoint(toolToReferenceMatrix);
+      this->SpinNumberOfInliers++;
+    }
+  }
+
+  vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+  toolTipToToolMatrix->DeepCopy(this->ToolTipToToolMatrix);
+  inlierSpinCalibrationAlgo->SetPivotPointToMarkerTransformMatrix(toolTipToToolMatrix);
+
+  bool success = inlierSpinCalibrationAlgo->DoSpinCalibration(nullptr, snapRotation, autoOrient) == IGSIO_SUCCESS;
+  this->ErrorText = this->GetErrorCodeAsString(inlierSpinCalibrationAlgo->GetErrorCode());
+  if (!success)
+  {
+    this->SetSpinRMSE(-1.0);
+    vtkErrorMacro("ComputeSpinCalibrationRobust: " << this->GetErrorText());
+    return false;
+  }
+
+  this->SetSpinRMSE(inlierSpinCalibrationAlgo->GetSpinCalibrationErrorMm());
+  this->ToolTipToToolMatrix->DeepCopy(inlierSpinCalibrationAlgo->GetPivotPointToMarkerTransformMatrix());
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::ComputeCalibrationFromSequence(vtkMRMLSequenceNode* pivotSequenceNode,
+  vtkMRMLSequenceNode* spinSequenceNode, ToolCalibrationResult& result, bool autoOrient /*=true*/)
+{
+  std::vector<vtkMRMLSequenceNode*> pivotSequenceNodes(1, pivotSequenceNode);
+  std::vector<vtkMRMLSequenceNode*> spinSequenceNodes(1, spinSequenceNode);
+  std::vector<ToolCalibrationResult> results;
+  bool success = this->ComputeCalibrationFromSequences(pivotSequenceNodes, spinSequenceNodes, results, autoOrient);
+  result = results[0];
+  return success;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::ComputeCalibrationFromSequences(const std::vector<vtkMRMLSequenceNode*>& pivotSequenceNodes,
+  const std::vector<vtkMRMLSequenceNode*>& spinSequenceNodes, std::vector<ToolCalibrationResult>& results, bool autoOrient /*=true*/)
+{
+  const int numberOfTools = static_cast<int>(std::max(pivotSequenceNodes.size(), spinSequenceNodes.size()));
+  results.clear();
+  results.resize(numberOfTools);
+  for (ToolCalibrationResult& result : results)
+  {
+    result.ToolTipToToolMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  }
+
+  // Get all poses from the sequences first, as MRML nodes must not be accessed from worker threads
+  std::vector< std::vector<PoseType> > pivotPoses(numberOfTools);
+  std::vector< std::vector<PoseType> > spinPoses(numberOfTools);
+  for (int toolIndex = 0; toolIndex < numberOfTools; toolIndex++)
+  {
+    vtkMRMLSequenceNode* pivotSequenceNode = (toolIndex < static_cast<int>(pivotSequenceNodes.size()) ? pivotSequenceNodes[toolIndex] : nullptr);
+    vtkMRMLSequenceNode* spinSequenceNode = (toolIndex < static_cast<int>(spinSequenceNodes.size()) ? spinSequenceNodes[toolIndex] : nullptr);
+    if (!GetPosesFromSequence(pivotSequenceNode, pivotPoses[toolIndex]) || !GetPosesFromSequence(spinSequenceNode, spinPoses[toolIndex]))
+    {
+      results[toolIndex].ErrorText = "Sequence contains items that are not linear transforms";
+      pivotPoses[toolIndex].clear();
+      spinPoses[toolIndex].clear();
+    }
+  }
+
+  vtkSMPTools::For(0, numberOfTools, [&](vtkIdType beginToolIndex, vtkIdType endToolIndex)
+  {
+    for (vtkIdType toolIndex = beginToolIndex; toolIndex < endToolIndex; toolIndex++)
+    {
+      this->Internal->ComputeCalibrationFromPoses(pivotPoses[toolIndex], spinPoses[toolIndex], autoOrient, results[toolIndex]);
+    }
+  });
+
+  bool success = true;
+  for (int toolIndex = 0; toolIndex < numberOfTools; toolIndex++)
+  {
+    const ToolCalibrationResult& result = results[toolIndex];
+    if (!result.ErrorText.empty() || (pivotPoses[toolIndex].empty() && spinPoses[toolIndex].empty()))
+    {
+      vtkWarningMacro("ComputeCalibrationFromSequences: calibration of tool " << toolIndex << " failed. " << result.ErrorText);
+      success = false;
+    }
+  }
+  return success;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::AddAndObserveToolTransformNode(vtkMRMLTransformNode* transformNode)
+{
+  if (!transformNode)
+  {
+    vtkErrorMacro("AddAndObserveToolTransformNode failed: invalid transformNode");
+    return;
+  }
+  if (this->Internal->GetToolState(transformNode))
+  {
+    // already added
+    return;
+  }
+  if (transformNode == this->ObservedTransformNode)
+  {
+    vtkWarningMacro("AddAndObserveToolTransformNode: " << transformNode->GetID()
+      << " is also set by SetAndObserveTransformNode, its poses will be used in both calibrations");
+  }
+  std::unique_ptr<vtkInternal::ToolState> tool(new vtkInternal::ToolState);
+  this->Internal->ClearToolState(tool.get());
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLTransformNode::TransformModifiedEvent);
+  vtkSetAndObserveMRMLNodeEventsMacro(tool->TransformNode, transformNode, events.GetPointer());
+  this->Internal->ToolStates.push_back(std::move(tool));
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::RemoveToolTransformNode(vtkMRMLTransformNode* transformNode)
+{
+  for (auto toolIt = this->Internal->ToolStates.begin(); toolIt != this->Internal->ToolStates.end(); ++toolIt)
+  {
+    if ((*toolIt)->TransformNode == transformNode)
+    {
+      vtkSetAndObserveMRMLNodeEventsMacro((*toolIt)->TransformNode, nullptr, nullptr);
+      this->Internal->ToolStates.erase(toolIt);
+      return;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::RemoveAllToolTransformNodes()
+{
+  for (std::unique_ptr<vtkInternal::ToolState>& tool : this->Internal->ToolStates)
+  {
+    vtkSetAndObserveMRMLNodeEventsMacro(tool->TransformNode, nullptr, nullptr);
+  }
+  this->Internal->ToolStates.clear();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPivotCalibrationLogic::GetNumberOfToolTransformNodes()
+{
+  return static_cast<int>(this->Internal->ToolStates.size());
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLTransformNode* vtkSlicerPivotCalibrationLogic::GetNthToolTransformNode(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Internal->ToolStates.size()))
+  {
+    vtkErrorMacro("GetNthToolTransformNode failed: invalid index " << index);
+    return nullptr;
+  }
+  return this->Internal->ToolStates[index]->TransformNode;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::ProcessQueuedToolPoses()
+{
+  std::vector<vtkInternal::ToolState*> tools;
+  for (std::unique_ptr<vtkInternal::ToolState>& tool : this->Internal->ToolStates)
+  {
+    if (!tool->QueuedPoses.empty())
+    {
+      this->Internal->UpdateToolAlgorithmSettings(tool.get());
+      tools.push_back(tool.get());
+    }
+  }
+  if (tools.empty())
+  {
+    return;
+  }
+
+  vtkSMPTools::For(0, static_cast<vtkIdType>(tools.size()), [&](vtkIdType beginToolIndex, vtkIdType endToolIndex)
+  {
+    for (vtkIdType toolIndex = beginToolIndex; toolIndex < endToolIndex; toolIndex++)
+    {
+      this->Internal->ProcessToolPoses(tools[toolIndex]);
+    }
+  });
+
+  // Collect completion events first, as observers may add or remove tools
+  std::vector< std::pair<unsigned long, vtkMRMLTransformNode*> > completionEvents;
+  for (vtkInternal::ToolState* tool : tools)
+  {
+    if (tool->PivotCalibrationCompleteEventPending)
+    {
+      tool->PivotCalibrationCompleteEventPending = false;
+      completionEvents.push_back(std::make_pair(static_cast<unsigned long>(ToolPivotCalibrationCompleteEvent), tool->TransformNode));
+    }
+    if (tool->SpinCalibrationCompleteEventPending)
+    {
+      tool->SpinCalibrationCompleteEventPending = false;
+      completionEvents.push_back(std::make_pair(static_cast<unsigned long>(ToolSpinCalibrationCompleteEvent), tool->TransformNode));
+    }
+  }
+  for (const std::pair<unsigned long, vtkMRMLTransformNode*>& completionEvent : completionEvents)
+  {
+    this->InvokeEvent(completionEvent.first, completionEvent.second);
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::ClearToolPoses()
+{
+  for (std::unique_ptr<vtkInternal::ToolState>& tool : this->Internal->ToolStates)
+  {
+    this->Internal->ClearToolState(tool.get());
+  }
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPivotCalibrationLogic::GetToolPivotNumberOfPoses(vtkMRMLTransformNode* transformNode)
+{
+  vtkInternal::ToolState* tool = this->Internal->GetToolState(transformNode);
+  return tool ? static_cast<int>(tool->PivotPoses.Poses.size()) : -1;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerPivotCalibrationLogic::GetToolSpinNumberOfPoses(vtkMRMLTransformNode* transformNode)
+{
+  vtkInternal::ToolState* tool = this->Internal->GetToolState(transformNode);
+  return tool ? static_cast<int>(tool->SpinPoses.Poses.size()) : -1;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::ComputeToolCalibrations(bool autoOrient /*=true*/)
+{
+  this->ProcessQueuedToolPoses();
+
+  std::vector<vtkInternal::ToolState*> tools;
+  for (std::unique_ptr<vtkInternal::ToolState>& tool : this->Internal->ToolStates)
+  {
+    this->Internal->UpdateToolAlgorithmSettings(tool.get());
+    tools.push_back(tool.get());
+  }
+  std::vector<char> toolSuccess(tools.size(), 1);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(tools.size()), [&](vtkIdType beginToolIndex, vtkIdType endToolIndex)
+  {
+    for (vtkIdType toolIndex = beginToolIndex; toolIndex < endToolIndex; toolIndex++)
+    {
+      vtkInternal::ToolState* tool = tools[toolIndex];
+      bool pivotPosesAvailable = tool->PivotCalibrationAlgo->GetNumberOfCalibrationPoints() > 0;
+      bool spinPosesAvailable = tool->SpinCalibrationAlgo->GetNumberOfCalibrationPoints() > 0;
+      if (!pivotPosesAvailable && !spinPosesAvailable)
+      {
+        toolSuccess[toolIndex] = 0;
+        continue;
+      }
+      if (pivotPosesAvailable && !this->Internal->ComputeToolPivotCalibration(tool, autoOrient))
+      {
+        toolSuccess[toolIndex] = 0;
+      }
+      if (spinPosesAvailable && !this->Internal->ComputeToolSpinCalibration(tool, autoOrient))
+      {
+        toolSuccess[toolIndex] = 0;
+      }
+    }
+  });
+
+  bool success = true;
+  for (size_t toolIndex = 0; toolIndex < tools.size(); toolIndex++)
+  {
+    if (!toolSuccess[toolIndex])
+    {
+      vtkWarningMacro("ComputeToolCalibrations: calibration of tool " << tools[toolIndex]->TransformNode->GetID()
+        << " failed. " << tools[toolIndex]->Result.ErrorText);
+      success = false;
+    }
+  }
+  return success;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::GetToolCalibrationResult(vtkMRMLTransformNode* transformNode, ToolCalibrationResult& result)
+{
+  vtkInternal::ToolState* tool = this->Internal->GetToolState(transformNode);
+  if (!tool)
+  {
+    return false;
+  }
+  result = tool->Result;
+  // Return a copy of the matrix, as the tool result is updated by further calibrations
+  result.ToolTipToToolMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  result.ToolTipToToolMatrix->DeepCopy(tool->Result.ToolTipToToolMatrix);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::GetPivotPoseResiduals(std::vector<double>& residuals)
+{
+  residuals = this->Internal->PivotPoseResiduals;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::GetSpinPoseResiduals(std::vector<double>& residuals)
+{
+  residuals = this->Internal->SpinPoseResiduals;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerPivotCalibrationLogic::GetPivotLivePoseResiduals(std::vector<double>& residuals)
+{
+  residuals.assign(this->Internal->PivotLivePoseResiduals.begin(), this->Internal->PivotLivePoseResiduals.end());
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerPivotCalibrationLogic::IsPivotCalibrationConverged()
+{
+  return this->Internal->IsPivotCalibrationConverged(this->PivotToolTipUncertaintyMm, this->PivotOrientationSpreadDegrees,
+    this->GetPivotNumberOfPoses());
+}
+
 //---------------------------------------------------------------------------
 void vtkSlicerPivotCalibrationLogic::GetToolTipToToolTranslation(vtkMatrix4x4* translationMatrix)
 {
@@ -359,7 +2473,6 @@ void vtkSlicerPivotCalibrationLogic::SetPivotAutoCalibrationEnabled(bool enabled
     return;
   }
   this->PivotAutoCalibrationEnabled = enabled;
-  this->Internal->PivotCalibrationAlgo->SetValidateInputBufferEnabled(enabled);
   this->UpdateMaximumCalibrationError();
   this->Modified();
   return;
@@ -373,7 +2486,6 @@ void vtkSlicerPivotCalibrationLogic::SetSpinAutoCalibrationEnabled(bool enabled)
     return;
   }
   this->SpinAutoCalibrationEnabled = enabled;
-  this->Internal->SpinCalibrationAlgo->SetValidateInputBufferEnabled(enabled);
   this->UpdateMaximumCalibrationError();
   this->Modified();
   return;
@@ -382,7 +2494,7 @@ void vtkSlicerPivotCalibrationLogic::SetSpinAutoCalibrationEnabled(bool enabled)
 //---------------------------------------------------------------------------
 int vtkSlicerPivotCalibrationLogic::GetPivotNumberOfPoses()
 {
-  return this->Internal->PivotCalibrationAlgo->GetNumberOfCalibrationPoints();
+  return static_cast<int>(this->Internal->PivotPoses.Poses.size());
 }
 
 //---------------------------------------------------------------------------
@@ -443,13 +2555,14 @@ void vtkSlicerPivotCalibrationLogic::SetPivotPoseBucketSize(int bucketSize)
 //---------------------------------------------------------------------------
 int vtkSlicerPivotCalibrationLogic::GetPivotMaximumNumberOfPoseBuckets()
 {
-  return this->Internal->PivotCalibrationAlgo->GetMaximumNumberOfPoseBuckets();
+  return this->PivotMaximumNumberOfPoseBuckets;
 }
 
 //---------------------------------------------------------------------------
-void vtkSlicerPivotCalibrationLogic::SetPivotMaximumNumberOfPoseBuckets(int bucketSize)
+void vtkSlicerPivotCalibrationLogic::SetPivotMaximumNumberOfPoseBuckets(int numberOfBuckets)
 {
-  this->Internal->PivotCalibrationAlgo->SetMaximumNumberOfPoseBuckets(bucketSize);
+  // Poses are discarded when the next pose is added
+  this->PivotMaximumNumberOfPoseBuckets = std::max(1, numberOfBuckets);
 }
 
 //---------------------------------------------------------------------------
@@ -491,7 +2604,7 @@ void vtkSlicerPivotCalibrationLogic::SetPivotOrientationDifferenceThresholdDegre
 //---------------------------------------------------------------------------
 int vtkSlicerPivotCalibrationLogic::GetSpinNumberOfPoses()
 {
-  return this->Internal->SpinCalibrationAlgo->GetNumberOfCalibrationPoints();
+  return static_cast<int>(this->Internal->SpinPoses.Poses.size());
 }
 
 //---------------------------------------------------------------------------
@@ -521,13 +2634,14 @@ void vtkSlicerPivotCalibrationLogic::SetSpinPoseBucketSize(int bucketSize)
 //---------------------------------------------------------------------------
 int vtkSlicerPivotCalibrationLogic::GetSpinMaximumNumberOfPoseBuckets()
 {
-  return this->Internal->SpinCalibrationAlgo->GetMaximumNumberOfPoseBuckets();
+  return this->SpinMaximumNumberOfPoseBuckets;
 }
 
 //---------------------------------------------------------------------------
-void vtkSlicerPivotCalibrationLogic::SetSpinMaximumNumberOfPoseBuckets(int bucketSize)
+void vtkSlicerPivotCalibrationLogic::SetSpinMaximumNumberOfPoseBuckets(int numberOfBuckets)
 {
-  this->Internal->SpinCalibrationAlgo->SetMaximumNumberOfPoseBuckets(bucketSize);
+  // Poses are discarded when the next pose is added
+  this->SpinMaximumNumberOfPoseBuckets = std::max(1, numberOfBuckets);
 }
 
 //---------------------------------------------------------------------------
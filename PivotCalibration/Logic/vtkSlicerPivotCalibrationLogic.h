@@ -25,6 +25,10 @@
 
 // VTK includes
 #include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <vector>
 
 // MRML includes
 #include "vtkMRMLTransformNode.h"
@@ -32,6 +36,8 @@
 // Pivot calibration includes
 #include "vtkSlicerPivotCalibrationModuleLogicExport.h"
 
+class vtkMRMLSequenceNode;
+
 
 /// \ingroup Slicer_QtModules_ExtensionTemplate
 /// Module for calibrating a tracked pointer/stylus device.
@@ -50,7 +56,10 @@ public:
     PivotInputTransformAdded,
     SpinInputTransformAdded,
     PivotCalibrationCompleteEvent,
-    SpinCalibrationCompleteEvent
+    SpinCalibrationCompleteEvent,
+    PivotQualityMetricsUpdatedEvent,
+    ToolPivotCalibrationCompleteEvent,
+    ToolSpinCalibrationCompleteEvent
   };
 
   enum CalibrationErrorCodes
@@ -75,23 +84,190 @@ public:
 
   // Add a tool transforms automatically by observing transform changes
   vtkGetMacro(RecordingState, bool);
-  vtkSetMacro(RecordingState, bool);
+  void SetRecordingState(bool);
   void SetAndObserveTransformNode(vtkMRMLTransformNode*);
 
   // Add a single tool transform manually
   void AddToolToReferenceMatrix(vtkMatrix4x4*);
 
+  //@{
+  /// Poses of the observed transform are stored with their timestamps in a fixed-capacity recording buffer
+  /// (oldest poses are overwritten when the buffer is full) and then added to the calibration.
+  /// RecordingDecimationFactor: only every N-th transform change is used (1 = all changes are used).
+  /// Rate limit and decimation are applied before checking if the tool is valid, so changes of an invalid tool are counted, too.
+  /// RecordingMaximumRateHz: poses that arrive sooner than 1/rate after the previous recorded pose are ignored (0 = no limit).
+  vtkGetMacro(RecordingDecimationFactor, int);
+  vtkSetClampMacro(RecordingDecimationFactor, int, 1, VTK_INT_MAX);
+  vtkGetMacro(RecordingMaximumRateHz, double);
+  vtkSetClampMacro(RecordingMaximumRateHz, double, 0.0, VTK_DOUBLE_MAX);
+  int GetRecordingBufferCapacity();
+  void SetRecordingBufferCapacity(int capacity);
+  //@}
+
+  //@{
+  /// Access poses in the recording buffer. Index 0 is the oldest pose.
+  /// GetRecordedPose returns the timestamp of the pose in seconds (negative value in case of error).
+  int GetNumberOfRecordedPoses();
+  double GetRecordedPose(int index, vtkMatrix4x4* toolToReferenceMatrix);
+  void ClearRecordedPoses();
+  //@}
+
+  //@{
+  /// Save/load the recording buffer to/from a text file (one pose per line: timestamp and first 3 rows of the matrix).
+  /// Returns with false on failure.
+  bool SaveRecordedPoses(const std::string& filePath);
+  bool LoadRecordedPoses(const std::string& filePath);
+  //@}
+
+  /// Add all poses of the recording buffer to the calibration, the same way as poses of the observed transform are added.
+  /// Decimation and rate limit are not applied again, as they were applied when the poses were recorded.
+  /// The recording buffer is not changed.
+  void ReplayRecordedPoses();
+
+  /// Record a pose (with timestamp in seconds) and add it to the calibration.
+  /// Decimation and rate limit are not applied, as they are checked when the transform change is received.
+  void RecordToolToReferenceMatrix(vtkMatrix4x4*, double timestampSec);
+
   // Computes calibration results.
   // By default, automatically flips the shaft direction to be consistent with the needle orientation protocol.
   // Returns with false on failure
   bool ComputePivotCalibration(bool autoOrient = true);
 
+  // Computes pivot calibration results from running least-squares accumulators,
+  // in constant time (the accumulators are updated as each pose is added).
+  // The full calibration is only computed when it is first needed and after poses are discarded from the pose buffer,
+  // otherwise the tool tip position and PivotRMSE are updated and the shaft direction is flipped
+  // the same way as in the full calibration, if needed.
+  // Returns with false on failure
+  bool ComputePivotCalibrationIncremental();
+
   // Computes calibration results.
   // By default, automatically flips the shaft direction to be consistent with the needle orientation protocol.
   // Optionally, snaps the rotation to be a 90 degree rotation about one of the coordinate axes.
   // Returns with false on failure
   bool ComputeSpinCalibration(bool snapRotation = false, bool autoOrient = true); // Note: The neede orientation protocol assumes that the shaft of the tool lies along the negative z-axis
 
+  //@{
+  /// Robust calibration, for pose buffers that contain outliers (e.g., tracking glitches, slipped tool tip).
+  /// Hypotheses are computed from random minimal subsets of poses (RANSAC) and scored in parallel,
+  /// then the best hypothesis is refined using iteratively reweighted least squares.
+  /// The final result is computed from the inlier poses the same way as in ComputePivotCalibration/ComputeSpinCalibration.
+  /// Returns with false on failure
+  bool ComputePivotCalibrationRobust(bool autoOrient = true);
+  bool ComputeSpinCalibrationRobust(bool snapRotation = false, bool autoOrient = true);
+  //@}
+
+  //@{
+  /// Random hypotheses are evaluated by robust calibration until a hypothesis that is computed from inlier poses only
+  /// is found with RobustConfidence probability (based on the inlier ratio of the best hypothesis so far),
+  /// but at most RobustMaximumNumberOfHypotheses hypotheses are evaluated.
+  /// RobustRandomSeed is used for generating the hypotheses, results are reproducible for the same seed.
+  vtkGetMacro(RobustMaximumNumberOfHypotheses, int);
+  vtkSetMacro(RobustMaximumNumberOfHypotheses, int);
+  vtkGetMacro(RobustConfidence, double);
+  vtkSetClampMacro(RobustConfidence, double, 0.0, 1.0);
+  vtkGetMacro(RobustRandomSeed, int);
+  vtkSetMacro(RobustRandomSeed, int);
+  /// Poses with larger distance between the computed and estimated pivot point are considered as outliers.
+  vtkGetMacro(PivotRobustInlierThresholdMm, double);
+  vtkSetMacro(PivotRobustInlierThresholdMm, double);
+  /// Poses with larger difference between the computed and estimated shaft direction (length of difference
+  /// of unit vectors) are considered as outliers.
+  vtkGetMacro(SpinRobustInlierThreshold, double);
+  vtkSetMacro(SpinRobustInlierThreshold, double);
+  //@}
+
+  //@{
+  /// Results of the last robust calibration: number of inlier poses, number of evaluated hypotheses
+  /// and the residual of each pose in the pose buffer.
+  vtkGetMacro(PivotNumberOfInliers, int);
+  vtkGetMacro(SpinNumberOfInliers, int);
+  vtkGetMacro(PivotNumberOfEvaluatedHypotheses, int);
+  vtkGetMacro(SpinNumberOfEvaluatedHypotheses, int);
+  void GetPivotPoseResiduals(std::vector<double>& residuals);
+  void GetSpinPoseResiduals(std::vector<double>& residuals);
+  //@}
+
+  //@{
+  /// Pivot calibration quality metrics, updated after each pose is added to (or discarded from) the pivot pose buffer,
+  /// from the running least-squares accumulators (PivotQualityMetricsUpdatedEvent is invoked after each update).
+  /// They can be used for stopping pose collection as soon as the calibration has converged.
+  /// Values are negative if they are not available (not enough poses).
+  /// PivotLatestPoseResidualMm: distance between the pivot point and the tool tip position computed from the newest pose.
+  /// PivotConditionNumber: condition number of the least-squares system. Large values indicate insufficient rotation.
+  /// PivotOrientationSpreadDegrees: root-mean-square rotation angle between the poses and their mean orientation.
+  /// PivotToolTipUncertaintyMm: estimated standard deviation of the computed tool tip position.
+  vtkGetMacro(PivotLatestPoseResidualMm, double);
+  vtkGetMacro(PivotConditionNumber, double);
+  vtkGetMacro(PivotOrientationSpreadDegrees, double);
+  vtkGetMacro(PivotToolTipUncertaintyMm, double);
+  /// Get the residual of each pose in the pivot pose buffer, computed when the pose was added.
+  void GetPivotLivePoseResiduals(std::vector<double>& residuals);
+  //@}
+
+  /// Returns true if enough poses have been collected and the estimated tool tip uncertainty
+  /// is below PivotAutoCalibrationTargetToolTipUncertaintyMm.
+  bool IsPivotCalibrationConverged();
+
+  /// Calibration result of a single tool
+  struct ToolCalibrationResult
+  {
+    vtkSmartPointer<vtkMatrix4x4> ToolTipToToolMatrix;
+    double PivotRMSE{ -1.0 };
+    double SpinRMSE{ -1.0 };
+    int PivotErrorCode{ CALIBRATION_NOT_STARTED };
+    int SpinErrorCode{ CALIBRATION_NOT_STARTED };
+    std::string ErrorText; // empty if calibration was successful
+  };
+
+  //@{
+  /// Compute pivot and spin calibration directly from recorded tool to reference transform sequences,
+  /// without adding the poses to the calibration of the logic (the state of the logic is not changed).
+  /// The current calibration settings (pose thresholds, bucket size, minimum orientation difference) are used.
+  /// For each tool, pivot calibration is computed from the pivot sequence and then spin calibration from the spin sequence.
+  /// Pivot or spin sequence may be nullptr, in which case that calibration is skipped.
+  /// Multiple tools are calibrated in parallel.
+  /// Returns with false if calibration of any of the tools failed.
+  bool ComputeCalibrationFromSequence(vtkMRMLSequenceNode* pivotSequenceNode, vtkMRMLSequenceNode* spinSequenceNode,
+    ToolCalibrationResult& result, bool autoOrient = true);
+  bool ComputeCalibrationFromSequences(const std::vector<vtkMRMLSequenceNode*>& pivotSequenceNodes,
+    const std::vector<vtkMRMLSequenceNode*>& spinSequenceNodes, std::vector<ToolCalibrationResult>& results, bool autoOrient = true);
+  //@}
+
+  //@{
+  /// Calibration of multiple tools at once. Each tool transform node has its own pose buffers, calibration results
+  /// and completion events (ToolPivotCalibrationCompleteEvent and ToolSpinCalibrationCompleteEvent, with the tool
+  /// transform node as call data). Tool poses are recorded while RecordingState is on, using the same recording
+  /// (decimation, rate limit), calibration and auto-calibration (incremental calibration, convergence) settings
+  /// as the transform node set by SetAndObserveTransformNode.
+  /// Auto-calibration is performed once for all the poses that are processed together.
+  /// If PivotAutoCalibrationStopWhenComplete/SpinAutoCalibrationStopWhenComplete is enabled then a tool
+  /// stops collecting poses for the completed calibration.
+  /// Transform changes are queued and the queued poses of the tools are processed in parallel, in worker threads.
+  /// If ToolPoseBatchProcessingEnabled is off (default) then queued poses are processed when all tools are updated
+  /// (or a tool is updated again before that) and when recording is stopped, otherwise the application has to call
+  /// ProcessQueuedToolPoses (e.g., after all tracked tool transforms are updated).
+  void AddAndObserveToolTransformNode(vtkMRMLTransformNode*);
+  void RemoveToolTransformNode(vtkMRMLTransformNode*);
+  void RemoveAllToolTransformNodes();
+  int GetNumberOfToolTransformNodes();
+  vtkMRMLTransformNode* GetNthToolTransformNode(int index);
+  vtkGetMacro(ToolPoseBatchProcessingEnabled, bool);
+  vtkSetMacro(ToolPoseBatchProcessingEnabled, bool);
+  vtkBooleanMacro(ToolPoseBatchProcessingEnabled, bool);
+  void ProcessQueuedToolPoses();
+  /// Clear poses and calibration results of all tools
+  void ClearToolPoses();
+  /// Returns the number of poses in the calibration algorithms of the tool (-1 if the node is not a tool)
+  int GetToolPivotNumberOfPoses(vtkMRMLTransformNode*);
+  int GetToolSpinNumberOfPoses(vtkMRMLTransformNode*);
+  /// Compute pivot and spin calibration of all tools from their collected poses, in parallel.
+  /// Returns with false if calibration of any of the tools failed.
+  bool ComputeToolCalibrations(bool autoOrient = true);
+  /// Get the latest calibration results of a tool. Returns with false if the node is not a tool.
+  bool GetToolCalibrationResult(vtkMRMLTransformNode*, ToolCalibrationResult& result);
+  //@}
+
   // Flip the direction of the shaft axis
   void FlipShaftDirection();
 
@@ -133,6 +309,15 @@ public:
   vtkBooleanMacro(SpinAutoCalibrationEnabled, bool);
   //@}
 
+  //@{
+  /// Flag that specifies if automatic pivot calibration uses ComputePivotCalibrationIncremental instead of
+  /// ComputePivotCalibration when a new pose is added. Recommended for high input transform update rates.
+  /// Off by default.
+  vtkGetMacro(PivotIncrementalCalibrationEnabled, bool);
+  vtkSetMacro(PivotIncrementalCalibrationEnabled, bool);
+  vtkBooleanMacro(PivotIncrementalCalibrationEnabled, bool);
+  //@}
+
   //@{
   /// Flag that specifies if calibration is enabled for the specified type.
   /// If on, poses will be added to the calibration algorithm as the transform is modified.
@@ -165,6 +350,14 @@ public:
   vtkSetMacro(SpinAutoCalibrationTargetNumberOfPoints, int);
   //@}
 
+  //@{
+  /// If positive, automatic pivot calibration is performed as soon as the calibration has converged
+  /// (see IsPivotCalibrationConverged), even if PivotAutoCalibrationTargetNumberOfPoints is not reached yet.
+  /// Disabled (0) by default.
+  vtkGetMacro(PivotAutoCalibrationTargetToolTipUncertaintyMm, double);
+  vtkSetMacro(PivotAutoCalibrationTargetToolTipUncertaintyMm, double);
+  //@}
+
   //@{
   /// The desired target error threshold for automatic calibration.
   vtkGetMacro(PivotAutoCalibrationTargetError, double);
@@ -175,7 +368,8 @@ public:
 
   //@{
   /// The number of poses that should be stored in each bucket.
-  /// When a bucket is filled, the algorithm will discard all saved poses if the error in the bucket is too high.
+  /// When a bucket is filled and auto-calibration is enabled, the poses of the bucket are discarded
+  /// if the error in the bucket is too high.
   /// This indicates the fact that the tool is not performing the required motion.
   int  GetPivotPoseBucketSize();
   void SetPivotPoseBucketSize(int bucketSize);
@@ -203,7 +397,8 @@ public:
 
   //@{
   /// The maximum amount of error that is allowed in a pose bucket.
-  /// When a bucket is filled, the algorithm will discard all saved poses if the error in the bucket is too high.
+  /// When a bucket is filled and auto-calibration is enabled, the poses of the bucket are discarded
+  /// if the error in the bucket is too high.
   /// This indicates the fact that the tool is not performing the required motion.
   double GetPivotMaximumPoseBucketError();
   void   SetPivotMaximumPoseBucketError(double);
@@ -235,6 +430,10 @@ protected:
 
   void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData) override;
 
+  /// Returns true if a pose received at the specified time should be recorded (according to decimation and rate limit).
+  /// Poses that are dropped by decimation are counted, therefore it must be called only once for each received pose.
+  bool IsRecordedPoseDue(double timestampSec);
+
   vtkSetMacro(PivotRMSE, double);
   vtkSetMacro(SpinRMSE, double);
 
@@ -255,12 +454,25 @@ private:
   // Calibration inputs
   vtkMRMLTransformNode* ObservedTransformNode{ nullptr };
   bool RecordingState{ false };
+  bool ToolPoseBatchProcessingEnabled{ false };
+  int RecordingDecimationFactor{ 1 };
+  double RecordingMaximumRateHz{ 0.0 };
 
   // Calibration results
   vtkMatrix4x4* ToolTipToToolMatrix;
   double PivotRMSE{ -1.0 };
   double SpinRMSE{ -1.0 };
   std::string ErrorText;
+  int PivotNumberOfInliers{ 0 };
+  int SpinNumberOfInliers{ 0 };
+  int PivotNumberOfEvaluatedHypotheses{ 0 };
+  int SpinNumberOfEvaluatedHypotheses{ 0 };
+
+  // Pivot calibration quality metrics
+  double PivotLatestPoseResidualMm{ -1.0 };
+  double PivotConditionNumber{ -1.0 };
+  double PivotOrientationSpreadDegrees{ -1.0 };
+  double PivotToolTipUncertaintyMm{ -1.0 };
 
   // Pivot/spin enabled flags
   bool   PivotCalibrationEnabled{ true };
@@ -271,12 +483,25 @@ private:
   double PivotAutoCalibrationTargetError{ 3.0 };
   int    PivotAutoCalibrationTargetNumberOfPoints{ 100 };
   bool   PivotAutoCalibrationStopWhenComplete{ false };
+  bool   PivotIncrementalCalibrationEnabled{ false };
+  double PivotAutoCalibrationTargetToolTipUncertaintyMm{ 0.0 };
 
   // Spin auto-calibration settings
   bool   SpinAutoCalibrationEnabled{ false };
   double SpinAutoCalibrationTargetError{ 0.01 };
   int    SpinAutoCalibrationTargetNumberOfPoints{ 100 };
   bool   SpinAutoCalibrationStopWhenComplete{ false };
+
+  // Pose buffer settings
+  int    PivotMaximumNumberOfPoseBuckets{ 10 };
+  int    SpinMaximumNumberOfPoseBuckets{ 10 };
+
+  // Robust calibration settings
+  int    RobustMaximumNumberOfHypotheses{ 500 };
+  double RobustConfidence{ 0.99 };
+  int    RobustRandomSeed{ 12345 };
+  double PivotRobustInlierThresholdMm{ 2.0 };
+  double SpinRobustInlierThreshold{ 0.05 };
 };
 
 #endif
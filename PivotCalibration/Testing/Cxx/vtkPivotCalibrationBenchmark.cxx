@@ -0,0 +1,396 @@
+/*==============================================================================
+
+Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+==============================================================================*/
+
+// Benchmark and regression test of pivot and spin calibration.
+// Synthetic pivot and spin motions are generated with known tool tip position and shaft direction,
+// with optional noise and outliers. Reports latency and accuracy (compared to ground truth) of
+// ComputePivotCalibration, ComputePivotCalibrationRobust, ComputeSpinCalibration and of the automatic
+// calibration through AddToolToReferenceMatrix, for increasing number of poses.
+// Fails if the error of the robust calibration, or of any calibration of poses without outliers, is larger than expected.
+//
+// Usage: vtkPivotCalibrationBenchmark [maximumNumberOfPoses]
+// Number of poses is increased from 100 by a factor of 10 up to the maximum (default: 10000,
+// use 100000 for the full range).
+
+// SlicerIGT includes
+#include <vtkSlicerPivotCalibrationLogic.h>
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  const int DEFAULT_MAXIMUM_NUMBER_OF_POSES = 10000;
+  const int POSE_BUCKET_SIZE = 100;
+
+  // Expected accuracy
+  const double MAXIMUM_EXACT_TOOL_TIP_ERROR_MM = 1.0e-3;
+  const double MAXIMUM_EXACT_SHAFT_ERROR_DEGREES = 1.0e-3;
+  const double MAXIMUM_NOISY_TOOL_TIP_ERROR_MM = 2.0;
+  const double MAXIMUM_NOISY_SHAFT_ERROR_DEGREES = 2.0;
+
+  // Ground truth
+  const double TOOL_TIP_POSITION_TOOL[3] = { 5.0, 12.6, -150.3 };
+  const double PIVOT_POSITION_REFERENCE[3] = { 20.0, -35.0, 80.0 };
+
+  struct Scenario
+  {
+    const char* Name;
+    double PositionNoiseMm;
+    double OrientationNoiseDegrees;
+    // Every N-th pose is an outlier (0 = no outliers)
+    int OutlierInterval;
+    double OutlierOffsetMm;
+    // Outliers are also tilted, so that they are outliers for spin calibration, too
+    double OutlierRotationDegrees;
+  };
+
+  const Scenario SCENARIOS[] =
+  {
+    { "exact", 0.0, 0.0, 0, 0.0, 0.0 },
+    { "noise", 0.5, 0.5, 0, 0.0, 0.0 },
+    { "noise+outliers", 0.5, 0.5, 20, 20.0, 20.0 },
+  };
+
+  //----------------------------------------------------------------------------
+  void AddNoise(vtkTransform* toolToReferenceTransform, const Scenario& scenario, int poseIndex, vtkMinimalStandardRandomSequence* random)
+  {
+    double translation[3] = { 0.0, 0.0, 0.0 };
+    for (int i = 0; i < 3; i++)
+    {
+      translation[i] = random->GetNextRangeValue(-scenario.PositionNoiseMm, scenario.PositionNoiseMm);
+    }
+    double outlierRotationAxis[3] = { 0.0, 0.0, 0.0 };
+    bool outlier = (scenario.OutlierInterval > 0 && poseIndex % scenario.OutlierInterval == scenario.OutlierInterval - 1);
+    if (outlier)
+    {
+      double outlierDirection[3] = { random->GetNextRangeValue(-1.0, 1.0), random->GetNextRangeValue(-1.0, 1.0), 1.0 };
+      vtkMath::Normalize(outlierDirection);
+      for (int i = 0; i < 3; i++)
+      {
+        translation[i] += scenario.OutlierOffsetMm * outlierDirection[i];
+      }
+      // Rotation axis is perpendicular to the shaft, so that the rotation changes the shaft direction
+      vtkMath::Cross(outlierDirection, TOOL_TIP_POSITION_TOOL, outlierRotationAxis);
+    }
+    double rotationAxis[3] = { random->GetNextRangeValue(-1.0, 1.0), random->GetNextRangeValue(-1.0, 1.0), random->GetNextRangeValue(-1.0, 1.0) };
+    double rotationAngleDegrees = random->GetNextRangeValue(-scenario.OrientationNoiseDegrees, scenario.OrientationNoiseDegrees);
+
+    // Position noise is applied in the reference coordinate system, orientation noise in the tool coordinate system
+    toolToReferenceTransform->PostMultiply();
+    toolToReferenceTransform->Translate(translation);
+    toolToReferenceTransform->PreMultiply();
+    if (vtkMath::Norm(rotationAxis) > 1e-6)
+    {
+      toolToReferenceTransform->RotateWXYZ(rotationAngleDegrees, rotationAxis);
+    }
+    if (outlier && vtkMath::Norm(outlierRotationAxis) > 1e-6)
+    {
+      toolToReferenceTransform->RotateWXYZ(scenario.OutlierRotationDegrees, outlierRotationAxis);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Tool is rotated around its tip, which stays at the pivot point
+  void GeneratePivotPoses(const Scenario& scenario, int numberOfPoses, std::vector<vtkSmartPointer<vtkMatrix4x4> >& poses)
+  {
+    vtkNew<vtkMinimalStandardRandomSequence> random;
+    random->SetSeed(1234);
+    poses.clear();
+    for (int poseIndex = 0; poseIndex < numberOfPoses; poseIndex++)
+    {
+      vtkNew<vtkTransform> toolToReferenceTransform;
+      toolToReferenceTransform->Translate(PIVOT_POSITION_REFERENCE);
+      toolToReferenceTransform->RotateX(random->GetNextRangeValue(-40.0, 40.0));
+      toolToReferenceTransform->RotateY(random->GetNextRangeValue(-40.0, 40.0));
+      toolToReferenceTransform->RotateZ(random->GetNextRangeValue(-180.0, 180.0));
+      toolToReferenceTransform->Translate(-TOOL_TIP_POSITION_TOOL[0], -TOOL_TIP_POSITION_TOOL[1], -TOOL_TIP_POSITION_TOOL[2]);
+      AddNoise(toolToReferenceTransform, scenario, poseIndex, random);
+      vtkSmartPointer<vtkMatrix4x4> pose = vtkSmartPointer<vtkMatrix4x4>::New();
+      pose->DeepCopy(toolToReferenceTransform->GetMatrix());
+      poses.push_back(pose);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Tool is rotated around its shaft (line between the tool origin and the tool tip)
+  void GenerateSpinPoses(const Scenario& scenario, int numberOfPoses, std::vector<vtkSmartPointer<vtkMatrix4x4> >& poses)
+  {
+    vtkNew<vtkMinimalStandardRandomSequence> random;
+    random->SetSeed(5678);
+    poses.clear();
+    for (int poseIndex = 0; poseIndex < numberOfPoses; poseIndex++)
+    {
+      vtkNew<vtkTransform> toolToReferenceTransform;
+      toolToReferenceTransform->Translate(PIVOT_POSITION_REFERENCE);
+      toolToReferenceTransform->RotateX(30.0);
+      toolToReferenceTransform->RotateWXYZ(random->GetNextRangeValue(0.0, 360.0), TOOL_TIP_POSITION_TOOL);
+      toolToReferenceTransform->Translate(-TOOL_TIP_POSITION_TOOL[0], -TOOL_TIP_POSITION_TOOL[1], -TOOL_TIP_POSITION_TOOL[2]);
+      AddNoise(toolToReferenceTransform, scenario, poseIndex, random);
+      vtkSmartPointer<vtkMatrix4x4> pose = vtkSmartPointer<vtkMatrix4x4>::New();
+      pose->DeepCopy(toolToReferenceTransform->GetMatrix());
+      poses.push_back(pose);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void ConfigureLogic(vtkSlicerPivotCalibrationLogic* logic, int numberOfPoses)
+  {
+    // Keep all poses in the buffer and do not discard any of them while they are added
+    int numberOfPoseBuckets = std::max(1, (numberOfPoses + POSE_BUCKET_SIZE - 1) / POSE_BUCKET_SIZE);
+    logic->SetPivotPoseBucketSize(POSE_BUCKET_SIZE);
+    logic->SetPivotMaximumNumberOfPoseBuckets(numberOfPoseBuckets);
+    logic->SetPivotMaximumPoseBucketError(VTK_DOUBLE_MAX);
+    logic->SetPivotPositionDifferenceThresholdMm(0.0);
+    logic->SetPivotOrientationDifferenceThresholdDegrees(0.0);
+    logic->SetSpinPoseBucketSize(POSE_BUCKET_SIZE);
+    logic->SetSpinMaximumNumberOfPoseBuckets(numberOfPoseBuckets);
+    logic->SetSpinMaximumPoseBucketError(VTK_DOUBLE_MAX);
+    logic->SetSpinPositionDifferenceThresholdMm(0.0);
+    logic->SetSpinOrientationDifferenceThresholdDegrees(0.0);
+    logic->SetPivotAutoCalibrationEnabled(false);
+    logic->SetSpinAutoCalibrationEnabled(false);
+    logic->SetPivotIncrementalCalibrationEnabled(false);
+    logic->ClearToolToReferenceMatrices();
+  }
+
+  //----------------------------------------------------------------------------
+  void AddPoses(vtkSlicerPivotCalibrationLogic* logic, const std::vector<vtkSmartPointer<vtkMatrix4x4> >& poses)
+  {
+    for (vtkMatrix4x4* pose : poses)
+    {
+      logic->AddToolToReferenceMatrix(pose);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  double GetToolTipError(vtkSlicerPivotCalibrationLogic* logic)
+  {
+    vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+    logic->GetToolTipToToolMatrix(toolTipToToolMatrix);
+    double toolTipPosition_Tool[3] =
+      { toolTipToToolMatrix->GetElement(0, 3), toolTipToToolMatrix->GetElement(1, 3), toolTipToToolMatrix->GetElement(2, 3) };
+    return std::sqrt(vtkMath::Distance2BetweenPoints(toolTipPosition_Tool, TOOL_TIP_POSITION_TOOL));
+  }
+
+  //----------------------------------------------------------------------------
+  double GetShaftDirectionErrorDegrees(vtkSlicerPivotCalibrationLogic* logic)
+  {
+    vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+    logic->GetToolTipToToolMatrix(toolTipToToolMatrix);
+    double shaftDirection_Tool[3] =
+      { toolTipToToolMatrix->GetElement(0, 2), toolTipToToolMatrix->GetElement(1, 2), toolTipToToolMatrix->GetElement(2, 2) };
+    double expectedShaftDirection_Tool[3] = { TOOL_TIP_POSITION_TOOL[0], TOOL_TIP_POSITION_TOOL[1], TOOL_TIP_POSITION_TOOL[2] };
+    vtkMath::Normalize(expectedShaftDirection_Tool);
+    // Direction of the shaft axis is not checked
+    double cosAngle = std::min(1.0, std::abs(vtkMath::Dot(shaftDirection_Tool, expectedShaftDirection_Tool)));
+    return vtkMath::DegreesFromRadians(std::acos(cosAngle));
+  }
+
+  //----------------------------------------------------------------------------
+  void PrintResult(const Scenario& scenario, int numberOfPoses, const char* method, double timeSec, bool success,
+    double error, const char* errorUnit, double rmse)
+  {
+    std::cout << std::left << std::setw(16) << scenario.Name << std::right << std::setw(8) << numberOfPoses
+      << "  " << std::left << std::setw(32) << method << std::right << std::fixed
+      << std::setprecision(3) << std::setw(12) << timeSec * 1000.0 << " ms";
+    if (success)
+    {
+      std::cout << std::setprecision(6) << std::setw(14) << error << " " << std::left << std::setw(4) << errorUnit
+        << std::right << " RMSE: " << rmse << std::endl;
+    }
+    else
+    {
+      std::cout << "  failed" << std::endl;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  bool CheckError(const Scenario& scenario, const char* method, bool success, double error, double maximumExactError, double maximumNoisyError)
+  {
+    double maximumError = (scenario.PositionNoiseMm > 0.0 || scenario.OrientationNoiseDegrees > 0.0) ? maximumNoisyError : maximumExactError;
+    if (!success || error > maximumError)
+    {
+      std::cerr << scenario.Name << " " << method << ": calibration failed or error (" << error << ") is larger than " << maximumError << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  bool RunPivotBenchmark(vtkSlicerPivotCalibrationLogic* logic, const Scenario& scenario, int numberOfPoses)
+  {
+    std::vector<vtkSmartPointer<vtkMatrix4x4> > poses;
+    GeneratePivotPoses(scenario, numberOfPoses, poses);
+    bool testSuccess = true;
+    vtkNew<vtkTimerLog> timer;
+
+    // Batch calibration
+    ConfigureLogic(logic, numberOfPoses);
+    logic->SetSpinCalibrationEnabled(false);
+    logic->SetPivotCalibrationEnabled(true);
+    AddPoses(logic, poses);
+    timer->StartTimer();
+    bool success = logic->ComputePivotCalibration();
+    timer->StopTimer();
+    double error = GetToolTipError(logic);
+    PrintResult(scenario, numberOfPoses, "ComputePivotCalibration", timer->GetElapsedTime(), success, error, "mm", logic->GetPivotRMSE());
+    if (scenario.OutlierInterval == 0)
+    {
+      testSuccess &= CheckError(scenario, "ComputePivotCalibration", success, error, MAXIMUM_EXACT_TOOL_TIP_ERROR_MM, MAXIMUM_NOISY_TOOL_TIP_ERROR_MM);
+    }
+
+    timer->StartTimer();
+    success = logic->ComputePivotCalibrationRobust();
+    timer->StopTimer();
+    error = GetToolTipError(logic);
+    PrintResult(scenario, numberOfPoses, "ComputePivotCalibrationRobust", timer->GetElapsedTime(), success, error, "mm", logic->GetPivotRMSE());
+    testSuccess &= CheckError(scenario, "ComputePivotCalibrationRobust", success, error, MAXIMUM_EXACT_TOOL_TIP_ERROR_MM, MAXIMUM_NOISY_TOOL_TIP_ERROR_MM);
+
+    // Automatic calibration when the target number of poses is reached, full and incremental
+    for (int incremental = 0; incremental < 2; incremental++)
+    {
+      ConfigureLogic(logic, numberOfPoses);
+      logic->SetSpinCalibrationEnabled(false);
+      logic->SetPivotCalibrationEnabled(true);
+      logic->SetPivotAutoCalibrationTargetNumberOfPoints(numberOfPoses);
+      logic->SetPivotAutoCalibrationTargetError(VTK_DOUBLE_MAX);
+      logic->SetPivotAutoCalibrationEnabled(true);
+      logic->SetPivotIncrementalCalibrationEnabled(incremental != 0);
+      timer->StartTimer();
+      AddPoses(logic, poses);
+      timer->StopTimer();
+      const char* method = (incremental ? "AddToolToReferenceMatrix (incr.)" : "AddToolToReferenceMatrix");
+      success = (logic->GetPivotRMSE() >= 0.0);
+      error = GetToolTipError(logic);
+      PrintResult(scenario, numberOfPoses, method, timer->GetElapsedTime(), success, error, "mm", logic->GetPivotRMSE());
+      if (scenario.OutlierInterval == 0)
+      {
+        testSuccess &= CheckError(scenario, method, success, error, MAXIMUM_EXACT_TOOL_TIP_ERROR_MM, MAXIMUM_NOISY_TOOL_TIP_ERROR_MM);
+      }
+    }
+    logic->SetPivotAutoCalibrationEnabled(false);
+    logic->SetPivotIncrementalCalibrationEnabled(false);
+
+    return testSuccess;
+  }
+
+  //----------------------------------------------------------------------------
+  bool RunSpinBenchmark(vtkSlicerPivotCalibrationLogic* logic, const Scenario& scenario, int numberOfPoses)
+  {
+    std::vector<vtkSmartPointer<vtkMatrix4x4> > poses;
+    GenerateSpinPoses(scenario, numberOfPoses, poses);
+    bool testSuccess = true;
+    vtkNew<vtkTimerLog> timer;
+
+    // Batch calibration
+    ConfigureLogic(logic, numberOfPoses);
+    logic->SetPivotCalibrationEnabled(false);
+    logic->SetSpinCalibrationEnabled(true);
+    AddPoses(logic, poses);
+    timer->StartTimer();
+    bool success = logic->ComputeSpinCalibration();
+    timer->StopTimer();
+    double error = GetShaftDirectionErrorDegrees(logic);
+    PrintResult(scenario, numberOfPoses, "ComputeSpinCalibration", timer->GetElapsedTime(), success, error, "deg", logic->GetSpinRMSE());
+    if (scenario.OutlierInterval == 0)
+    {
+      testSuccess &= CheckError(scenario, "ComputeSpinCalibration", success, error, MAXIMUM_EXACT_SHAFT_ERROR_DEGREES, MAXIMUM_NOISY_SHAFT_ERROR_DEGREES);
+    }
+
+    timer->StartTimer();
+    success = logic->ComputeSpinCalibrationRobust();
+    timer->StopTimer();
+    error = GetShaftDirectionErrorDegrees(logic);
+    PrintResult(scenario, numberOfPoses, "ComputeSpinCalibrationRobust", timer->GetElapsedTime(), success, error, "deg", logic->GetSpinRMSE());
+    testSuccess &= CheckError(scenario, "ComputeSpinCalibrationRobust", success, error, MAXIMUM_EXACT_SHAFT_ERROR_DEGREES, MAXIMUM_NOISY_SHAFT_ERROR_DEGREES);
+
+    // Automatic calibration when the target number of poses is reached
+    ConfigureLogic(logic, numberOfPoses);
+    logic->SetPivotCalibrationEnabled(false);
+    logic->SetSpinCalibrationEnabled(true);
+    logic->SetSpinAutoCalibrationTargetNumberOfPoints(numberOfPoses);
+    logic->SetSpinAutoCalibrationTargetError(VTK_DOUBLE_MAX);
+    logic->SetSpinAutoCalibrationEnabled(true);
+    timer->StartTimer();
+    AddPoses(logic, poses);
+    timer->StopTimer();
+    success = (logic->GetSpinRMSE() >= 0.0);
+    error = GetShaftDirectionErrorDegrees(logic);
+    PrintResult(scenario, numberOfPoses, "AddToolToReferenceMatrix", timer->GetElapsedTime(), success, error, "deg", logic->GetSpinRMSE());
+    if (scenario.OutlierInterval == 0)
+    {
+      testSuccess &= CheckError(scenario, "AddToolToReferenceMatrix", success, error, MAXIMUM_EXACT_SHAFT_ERROR_DEGREES, MAXIMUM_NOISY_SHAFT_ERROR_DEGREES);
+    }
+    logic->SetSpinAutoCalibrationEnabled(false);
+
+    return testSuccess;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkPivotCalibrationBenchmark(int argc, char* argv[])
+{
+  int maximumNumberOfPoses = DEFAULT_MAXIMUM_NUMBER_OF_POSES;
+  if (argc > 1)
+  {
+    maximumNumberOfPoses = atoi(argv[1]);
+    if (maximumNumberOfPoses < 100)
+    {
+      std::cerr << "Invalid maximum number of poses: " << argv[1] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  vtkNew<vtkSlicerPivotCalibrationLogic> logic;
+  bool success = true;
+
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Pivot calibration (tool tip position error)" << std::endl;
+  for (const Scenario& scenario : SCENARIOS)
+  {
+    for (int numberOfPoses = 100; numberOfPoses <= maximumNumberOfPoses; numberOfPoses *= 10)
+    {
+      success &= RunPivotBenchmark(logic, scenario, numberOfPoses);
+    }
+  }
+
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Spin calibration (shaft direction error)" << std::endl;
+  for (const Scenario& scenario : SCENARIOS)
+  {
+    for (int numberOfPoses = 100; numberOfPoses <= maximumNumberOfPoses; numberOfPoses *= 10)
+    {
+      success &= RunSpinBenchmark(logic, scenario, numberOfPoses);
+    }
+  }
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -23,11 +23,20 @@ Care Ontario.
 
 // Slicer MRML includes
 #include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLScene.h>
 
+// Sequences MRML includes
+#include <vtkMRMLSequenceNode.h>
+
 // VTK includes
+#include <vtkCallbackCommand.h>
 #include <vtkMinimalStandardRandomSequence.h>
 #include <vtkTransform.h>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <set>
 
 int NUMBER_OF_POINTS = 100;
 double epsilon = 1.0e-6;
@@ -180,27 +189,1179 @@ bool TestSpinCalibration(vtkSlicerPivotCalibrationLogic* logic, vtkMRMLTransform
 }
 
 //----------------------------------------------------------------------------
-int vtkPivotCalibrationTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+bool TestIncrementalPivotCalibration(vtkSlicerPivotCalibrationLogic* logic, vtkMRMLTransformNode* markerToReferenceTransform)
 {
-  vtkNew<vtkMRMLScene> scene;
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting incremental pivot calibration test..." << std::endl;
 
-  vtkNew<vtkMRMLTransformNode> markerToReferenceTransform;
-  scene->AddNode(markerToReferenceTransform);
+  logic->ClearToolToReferenceMatrices();
 
-  vtkNew<vtkSlicerPivotCalibrationLogic> logic;
-  logic->SetMRMLScene(scene);
-  logic->SetAndObserveTransformNode(markerToReferenceTransform);
+  double expectedToolTipPosition_Marker[3] = { 5.0, 12.6, 3.3 };
 
-  double pivotErrorsMm[4] = { 0.0, 0.1, 1.0, 10.0 };
-  for (double pivotErrorMm : pivotErrorsMm)
+  vtkNew<vtkTransform> startTransform;
+  startTransform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+  markerToReferenceTransform->SetAndObserveTransformToParent(startTransform);
+
+  vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+  logic->SetRecordingState(true);
+  for (int i = 0; i < NUMBER_OF_POINTS; ++i)
   {
-    if (!TestPivotCalibration(logic, markerToReferenceTransform, pivotErrorMm))
+    vtkNew<vtkTransform> transform;
+    transform->DeepCopy(startTransform);
+    transform->Translate(expectedToolTipPosition_Marker);
+    transform->RotateX(double(i) / NUMBER_OF_POINTS * 90.0);
+    transform->RotateY(double(i) / NUMBER_OF_POINTS * 90.0);
+    transform->RotateZ(double(i) / NUMBER_OF_POINTS * 90.0);
+    transform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+    markerToReferenceTransform->SetAndObserveTransformToParent(transform);
+
+    if (i == NUMBER_OF_POINTS / 2)
     {
-      return EXIT_FAILURE;
+      // First computation is a full calibration, subsequent ones are incremental
+      if (!logic->ComputePivotCalibrationIncremental())
+      {
+        std::cerr << "Could not compute initial incremental pivot calibration: " << logic->GetErrorText() << std::endl;
+        return false;
+      }
     }
   }
+  logic->SetRecordingState(false);
 
-  if (!TestSpinCalibration(logic, markerToReferenceTransform))
+  std::vector<double> livePoseResiduals;
+  logic->GetPivotLivePoseResiduals(livePoseResiduals);
+  std::cout << "Condition number: " << logic->GetPivotConditionNumber()
+    << ", orientation spread: " << logic->GetPivotOrientationSpreadDegrees() << " deg"
+    << ", tool tip uncertainty: " << logic->GetPivotToolTipUncertaintyMm() << " mm" << std::endl;
+  if (static_cast<int>(livePoseResiduals.size()) != logic->GetPivotNumberOfPoses()
+    || logic->GetPivotLatestPoseResidualMm() < 0.0 || logic->GetPivotLatestPoseResidualMm() >= epsilon
+    || logic->GetPivotConditionNumber() < 1.0 || logic->GetPivotConditionNumber() >= VTK_DOUBLE_MAX
+    || logic->GetPivotOrientationSpreadDegrees() <= 10.0
+    || logic->GetPivotToolTipUncertaintyMm() < 0.0 || logic->GetPivotToolTipUncertaintyMm() >= epsilon)
+  {
+    std::cerr << "Pivot calibration quality metrics are different than expected" << std::endl;
+    return false;
+  }
+
+  // The incremental calibration must orient the shaft the same way as the full calibration
+  logic->FlipShaftDirection();
+  if (!logic->ComputePivotCalibrationIncremental())
+  {
+    std::cerr << "Could not compute incremental pivot calibration: " << logic->GetErrorText() << std::endl;
+    return false;
+  }
+  if (logic->GetPivotRMSE() >= epsilon)
+  {
+    std::cerr << "Incremental pivot calibration error is too large: " << logic->GetPivotRMSE() << std::endl;
+    return false;
+  }
+  vtkNew<vtkMatrix4x4> incrementalToolTipToToolMatrix;
+  logic->GetToolTipToToolMatrix(incrementalToolTipToToolMatrix);
+  double incrementalToolTipPosition_Marker[3] = { incrementalToolTipToToolMatrix->GetElement(0, 3),
+    incrementalToolTipToToolMatrix->GetElement(1, 3), incrementalToolTipToToolMatrix->GetElement(2, 3) };
+
+  if (!logic->ComputePivotCalibration())
+  {
+    std::cerr << "Could not compute pivot calibration: " << logic->GetErrorText() << std::endl;
+    return false;
+  }
+  logic->GetToolTipToToolMatrix(toolTipToToolMatrix);
+  double fullToolTipPosition_Marker[3] =
+    { toolTipToToolMatrix->GetElement(0, 3), toolTipToToolMatrix->GetElement(1, 3), toolTipToToolMatrix->GetElement(2, 3) };
+  for (int row = 0; row < 3; row++)
+  {
+    for (int column = 0; column < 3; column++)
+    {
+      if (std::abs(incrementalToolTipToToolMatrix->GetElement(row, column) - toolTipToToolMatrix->GetElement(row, column)) >= epsilon)
+      {
+        std::cerr << "Incremental tool tip orientation is different from the full calibration" << std::endl;
+        return false;
+      }
+    }
+  }
+
+  double distanceBetweenIncrementalAndFullToolTipPosition =
+    std::sqrt(vtkMath::Distance2BetweenPoints(incrementalToolTipPosition_Marker, fullToolTipPosition_Marker));
+  double distanceBetweenIncrementalAndExpectedToolTipPosition =
+    std::sqrt(vtkMath::Distance2BetweenPoints(incrementalToolTipPosition_Marker, expectedToolTipPosition_Marker));
+  std::cout << "Difference from full calibration: " << distanceBetweenIncrementalAndFullToolTipPosition << " mm" << std::endl;
+  std::cout << "Position error: " << distanceBetweenIncrementalAndExpectedToolTipPosition << " mm" << std::endl;
+  if (distanceBetweenIncrementalAndFullToolTipPosition >= epsilon || distanceBetweenIncrementalAndExpectedToolTipPosition >= epsilon)
+  {
+    std::cerr << "Incremental tool tip position is different than expected" << std::endl;
+    return false;
+  }
+
+  std::cout << "Incremental pivot calibration completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Pose rotated randomly around the pivot point, which is offset randomly by up to pivotErrorMm from the origin
+void GetRandomPivotPose(vtkMinimalStandardRandomSequence* randomSequence, const double toolTipPosition_Marker[3],
+  double pivotErrorMm, vtkMatrix4x4* markerToReferenceMatrix)
+{
+  vtkNew<vtkTransform> transform;
+  transform->Translate((2.0 * randomSequence->GetNextValue() - 1.0) * pivotErrorMm,
+    (2.0 * randomSequence->GetNextValue() - 1.0) * pivotErrorMm, (2.0 * randomSequence->GetNextValue() - 1.0) * pivotErrorMm);
+  transform->RotateX((2.0 * randomSequence->GetNextValue() - 1.0) * 40.0);
+  transform->RotateY((2.0 * randomSequence->GetNextValue() - 1.0) * 40.0);
+  transform->RotateZ((2.0 * randomSequence->GetNextValue() - 1.0) * 40.0);
+  transform->Translate(-toolTipPosition_Marker[0], -toolTipPosition_Marker[1], -toolTipPosition_Marker[2]);
+  markerToReferenceMatrix->DeepCopy(transform->GetMatrix());
+}
+
+//----------------------------------------------------------------------------
+// Fill the pose buffer past the maximum number of pose buckets, with pose bucket validation enabled
+// (an erroneous bucket is discarded from the end, the oldest buckets are discarded from the beginning).
+// Incremental calibration must use the same poses as the full calibration.
+bool TestPivotPoseBuffer(vtkSlicerPivotCalibrationLogic* logic)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting pivot pose buffer test..." << std::endl;
+
+  const int poseBucketSize = 5;
+  const int maximumNumberOfPoseBuckets = 4;
+  int originalPoseBucketSize = logic->GetPivotPoseBucketSize();
+  int originalMaximumNumberOfPoseBuckets = logic->GetPivotMaximumNumberOfPoseBuckets();
+  double originalPositionDifferenceThresholdMm = logic->GetPivotPositionDifferenceThresholdMm();
+  double originalOrientationDifferenceThresholdDegrees = logic->GetPivotOrientationDifferenceThresholdDegrees();
+  int targetNumberOfPoints = logic->GetPivotAutoCalibrationTargetNumberOfPoints();
+  logic->ClearToolToReferenceMatrices();
+  logic->SetPivotPoseBucketSize(poseBucketSize);
+  logic->SetPivotMaximumNumberOfPoseBuckets(maximumNumberOfPoseBuckets);
+  logic->SetPivotPositionDifferenceThresholdMm(0.0);
+  logic->SetPivotOrientationDifferenceThresholdDegrees(0.0);
+  // Auto-calibration enables pose bucket validation, calibration is not triggered by the number of poses
+  logic->SetPivotAutoCalibrationTargetNumberOfPoints(10 * NUMBER_OF_POINTS);
+  logic->SetPivotIncrementalCalibrationEnabled(true);
+  logic->SetPivotAutoCalibrationEnabled(true);
+
+  double expectedToolTipPosition_Marker[3] = { 5.0, 12.6, 3.3 };
+  vtkNew<vtkMinimalStandardRandomSequence> randomSequence;
+  randomSequence->SetSeed(12345);
+  vtkNew<vtkMatrix4x4> markerToReferenceMatrix;
+  // 3 valid buckets, 1 erroneous bucket that is discarded, then 12 valid poses:
+  // the oldest buckets are discarded when the 5th bucket is started, 17 poses remain.
+  const int numberOfPoses[3] = { 3 * poseBucketSize, poseBucketSize, 12 };
+  const double pivotErrorsMm[3] = { 0.0, 20.0, 0.0 };
+  for (int part = 0; part < 3; part++)
+  {
+    for (int i = 0; i < numberOfPoses[part]; i++)
+    {
+      GetRandomPivotPose(randomSequence, expectedToolTipPosition_Marker, pivotErrorsMm[part], markerToReferenceMatrix);
+      logic->AddToolToReferenceMatrix(markerToReferenceMatrix);
+    }
+  }
+
+  bool success = true;
+  if (logic->GetPivotNumberOfPoses() != 17)
+  {
+    std::cerr << "Number of poses mismatch. Expected: 17, actual: " << logic->GetPivotNumberOfPoses() << std::endl;
+    success = false;
+  }
+
+  // First computation is a full calibration (poses were discarded), the next one is incremental
+  if (success && !logic->ComputePivotCalibrationIncremental())
+  {
+    std::cerr << "Could not compute initial incremental pivot calibration: " << logic->GetErrorText() << std::endl;
+    success = false;
+  }
+  for (int i = 0; success && i < 2; i++)
+  {
+    GetRandomPivotPose(randomSequence, expectedToolTipPosition_Marker, 0.0, markerToReferenceMatrix);
+    logic->AddToolToReferenceMatrix(markerToReferenceMatrix);
+  }
+  if (success && !logic->ComputePivotCalibrationIncremental())
+  {
+    std::cerr << "Could not compute incremental pivot calibration: " << logic->GetErrorText() << std::endl;
+    success = false;
+  }
+  vtkNew<vtkMatrix4x4> incrementalToolTipToToolMatrix;
+  logic->GetToolTipToToolMatrix(incrementalToolTipToToolMatrix);
+  double incrementalRmseMm = logic->GetPivotRMSE();
+
+  std::vector<double> livePoseResiduals;
+  logic->GetPivotLivePoseResiduals(livePoseResiduals);
+  if (success && (logic->GetPivotNumberOfPoses() != 19 || static_cast<int>(livePoseResiduals.size()) != 19))
+  {
+    std::cerr << "Number of poses mismatch. Expected: 19, actual: " << logic->GetPivotNumberOfPoses()
+      << " (" << livePoseResiduals.size() << " live pose residuals)" << std::endl;
+    success = false;
+  }
+
+  vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+  if (success && !logic->ComputePivotCalibration())
+  {
+    std::cerr << "Could not compute pivot calibration: " << logic->GetErrorText() << std::endl;
+    success = false;
+  }
+  logic->GetToolTipToToolMatrix(toolTipToToolMatrix);
+  std::cout << "Incremental RMSE: " << incrementalRmseMm << " mm, full RMSE: " << logic->GetPivotRMSE() << " mm" << std::endl;
+  if (success && (std::abs(incrementalRmseMm - logic->GetPivotRMSE()) >= epsilon || logic->GetPivotRMSE() >= epsilon))
+  {
+    // A non-zero error means that poses of the erroneous bucket were used
+    std::cerr << "Pivot calibration error is different than expected" << std::endl;
+    success = false;
+  }
+  for (int row = 0; success && row < 3; row++)
+  {
+    for (int column = 0; column < 4; column++)
+    {
+      if (std::abs(incrementalToolTipToToolMatrix->GetElement(row, column) - toolTipToToolMatrix->GetElement(row, column)) >= epsilon)
+      {
+        std::cerr << "Incremental tool tip to tool transform is different from the full calibration" << std::endl;
+        success = false;
+        break;
+      }
+    }
+  }
+
+  logic->SetPivotAutoCalibrationEnabled(false);
+  logic->SetPivotIncrementalCalibrationEnabled(false);
+  logic->SetPivotAutoCalibrationTargetNumberOfPoints(targetNumberOfPoints);
+  logic->SetPivotPoseBucketSize(originalPoseBucketSize);
+  logic->SetPivotMaximumNumberOfPoseBuckets(originalMaximumNumberOfPoseBuckets);
+  logic->SetPivotPositionDifferenceThresholdMm(originalPositionDifferenceThresholdMm);
+  logic->SetPivotOrientationDifferenceThresholdDegrees(originalOrientationDifferenceThresholdDegrees);
+  logic->ClearToolToReferenceMatrices();
+  if (!success)
+  {
+    return false;
+  }
+
+  std::cout << "Pivot pose buffer test completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestPivotCalibrationConvergence(vtkSlicerPivotCalibrationLogic* logic, vtkMRMLTransformNode* markerToReferenceTransform)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting pivot calibration convergence test..." << std::endl;
+
+  double expectedToolTipPosition_Marker[3] = { 5.0, 12.6, 3.3 };
+  double positionErrorMm = 0.1;
+  bool spinCalibrationEnabled = logic->GetSpinCalibrationEnabled();
+  int targetNumberOfPoints = logic->GetPivotAutoCalibrationTargetNumberOfPoints();
+  double targetError = logic->GetPivotAutoCalibrationTargetError();
+  logic->SetSpinCalibrationEnabled(false);
+
+  // Record the same noisy poses in each pass
+  auto recordPoses = [&]()
+  {
+    vtkNew<vtkMinimalStandardRandomSequence> randomSequence;
+    randomSequence->SetSeed(12345);
+    std::vector<double> toolTipUncertaintiesMm;
+    logic->SetRecordingState(true);
+    for (int i = 0; i < NUMBER_OF_POINTS; ++i)
+    {
+      double errorOffset[3] = { 0.0, 0.0, 0.0 };
+      for (int axis = 0; axis < 3; axis++)
+      {
+        errorOffset[axis] = (2.0 * randomSequence->GetNextValue() - 1.0) * positionErrorMm;
+      }
+      vtkNew<vtkTransform> transform;
+      transform->Translate(expectedToolTipPosition_Marker);
+      transform->RotateX(double(i) / NUMBER_OF_POINTS * 90.0);
+      transform->RotateY(double(i) / NUMBER_OF_POINTS * 90.0);
+      transform->RotateZ(double(i) / NUMBER_OF_POINTS * 90.0);
+      transform->Translate(errorOffset[0] - expectedToolTipPosition_Marker[0], errorOffset[1] - expectedToolTipPosition_Marker[1], errorOffset[2] - expectedToolTipPosition_Marker[2]);
+      markerToReferenceTransform->SetAndObserveTransformToParent(transform);
+      toolTipUncertaintiesMm.push_back(logic->GetPivotToolTipUncertaintyMm());
+    }
+    logic->SetRecordingState(false);
+    return toolTipUncertaintiesMm;
+  };
+
+  // Without a target uncertainty the calibration never converges
+  logic->ClearToolToReferenceMatrices();
+  logic->SetPivotAutoCalibrationTargetToolTipUncertaintyMm(0.0);
+  std::vector<double> toolTipUncertaintiesMm = recordPoses();
+  int numberOfPosesWithoutAutoCalibration = logic->GetPivotNumberOfPoses();
+  if (logic->IsPivotCalibrationConverged())
+  {
+    std::cerr << "Pivot calibration is converged without a target tool tip uncertainty" << std::endl;
+    return false;
+  }
+
+  // The uncertainty decreases as poses are added. Use the uncertainty after 3/4 of the poses as target,
+  // so that the auto calibration must stop before all poses are recorded.
+  double targetToolTipUncertaintyMm = toolTipUncertaintiesMm[NUMBER_OF_POINTS * 3 / 4];
+  std::cout << "Tool tip uncertainty: " << toolTipUncertaintiesMm[NUMBER_OF_POINTS / 4] << " mm"
+    << " -> " << toolTipUncertaintiesMm.back() << " mm, target: " << targetToolTipUncertaintyMm << " mm" << std::endl;
+  if (targetToolTipUncertaintyMm <= 0.0 || toolTipUncertaintiesMm.back() >= toolTipUncertaintiesMm[NUMBER_OF_POINTS / 4])
+  {
+    std::cerr << "Tool tip uncertainty does not decrease as poses are added" << std::endl;
+    return false;
+  }
+
+  logic->ClearToolToReferenceMatrices();
+  logic->SetPivotAutoCalibrationTargetToolTipUncertaintyMm(targetToolTipUncertaintyMm);
+  logic->SetPivotAutoCalibrationTargetNumberOfPoints(10 * NUMBER_OF_POINTS);
+  logic->SetPivotAutoCalibrationTargetError(1.0);
+  logic->SetPivotAutoCalibrationStopWhenComplete(true);
+  logic->SetPivotAutoCalibrationEnabled(true);
+  recordPoses();
+  int numberOfPosesAtConvergence = logic->GetPivotNumberOfPoses();
+  bool pivotCalibrationStopped = !logic->GetPivotCalibrationEnabled();
+  bool converged = logic->IsPivotCalibrationConverged();
+  double toolTipUncertaintyMm = logic->GetPivotToolTipUncertaintyMm();
+
+  logic->SetPivotAutoCalibrationEnabled(false);
+  logic->SetPivotAutoCalibrationStopWhenComplete(false);
+  logic->SetPivotAutoCalibrationTargetToolTipUncertaintyMm(0.0);
+  logic->SetPivotAutoCalibrationTargetNumberOfPoints(targetNumberOfPoints);
+  logic->SetPivotCalibrationEnabled(true);
+  logic->SetSpinCalibrationEnabled(spinCalibrationEnabled);
+
+  std::cout << "Number of poses at convergence: " << numberOfPosesAtConvergence << " / " << numberOfPosesWithoutAutoCalibration
+    << ", tool tip uncertainty: " << toolTipUncertaintyMm << " mm" << std::endl;
+  if (!pivotCalibrationStopped || !converged)
+  {
+    std::cerr << "Auto calibration did not stop when the calibration converged" << std::endl;
+    return false;
+  }
+  if (numberOfPosesAtConvergence >= numberOfPosesWithoutAutoCalibration || toolTipUncertaintyMm > targetToolTipUncertaintyMm)
+  {
+    std::cerr << "Poses were recorded after the calibration converged" << std::endl;
+    return false;
+  }
+  if (logic->GetPivotRMSE() < 0.0 || logic->GetPivotRMSE() > logic->GetPivotAutoCalibrationTargetError())
+  {
+    std::cerr << "Pivot calibration error is larger than the target error: " << logic->GetPivotRMSE() << std::endl;
+    return false;
+  }
+  logic->SetPivotAutoCalibrationTargetError(targetError);
+
+  std::cout << "Pivot calibration convergence test completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestRobustPivotCalibration(vtkSlicerPivotCalibrationLogic* logic, vtkMRMLTransformNode* markerToReferenceTransform)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting robust pivot calibration test..." << std::endl;
+
+  logic->ClearToolToReferenceMatrices();
+
+  double expectedToolTipPosition_Marker[3] = { 5.0, 12.6, 3.3 };
+  double outlierOffsetMm = 20.0;
+
+  vtkNew<vtkTransform> startTransform;
+  startTransform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+  markerToReferenceTransform->SetAndObserveTransformToParent(startTransform);
+
+  logic->SetRecordingState(true);
+  for (int i = 0; i < NUMBER_OF_POINTS; ++i)
+  {
+    vtkNew<vtkTransform> transform;
+    transform->DeepCopy(startTransform);
+    if (i % 10 == 5)
+    {
+      // Simulate a tracking glitch
+      transform->Translate(outlierOffsetMm, 0.0, 0.0);
+    }
+    transform->Translate(expectedToolTipPosition_Marker);
+    transform->RotateX(double(i) / NUMBER_OF_POINTS * 90.0);
+    transform->RotateY(double(i) / NUMBER_OF_POINTS * 90.0);
+    transform->RotateZ(double(i) / NUMBER_OF_POINTS * 90.0);
+    transform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+    markerToReferenceTransform->SetAndObserveTransformToParent(transform);
+  }
+  logic->SetRecordingState(false);
+
+  if (!logic->ComputePivotCalibrationRobust())
+  {
+    std::cerr << "Could not compute robust pivot calibration: " << logic->GetErrorText() << std::endl;
+    return false;
+  }
+
+  std::vector<double> residuals;
+  logic->GetPivotPoseResiduals(residuals);
+  std::cout << "Number of inliers: " << logic->GetPivotNumberOfInliers() << " / " << logic->GetPivotNumberOfPoses() << std::endl;
+  if (static_cast<int>(residuals.size()) != logic->GetPivotNumberOfPoses()
+    || logic->GetPivotNumberOfInliers() <= 0 || logic->GetPivotNumberOfInliers() >= logic->GetPivotNumberOfPoses())
+  {
+    std::cerr << "Outlier poses are not detected" << std::endl;
+    return false;
+  }
+  if (logic->GetPivotRMSE() >= epsilon)
+  {
+    std::cerr << "Robust pivot calibration error is too large: " << logic->GetPivotRMSE() << std::endl;
+    return false;
+  }
+  // With 10% outliers only a few hypotheses are needed for the required confidence
+  std::cout << "Number of evaluated hypotheses: " << logic->GetPivotNumberOfEvaluatedHypotheses() << std::endl;
+  if (logic->GetPivotNumberOfEvaluatedHypotheses() <= 0
+    || logic->GetPivotNumberOfEvaluatedHypotheses() >= logic->GetRobustMaximumNumberOfHypotheses())
+  {
+    std::cerr << "Number of evaluated hypotheses is not adapted to the inlier ratio" << std::endl;
+    return false;
+  }
+
+  vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+  logic->GetToolTipToToolMatrix(toolTipToToolMatrix);
+  double actualToolTipPosition_Marker[3] =
+    { toolTipToToolMatrix->GetElement(0, 3), toolTipToToolMatrix->GetElement(1, 3), toolTipToToolMatrix->GetElement(2, 3) };
+  double distanceBetweenActualAndExpectedToolTipPosition =
+    std::sqrt(vtkMath::Distance2BetweenPoints(actualToolTipPosition_Marker, expectedToolTipPosition_Marker));
+  std::cout << "Position error: " << distanceBetweenActualAndExpectedToolTipPosition << " mm" << std::endl;
+  if (distanceBetweenActualAndExpectedToolTipPosition >= epsilon)
+  {
+    std::cerr << "Tool tip position error is larger than expected" << std::endl;
+    return false;
+  }
+
+  std::cout << "Robust pivot calibration completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestRobustSpinCalibration(vtkSlicerPivotCalibrationLogic* logic, vtkMRMLTransformNode* markerToReferenceTransform)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting robust spin calibration test..." << std::endl;
+
+  logic->ClearToolToReferenceMatrices();
+
+  double expectedToolTipPosition_Marker[3] = { 5.0, 12.6, 3.3 };
+  double expectedToolShaftDirection_Marker[3] = { 1.0, 2.5, 4.1 };
+  vtkMath::Normalize(expectedToolShaftDirection_Marker);
+  double outlierAxis_Marker[3] = { 0.0, 0.0, 0.0 };
+  vtkMath::Perpendiculars(expectedToolShaftDirection_Marker, outlierAxis_Marker, nullptr, 0.0);
+  double outlierAngleDegrees = 20.0;
+
+  vtkNew<vtkTransform> startTransform;
+  startTransform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+  markerToReferenceTransform->SetAndObserveTransformToParent(startTransform);
+
+  logic->SetRecordingState(true);
+  double angleStepSize = 360.0 / NUMBER_OF_POINTS;
+  for (int i = 0; i < NUMBER_OF_POINTS; ++i)
+  {
+    vtkNew<vtkTransform> transform;
+    transform->DeepCopy(startTransform);
+    transform->Translate(expectedToolTipPosition_Marker);
+    transform->RotateWXYZ(angleStepSize * i, expectedToolShaftDirection_Marker);
+    if (i % 10 == 5)
+    {
+      // Simulate a tracking glitch that tilts the tool away from the shaft axis
+      transform->RotateWXYZ(outlierAngleDegrees, outlierAxis_Marker);
+    }
+    transform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+    markerToReferenceTransform->SetAndObserveTransformToParent(transform);
+  }
+  logic->SetRecordingState(false);
+
+  if (!logic->ComputeSpinCalibrationRobust())
+  {
+    std::cerr << "Could not compute robust spin calibration: " << logic->GetErrorText() << std::endl;
+    return false;
+  }
+
+  std::vector<double> residuals;
+  logic->GetSpinPoseResiduals(residuals);
+  std::cout << "Number of inliers: " << logic->GetSpinNumberOfInliers() << " / " << logic->GetSpinNumberOfPoses()
+    << ", number of evaluated hypotheses: " << logic->GetSpinNumberOfEvaluatedHypotheses() << std::endl;
+  if (static_cast<int>(residuals.size()) != logic->GetSpinNumberOfPoses()
+    || logic->GetSpinNumberOfInliers() <= 0 || logic->GetSpinNumberOfInliers() >= logic->GetSpinNumberOfPoses())
+  {
+    std::cerr << "Outlier poses are not detected" << std::endl;
+    return false;
+  }
+  if (logic->GetSpinNumberOfEvaluatedHypotheses() <= 0
+    || logic->GetSpinNumberOfEvaluatedHypotheses() >= logic->GetRobustMaximumNumberOfHypotheses())
+  {
+    std::cerr << "Number of evaluated hypotheses is not adapted to the inlier ratio" << std::endl;
+    return false;
+  }
+  if (logic->GetSpinRMSE() >= epsilon)
+  {
+    std::cerr << "Robust spin calibration error is too large: " << logic->GetSpinRMSE() << std::endl;
+    return false;
+  }
+
+  vtkNew<vtkMatrix4x4> toolTipToToolMatrix;
+  logic->GetToolTipToToolMatrix(toolTipToToolMatrix);
+  vtkNew<vtkTransform> toolTipToToolTransform;
+  toolTipToToolTransform->Concatenate(toolTipToToolMatrix);
+  double* actualToolShaftDirection_Marker = toolTipToToolTransform->TransformVector(0.0, 0.0, 1.0);
+  if (vtkMath::Dot(actualToolShaftDirection_Marker, expectedToolShaftDirection_Marker) < 0.0)
+  {
+    // Flip tool shaft.
+    vtkMath::MultiplyScalar(actualToolShaftDirection_Marker, -1.0);
+  }
+  double angleBetweenActualAndExpectedToolShaftDirection_Marker =
+    vtkMath::AngleBetweenVectors(actualToolShaftDirection_Marker, expectedToolShaftDirection_Marker);
+  std::cout << "Angle error: " << angleBetweenActualAndExpectedToolShaftDirection_Marker << " degrees" << std::endl;
+  if (angleBetweenActualAndExpectedToolShaftDirection_Marker >= epsilon)
+  {
+    std::cerr << "Tool shaft direction different than expected" << std::endl;
+    return false;
+  }
+
+  // Results must be reproducible for the same random seed
+  int numberOfInliers = logic->GetSpinNumberOfInliers();
+  int numberOfEvaluatedHypotheses = logic->GetSpinNumberOfEvaluatedHypotheses();
+  if (!logic->ComputeSpinCalibrationRobust()
+    || logic->GetSpinNumberOfInliers() != numberOfInliers
+    || logic->GetSpinNumberOfEvaluatedHypotheses() != numberOfEvaluatedHypotheses)
+  {
+    std::cerr << "Robust spin calibration is not reproducible" << std::endl;
+    return false;
+  }
+
+  std::cout << "Robust spin calibration completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestRecordingBuffer(vtkSlicerPivotCalibrationLogic* logic, vtkMRMLTransformNode* markerToReferenceTransform)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting recording buffer test..." << std::endl;
+
+  logic->ClearToolToReferenceMatrices();
+  logic->ClearRecordedPoses();
+  logic->SetRecordingDecimationFactor(2);
+
+  double expectedToolTipPosition_Marker[3] = { 5.0, 12.6, 3.3 };
+  vtkNew<vtkTransform> startTransform;
+  startTransform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+
+  logic->SetRecordingState(true);
+  for (int i = 0; i < NUMBER_OF_POINTS; ++i)
+  {
+    vtkNew<vtkTransform> transform;
+    transform->DeepCopy(startTransform);
+    transform->Translate(expectedToolTipPosition_Marker);
+    transform->RotateX(double(i) / NUMBER_OF_POINTS * 90.0);
+    transform->RotateY(double(i) / NUMBER_OF_POINTS * 90.0);
+    transform->RotateZ(double(i) / NUMBER_OF_POINTS * 90.0);
+    transform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+    markerToReferenceTransform->SetAndObserveTransformToParent(transform);
+  }
+  logic->SetRecordingState(false);
+
+  std::cout << "Number of recorded poses: " << logic->GetNumberOfRecordedPoses() << std::endl;
+  if (logic->GetNumberOfRecordedPoses() != NUMBER_OF_POINTS / 2)
+  {
+    std::cerr << "Unexpected number of recorded poses: " << logic->GetNumberOfRecordedPoses() << ", expected " << NUMBER_OF_POINTS / 2 << std::endl;
+    return false;
+  }
+  if (!logic->ComputePivotCalibration())
+  {
+    std::cerr << "Could not compute pivot calibration: " << logic->GetErrorText() << std::endl;
+    return false;
+  }
+  vtkNew<vtkMatrix4x4> recordedToolTipToToolMatrix;
+  logic->GetToolTipToToolMatrix(recordedToolTipToToolMatrix);
+
+  int numberOfPivotPoses = logic->GetPivotNumberOfPoses();
+
+  // Replaying the recorded poses must give the same result, decimation is not applied again
+  logic->ClearToolToReferenceMatrices();
+  logic->ReplayRecordedPoses();
+  if (logic->GetNumberOfRecordedPoses() != NUMBER_OF_POINTS / 2)
+  {
+    std::cerr << "Unexpected number of recorded poses after replay: " << logic->GetNumberOfRecordedPoses() << std::endl;
+    return false;
+  }
+  if (logic->GetPivotNumberOfPoses() != numberOfPivotPoses)
+  {
+    std::cerr << "Unexpected number of pivot poses after replay: " << logic->GetPivotNumberOfPoses() << ", expected " << numberOfPivotPoses << std::endl;
+    return false;
+  }
+  if (!logic->ComputePivotCalibration())
+  {
+    std::cerr << "Could not compute pivot calibration from replayed poses: " << logic->GetErrorText() << std::endl;
+    return false;
+  }
+  vtkNew<vtkMatrix4x4> replayedToolTipToToolMatrix;
+  logic->GetToolTipToToolMatrix(replayedToolTipToToolMatrix);
+  for (int row = 0; row < 3; row++)
+  {
+    if (std::abs(recordedToolTipToToolMatrix->GetElement(row, 3) - replayedToolTipToToolMatrix->GetElement(row, 3)) >= epsilon)
+    {
+      std::cerr << "Calibration result from replayed poses is different" << std::endl;
+      return false;
+    }
+  }
+  logic->SetRecordingDecimationFactor(1);
+
+  // Poses of an invalid tool are not recorded
+  markerToReferenceTransform->SetAttribute("OpenIGTLink.TransformValid", "0");
+  logic->SetRecordingState(true);
+  for (int i = 0; i < 10; ++i)
+  {
+    vtkNew<vtkTransform> invalidTransform;
+    invalidTransform->Translate(100.0 + i, 0.0, 0.0);
+    markerToReferenceTransform->SetAndObserveTransformToParent(invalidTransform);
+  }
+  logic->SetRecordingState(false);
+  markerToReferenceTransform->SetAttribute("OpenIGTLink.TransformValid", "1");
+  if (logic->GetNumberOfRecordedPoses() != NUMBER_OF_POINTS / 2)
+  {
+    std::cerr << "Poses of an invalid tool were recorded, number of recorded poses: " << logic->GetNumberOfRecordedPoses() << std::endl;
+    return false;
+  }
+
+  std::cout << "Recording buffer test completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void GetRecordingTestMatrix(int poseIndex, vtkMatrix4x4* toolToReferenceMatrix)
+{
+  vtkNew<vtkTransform> transform;
+  transform->Translate(1.0 * poseIndex, -2.0 * poseIndex, 3.0);
+  transform->RotateWXYZ(7.0 * poseIndex, 1.0, 2.0, 3.0);
+  toolToReferenceMatrix->DeepCopy(transform->GetMatrix());
+}
+
+//----------------------------------------------------------------------------
+// Returns true if the recorded pose is the one that was recorded by RecordTestPoses with the specified pose index
+bool IsRecordedTestPose(vtkSlicerPivotCalibrationLogic* logic, int recordedPoseIndex, int expectedPoseIndex)
+{
+  vtkNew<vtkMatrix4x4> recordedMatrix;
+  double timestampSec = logic->GetRecordedPose(recordedPoseIndex, recordedMatrix);
+  if (timestampSec != 10.0 + 0.1 * expectedPoseIndex)
+  {
+    std::cerr << "Recorded pose " << recordedPoseIndex << " has timestamp " << timestampSec << ", expected " << 10.0 + 0.1 * expectedPoseIndex << std::endl;
+    return false;
+  }
+  vtkNew<vtkMatrix4x4> expectedMatrix;
+  GetRecordingTestMatrix(expectedPoseIndex, expectedMatrix);
+  for (int row = 0; row < 4; row++)
+  {
+    for (int column = 0; column < 4; column++)
+    {
+      if (recordedMatrix->GetElement(row, column) != expectedMatrix->GetElement(row, column))
+      {
+        std::cerr << "Recorded pose " << recordedPoseIndex << " is different from the expected pose " << expectedPoseIndex << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void RecordTestPoses(vtkSlicerPivotCalibrationLogic* logic, int numberOfPoses)
+{
+  vtkNew<vtkMatrix4x4> toolToReferenceMatrix;
+  for (int i = 0; i < numberOfPoses; ++i)
+  {
+    GetRecordingTestMatrix(i, toolToReferenceMatrix);
+    logic->RecordToolToReferenceMatrix(toolToReferenceMatrix, 10.0 + 0.1 * i);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool TestRecordingRateLimit(vtkSlicerPivotCalibrationLogic* logic, vtkMRMLTransformNode* markerToReferenceTransform)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting recording rate limit test..." << std::endl;
+
+  logic->ClearToolToReferenceMatrices();
+  logic->ClearRecordedPoses();
+
+  // The minimum time between recorded poses is much longer than the test, so only the first pose is recorded
+  logic->SetRecordingMaximumRateHz(0.001);
+  logic->SetRecordingState(true);
+  for (int i = 0; i < 10; ++i)
+  {
+    vtkNew<vtkTransform> transform;
+    transform->Translate(1.0 * i, 0.0, 0.0);
+    markerToReferenceTransform->SetAndObserveTransformToParent(transform);
+  }
+  logic->SetRecordingState(false);
+  if (logic->GetNumberOfRecordedPoses() != 1)
+  {
+    std::cerr << "Unexpected number of recorded poses with rate limit: " << logic->GetNumberOfRecordedPoses() << ", expected 1" << std::endl;
+    return false;
+  }
+  vtkNew<vtkMatrix4x4> recordedMatrix;
+  logic->GetRecordedPose(0, recordedMatrix);
+  if (recordedMatrix->GetElement(0, 3) != 0.0)
+  {
+    std::cerr << "Recorded pose is not the first pose" << std::endl;
+    return false;
+  }
+
+  // Clearing the recorded poses resets the rate limit
+  logic->ClearRecordedPoses();
+  logic->SetRecordingState(true);
+  vtkNew<vtkTransform> nextTransform;
+  nextTransform->Translate(20.0, 0.0, 0.0);
+  markerToReferenceTransform->SetAndObserveTransformToParent(nextTransform);
+  logic->SetRecordingState(false);
+  if (logic->GetNumberOfRecordedPoses() != 1)
+  {
+    std::cerr << "Pose was not recorded after clearing the recorded poses" << std::endl;
+    return false;
+  }
+
+  // Without rate limit all poses are recorded
+  logic->SetRecordingMaximumRateHz(0.0);
+  logic->ClearRecordedPoses();
+  logic->SetRecordingState(true);
+  for (int i = 0; i < 10; ++i)
+  {
+    vtkNew<vtkTransform> transform;
+    transform->Translate(1.0 * i, 0.0, 0.0);
+    markerToReferenceTransform->SetAndObserveTransformToParent(transform);
+  }
+  logic->SetRecordingState(false);
+  if (logic->GetNumberOfRecordedPoses() != 10)
+  {
+    std::cerr << "Unexpected number of recorded poses without rate limit: " << logic->GetNumberOfRecordedPoses() << ", expected 10" << std::endl;
+    return false;
+  }
+  logic->ClearRecordedPoses();
+  logic->ClearToolToReferenceMatrices();
+
+  std::cout << "Recording rate limit test completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestRecordingBufferCapacity(vtkSlicerPivotCalibrationLogic* logic)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting recording buffer capacity test..." << std::endl;
+
+  logic->ClearToolToReferenceMatrices();
+  logic->ClearRecordedPoses();
+  int originalCapacity = logic->GetRecordingBufferCapacity();
+
+  // Oldest poses are overwritten when the buffer is full
+  logic->SetRecordingBufferCapacity(5);
+  RecordTestPoses(logic, 8);
+  if (logic->GetNumberOfRecordedPoses() != 5)
+  {
+    std::cerr << "Unexpected number of recorded poses in full buffer: " << logic->GetNumberOfRecordedPoses() << ", expected 5" << std::endl;
+    return false;
+  }
+  for (int i = 0; i < 5; ++i)
+  {
+    if (!IsRecordedTestPose(logic, i, i + 3))
+    {
+      return false;
+    }
+  }
+
+  // Reducing the capacity keeps the newest poses
+  logic->SetRecordingBufferCapacity(3);
+  if (logic->GetRecordingBufferCapacity() != 3 || logic->GetNumberOfRecordedPoses() != 3)
+  {
+    std::cerr << "Unexpected number of recorded poses after reducing the capacity: " << logic->GetNumberOfRecordedPoses() << ", expected 3" << std::endl;
+    return false;
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    if (!IsRecordedTestPose(logic, i, i + 5))
+    {
+      return false;
+    }
+  }
+
+  // Invalid capacity is rejected
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  logic->SetRecordingBufferCapacity(0);
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+  if (logic->GetRecordingBufferCapacity() != 3)
+  {
+    std::cerr << "Invalid capacity changed the recording buffer capacity to " << logic->GetRecordingBufferCapacity() << std::endl;
+    return false;
+  }
+
+  logic->SetRecordingBufferCapacity(originalCapacity);
+  logic->ClearRecordedPoses();
+  logic->ClearToolToReferenceMatrices();
+
+  std::cout << "Recording buffer capacity test completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestRecordedPosesSaveLoad(vtkSlicerPivotCalibrationLogic* logic)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting recorded poses save and load test..." << std::endl;
+
+  const std::string filePath = "vtkPivotCalibrationTestRecordedPoses.txt";
+  const int numberOfPoses = 12;
+
+  logic->ClearToolToReferenceMatrices();
+  logic->ClearRecordedPoses();
+  RecordTestPoses(logic, numberOfPoses);
+  if (!logic->SaveRecordedPoses(filePath))
+  {
+    std::cerr << "Failed to save recorded poses" << std::endl;
+    return false;
+  }
+
+  // Loading replaces the content of the recording buffer
+  logic->ClearRecordedPoses();
+  RecordTestPoses(logic, 3);
+  if (!logic->LoadRecordedPoses(filePath))
+  {
+    std::cerr << "Failed to load recorded poses" << std::endl;
+    return false;
+  }
+  vtksys::SystemTools::RemoveFile(filePath);
+  if (logic->GetNumberOfRecordedPoses() != numberOfPoses)
+  {
+    std::cerr << "Unexpected number of loaded poses: " << logic->GetNumberOfRecordedPoses() << ", expected " << numberOfPoses << std::endl;
+    return false;
+  }
+  // Timestamps and matrices are saved with full precision
+  for (int i = 0; i < numberOfPoses; ++i)
+  {
+    if (!IsRecordedTestPose(logic, i, i))
+    {
+      return false;
+    }
+  }
+
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  bool loadedMissingFile = logic->LoadRecordedPoses(filePath);
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+  if (loadedMissingFile)
+  {
+    std::cerr << "Loading a missing file did not fail" << std::endl;
+    return false;
+  }
+  logic->ClearRecordedPoses();
+  logic->ClearToolToReferenceMatrices();
+
+  std::cout << "Recorded poses save and load test completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestSequenceCalibration(vtkSlicerPivotCalibrationLogic* logic)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting pivot and spin calibration from sequences test..." << std::endl;
+
+  const int numberOfTools = 3;
+  double angleStepSize = 360.0 / NUMBER_OF_POINTS;
+  std::vector<vtkSmartPointer<vtkMRMLSequenceNode> > sequenceNodes;
+  std::vector<vtkMRMLSequenceNode*> pivotSequenceNodes;
+  std::vector<vtkMRMLSequenceNode*> spinSequenceNodes;
+  for (int toolIndex = 0; toolIndex < numberOfTools; toolIndex++)
+  {
+    double expectedToolTipPosition_Marker[3] = { 5.0 + toolIndex * 10.0, 12.6, 3.3 };
+    double expectedToolShaftDirection_Marker[3] = { 1.0, 2.5 - toolIndex, 4.1 };
+    vtkMath::Normalize(expectedToolShaftDirection_Marker);
+    vtkSmartPointer<vtkMRMLSequenceNode> pivotSequenceNode = vtkSmartPointer<vtkMRMLSequenceNode>::New();
+    vtkSmartPointer<vtkMRMLSequenceNode> spinSequenceNode = vtkSmartPointer<vtkMRMLSequenceNode>::New();
+    for (int i = 0; i < NUMBER_OF_POINTS; ++i)
+    {
+      vtkNew<vtkTransform> pivotTransform;
+      pivotTransform->Translate(expectedToolTipPosition_Marker);
+      pivotTransform->RotateX(double(i) / NUMBER_OF_POINTS * 90.0);
+      pivotTransform->RotateY(double(i) / NUMBER_OF_POINTS * 90.0);
+      pivotTransform->RotateZ(double(i) / NUMBER_OF_POINTS * 90.0);
+      pivotTransform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+      vtkNew<vtkMRMLLinearTransformNode> pivotTransformNode;
+      pivotTransformNode->SetMatrixTransformToParent(pivotTransform->GetMatrix());
+      pivotSequenceNode->SetDataNodeAtValue(pivotTransformNode, std::to_string(i));
+
+      vtkNew<vtkTransform> spinTransform;
+      spinTransform->Translate(expectedToolTipPosition_Marker);
+      spinTransform->RotateWXYZ(angleStepSize * i, expectedToolShaftDirection_Marker);
+      spinTransform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+      vtkNew<vtkMRMLLinearTransformNode> spinTransformNode;
+      spinTransformNode->SetMatrixTransformToParent(spinTransform->GetMatrix());
+      spinSequenceNode->SetDataNodeAtValue(spinTransformNode, std::to_string(i));
+    }
+    sequenceNodes.push_back(pivotSequenceNode);
+    sequenceNodes.push_back(spinSequenceNode);
+    pivotSequenceNodes.push_back(pivotSequenceNode);
+    spinSequenceNodes.push_back(spinSequenceNode);
+  }
+
+  std::vector<vtkSlicerPivotCalibrationLogic::ToolCalibrationResult> results;
+  if (!logic->ComputeCalibrationFromSequences(pivotSequenceNodes, std::vector<vtkMRMLSequenceNode*>(), results))
+  {
+    std::cerr << "Could not compute pivot calibration from sequences" << std::endl;
+    return false;
+  }
+
+  for (int toolIndex = 0; toolIndex < numberOfTools; toolIndex++)
+  {
+    double expectedToolTipPosition_Marker[3] = { 5.0 + toolIndex * 10.0, 12.6, 3.3 };
+    vtkMatrix4x4* toolTipToToolMatrix = results[toolIndex].ToolTipToToolMatrix;
+    double actualToolTipPosition_Marker[3] =
+      { toolTipToToolMatrix->GetElement(0, 3), toolTipToToolMatrix->GetElement(1, 3), toolTipToToolMatrix->GetElement(2, 3) };
+    double distanceBetweenActualAndExpectedToolTipPosition =
+      std::sqrt(vtkMath::Distance2BetweenPoints(actualToolTipPosition_Marker, expectedToolTipPosition_Marker));
+    std::cout << "Tool " << toolIndex << " position error: " << distanceBetweenActualAndExpectedToolTipPosition << " mm" << std::endl;
+    if (distanceBetweenActualAndExpectedToolTipPosition >= epsilon || results[toolIndex].PivotRMSE >= epsilon)
+    {
+      std::cerr << "Tool tip position error is larger than expected" << std::endl;
+      return false;
+    }
+  }
+
+  // Pivot and spin calibration of each tool
+  if (!logic->ComputeCalibrationFromSequences(pivotSequenceNodes, spinSequenceNodes, results))
+  {
+    std::cerr << "Could not compute pivot and spin calibration from sequences" << std::endl;
+    return false;
+  }
+
+  for (int toolIndex = 0; toolIndex < numberOfTools; toolIndex++)
+  {
+    double expectedToolTipPosition_Marker[3] = { 5.0 + toolIndex * 10.0, 12.6, 3.3 };
+    double expectedToolShaftDirection_Marker[3] = { 1.0, 2.5 - toolIndex, 4.1 };
+    vtkMath::Normalize(expectedToolShaftDirection_Marker);
+    if (results[toolIndex].SpinRMSE < 0.0 || results[toolIndex].SpinRMSE >= epsilon)
+    {
+      std::cerr << "Tool " << toolIndex << " spin calibration error is too large: " << results[toolIndex].SpinRMSE << std::endl;
+      return false;
+    }
+
+    vtkMatrix4x4* toolTipToToolMatrix = results[toolIndex].ToolTipToToolMatrix;
+    // Spin calibration must keep the tool tip position computed by pivot calibration
+    double actualToolTipPosition_Marker[3] =
+      { toolTipToToolMatrix->GetElement(0, 3), toolTipToToolMatrix->GetElement(1, 3), toolTipToToolMatrix->GetElement(2, 3) };
+    double distanceBetweenActualAndExpectedToolTipPosition =
+      std::sqrt(vtkMath::Distance2BetweenPoints(actualToolTipPosition_Marker, expectedToolTipPosition_Marker));
+
+    double actualToolShaftDirection_Marker[3] =
+      { toolTipToToolMatrix->GetElement(0, 2), toolTipToToolMatrix->GetElement(1, 2), toolTipToToolMatrix->GetElement(2, 2) };
+    if (vtkMath::Dot(actualToolShaftDirection_Marker, expectedToolShaftDirection_Marker) < 0.0)
+    {
+      // Flip tool shaft.
+      vtkMath::MultiplyScalar(actualToolShaftDirection_Marker, -1.0);
+    }
+    double angleBetweenActualAndExpectedToolShaftDirection_Marker =
+      vtkMath::AngleBetweenVectors(actualToolShaftDirection_Marker, expectedToolShaftDirection_Marker);
+    std::cout << "Tool " << toolIndex << " position error: " << distanceBetweenActualAndExpectedToolTipPosition << " mm"
+      << ", shaft angle error: " << angleBetweenActualAndExpectedToolShaftDirection_Marker << std::endl;
+    if (distanceBetweenActualAndExpectedToolTipPosition >= epsilon
+      || angleBetweenActualAndExpectedToolShaftDirection_Marker >= epsilon)
+    {
+      std::cerr << "Tool tip pose error is larger than expected" << std::endl;
+      return false;
+    }
+  }
+
+  std::cout << "Pivot and spin calibration from sequences completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestMultiToolPivotCalibration(vtkSlicerPivotCalibrationLogic* logic, vtkMRMLScene* scene)
+{
+  std::cout << "=================================================================" << std::endl;
+  std::cout << "Starting multi-tool pivot calibration test..." << std::endl;
+
+  logic->ClearToolToReferenceMatrices();
+  logic->SetSpinCalibrationEnabled(false);
+  logic->SetToolPoseBatchProcessingEnabled(true);
+
+  const int numberOfTools = 3;
+  std::vector<vtkMRMLTransformNode*> toolNodes;
+  for (int toolIndex = 0; toolIndex < numberOfTools; toolIndex++)
+  {
+    vtkMRMLTransformNode* toolNode = vtkMRMLTransformNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLLinearTransformNode"));
+    logic->AddAndObserveToolTransformNode(toolNode);
+    toolNodes.push_back(toolNode);
+  }
+
+  auto setToolPoses = [&](int i)
+  {
+    for (int toolIndex = 0; toolIndex < numberOfTools; toolIndex++)
+    {
+      double expectedToolTipPosition_Marker[3] = { 5.0 + toolIndex * 10.0, 12.6, 3.3 };
+      vtkNew<vtkTransform> transform;
+      transform->Translate(expectedToolTipPosition_Marker);
+      transform->RotateX(double(i) / NUMBER_OF_POINTS * 90.0);
+      transform->RotateY(double(i) / NUMBER_OF_POINTS * 90.0);
+      transform->RotateZ(double(i) / NUMBER_OF_POINTS * 90.0);
+      transform->Translate(-expectedToolTipPosition_Marker[0], -expectedToolTipPosition_Marker[1], -expectedToolTipPosition_Marker[2]);
+      vtkMRMLLinearTransformNode::SafeDownCast(toolNodes[toolIndex])->SetMatrixTransformToParent(transform->GetMatrix());
+    }
+  };
+
+  logic->SetRecordingState(true);
+  for (int i = 0; i < NUMBER_OF_POINTS; ++i)
+  {
+    setToolPoses(i);
+    logic->ProcessQueuedToolPoses();
+  }
+  logic->SetRecordingState(false);
+
+  bool success = logic->ComputeToolCalibrations();
+  auto checkToolCalibrationResults = [&]()
+  {
+    for (int toolIndex = 0; success && toolIndex < numberOfTools; toolIndex++)
+    {
+      double expectedToolTipPosition_Marker[3] = { 5.0 + toolIndex * 10.0, 12.6, 3.3 };
+      vtkSlicerPivotCalibrationLogic::ToolCalibrationResult result;
+      if (!logic->GetToolCalibrationResult(toolNodes[toolIndex], result))
+      {
+        std::cerr << "Could not get calibration result of tool " << toolIndex << std::endl;
+        success = false;
+        break;
+      }
+      double actualToolTipPosition_Marker[3] =
+        { result.ToolTipToToolMatrix->GetElement(0, 3), result.ToolTipToToolMatrix->GetElement(1, 3), result.ToolTipToToolMatrix->GetElement(2, 3) };
+      double distanceBetweenActualAndExpectedToolTipPosition =
+        std::sqrt(vtkMath::Distance2BetweenPoints(actualToolTipPosition_Marker, expectedToolTipPosition_Marker));
+      std::cout << "Tool " << toolIndex << " poses: " << logic->GetToolPivotNumberOfPoses(toolNodes[toolIndex])
+        << ", position error: " << distanceBetweenActualAndExpectedToolTipPosition << " mm" << std::endl;
+      if (distanceBetweenActualAndExpectedToolTipPosition >= epsilon || result.PivotRMSE >= epsilon)
+      {
+        std::cerr << "Tool tip position error is larger than expected" << std::endl;
+        success = false;
+      }
+    }
+  };
+  checkToolCalibrationResults();
+
+  // Tool poses are recorded with the same decimation and incremental auto-calibration as the observed transform.
+  // Without batch processing the tools are processed together, when all of them are updated.
+  vtkNew<vtkCallbackCommand> completeCallback;
+  std::set<vtkMRMLTransformNode*> completedToolNodes;
+  completeCallback->SetClientData(&completedToolNodes);
+  completeCallback->SetCallback([](vtkObject*, unsigned long, void* clientData, void* callData)
+    {
+      static_cast<std::set<vtkMRMLTransformNode*>*>(clientData)->insert(static_cast<vtkMRMLTransformNode*>(callData));
+    });
+  logic->AddObserver(vtkSlicerPivotCalibrationLogic::ToolPivotCalibrationCompleteEvent, completeCallback);
+  logic->ClearToolPoses();
+  logic->SetToolPoseBatchProcessingEnabled(false);
+  logic->SetRecordingDecimationFactor(2);
+  int targetNumberOfPoints = logic->GetPivotAutoCalibrationTargetNumberOfPoints();
+  logic->SetPivotAutoCalibrationTargetNumberOfPoints(NUMBER_OF_POINTS / 4);
+  logic->SetPivotIncrementalCalibrationEnabled(true);
+  logic->SetPivotAutoCalibrationEnabled(true);
+  logic->SetRecordingState(true);
+  for (int i = 0; success && i < NUMBER_OF_POINTS; ++i)
+  {
+    setToolPoses(i);
+  }
+  logic->SetRecordingState(false);
+  logic->SetPivotAutoCalibrationEnabled(false);
+  logic->SetPivotIncrementalCalibrationEnabled(false);
+  logic->SetPivotAutoCalibrationTargetNumberOfPoints(targetNumberOfPoints);
+  logic->SetRecordingDecimationFactor(1);
+  logic->RemoveObserver(completeCallback);
+
+  std::cout << "Number of completed tools: " << completedToolNodes.size() << std::endl;
+  if (success && static_cast<int>(completedToolNodes.size()) != numberOfTools)
+  {
+    std::cerr << "Tool auto-calibration did not complete" << std::endl;
+    success = false;
+  }
+  for (int toolIndex = 0; success && toolIndex < numberOfTools; toolIndex++)
+  {
+    int numberOfPoses = logic->GetToolPivotNumberOfPoses(toolNodes[toolIndex]);
+    if (numberOfPoses <= 0 || numberOfPoses > NUMBER_OF_POINTS / 2)
+    {
+      std::cerr << "Tool " << toolIndex << " poses are not decimated: " << numberOfPoses << std::endl;
+      success = false;
+    }
+  }
+  checkToolCalibrationResults();
+
+  logic->RemoveAllToolTransformNodes();
+  logic->SetToolPoseBatchProcessingEnabled(false);
+  logic->SetSpinCalibrationEnabled(true);
+  if (!success)
+  {
+    std::cerr << "Multi-tool pivot calibration failed" << std::endl;
+    return false;
+  }
+
+  std::cout << "Multi-tool pivot calibration completed successfully." << std::endl;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkPivotCalibrationTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkNew<vtkMRMLTransformNode> markerToReferenceTransform;
+  scene->AddNode(markerToReferenceTransform);
+
+  vtkNew<vtkSlicerPivotCalibrationLogic> logic;
+  logic->SetMRMLScene(scene);
+  logic->SetAndObserveTransformNode(markerToReferenceTransform);
+
+  double pivotErrorsMm[4] = { 0.0, 0.1, 1.0, 10.0 };
+  for (double pivotErrorMm : pivotErrorsMm)
+  {
+    if (!TestPivotCalibration(logic, markerToReferenceTransform, pivotErrorMm))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!TestIncrementalPivotCalibration(logic, markerToReferenceTransform))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestPivotPoseBuffer(logic))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestPivotCalibrationConvergence(logic, markerToReferenceTransform))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestRobustPivotCalibration(logic, markerToReferenceTransform))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestRecordingBuffer(logic, markerToReferenceTransform))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestRecordingRateLimit(logic, markerToReferenceTransform))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestRecordingBufferCapacity(logic))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestRecordedPosesSaveLoad(logic))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestSequenceCalibration(logic))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestMultiToolPivotCalibration(logic, scene))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestSpinCalibration(logic, markerToReferenceTransform))
+  {
+    return EXIT_FAILURE;
+  }
+
+  if (!TestRobustSpinCalibration(logic, markerToReferenceTransform))
   {
     return EXIT_FAILURE;
   }
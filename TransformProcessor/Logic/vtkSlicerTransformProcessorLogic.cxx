@@ -24,30 +24,111 @@
 #include "vtkMRMLTransformProcessorNode.h"
 
 // MRML includes
+#include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLScene.h>
 #include "vtkMRMLTransformNode.h"
 
+// Sequences MRML includes
+#include <vtkMRMLSequenceNode.h>
+
 // VTK includes
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkMatrix4x4.h>
 #include <vtkMath.h>
 #include <vtkNumberToString.h>
+#include <vtkSMPTools.h>
 #include <vtkTimerLog.h>
+#include <vtkVariant.h>
 
 //#include <vtkQuaternionInterpolator.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 
 const float EPSILON = 0.00001;
 
+// Continuously updated nodes are considered due if their scheduled time is
+// within this tolerance, as timers may fire slightly earlier than requested.
+const double CONTINUOUS_UPDATE_TIME_TOLERANCE_SEC = 0.0005;
+
 vtkStandardNewMacro( vtkSlicerTransformProcessorLogic );
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  bool GetAxisFromLabel( int axisLabel, double axis[ 3 ] )
+  {
+    axis[ 0 ] = 0.0;
+    axis[ 1 ] = 0.0;
+    axis[ 2 ] = 0.0;
+    if ( axisLabel < vtkMRMLTransformProcessorNode::AXIS_LABEL_X || axisLabel >= vtkMRMLTransformProcessorNode::AXIS_LABEL_LAST )
+    {
+      return false;
+    }
+    axis[ axisLabel - vtkMRMLTransformProcessorNode::AXIS_LABEL_X ] = 1.0;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Same rotation as vtkTransform::RotateWXYZ, written into the upper-left 3x3 of a 4x4 row-major matrix
+  void SetRotationFromAngleAxis( double angleDegrees, const double axis[ 3 ], double matrix[ 16 ] )
+  {
+    double quaternion[ 4 ] = { 1.0, 0.0, 0.0, 0.0 };
+    double axisNorm = vtkMath::Norm( axis );
+    if ( axisNorm > 0.0 )
+    {
+      const double halfAngleRadians = vtkMath::RadiansFromDegrees( angleDegrees ) * 0.5;
+      const double sinHalfAngle = sin( halfAngleRadians ) / axisNorm;
+      quaternion[ 0 ] = cos( halfAngleRadians );
+      quaternion[ 1 ] = axis[ 0 ] * sinHalfAngle;
+      quaternion[ 2 ] = axis[ 1 ] * sinHalfAngle;
+      quaternion[ 3 ] = axis[ 2 ] * sinHalfAngle;
+    }
+    double rotation[ 3 ][ 3 ];
+    vtkMath::QuaternionToMatrix3x3( quaternion, rotation );
+    for ( int row = 0; row < 3; row++ )
+    {
+      for ( int column = 0; column < 3; column++ )
+      {
+        matrix[ row * 4 + column ] = rotation[ row ][ column ];
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void SetIdentity( double matrix[ 16 ] )
+  {
+    for ( int i = 0; i < 16; i++ )
+    {
+      matrix[ i ] = ( i % 5 == 0 ) ? 1.0 : 0.0;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Multiply a vector by the upper-left 3x3 of a 4x4 row-major matrix
+  void TransformVector( const double matrix[ 16 ], const double vector[ 3 ], double transformedVector[ 3 ] )
+  {
+    for ( int row = 0; row < 3; row++ )
+    {
+      transformedVector[ row ] = matrix[ row * 4 ] * vector[ 0 ] + matrix[ row * 4 + 1 ] * vector[ 1 ] + matrix[ row * 4 + 2 ] * vector[ 2 ];
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 vtkSlicerTransformProcessorLogic::vtkSlicerTransformProcessorLogic()
+  : BatchUpdateEnabled( false )
+  , BatchUpdateInProgress( false )
+  , ProcessorNodeGraphModified( true )
 {
+  this->ScratchInputMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->ScratchPreviousMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->ScratchOutputMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->ScratchNextMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->ScratchSampleMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
 }
 
 //-----------------------------------------------------------------------------
@@ -59,6 +140,7 @@ vtkSlicerTransformProcessorLogic::~vtkSlicerTransformProcessorLogic()
 void vtkSlicerTransformProcessorLogic::PrintSelf( ostream& os, vtkIndent indent )
 {
   this->Superclass::PrintSelf( os, indent );
+  os << indent << "BatchUpdateEnabled: " << ( this->BatchUpdateEnabled ? "true" : "false" ) << std::endl;
 }
 
 //-----------------------------------------------------------------------------
@@ -100,8 +182,11 @@ void vtkSlicerTransformProcessorLogic::OnMRMLSceneNodeAdded( vtkMRMLNode* node )
     vtkNew<vtkIntArray> events;
     events->InsertNextValue( vtkCommand::ModifiedEvent );
     events->InsertNextValue( vtkMRMLTransformProcessorNode::InputDataModifiedEvent );
+    events->InsertNextValue( vtkMRMLTransformProcessorNode::InputCombineTransformModifiedEvent );
     vtkObserveMRMLNodeEventsMacro( pNode, events.GetPointer() );
     this->UpdateContinuouslyUpdatedNodesList(pNode);
+    this->ProcessorNodeGraphModified = true;
+    this->InvokeEvent( UpdateScheduleModifiedEvent );
   }
 }
 
@@ -119,7 +204,15 @@ void vtkSlicerTransformProcessorLogic::OnMRMLSceneNodeRemoved( vtkMRMLNode* node
   {
     vtkDebugMacro( "OnMRMLSceneNodeRemoved" );
     vtkUnObserveMRMLNodeMacro( pNode );
-    this->UpdateContinuouslyUpdatedNodesList(pNode);
+    this->ContinuouslyUpdatedNodes.erase( std::remove( this->ContinuouslyUpdatedNodes.begin(), this->ContinuouslyUpdatedNodes.end(), pNode ),
+      this->ContinuouslyUpdatedNodes.end() );
+    this->ContinuousUpdateInfos.erase( pNode );
+    this->StabilizationInfos.erase( pNode );
+    this->DirtyNodes.erase( pNode );
+    this->TimeSynchronizationHistories.erase( pNode );
+    this->ProcessorNodeInputTransformHierarchies.erase( pNode );
+    this->ProcessorNodeGraphModified = true;
+    this->InvokeEvent( UpdateScheduleModifiedEvent );
   }
 }
 
@@ -141,22 +234,23 @@ void vtkSlicerTransformProcessorLogic::UpdateContinuouslyUpdatedNodesList(vtkMRM
     }
   }
   // Add/remove node to current list
-  if (paramNode->GetProcessingMode() == vtkMRMLTransformProcessorNode::PROCESSING_MODE_STABILIZE && paramNode->GetStabilizationEnabled())
+  if (this->IsContinuousUpdateRequired(paramNode))
   {
     // node should be in ContinuouslyUpdatedNodes
     if (continuouslyUpdatedNodesIt == this->ContinuouslyUpdatedNodes.end())
     {
       this->ContinuouslyUpdatedNodes.push_back(paramNode);
+      this->ContinuousUpdateInfos[paramNode] = ContinuousUpdateInfo();
     }
   }
   else
   {
     // node should not be in ContinuouslyUpdatedNodes
-    // node should be in ContinuouslyUpdatedNodes
     if (continuouslyUpdatedNodesIt != this->ContinuouslyUpdatedNodes.end())
     {
       this->ContinuouslyUpdatedNodes.erase(continuouslyUpdatedNodesIt);
     }
+    this->ContinuousUpdateInfos.erase(paramNode);
   }
   // Remove deleted nodes
   for (continuouslyUpdatedNodesIt = this->ContinuouslyUpdatedNodes.begin();
@@ -170,7 +264,186 @@ void vtkSlicerTransformProcessorLogic::UpdateContinuouslyUpdatedNodesList(vtkMRM
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlicerTransformProcessorLogic::ProcessMRMLNodesEvents( vtkObject* caller, unsigned long event, void* vtkNotUsed(callData) )
+bool vtkSlicerTransformProcessorLogic::IsContinuousUpdateRequired(vtkMRMLTransformProcessorNode* paramNode)
+{
+  if (paramNode->GetProcessingMode() == vtkMRMLTransformProcessorNode::PROCESSING_MODE_STABILIZE)
+  {
+    return paramNode->GetStabilizationEnabled();
+  }
+  if (paramNode->GetProcessingMode() == vtkMRMLTransformProcessorNode::PROCESSING_MODE_QUATERNION_AVERAGE)
+  {
+    // target time of the resampled inputs moves forward even if the inputs do not change
+    return paramNode->GetTimeSynchronizationEnabled();
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::RecordTimeSynchronizationSample(vtkMRMLTransformProcessorNode* paramNode, vtkMRMLTransformNode* inputNode)
+{
+  if (!paramNode || !inputNode
+    || paramNode->GetProcessingMode() != vtkMRMLTransformProcessorNode::PROCESSING_MODE_QUATERNION_AVERAGE
+    || !paramNode->GetTimeSynchronizationEnabled())
+  {
+    return;
+  }
+  // Acquisition time of the sample: timestamp provided by the source, or the arrival time, minus the input latency
+  double sampleTimeSec = this->GetCurrentTimeSec();
+  const char* timestampSecStr = inputNode->GetAttribute(vtkMRMLTransformProcessorNode::GetInputTimestampAttributeName());
+  if (timestampSecStr)
+  {
+    bool valid = false;
+    double timestampSec = vtkVariant(timestampSecStr).ToDouble(&valid);
+    if (valid)
+    {
+      sampleTimeSec = timestampSec;
+    }
+    else
+    {
+      vtkWarningMacro("RecordTimeSynchronizationSample: invalid timestamp '" << timestampSecStr << "' in input transform "
+        << (inputNode->GetName() ? inputNode->GetName() : "(unknown)") << ", the arrival time is used instead");
+    }
+  }
+  sampleTimeSec -= paramNode->GetInputCombineTransformLatencySec(inputNode);
+
+  TimeSynchronizationHistory& history = this->TimeSynchronizationHistories[paramNode][inputNode];
+  if (!history.Samples.empty())
+  {
+    // Samples must be ordered by time. A sample with the same time as the newest one replaces it,
+    // older samples (e.g., received out of order) are ignored.
+    const double newestSampleTimeSec = history.Samples.back().TimeSec;
+    if (sampleTimeSec < newestSampleTimeSec)
+    {
+      return;
+    }
+    if (sampleTimeSec == newestSampleTimeSec)
+    {
+      history.Samples.pop_back();
+    }
+  }
+  history.Samples.emplace_back();
+  TimeSynchronizationSample& sample = history.Samples.back();
+  sample.TimeSec = sampleTimeSec;
+  // Recording may happen while another node's output is being computed, so it uses its own matrix
+  inputNode->GetMatrixTransformToParent(this->ScratchSampleMatrix);
+  std::copy(&this->ScratchSampleMatrix->Element[0][0], &this->ScratchSampleMatrix->Element[0][0] + 16, sample.Matrix);
+
+  // The target time only moves forward, so of the samples before the current target time
+  // only the newest one is needed for interpolation.
+  const double targetTimeSec = this->GetCurrentTimeSec() - paramNode->GetTimeSynchronizationDelaySec();
+  while (history.Samples.size() > 1 && history.Samples[1].TimeSec <= targetTimeSec)
+  {
+    history.Samples.pop_front();
+    history.SamplesDiscarded = true;
+  }
+  while (history.Samples.size() > TIME_SYNCHRONIZATION_MAXIMUM_HISTORY_SIZE)
+  {
+    history.Samples.pop_front();
+    history.SamplesDiscarded = true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::UpdateTimeSynchronizationHistories(vtkMRMLTransformProcessorNode* paramNode)
+{
+  auto nodeHistoriesIt = this->TimeSynchronizationHistories.find(paramNode);
+  if (nodeHistoriesIt == this->TimeSynchronizationHistories.end())
+  {
+    return;
+  }
+  if (paramNode->GetProcessingMode() != vtkMRMLTransformProcessorNode::PROCESSING_MODE_QUATERNION_AVERAGE
+    || !paramNode->GetTimeSynchronizationEnabled())
+  {
+    this->TimeSynchronizationHistories.erase(nodeHistoriesIt);
+    return;
+  }
+  std::set< vtkMRMLTransformNode* > inputNodes;
+  int numberOfInputs = paramNode->GetNumberOfInputCombineTransformNodes();
+  for (int i = 0; i < numberOfInputs; i++)
+  {
+    inputNodes.insert(paramNode->GetNthInputCombineTransformNode(i));
+  }
+  for (auto inputHistoryIt = nodeHistoriesIt->second.begin(); inputHistoryIt != nodeHistoriesIt->second.end(); )
+  {
+    if (inputNodes.find(inputHistoryIt->first) == inputNodes.end())
+    {
+      inputHistoryIt = nodeHistoriesIt->second.erase(inputHistoryIt);
+    }
+    else
+    {
+      ++inputHistoryIt;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::GetTimeSynchronizedInputMatrix(vtkMRMLTransformProcessorNode* paramNode, vtkMRMLTransformNode* inputNode,
+  double targetTimeSec, vtkMatrix4x4* inputMatrix)
+{
+  TimeSynchronizationHistory* history = nullptr;
+  auto nodeHistoriesIt = this->TimeSynchronizationHistories.find(paramNode);
+  if (nodeHistoriesIt != this->TimeSynchronizationHistories.end())
+  {
+    auto inputHistoryIt = nodeHistoriesIt->second.find(inputNode);
+    if (inputHistoryIt != nodeHistoriesIt->second.end())
+    {
+      history = &inputHistoryIt->second;
+    }
+  }
+  if (history == nullptr || history->Samples.empty())
+  {
+    // input has not changed since time synchronization was enabled
+    inputNode->GetMatrixTransformToParent(inputMatrix);
+    return;
+  }
+
+  // Find the first sample that is newer than the target time
+  const std::deque<TimeSynchronizationSample>& samples = history->Samples;
+  auto newerSampleIt = std::upper_bound(samples.begin(), samples.end(), targetTimeSec,
+    [](double timeSec, const TimeSynchronizationSample& sample) { return timeSec < sample.TimeSec; });
+  if (newerSampleIt == samples.begin())
+  {
+    if (history->SamplesDiscarded && !history->MissingSamplesWarningLogged)
+    {
+      vtkWarningMacro("GetTimeSynchronizedInputMatrix: target time is " << samples.front().TimeSec - targetTimeSec
+        << " s before the oldest recorded sample of input transform " << (inputNode->GetName() ? inputNode->GetName() : "(unknown)")
+        << ", the oldest sample is used. The time synchronization delay may have been increased.");
+      history->MissingSamplesWarningLogged = true;
+    }
+  }
+  else
+  {
+    history->MissingSamplesWarningLogged = false;
+  }
+  if (newerSampleIt == samples.begin() || newerSampleIt == samples.end())
+  {
+    // Target time is after the newest or before the oldest sample: no extrapolation, use the nearest sample
+    const double* sampleMatrix = (newerSampleIt == samples.end() ? samples.back().Matrix : samples.front().Matrix);
+    std::copy(sampleMatrix, sampleMatrix + 16, &inputMatrix->Element[0][0]);
+    inputMatrix->Modified();
+    return;
+  }
+
+  const TimeSynchronizationSample& olderSample = *(newerSampleIt - 1);
+  const TimeSynchronizationSample& newerSample = *newerSampleIt;
+  vtkMatrix4x4* olderMatrix = this->ScratchPreviousMatrix;
+  std::copy(olderSample.Matrix, olderSample.Matrix + 16, &olderMatrix->Element[0][0]);
+  vtkMatrix4x4* newerMatrix = this->ScratchNextMatrix;
+  std::copy(newerSample.Matrix, newerSample.Matrix + 16, &newerMatrix->Element[0][0]);
+  inputMatrix->Identity();
+  this->GetInterpolatedTransform(olderMatrix, newerMatrix,
+    newerSample.TimeSec - targetTimeSec, targetTimeSec - olderSample.TimeSec, inputMatrix);
+  inputMatrix->Modified();
+}
+
+//-----------------------------------------------------------------------------
+double vtkSlicerTransformProcessorLogic::GetCurrentTimeSec()
+{
+  return vtkTimerLog::GetUniversalTime();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::ProcessMRMLNodesEvents( vtkObject* caller, unsigned long event, void* callData )
 {
   vtkMRMLTransformProcessorNode* paramNode = vtkMRMLTransformProcessorNode::SafeDownCast( caller );
   if ( paramNode == NULL )
@@ -178,12 +451,41 @@ void vtkSlicerTransformProcessorLogic::ProcessMRMLNodesEvents( vtkObject* caller
     return;
   }
 
-  // these are the only two events that should be handled
-  if ( event == vtkMRMLTransformProcessorNode::InputDataModifiedEvent )
+  if ( event == vtkMRMLTransformProcessorNode::InputCombineTransformModifiedEvent )
+  {
+    // Only record the time of the change, the output is updated on InputDataModifiedEvent
+    this->RecordTimeSynchronizationSample( paramNode, vtkMRMLTransformNode::SafeDownCast( reinterpret_cast<vtkObject*>( callData ) ) );
+  }
+  else if ( event == vtkMRMLTransformProcessorNode::InputDataModifiedEvent )
   {
+    if ( this->BatchUpdateInProgress )
+    {
+      // Output of an upstream node has been modified by the batch update,
+      // all nodes that depend on it have already been updated.
+      return;
+    }
+    if ( this->BatchUpdateEnabled && !this->ProcessorNodeGraphModified && this->IsInputTransformHierarchyModified( paramNode ) )
+    {
+      // An input transform or one of its parents has been reparented, which may change dependencies between nodes.
+      // The graph is only used by batch updates, therefore it is not checked otherwise.
+      this->ProcessorNodeGraphModified = true;
+    }
     if ( paramNode->GetUpdateMode() == vtkMRMLTransformProcessorNode::UPDATE_MODE_AUTO )
     {
-      this->UpdateOutputTransform( paramNode );
+      if ( this->BatchUpdateEnabled )
+      {
+        bool firstDirtyNode = this->DirtyNodes.empty();
+        this->DirtyNodes.insert( paramNode );
+        if ( firstDirtyNode )
+        {
+          // the application has to call UpdateAllOutputs as soon as possible
+          this->InvokeEvent( UpdateScheduleModifiedEvent );
+        }
+      }
+      else
+      {
+        this->UpdateOutputTransform( paramNode );
+      }
     }
   }
   else if (event == vtkCommand::ModifiedEvent)
@@ -191,6 +493,11 @@ void vtkSlicerTransformProcessorLogic::ProcessMRMLNodesEvents( vtkObject* caller
     // This is less frequent than vtkMRMLTransformProcessorNode::InputDataModifiedEvent
     // (which is called at every input transform node change)
     this->UpdateContinuouslyUpdatedNodesList(paramNode);
+    this->UpdateTimeSynchronizationHistories(paramNode);
+    // Input or output node references may have changed
+    this->ProcessorNodeGraphModified = true;
+    // Processing mode, update mode, or update rate may have changed
+    this->InvokeEvent(UpdateScheduleModifiedEvent);
   }
 }
 
@@ -253,20 +560,38 @@ void vtkSlicerTransformProcessorLogic::QuaternionAverage( vtkMRMLTransformProces
   }
 
   // Average quaternion
-  vtkSmartPointer< vtkMatrix4x4 > resultMatrix = vtkSmartPointer< vtkMatrix4x4 >::New();
+  vtkMatrix4x4* resultMatrix = this->ScratchOutputMatrix;
+  resultMatrix->Identity();
   int numberOfInputs = paramNode->GetNumberOfInputCombineTransformNodes();
   // numberOfInputs is greater than 1, as checked by IsTransformProcessingPossible
-  vtkSmartPointer< vtkMatrix4x4 > matrix4x4Pointer = vtkSmartPointer< vtkMatrix4x4 >::New();
+  vtkMatrix4x4* matrix4x4Pointer = this->ScratchInputMatrix;
 
   float rotationMatrix[ 3 ][ 3 ] = { { 0 } };
   float averageRotationMatrix[ 3 ][ 3 ] = { { 0 } };
   float singleQuaternion[ 4 ] = { 0 };
   float averageQuaternion[ 4 ] = { 0 };
+  double averageTranslation[ 4 ] = { 0.0, 0.0, 0.0, 0.0 };
+
+  // If time synchronization is enabled then all inputs are resampled to the same point in time
+  bool timeSynchronizationEnabled = paramNode->GetTimeSynchronizationEnabled();
+  double targetTimeSec = this->GetCurrentTimeSec() - paramNode->GetTimeSynchronizationDelaySec();
 
   for ( int i = 0; i < numberOfInputs; i++ )
   {
+    if ( timeSynchronizationEnabled )
+    {
+      this->GetTimeSynchronizedInputMatrix( paramNode, paramNode->GetNthInputCombineTransformNode( i ), targetTimeSec, matrix4x4Pointer );
+    }
+    else
+    {
+      paramNode->GetNthInputCombineTransformNode( i )->GetMatrixTransformToParent( matrix4x4Pointer );
+    }
 
-    paramNode->GetNthInputCombineTransformNode( i )->GetMatrixTransformToParent( matrix4x4Pointer );
+    // linear elements are averaged separately
+    for ( int row = 0; row < 4; row++ )
+    {
+      averageTranslation[ row ] += matrix4x4Pointer->GetElement( row, 3 );
+    }
 
     for ( int row = 0; row < 3; row++ )
     {
@@ -309,17 +634,9 @@ void vtkSlicerTransformProcessorLogic::QuaternionAverage( vtkMRMLTransformProces
   }
 
   // Average linear elements
-  double value = 0;
   for ( int row = 0; row < 4; row++ )
   {
-    for ( int i = 0; i < numberOfInputs; i++ )
-    {
-      paramNode->GetNthInputCombineTransformNode( i )->GetMatrixTransformToParent( matrix4x4Pointer );
-      value += matrix4x4Pointer->GetElement( row, 3 );
-    }
-    value = value / numberOfInputs;
-    resultMatrix->SetElement( row, 3 , value );
-    value = 0;
+    resultMatrix->SetElement( row, 3, averageTranslation[ row ] / numberOfInputs );
   }
 
   outputNode->SetMatrixTransformToParent( resultMatrix );
@@ -342,16 +659,43 @@ void vtkSlicerTransformProcessorLogic::ComputeShaftPivotTransform( vtkMRMLTransf
   // Translation must be handled separately as:
   // AdjustedToInputAnchorTranslation = InputChangedToInputInitialTranslation
 
-  // first determine rotation components
   vtkMRMLTransformNode* inputChangedNode = paramNode->GetInputChangedTransformNode();
   vtkMRMLTransformNode* inputInitialNode = paramNode->GetInputInitialTransformNode();
+  vtkMRMLTransformNode* inputAnchorNode = paramNode->GetInputAnchorTransformNode();
+  double shaftDirection[ 3 ] = { 0.0, 0.0, -1.0 }; // conventional shaft direction in SlicerIGT
+
+  // If all transforms are linear then compute using matrices
+  double adjustedToInputInitialRotationOnlyMatrix[ 16 ];
+  double inputInitialToInputAnchorRotationOnlyMatrix[ 16 ];
+  double inputChangedToInputAnchorTranslationMatrix[ 16 ];
+  double* inputMatrix = &this->ScratchInputMatrix->Element[ 0 ][ 0 ];
+  if ( vtkMRMLTransformNode::GetMatrixTransformBetweenNodes( inputChangedNode, inputInitialNode, this->ScratchInputMatrix ) )
+  {
+    vtkSlicerTransformProcessorLogic::GetRotationSingleAxisWithPivotFromMatrix( inputMatrix, shaftDirection, adjustedToInputInitialRotationOnlyMatrix );
+    if ( vtkMRMLTransformNode::GetMatrixTransformBetweenNodes( inputInitialNode, inputAnchorNode, this->ScratchInputMatrix ) )
+    {
+      vtkSlicerTransformProcessorLogic::GetRotationAllAxesFromMatrix( inputMatrix, inputInitialToInputAnchorRotationOnlyMatrix );
+      if ( vtkMRMLTransformNode::GetMatrixTransformBetweenNodes( inputChangedNode, inputAnchorNode, this->ScratchInputMatrix ) )
+      {
+        bool copyComponents[ 3 ] = { 1, 1, 1 }; // copy x, y, and z
+        vtkSlicerTransformProcessorLogic::GetTranslationOnlyFromMatrix( inputMatrix, copyComponents, inputChangedToInputAnchorTranslationMatrix );
+        // adjustedToInputAnchor = translation * initialToAnchorRotation * adjustedToInitialRotation
+        double translationAndRotationMatrix[ 16 ];
+        vtkMatrix4x4::Multiply4x4( inputChangedToInputAnchorTranslationMatrix, inputInitialToInputAnchorRotationOnlyMatrix, translationAndRotationMatrix );
+        vtkMatrix4x4::Multiply4x4( translationAndRotationMatrix, adjustedToInputInitialRotationOnlyMatrix, &this->ScratchOutputMatrix->Element[ 0 ][ 0 ] );
+        // the existence of outputNode is already checked in IsTransformProcessingPossible, no error check necessary
+        paramNode->GetOutputTransformNode()->SetMatrixTransformToParent( this->ScratchOutputMatrix );
+        return;
+      }
+    }
+  }
+
+  // first determine rotation components
   vtkSmartPointer< vtkGeneralTransform > inputChangedToInputInitialTransform = vtkSmartPointer< vtkGeneralTransform >::New();
   vtkMRMLTransformNode::GetTransformBetweenNodes( inputChangedNode, inputInitialNode, inputChangedToInputInitialTransform );
-  double shaftDirection[ 3 ] = { 0.0, 0.0, -1.0 }; // conventional shaft direction in SlicerIGT
   vtkSmartPointer< vtkTransform > adjustedToInputInitialRotationOnlyTransform = vtkSmartPointer< vtkTransform >::New();
   this->GetRotationSingleAxisWithPivotFromTransform( inputChangedToInputInitialTransform, shaftDirection, adjustedToInputInitialRotationOnlyTransform );
 
-  vtkMRMLTransformNode* inputAnchorNode = paramNode->GetInputAnchorTransformNode();
   vtkSmartPointer< vtkGeneralTransform > inputInitialToInputAnchorTransform = vtkSmartPointer< vtkGeneralTransform >::New();
   vtkMRMLTransformNode::GetTransformBetweenNodes( inputInitialNode, inputAnchorNode, inputInitialToInputAnchorTransform );
   vtkSmartPointer< vtkTransform > inputInitialToInputAnchorRotationOnlyTransform = vtkSmartPointer< vtkTransform >::New();
@@ -428,10 +772,8 @@ void vtkSlicerTransformProcessorLogic::ComputeRotation( vtkMRMLTransformProcesso
       return;
   }
 
-  vtkSmartPointer< vtkGeneralTransform > fromToToGeneralTransform = vtkSmartPointer< vtkGeneralTransform >::New();
   vtkMRMLTransformNode* fromTransformNode = paramNode->GetInputFromTransformNode();
   vtkMRMLTransformNode* toTransformNode = paramNode->GetInputToTransformNode();
-  vtkMRMLTransformNode::GetTransformBetweenNodes( fromTransformNode, toTransformNode, fromToToGeneralTransform );
 
   // if there are other modes that need to check and corrrect for duplicate axes, these should be added below:
   if ( paramNode->GetDependentAxesMode() == vtkMRMLTransformProcessorNode::DEPENDENT_AXES_MODE_FROM_SECONDARY_AXIS )
@@ -440,6 +782,22 @@ void vtkSlicerTransformProcessorLogic::ComputeRotation( vtkMRMLTransformProcesso
   }
 
   // computation
+  if ( vtkMRMLTransformNode::GetMatrixTransformBetweenNodes( fromTransformNode, toTransformNode, this->ScratchInputMatrix ) )
+  {
+    if ( !vtkSlicerTransformProcessorLogic::GetRotationOnlyFromMatrix( &this->ScratchInputMatrix->Element[ 0 ][ 0 ], rotationMode, dependentAxesMode,
+      primaryAxis, secondaryAxis, &this->ScratchOutputMatrix->Element[ 0 ][ 0 ] ) )
+    {
+      vtkErrorMacro( "CopyRotation: rotationMode " << rotationMode << " is unrecognized. Returning, but no operation performed." );
+      return;
+    }
+    // the existence of outputNode is already checked in IsTransformProcessingPossible, no error check necessary
+    paramNode->GetOutputTransformNode()->SetMatrixTransformToParent( this->ScratchOutputMatrix );
+    return;
+  }
+
+  // non-linear transform between the nodes
+  vtkSmartPointer< vtkGeneralTransform > fromToToGeneralTransform = vtkSmartPointer< vtkGeneralTransform >::New();
+  vtkMRMLTransformNode::GetTransformBetweenNodes( fromTransformNode, toTransformNode, fromToToGeneralTransform );
   vtkSmartPointer< vtkTransform > fromToToRotationOnlyTransform = vtkSmartPointer< vtkTransform >::New();
   vtkSlicerTransformProcessorLogic::GetRotationOnlyFromTransform( fromToToGeneralTransform, rotationMode, dependentAxesMode, primaryAxis, secondaryAxis, fromToToRotationOnlyTransform );
   vtkMRMLTransformNode* outputNode = paramNode->GetOutputTransformNode();
@@ -459,9 +817,18 @@ void vtkSlicerTransformProcessorLogic::ComputeTranslation( vtkMRMLTransformProce
 
   // get parameters from parameter node
   const bool* copyComponents = paramNode->GetCopyTranslationComponents();
-  vtkSmartPointer< vtkGeneralTransform > fromToToGeneralTransform = vtkSmartPointer< vtkGeneralTransform >::New();
   vtkMRMLTransformNode* fromTransformNode = paramNode->GetInputFromTransformNode();
   vtkMRMLTransformNode* toTransformNode = paramNode->GetInputToTransformNode();
+  if ( vtkMRMLTransformNode::GetMatrixTransformBetweenNodes( fromTransformNode, toTransformNode, this->ScratchInputMatrix ) )
+  {
+    vtkSlicerTransformProcessorLogic::GetTranslationOnlyFromMatrix( &this->ScratchInputMatrix->Element[ 0 ][ 0 ], copyComponents, &this->ScratchOutputMatrix->Element[ 0 ][ 0 ] );
+    // the existence of outputNode is already checked in IsTransformProcessingPossible, no error check necessary
+    paramNode->GetOutputTransformNode()->SetMatrixTransformToParent( this->ScratchOutputMatrix );
+    return;
+  }
+
+  // non-linear transform between the nodes
+  vtkSmartPointer< vtkGeneralTransform > fromToToGeneralTransform = vtkSmartPointer< vtkGeneralTransform >::New();
   vtkMRMLTransformNode::GetTransformBetweenNodes( fromTransformNode, toTransformNode, fromToToGeneralTransform );
   vtkSmartPointer< vtkTransform > fromToToTranslationOnlyTransform = vtkSmartPointer< vtkTransform >::New();
   this->GetTranslationOnlyFromTransform( fromToToGeneralTransform, copyComponents, fromToToTranslationOnlyTransform );
@@ -480,9 +847,18 @@ void vtkSlicerTransformProcessorLogic::ComputeFullTransform( vtkMRMLTransformPro
     return;
   }
 
-  vtkSmartPointer< vtkGeneralTransform > fromToToGeneralTransform = vtkSmartPointer< vtkGeneralTransform >::New();
   vtkMRMLTransformNode* fromTransformNode = paramNode->GetInputFromTransformNode();
   vtkMRMLTransformNode* toTransformNode = paramNode->GetInputToTransformNode();
+  if ( vtkMRMLTransformNode::GetMatrixTransformBetweenNodes( fromTransformNode, toTransformNode, this->ScratchInputMatrix ) )
+  {
+    vtkSlicerTransformProcessorLogic::GetFullTransformFromMatrix( &this->ScratchInputMatrix->Element[ 0 ][ 0 ], &this->ScratchOutputMatrix->Element[ 0 ][ 0 ] );
+    // the existence of outputTransformNode is already checked in IsTransformProcessingPossible, no error check necessary
+    paramNode->GetOutputTransformNode()->SetMatrixTransformToParent( this->ScratchOutputMatrix );
+    return;
+  }
+
+  // non-linear transform between the nodes
+  vtkSmartPointer< vtkGeneralTransform > fromToToGeneralTransform = vtkSmartPointer< vtkGeneralTransform >::New();
   vtkMRMLTransformNode::GetTransformBetweenNodes( fromTransformNode, toTransformNode, fromToToGeneralTransform );
 
   // need to convert the general transform to a matrix. Decompose then concatenate the rotation and translation
@@ -516,7 +892,7 @@ void vtkSlicerTransformProcessorLogic::ComputeInverseTransform( vtkMRMLTransform
 
   vtkMRMLTransformNode* forwardTransformNode = paramNode->GetInputForwardTransformNode();
   // node stores the transform _to_ parent. Inverse will be the transform _from_ parent.
-  vtkSmartPointer< vtkMatrix4x4 > matrixTransformFromParent = vtkSmartPointer< vtkMatrix4x4 >::New(); 
+  vtkMatrix4x4* matrixTransformFromParent = this->ScratchOutputMatrix;
   forwardTransformNode->GetMatrixTransformFromParent( matrixTransformFromParent );
   vtkMRMLTransformNode* outputTransformNode = paramNode->GetOutputTransformNode();
   // the existence of outputTransformNode is already checked in IsTransformProcessingPossible, no error check necessary
@@ -872,6 +1248,320 @@ void vtkSlicerTransformProcessorLogic::GetRotationMatrixFromAxes( const double*
   rotationMatrix->SetElement( 2, 2, zAxis[ 2 ] );
 }
 
+//----------------------------------------------------------------------------
+bool vtkSlicerTransformProcessorLogic::GetRotationOnlyFromMatrix( const double sourceToTargetMatrix[ 16 ], int rotationMode, int dependentAxesMode,
+  const double* primaryAxis, const double* secondaryAxis, double rotationOnlyMatrix[ 16 ] )
+{
+  switch ( rotationMode )
+  {
+    case vtkMRMLTransformProcessorNode::ROTATION_MODE_COPY_ALL_AXES:
+      vtkSlicerTransformProcessorLogic::GetRotationAllAxesFromMatrix( sourceToTargetMatrix, rotationOnlyMatrix );
+      return true;
+    case vtkMRMLTransformProcessorNode::ROTATION_MODE_COPY_SINGLE_AXIS:
+      if ( dependentAxesMode == vtkMRMLTransformProcessorNode::DEPENDENT_AXES_MODE_FROM_SECONDARY_AXIS )
+      {
+        vtkSlicerTransformProcessorLogic::GetRotationSingleAxisWithSecondaryFromMatrix( sourceToTargetMatrix, primaryAxis, secondaryAxis, rotationOnlyMatrix );
+      }
+      else
+      {
+        vtkSlicerTransformProcessorLogic::GetRotationSingleAxisWithPivotFromMatrix( sourceToTargetMatrix, primaryAxis, rotationOnlyMatrix );
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::GetRotationAllAxesFromMatrix( const double sourceToTargetMatrix[ 16 ], double rotationOnlyMatrix[ 16 ] )
+{
+  for ( int row = 0; row < 3; row++ )
+  {
+    rotationOnlyMatrix[ row * 4 ] = sourceToTargetMatrix[ row * 4 ];
+    rotationOnlyMatrix[ row * 4 + 1 ] = sourceToTargetMatrix[ row * 4 + 1 ];
+    rotationOnlyMatrix[ row * 4 + 2 ] = sourceToTargetMatrix[ row * 4 + 2 ];
+    rotationOnlyMatrix[ row * 4 + 3 ] = 0.0;
+  }
+  rotationOnlyMatrix[ 12 ] = 0.0;
+  rotationOnlyMatrix[ 13 ] = 0.0;
+  rotationOnlyMatrix[ 14 ] = 0.0;
+  rotationOnlyMatrix[ 15 ] = 1.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::GetRotationSingleAxisWithPivotFromMatrix( const double sourceToTargetMatrix[ 16 ], const double* primaryAxis, double rotationOnlyMatrix[ 16 ] )
+{
+  // See GetRotationSingleAxisWithPivotFromTransform for details
+  double primaryAxisRotated[ 3 ];
+  TransformVector( sourceToTargetMatrix, primaryAxis, primaryAxisRotated );
+
+  double rotationAxisSourceToTarget[ 3 ];
+  vtkMath::Cross( primaryAxis, primaryAxisRotated, rotationAxisSourceToTarget );
+  double rotationDegreesSourceToTarget = asin( vtkMath::Norm( rotationAxisSourceToTarget ) ) * 180.0 / vtkMath::Pi();
+  bool rotationMagnitudeGreaterThan90 = ( vtkMath::Dot( primaryAxis, primaryAxisRotated ) < 0.0 );
+  if ( rotationMagnitudeGreaterThan90 )
+  {
+    rotationDegreesSourceToTarget = 180.0 - rotationDegreesSourceToTarget; // asin result is never negative
+  }
+
+  vtkMath::Normalize( rotationAxisSourceToTarget );
+  if ( vtkMath::Norm( rotationAxisSourceToTarget ) <= EPSILON )
+  {
+    rotationAxisSourceToTarget[ 0 ] = 1.0;
+    rotationAxisSourceToTarget[ 1 ] = 0.0;
+    rotationAxisSourceToTarget[ 2 ] = 0.0;
+    rotationDegreesSourceToTarget = 0.0;
+  }
+
+  SetIdentity( rotationOnlyMatrix );
+  SetRotationFromAngleAxis( rotationDegreesSourceToTarget, rotationAxisSourceToTarget, rotationOnlyMatrix );
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::GetRotationSingleAxisWithSecondaryFromMatrix( const double sourceToTargetMatrix[ 16 ], const double* primaryAxis, const double* secondaryAxis, double rotationOnlyMatrix[ 16 ] )
+{
+  // See GetRotationSingleAxisWithSecondaryFromTransform for details
+  double primarySourceAxisInTarget[ 3 ];
+  TransformVector( sourceToTargetMatrix, primaryAxis, primarySourceAxisInTarget );
+
+  double tertiaryResultAxisInTarget[ 3 ];
+  vtkMath::Cross( primarySourceAxisInTarget, secondaryAxis, tertiaryResultAxisInTarget );
+  if ( vtkMath::Norm( tertiaryResultAxisInTarget ) < EPSILON )
+  {
+    vtkMath::Perpendiculars( primarySourceAxisInTarget, tertiaryResultAxisInTarget, NULL, 0.0 );
+  }
+  vtkMath::Normalize( tertiaryResultAxisInTarget );
+
+  double secondaryResultAxisInTarget[ 3 ];
+  vtkMath::Cross( tertiaryResultAxisInTarget, primarySourceAxisInTarget, secondaryResultAxisInTarget );
+  vtkMath::Normalize( secondaryResultAxisInTarget );
+
+  double sourceToTargetLinear[ 3 ][ 3 ];
+  for ( int row = 0; row < 3; row++ )
+  {
+    for ( int column = 0; column < 3; column++ )
+    {
+      sourceToTargetLinear[ row ][ column ] = sourceToTargetMatrix[ row * 4 + column ];
+    }
+  }
+  double targetToSourceLinear[ 3 ][ 3 ];
+  vtkMath::Invert3x3( sourceToTargetLinear, targetToSourceLinear );
+  double secondaryResultAxisInSource[ 3 ];
+  vtkMath::Multiply3x3( targetToSourceLinear, secondaryResultAxisInTarget, secondaryResultAxisInSource );
+
+  double rotationAxisTargetToResult[ 3 ];
+  vtkMath::Cross( secondaryAxis, secondaryResultAxisInSource, rotationAxisTargetToResult );
+  double rotationDegreesTargetToResult = asin( vtkMath::Norm( rotationAxisTargetToResult ) ) * 180.0 / vtkMath::Pi();
+  vtkMath::Normalize( rotationAxisTargetToResult );
+  const double rotationAxisSign = ( vtkMath::Dot( rotationAxisTargetToResult, primaryAxis ) > 0 ) ? 1.0 : -1.0;
+  rotationAxisTargetToResult[ 0 ] = rotationAxisSign * primaryAxis[ 0 ];
+  rotationAxisTargetToResult[ 1 ] = rotationAxisSign * primaryAxis[ 1 ];
+  rotationAxisTargetToResult[ 2 ] = rotationAxisSign * primaryAxis[ 2 ];
+  if ( vtkMath::Dot( secondaryResultAxisInSource, secondaryAxis ) < 0 )
+  {
+    rotationDegreesTargetToResult = 180 - rotationDegreesTargetToResult;
+  }
+
+  // rotationOnly = sourceToTargetRotationOnly * rotationTargetToResult
+  double sourceToTargetRotationOnlyMatrix[ 16 ];
+  vtkSlicerTransformProcessorLogic::GetRotationAllAxesFromMatrix( sourceToTargetMatrix, sourceToTargetRotationOnlyMatrix );
+  double rotationTargetToResultMatrix[ 16 ];
+  SetIdentity( rotationTargetToResultMatrix );
+  SetRotationFromAngleAxis( rotationDegreesTargetToResult, rotationAxisTargetToResult, rotationTargetToResultMatrix );
+  vtkMatrix4x4::Multiply4x4( sourceToTargetRotationOnlyMatrix, rotationTargetToResultMatrix, rotationOnlyMatrix );
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::GetTranslationOnlyFromMatrix( const double sourceToTargetMatrix[ 16 ], const bool* copyComponents, double translationOnlyMatrix[ 16 ] )
+{
+  SetIdentity( translationOnlyMatrix );
+  for ( int dimension = 0; dimension < 3; dimension++ )
+  {
+    translationOnlyMatrix[ dimension * 4 + 3 ] = copyComponents[ dimension ] ? sourceToTargetMatrix[ dimension * 4 + 3 ] : 0.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::GetFullTransformFromMatrix( const double sourceToTargetMatrix[ 16 ], double fullTransformMatrix[ 16 ] )
+{
+  // Same as concatenating the translation-only and rotation-only transforms
+  for ( int i = 0; i < 12; i++ )
+  {
+    fullTransformMatrix[ i ] = sourceToTargetMatrix[ i ];
+  }
+  fullTransformMatrix[ 12 ] = 0.0;
+  fullTransformMatrix[ 13 ] = 0.0;
+  fullTransformMatrix[ 14 ] = 0.0;
+  fullTransformMatrix[ 15 ] = 1.0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTransformProcessorLogic::ProcessTransformSequence( vtkMRMLTransformProcessorNode* paramNode,
+  vtkMRMLSequenceNode* inputSequenceNode, vtkMRMLSequenceNode* outputSequenceNode )
+{
+  if ( paramNode == NULL || inputSequenceNode == NULL || outputSequenceNode == NULL )
+  {
+    vtkErrorMacro( "ProcessTransformSequence: invalid parameter node, input sequence, or output sequence. Returning, no operation performed." );
+    return false;
+  }
+  if ( inputSequenceNode == outputSequenceNode )
+  {
+    vtkErrorMacro( "ProcessTransformSequence: input and output sequences must be different. Returning, no operation performed." );
+    return false;
+  }
+
+  const int mode = paramNode->GetProcessingMode();
+  if ( mode != vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_ROTATION
+    && mode != vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_TRANSLATION
+    && mode != vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_FULL_TRANSFORM
+    && mode != vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_INVERSE
+    && mode != vtkMRMLTransformProcessorNode::PROCESSING_MODE_STABILIZE )
+  {
+    vtkErrorMacro( "ProcessTransformSequence: processing mode " << vtkMRMLTransformProcessorNode::GetProcessingModeAsString( mode )
+      << " is not supported for sequences. Returning, no operation performed." );
+    return false;
+  }
+
+  // Copy all input matrices into a contiguous array
+  const int numberOfItems = inputSequenceNode->GetNumberOfDataNodes();
+  std::vector< double > inputMatrices( 16 * numberOfItems );
+  std::vector< double > outputMatrices( 16 * numberOfItems );
+  vtkNew< vtkMatrix4x4 > matrix;
+  for ( int itemIndex = 0; itemIndex < numberOfItems; itemIndex++ )
+  {
+    vtkMRMLTransformNode* transformNode = vtkMRMLTransformNode::SafeDownCast( inputSequenceNode->GetNthDataNode( itemIndex ) );
+    if ( transformNode == NULL || !transformNode->IsLinear() )
+    {
+      vtkErrorMacro( "ProcessTransformSequence: item " << itemIndex << " of the input sequence is not a linear transform. Returning, no operation performed." );
+      return false;
+    }
+    transformNode->GetMatrixTransformToParent( matrix );
+    std::copy( &matrix->Element[ 0 ][ 0 ], &matrix->Element[ 0 ][ 0 ] + 16, inputMatrices.begin() + 16 * itemIndex );
+  }
+
+  const double* inputMatricesBegin = inputMatrices.data();
+  double* outputMatricesBegin = outputMatrices.data();
+  if ( mode == vtkMRMLTransformProcessorNode::PROCESSING_MODE_STABILIZE )
+  {
+    // Index values are used as timestamps, they must be numbers in increasing order
+    if ( inputSequenceNode->GetIndexType() != vtkMRMLSequenceNode::NumericIndex )
+    {
+      vtkErrorMacro( "ProcessTransformSequence: stabilization requires numeric index values (timestamps in seconds). Returning, no operation performed." );
+      return false;
+    }
+    std::vector< double > timestampsSec( numberOfItems );
+    for ( int itemIndex = 0; itemIndex < numberOfItems; itemIndex++ )
+    {
+      bool valid = false;
+      timestampsSec[ itemIndex ] = vtkVariant( inputSequenceNode->GetNthIndexValue( itemIndex ) ).ToDouble( &valid );
+      if ( !valid )
+      {
+        vtkErrorMacro( "ProcessTransformSequence: index value '" << inputSequenceNode->GetNthIndexValue( itemIndex ) << "' of item " << itemIndex
+          << " is not a valid timestamp. Returning, no operation performed." );
+        return false;
+      }
+      if ( itemIndex > 0 && timestampsSec[ itemIndex ] < timestampsSec[ itemIndex - 1 ] )
+      {
+        vtkErrorMacro( "ProcessTransformSequence: index value of item " << itemIndex << " is smaller than the previous index value,"
+          " timestamps must be in increasing order. Returning, no operation performed." );
+        return false;
+      }
+    }
+
+    // Low-pass filter, each output depends on the previous output
+    vtkNew< vtkMatrix4x4 > matrixPrevious;
+    vtkNew< vtkMatrix4x4 > matrixCurrent;
+    vtkNew< vtkMatrix4x4 > matrixOutput;
+    const double cutoffFrequency = paramNode->GetStabilizationCutOffFrequency();
+    for ( int itemIndex = 0; itemIndex < numberOfItems; itemIndex++ )
+    {
+      const double* inputMatrix = inputMatricesBegin + 16 * itemIndex;
+      double* outputMatrix = outputMatricesBegin + 16 * itemIndex;
+      if ( itemIndex == 0 || !paramNode->GetStabilizationEnabled() )
+      {
+        std::copy( inputMatrix, inputMatrix + 16, outputMatrix );
+      }
+      else
+      {
+        const double weightPrevious = 1;
+        const double weightCurrent = ( timestampsSec[ itemIndex ] - timestampsSec[ itemIndex - 1 ] ) * cutoffFrequency;
+        matrixPrevious->DeepCopy( outputMatrix - 16 );
+        matrixCurrent->DeepCopy( inputMatrix );
+        this->GetInterpolatedTransform( matrixPrevious, matrixCurrent, weightPrevious, weightCurrent, matrixOutput );
+        std::copy( &matrixOutput->Element[ 0 ][ 0 ], &matrixOutput->Element[ 0 ][ 0 ] + 16, outputMatrix );
+      }
+    }
+  }
+  else
+  {
+    // Get the parameters before going parallel
+    const int rotationMode = paramNode->GetRotationMode();
+    const int dependentAxesMode = paramNode->GetDependentAxesMode();
+    double primaryAxis[ 3 ] = { 0.0, 0.0, 0.0 };
+    double secondaryAxis[ 3 ] = { 0.0, 0.0, 0.0 };
+    if ( mode == vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_ROTATION )
+    {
+      if ( rotationMode != vtkMRMLTransformProcessorNode::ROTATION_MODE_COPY_ALL_AXES
+        && rotationMode != vtkMRMLTransformProcessorNode::ROTATION_MODE_COPY_SINGLE_AXIS )
+      {
+        vtkErrorMacro( "ProcessTransformSequence: rotationMode " << rotationMode << " is unrecognized. Returning, no operation performed." );
+        return false;
+      }
+      if ( dependentAxesMode == vtkMRMLTransformProcessorNode::DEPENDENT_AXES_MODE_FROM_SECONDARY_AXIS )
+      {
+        paramNode->CheckAndCorrectForDuplicateAxes();
+      }
+      if ( !GetAxisFromLabel( paramNode->GetPrimaryAxisLabel(), primaryAxis )
+        || !GetAxisFromLabel( paramNode->GetSecondaryAxisLabel(), secondaryAxis ) )
+      {
+        vtkErrorMacro( "ProcessTransformSequence: unrecognized axis label. Returning, no operation performed." );
+        return false;
+      }
+    }
+    bool copyComponents[ 3 ] = { true, true, true };
+    std::copy( paramNode->GetCopyTranslationComponents(), paramNode->GetCopyTranslationComponents() + 3, copyComponents );
+
+    vtkSMPTools::For( 0, numberOfItems, [&]( vtkIdType beginItemIndex, vtkIdType endItemIndex )
+    {
+      for ( vtkIdType itemIndex = beginItemIndex; itemIndex < endItemIndex; itemIndex++ )
+      {
+        const double* inputMatrix = inputMatricesBegin + 16 * itemIndex;
+        double* outputMatrix = outputMatricesBegin + 16 * itemIndex;
+        switch ( mode )
+        {
+          case vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_INVERSE:
+            vtkMatrix4x4::Invert( inputMatrix, outputMatrix );
+            break;
+          case vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_TRANSLATION:
+            vtkSlicerTransformProcessorLogic::GetTranslationOnlyFromMatrix( inputMatrix, copyComponents, outputMatrix );
+            break;
+          case vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_FULL_TRANSFORM:
+            vtkSlicerTransformProcessorLogic::GetFullTransformFromMatrix( inputMatrix, outputMatrix );
+            break;
+          case vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_ROTATION:
+            vtkSlicerTransformProcessorLogic::GetRotationOnlyFromMatrix( inputMatrix, rotationMode, dependentAxesMode, primaryAxis, secondaryAxis, outputMatrix );
+            break;
+        }
+      }
+    } );
+  }
+
+  // Write results into the output sequence
+  MRMLNodeModifyBlocker blocker( outputSequenceNode );
+  outputSequenceNode->RemoveAllDataNodes();
+  outputSequenceNode->SetIndexName( inputSequenceNode->GetIndexName() );
+  outputSequenceNode->SetIndexUnit( inputSequenceNode->GetIndexUnit() );
+  outputSequenceNode->SetIndexType( inputSequenceNode->GetIndexType() );
+  vtkNew< vtkMRMLLinearTransformNode > outputTransformNode;
+  for ( int itemIndex = 0; itemIndex < numberOfItems; itemIndex++ )
+  {
+    matrix->DeepCopy( outputMatricesBegin + 16 * itemIndex );
+    outputTransformNode->SetMatrixTransformToParent( matrix );
+    outputSequenceNode->SetDataNodeAtValue( outputTransformNode, inputSequenceNode->GetNthIndexValue( itemIndex ) );
+  }
+  return true;
+}
+
 //----------------------------------------------------------------------------
 bool vtkSlicerTransformProcessorLogic::IsTransformProcessingPossible( vtkMRMLTransformProcessorNode *node, bool verbose )
 {
@@ -966,21 +1656,14 @@ void vtkSlicerTransformProcessorLogic::ComputeStabilizedTransform(vtkMRMLTransfo
   }
 
   // Get timestamps
-  double currentTimeSec = vtkTimerLog::GetUniversalTime();
-  double lastUpdateTimeSec = 0.0;
-  const char* lastUpdateTimeSecStr = outputNode->GetAttribute("TransformProcessor.LastUpdateTimeSec");
-  if (lastUpdateTimeSecStr)
-  {
-    std::istringstream convertedStream(lastUpdateTimeSecStr);
-    convertedStream >> lastUpdateTimeSec;
-  }
-  std::stringstream ss;
-  ss.precision(4);
-  ss << std::fixed << currentTimeSec;
-  outputNode->SetAttribute("TransformProcessor.LastUpdateTimeSec", ss.str().c_str());
+  double currentTimeSec = this->GetCurrentTimeSec();
+  StabilizationInfo& stabilizationInfo = this->StabilizationInfos[paramNode];
+  double lastUpdateTimeSec = (stabilizationInfo.OutputNode == outputNode) ? stabilizationInfo.LastUpdateTimeSec : -1.0;
+  stabilizationInfo.OutputNode = outputNode;
+  stabilizationInfo.LastUpdateTimeSec = currentTimeSec;
 
   // Get matrices
-  vtkNew<vtkMatrix4x4> matrixCurrent;
+  vtkMatrix4x4* matrixCurrent = this->ScratchInputMatrix;
   inputNode->GetMatrixTransformToParent(matrixCurrent);
   
   if (lastUpdateTimeSec <= 0.0 || !paramNode->GetStabilizationEnabled())
@@ -996,10 +1679,10 @@ void vtkSlicerTransformProcessorLogic::ComputeStabilizedTransform(vtkMRMLTransfo
     const double weightPrevious = 1;
     const double weightCurrent = elapsedTimeSec * cutoff_frequency;
 
-    vtkNew<vtkMatrix4x4> matrixPrevious;
+    vtkMatrix4x4* matrixPrevious = this->ScratchPreviousMatrix;
     outputNode->GetMatrixTransformToParent(matrixPrevious);
 
-    vtkNew<vtkMatrix4x4> matrixOutput;
+    vtkMatrix4x4* matrixOutput = this->ScratchOutputMatrix;
     this->GetInterpolatedTransform(matrixPrevious, matrixCurrent, weightPrevious, weightCurrent, matrixOutput);
     outputNode->SetMatrixTransformToParent(matrixOutput);
   }
@@ -1111,12 +1794,351 @@ void vtkSlicerTransformProcessorLogic::GetInterpolatedTransform(vtkMatrix4x4* it
 //----------------------------------------------------------------------------
 void vtkSlicerTransformProcessorLogic::UpdateAllOutputs()
 {
+  const double currentTimeSec = this->GetCurrentTimeSec();
+  for (auto paramNode : this->ContinuouslyUpdatedNodes)
+  {
+    if (paramNode->GetUpdateMode() == vtkMRMLTransformProcessorNode::UPDATE_MODE_AUTO && this->IsContinuousUpdateRequired(paramNode))
+    {
+      ContinuousUpdateInfo& updateInfo = this->ContinuousUpdateInfos[paramNode];
+      if (currentTimeSec + CONTINUOUS_UPDATE_TIME_TOLERANCE_SEC < updateInfo.NextUpdateTimeSec)
+      {
+        // not due yet
+        continue;
+      }
+
+      // Update statistics
+      const double targetPeriodSec = 1.0 / paramNode->GetContinuousUpdateRateHz();
+      if (updateInfo.LastUpdateTimeSec >= 0.0)
+      {
+        const double periodSec = currentTimeSec - updateInfo.LastUpdateTimeSec;
+        const double periodErrorSec = periodSec - targetPeriodSec;
+        updateInfo.NumberOfPeriods++;
+        updateInfo.SumPeriodSec += periodSec;
+        updateInfo.SumPeriodErrorSec += periodErrorSec;
+        updateInfo.SumSquaredPeriodErrorSec2 += periodErrorSec * periodErrorSec;
+        updateInfo.MaximumLatenessSec = std::max(updateInfo.MaximumLatenessSec, currentTimeSec - updateInfo.NextUpdateTimeSec);
+      }
+      updateInfo.LastUpdateTimeSec = currentTimeSec;
+
+      // Schedule next update. Keep a fixed schedule to avoid drifting, unless we fell behind by more than a period.
+      updateInfo.NextUpdateTimeSec += targetPeriodSec;
+      if (updateInfo.NextUpdateTimeSec < currentTimeSec)
+      {
+        updateInfo.NextUpdateTimeSec = currentTimeSec + targetPeriodSec;
+      }
+
+      if (this->BatchUpdateEnabled)
+      {
+        this->DirtyNodes.insert(paramNode);
+      }
+      else
+      {
+        this->UpdateOutputTransform(paramNode);
+      }
+    }
+  }
+  if (this->BatchUpdateEnabled)
+  {
+    this->UpdateDirtyNodes();
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerTransformProcessorLogic::GetTimeUntilNextUpdateSec()
+{
+  if (this->BatchUpdateEnabled && !this->DirtyNodes.empty())
+  {
+    return 0.0;
+  }
+  const double currentTimeSec = this->GetCurrentTimeSec();
+  double timeUntilNextUpdateSec = -1.0;
   for (auto paramNode : this->ContinuouslyUpdatedNodes)
   {
-    if (paramNode->GetUpdateMode() == vtkMRMLTransformProcessorNode::UPDATE_MODE_AUTO &&
-      paramNode->GetProcessingMode() == vtkMRMLTransformProcessorNode::PROCESSING_MODE_STABILIZE && paramNode->GetStabilizationEnabled())
+    if (paramNode == nullptr || paramNode->GetUpdateMode() != vtkMRMLTransformProcessorNode::UPDATE_MODE_AUTO)
+    {
+      continue;
+    }
+    double nodeTimeUntilNextUpdateSec = std::max(0.0, this->ContinuousUpdateInfos[paramNode].NextUpdateTimeSec - currentTimeSec);
+    if (timeUntilNextUpdateSec < 0.0 || nodeTimeUntilNextUpdateSec < timeUntilNextUpdateSec)
     {
-      this->UpdateOutputTransform(paramNode);
+      timeUntilNextUpdateSec = nodeTimeUntilNextUpdateSec;
     }
   }
+  return timeUntilNextUpdateSec;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTransformProcessorLogic::GetContinuousUpdateStatistics(vtkMRMLTransformProcessorNode* paramNode,
+  double& actualRateHz, double& jitterSec, double& maximumLatenessSec)
+{
+  auto updateInfoIt = this->ContinuousUpdateInfos.find(paramNode);
+  if (updateInfoIt == this->ContinuousUpdateInfos.end() || updateInfoIt->second.NumberOfPeriods < 1)
+  {
+    return false;
+  }
+  const ContinuousUpdateInfo& updateInfo = updateInfoIt->second;
+  const double numberOfPeriods = updateInfo.NumberOfPeriods;
+  actualRateHz = (updateInfo.SumPeriodSec > 0.0 ? numberOfPeriods / updateInfo.SumPeriodSec : 0.0);
+  const double meanPeriodErrorSec = updateInfo.SumPeriodErrorSec / numberOfPeriods;
+  const double periodErrorVariance = updateInfo.SumSquaredPeriodErrorSec2 / numberOfPeriods - meanPeriodErrorSec * meanPeriodErrorSec;
+  jitterSec = sqrt(std::max(0.0, periodErrorVariance));
+  maximumLatenessSec = updateInfo.MaximumLatenessSec;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::ResetContinuousUpdateStatistics()
+{
+  for (auto& updateInfoIt : this->ContinuousUpdateInfos)
+  {
+    ContinuousUpdateInfo& updateInfo = updateInfoIt.second;
+    updateInfo.LastUpdateTimeSec = -1.0;
+    updateInfo.NumberOfPeriods = 0;
+    updateInfo.SumPeriodSec = 0.0;
+    updateInfo.SumPeriodErrorSec = 0.0;
+    updateInfo.SumSquaredPeriodErrorSec2 = 0.0;
+    updateInfo.MaximumLatenessSec = 0.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::SetBatchUpdateEnabled(bool enabled)
+{
+  if (this->BatchUpdateEnabled == enabled)
+  {
+    return;
+  }
+  if (!enabled)
+  {
+    // Make sure pending changes are not lost
+    this->UpdateDirtyNodes();
+  }
+  if (enabled)
+  {
+    // Reparenting of input transforms is not tracked while batch update is disabled
+    this->ProcessorNodeGraphModified = true;
+  }
+  this->BatchUpdateEnabled = enabled;
+  this->Modified();
+  this->InvokeEvent(UpdateScheduleModifiedEvent);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::UpdateProcessorNodeGraph()
+{
+  this->SortedProcessorNodes.clear();
+  this->SortedProcessorNodeDependencies.clear();
+  this->ProcessorNodeInputTransformHierarchies.clear();
+  this->ProcessorNodeGraphModified = false;
+
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene)
+  {
+    return;
+  }
+
+  std::vector<vtkMRMLNode*> nodes;
+  scene->GetNodesByClass("vtkMRMLTransformProcessorNode", nodes);
+  std::vector<vtkMRMLTransformProcessorNode*> processorNodes;
+  for (vtkMRMLNode* node : nodes)
+  {
+    vtkMRMLTransformProcessorNode* processorNode = vtkMRMLTransformProcessorNode::SafeDownCast(node);
+    if (processorNode)
+    {
+      processorNodes.push_back(processorNode);
+    }
+  }
+  const int numberOfNodes = static_cast<int>(processorNodes.size());
+
+  // Node A depends on node B if the output of B is any of the inputs of A or a parent of any of the inputs of A.
+  std::vector< std::vector<int> > dependencies(numberOfNodes);
+  std::vector< std::vector<int> > dependents(numberOfNodes);
+  for (int nodeIndex = 0; nodeIndex < numberOfNodes; nodeIndex++)
+  {
+    std::vector<vtkMRMLTransformNode*>& inputTransformHierarchy = this->ProcessorNodeInputTransformHierarchies[processorNodes[nodeIndex]];
+    vtkSlicerTransformProcessorLogic::GetInputTransformHierarchy(processorNodes[nodeIndex], inputTransformHierarchy);
+    for (int otherNodeIndex = 0; otherNodeIndex < numberOfNodes; otherNodeIndex++)
+    {
+      vtkMRMLTransformNode* otherOutputNode = processorNodes[otherNodeIndex]->GetOutputTransformNode();
+      if (otherNodeIndex == nodeIndex || otherOutputNode == nullptr)
+      {
+        continue;
+      }
+      bool dependsOnOtherNode = (std::find(inputTransformHierarchy.begin(), inputTransformHierarchy.end(), otherOutputNode) != inputTransformHierarchy.end());
+      if (dependsOnOtherNode)
+      {
+        dependencies[nodeIndex].push_back(otherNodeIndex);
+        dependents[otherNodeIndex].push_back(nodeIndex);
+      }
+    }
+  }
+
+  // Topological sort (Kahn's algorithm)
+  std::vector<int> sortedIndices;
+  std::vector<int> sortedPositions(numberOfNodes, -1);
+  std::vector<int> numberOfUnsortedDependencies(numberOfNodes, 0);
+  std::deque<int> readyNodeIndices;
+  for (int nodeIndex = 0; nodeIndex < numberOfNodes; nodeIndex++)
+  {
+    numberOfUnsortedDependencies[nodeIndex] = static_cast<int>(dependencies[nodeIndex].size());
+    if (numberOfUnsortedDependencies[nodeIndex] == 0)
+    {
+      readyNodeIndices.push_back(nodeIndex);
+    }
+  }
+  while (!readyNodeIndices.empty())
+  {
+    int nodeIndex = readyNodeIndices.front();
+    readyNodeIndices.pop_front();
+    sortedPositions[nodeIndex] = static_cast<int>(sortedIndices.size());
+    sortedIndices.push_back(nodeIndex);
+    for (int dependentIndex : dependents[nodeIndex])
+    {
+      numberOfUnsortedDependencies[dependentIndex]--;
+      if (numberOfUnsortedDependencies[dependentIndex] == 0)
+      {
+        readyNodeIndices.push_back(dependentIndex);
+      }
+    }
+  }
+  if (static_cast<int>(sortedIndices.size()) < numberOfNodes)
+  {
+    vtkWarningMacro("UpdateProcessorNodeGraph: circular dependency found between transform processor nodes."
+      " Nodes in the cycle are updated in scene order.");
+    for (int nodeIndex = 0; nodeIndex < numberOfNodes; nodeIndex++)
+    {
+      if (sortedPositions[nodeIndex] < 0)
+      {
+        sortedPositions[nodeIndex] = static_cast<int>(sortedIndices.size());
+        sortedIndices.push_back(nodeIndex);
+      }
+    }
+  }
+
+  // Store dependencies as positions in the sorted list.
+  // Only dependencies that are updated earlier are kept (others may only occur in cycles).
+  this->SortedProcessorNodeDependencies.resize(numberOfNodes);
+  for (int sortedPosition = 0; sortedPosition < numberOfNodes; sortedPosition++)
+  {
+    int nodeIndex = sortedIndices[sortedPosition];
+    this->SortedProcessorNodes.push_back(processorNodes[nodeIndex]);
+    for (int dependencyIndex : dependencies[nodeIndex])
+    {
+      if (sortedPositions[dependencyIndex] < sortedPosition)
+      {
+        this->SortedProcessorNodeDependencies[sortedPosition].push_back(sortedPositions[dependencyIndex]);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::GetInputTransformHierarchy(vtkMRMLTransformProcessorNode* paramNode,
+  std::vector<vtkMRMLTransformNode*>& inputTransformHierarchy)
+{
+  std::vector<vtkMRMLTransformNode*> inputTransformNodes;
+  paramNode->GetInputTransformNodes(inputTransformNodes);
+  inputTransformHierarchy.clear();
+  for (vtkMRMLTransformNode* inputTransformNode : inputTransformNodes)
+  {
+    for (vtkMRMLTransformNode* transformNode = inputTransformNode; transformNode; transformNode = transformNode->GetParentTransformNode())
+    {
+      inputTransformHierarchy.push_back(transformNode);
+    }
+    inputTransformHierarchy.push_back(nullptr);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerTransformProcessorLogic::IsInputTransformHierarchyModified(vtkMRMLTransformProcessorNode* paramNode)
+{
+  auto inputTransformHierarchyIt = this->ProcessorNodeInputTransformHierarchies.find(paramNode);
+  if (inputTransformHierarchyIt == this->ProcessorNodeInputTransformHierarchies.end())
+  {
+    // node is not in the graph yet
+    return true;
+  }
+  // Walk the current hierarchy and compare it to the stored one, as this is called at each input transform change
+  const std::vector<vtkMRMLTransformNode*>& storedHierarchy = inputTransformHierarchyIt->second;
+  std::vector<vtkMRMLTransformNode*>::const_iterator storedTransformNodeIt = storedHierarchy.begin();
+  std::vector<vtkMRMLTransformNode*> inputTransformNodes;
+  paramNode->GetInputTransformNodes(inputTransformNodes);
+  for (vtkMRMLTransformNode* inputTransformNode : inputTransformNodes)
+  {
+    for (vtkMRMLTransformNode* transformNode = inputTransformNode; transformNode; transformNode = transformNode->GetParentTransformNode())
+    {
+      if (storedTransformNodeIt == storedHierarchy.end() || *storedTransformNodeIt != transformNode)
+      {
+        return true;
+      }
+      ++storedTransformNodeIt;
+    }
+    if (storedTransformNodeIt == storedHierarchy.end() || *storedTransformNodeIt != nullptr)
+    {
+      return true;
+    }
+    ++storedTransformNodeIt;
+  }
+  return storedTransformNodeIt != storedHierarchy.end();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerTransformProcessorLogic::UpdateDirtyNodes()
+{
+  if (this->DirtyNodes.empty() || this->BatchUpdateInProgress)
+  {
+    return;
+  }
+  if (this->ProcessorNodeGraphModified)
+  {
+    this->UpdateProcessorNodeGraph();
+  }
+
+  this->BatchUpdateInProgress = true;
+
+  // Output transform nodes are kept in modifying state until all nodes are updated,
+  // so that each output invokes a single modified event at the end.
+  std::vector< std::pair<vtkMRMLTransformNode*, int> > modifiedOutputNodes;
+  const int numberOfNodes = static_cast<int>(this->SortedProcessorNodes.size());
+  std::vector<bool> nodeUpdated(numberOfNodes, false);
+  for (int nodeIndex = 0; nodeIndex < numberOfNodes; nodeIndex++)
+  {
+    vtkMRMLTransformProcessorNode* paramNode = this->SortedProcessorNodes[nodeIndex];
+    if (paramNode == nullptr)
+    {
+      continue;
+    }
+    bool updateRequired = (this->DirtyNodes.find(paramNode) != this->DirtyNodes.end());
+    if (!updateRequired && paramNode->GetUpdateMode() == vtkMRMLTransformProcessorNode::UPDATE_MODE_AUTO)
+    {
+      for (int dependencyIndex : this->SortedProcessorNodeDependencies[nodeIndex])
+      {
+        if (nodeUpdated[dependencyIndex])
+        {
+          updateRequired = true;
+          break;
+        }
+      }
+    }
+    if (!updateRequired)
+    {
+      continue;
+    }
+    vtkMRMLTransformNode* outputNode = paramNode->GetOutputTransformNode();
+    if (outputNode)
+    {
+      modifiedOutputNodes.push_back(std::make_pair(outputNode, outputNode->StartModify()));
+    }
+    this->UpdateOutputTransform(paramNode);
+    nodeUpdated[nodeIndex] = true;
+  }
+  this->DirtyNodes.clear();
+
+  // Invoke pending modified events of all output nodes
+  for (auto modifiedOutputNodeIt = modifiedOutputNodes.rbegin(); modifiedOutputNodeIt != modifiedOutputNodes.rend(); ++modifiedOutputNodeIt)
+  {
+    modifiedOutputNodeIt->first->EndModify(modifiedOutputNodeIt->second);
+  }
+
+  this->BatchUpdateInProgress = false;
 }
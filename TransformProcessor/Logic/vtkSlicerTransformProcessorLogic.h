@@ -28,6 +28,9 @@
 
 #include <string>
 #include <deque>
+#include <map>
+#include <set>
+#include <vector>
 
 // Slicer includes
 #include "vtkSlicerModuleLogic.h"
@@ -37,6 +40,7 @@
 #include "vtkMRMLNode.h"
 #include "vtkMRMLScene.h"
 
+class vtkMRMLSequenceNode;
 class vtkMRMLTransformProcessorNode;
 class vtkMRMLTransformNode;
 
@@ -61,12 +65,51 @@ public:
   static vtkSlicerTransformProcessorLogic *New();
   vtkTypeMacro( vtkSlicerTransformProcessorLogic, vtkSlicerModuleLogic );
   void PrintSelf( ostream& os, vtkIndent indent ) override;
+
+  enum Events
+  {
+    // Invoked when the time returned by GetTimeUntilNextUpdateSec may have changed for other reasons
+    // than calling UpdateAllOutputs (continuously updated nodes are added, removed, or their update rate is changed,
+    // or the first dirty node is marked in batch update mode). The application should reschedule the next UpdateAllOutputs call.
+    // vtkCommand::UserEvent + 778 is just a random value that is very unlikely to be used for anything else in this class
+    UpdateScheduleModifiedEvent = vtkCommand::UserEvent + 778
+  };
   
 public:
   // Update all output transforms that are to be updated continuously.
   // This method is called regularly by the application.
+  // Each continuously updated node is only updated if it is due, according to its ContinuousUpdateRateHz.
   void UpdateAllOutputs();
 
+  // Returns the time until the next continuously updated node is due, in seconds.
+  // Returns 0 if batch update is enabled and there are dirty nodes waiting to be updated.
+  // Returns a negative value if there are no continuously updated nodes and no dirty nodes,
+  // in this case UpdateAllOutputs does not need to be called until UpdateScheduleModifiedEvent is invoked.
+  // The application can use this to schedule the next UpdateAllOutputs call.
+  double GetTimeUntilNextUpdateSec();
+
+  // Get statistics of the continuous updates of a node since the last reset.
+  // actualRateHz: mean number of updates per second
+  // jitterSec: standard deviation of the difference between actual and target update period
+  // maximumLatenessSec: maximum delay of an update compared to its scheduled time
+  // Returns false if the node is not continuously updated or there is no statistics available yet.
+  bool GetContinuousUpdateStatistics( vtkMRMLTransformProcessorNode*, double& actualRateHz, double& jitterSec, double& maximumLatenessSec );
+  void ResetContinuousUpdateStatistics();
+
+  // If batch update is enabled then input changes of auto-update processor nodes do not trigger
+  // immediate recomputation. Instead, the node is marked as dirty and all dirty nodes are
+  // evaluated in UpdateAllOutputs: each node is updated exactly once, in dependency order
+  // (a node whose output is used as input by another node is updated first), and
+  // output transform modified events are invoked together after all nodes are updated.
+  // Disabled by default.
+  vtkGetMacro( BatchUpdateEnabled, bool );
+  void SetBatchUpdateEnabled( bool );
+  vtkBooleanMacro( BatchUpdateEnabled, bool );
+
+  // Evaluate all dirty processor nodes (and auto-update nodes depending on them) in dependency order.
+  // Called by UpdateAllOutputs if batch update is enabled.
+  void UpdateDirtyNodes();
+
   void UpdateOutputTransform( vtkMRMLTransformProcessorNode* );
   void QuaternionAverage( vtkMRMLTransformProcessorNode* );
   void ComputeShaftPivotTransform( vtkMRMLTransformProcessorNode* );
@@ -82,6 +125,26 @@ public:
   static void GetRotationSingleAxisWithSecondaryFromTransform( vtkGeneralTransform*, const double*, const double*, vtkTransform* );
   static void GetTranslationOnlyFromTransform( vtkGeneralTransform*, const bool*, vtkTransform* );
   static void GetRotationMatrixFromAxes( const double*, const double*, const double*, vtkMatrix4x4* );
+
+  // Apply the processing of the parameter node to all transforms of a recorded sequence at once.
+  // Each item of the input sequence is a linear transform node, which is processed as if it was the
+  // input transform of the processing mode (the "Forward", "Unstabilized", or "From" transform, with
+  // "To" transform being its parent). The results are written into the output sequence, with the same index values.
+  // Transforms are processed as contiguous arrays of 4x4 matrices, in parallel for modes that have no state.
+  // Stabilization uses the index values as timestamps (in seconds), therefore it is processed sequentially.
+  // Index values must be numeric and in increasing order for stabilization.
+  // Supported modes: rotation, translation, full transform, inverse, stabilize.
+  // Returns false on failure.
+  bool ProcessTransformSequence( vtkMRMLTransformProcessorNode* paramNode, vtkMRMLSequenceNode* inputSequenceNode, vtkMRMLSequenceNode* outputSequenceNode );
+
+  // Matrix kernels that compute the same results as the vtkGeneralTransform based methods above,
+  // for linear transforms. Matrices are 4x4 row-major arrays (same layout as vtkMatrix4x4::Element).
+  // Inputs and outputs must not overlap.
+  static void GetRotationAllAxesFromMatrix( const double sourceToTargetMatrix[16], double rotationOnlyMatrix[16] );
+  static void GetRotationSingleAxisWithPivotFromMatrix( const double sourceToTargetMatrix[16], const double* primaryAxis, double rotationOnlyMatrix[16] );
+  static void GetRotationSingleAxisWithSecondaryFromMatrix( const double sourceToTargetMatrix[16], const double* primaryAxis, const double* secondaryAxis, double rotationOnlyMatrix[16] );
+  static void GetTranslationOnlyFromMatrix( const double sourceToTargetMatrix[16], const bool* copyComponents, double translationOnlyMatrix[16] );
+  static void GetFullTransformFromMatrix( const double sourceToTargetMatrix[16], double fullTransformMatrix[16] );
   
 protected:
   vtkSlicerTransformProcessorLogic();
@@ -92,6 +155,10 @@ protected:
   virtual void OnMRMLSceneNodeAdded( vtkMRMLNode* node ) override;
   virtual void OnMRMLSceneNodeRemoved( vtkMRMLNode* node ) override;
   void ProcessMRMLNodesEvents( vtkObject* caller, unsigned long event, void* callData ) override;
+
+  // Current time in seconds, used for scheduling continuous updates, stabilization, and time synchronization.
+  // Tests may override it to simulate the passing of time.
+  virtual double GetCurrentTimeSec();
   
 private:
   vtkSlicerTransformProcessorLogic( const vtkSlicerTransformProcessorLogic& );// Not implemented
@@ -100,8 +167,31 @@ private:
   // these helper functions should only be used by processing modes themselves, and are therefore private
   void GetRotationOnlyFromTransform( vtkGeneralTransform*, int, int, const double*, const double*, vtkTransform* );
   void GetRotationSingleAxisFromTransform( vtkGeneralTransform*, int, const double*, const double*, vtkTransform* );
+  // Returns false if rotationMode is unrecognized, in this case rotationOnlyMatrix is not modified
+  static bool GetRotationOnlyFromMatrix( const double sourceToTargetMatrix[16], int rotationMode, int dependentAxesMode,
+    const double* primaryAxis, const double* secondaryAxis, double rotationOnlyMatrix[16] );
 
   void UpdateContinuouslyUpdatedNodesList(vtkMRMLTransformProcessorNode* paramNode);
+  // Returns true if the output of the node changes over time, even if inputs do not change
+  bool IsContinuousUpdateRequired(vtkMRMLTransformProcessorNode* paramNode);
+
+  // Add the current value of an input combine transform to its time synchronization history
+  void RecordTimeSynchronizationSample(vtkMRMLTransformProcessorNode* paramNode, vtkMRMLTransformNode* inputNode);
+  // Remove history of inputs that are no longer used by the node
+  void UpdateTimeSynchronizationHistories(vtkMRMLTransformProcessorNode* paramNode);
+  // Get the input transform at the target time by interpolating between the two nearest samples in the history.
+  // If there are no samples recorded then the current value of the input transform is returned.
+  // A warning is logged if the target time is before the oldest sample that is kept.
+  void GetTimeSynchronizedInputMatrix(vtkMRMLTransformProcessorNode* paramNode, vtkMRMLTransformNode* inputNode,
+    double targetTimeSec, vtkMatrix4x4* inputMatrix);
+
+  // Sort processor nodes of the scene so that each node comes after the nodes it depends on
+  void UpdateProcessorNodeGraph();
+  // Get the input transforms of the node, each followed by all its parent transforms and a nullptr
+  static void GetInputTransformHierarchy(vtkMRMLTransformProcessorNode* paramNode, std::vector<vtkMRMLTransformNode*>& inputTransformHierarchy);
+  // Returns true if an input transform of the node has been reparented (or any of its parents)
+  // since the processor node graph was last updated. Only checked while batch update is enabled.
+  bool IsInputTransformHierarchyModified(vtkMRMLTransformProcessorNode* paramNode);
 
   void Slerp(double* result, double t, double* from, double* to, bool adjustSign = true);
   void GetInterpolatedTransform(vtkMatrix4x4* itemAmatrix, vtkMatrix4x4* itemBmatrix,
@@ -110,6 +200,71 @@ private:
 
   std::deque< vtkWeakPointer<vtkMRMLTransformProcessorNode> > ContinuouslyUpdatedNodes;
 
+  // Pre-allocated matrices for computing outputs, to avoid allocations at each update.
+  // Linear transforms are processed using the matrix kernels, vtkGeneralTransform
+  // objects are only created for non-linear inputs.
+  vtkSmartPointer<vtkMatrix4x4> ScratchInputMatrix;
+  vtkSmartPointer<vtkMatrix4x4> ScratchPreviousMatrix;
+  vtkSmartPointer<vtkMatrix4x4> ScratchOutputMatrix;
+  vtkSmartPointer<vtkMatrix4x4> ScratchNextMatrix;
+  vtkSmartPointer<vtkMatrix4x4> ScratchSampleMatrix;
+
+  // Recent input transform values, with the time when each was acquired, ordered by time.
+  // Samples are kept back to the current target time of the time synchronization, so the number of samples
+  // depends on the input rate and the time synchronization delay. The size is limited to protect against
+  // timestamps far in the future.
+  enum
+  {
+    TIME_SYNCHRONIZATION_MAXIMUM_HISTORY_SIZE = 10000
+  };
+  struct TimeSynchronizationSample
+  {
+    double TimeSec;
+    double Matrix[ 16 ];
+  };
+  struct TimeSynchronizationHistory
+  {
+    std::deque< TimeSynchronizationSample > Samples;
+    // Set when samples are discarded, after that a target time before the oldest sample means that data is missing
+    bool SamplesDiscarded{ false };
+    bool MissingSamplesWarningLogged{ false };
+  };
+  std::map< vtkMRMLTransformProcessorNode*, std::map< vtkMRMLTransformNode*, TimeSynchronizationHistory > > TimeSynchronizationHistories;
+
+  struct ContinuousUpdateInfo
+  {
+    double NextUpdateTimeSec{ 0.0 };
+    double LastUpdateTimeSec{ -1.0 };
+    int NumberOfPeriods{ 0 };
+    double SumPeriodSec{ 0.0 };
+    double SumPeriodErrorSec{ 0.0 };
+    double SumSquaredPeriodErrorSec2{ 0.0 };
+    double MaximumLatenessSec{ 0.0 };
+  };
+  std::map< vtkMRMLTransformProcessorNode*, ContinuousUpdateInfo > ContinuousUpdateInfos;
+
+  // Time of the last stabilized output of each node. The output is only filtered if it was
+  // computed for the same output transform node.
+  struct StabilizationInfo
+  {
+    vtkWeakPointer<vtkMRMLTransformNode> OutputNode;
+    double LastUpdateTimeSec{ -1.0 };
+  };
+  std::map< vtkMRMLTransformProcessorNode*, StabilizationInfo > StabilizationInfos;
+
+  bool BatchUpdateEnabled;
+  bool BatchUpdateInProgress;
+
+  // Processor nodes in dependency order and the indices of the nodes that each node depends on
+  bool ProcessorNodeGraphModified;
+  std::vector< vtkWeakPointer<vtkMRMLTransformProcessorNode> > SortedProcessorNodes;
+  std::vector< std::vector<int> > SortedProcessorNodeDependencies;
+  // Input transform hierarchies that the current graph is computed from
+  std::map< vtkMRMLTransformProcessorNode*, std::vector<vtkMRMLTransformNode*> > ProcessorNodeInputTransformHierarchies;
+
+  // Nodes that have to be updated in the next batch update
+  std::set< vtkMRMLTransformProcessorNode* > DirtyNodes;
+
 };
 
 #endif
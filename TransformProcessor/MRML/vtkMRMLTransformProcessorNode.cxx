@@ -78,6 +78,9 @@ vtkMRMLTransformProcessorNode::vtkMRMLTransformProcessorNode()
   this->SecondaryAxisLabel = AXIS_LABEL_Y;
   this->StabilizationEnabled = true;
   this->StabilizationCutOffFrequency = 7.5;
+  this->ContinuousUpdateRateHz = 30.0;
+  this->TimeSynchronizationEnabled = false;
+  this->TimeSynchronizationDelaySec = 0.1;
 }
 
 //----------------------------------------------------------------------------
@@ -103,7 +106,31 @@ void vtkMRMLTransformProcessorNode::ReadXMLAttributes( const char** atts )
   vtkMRMLReadXMLBooleanMacro(copyTranslationZ, CopyTranslationZ);
   vtkMRMLReadXMLBooleanMacro(stabilizationEnabled, StabilizationEnabled);
   vtkMRMLReadXMLFloatMacro(stabilizationCutOffFrequency, StabilizationCutOffFrequency);
+  vtkMRMLReadXMLFloatMacro(continuousUpdateRateHz, ContinuousUpdateRateHz);
+  vtkMRMLReadXMLBooleanMacro(timeSynchronizationEnabled, TimeSynchronizationEnabled);
+  vtkMRMLReadXMLFloatMacro(timeSynchronizationDelaySec, TimeSynchronizationDelaySec);
   vtkMRMLReadXMLEndMacro();
+
+  // Input combine transform latencies are stored as a list of node ID and latency pairs
+  const char* attName;
+  const char* attValue;
+  while (*atts != NULL)
+  {
+    attName = *(atts++);
+    attValue = *(atts++);
+    if (!strcmp(attName, "inputCombineTransformLatenciesSec"))
+    {
+      this->InputCombineTransformLatenciesSec.clear();
+      std::stringstream ss;
+      ss << attValue;
+      std::string nodeId;
+      double latencySec = 0.0;
+      while (ss >> nodeId >> latencySec)
+      {
+        this->InputCombineTransformLatenciesSec[nodeId] = latencySec;
+      }
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -123,7 +150,20 @@ void vtkMRMLTransformProcessorNode::WriteXML( ostream& of, int nIndent )
   vtkMRMLWriteXMLBooleanMacro(copyTranslationZ, CopyTranslationZ);
   vtkMRMLWriteXMLBooleanMacro(stabilizationEnabled, StabilizationEnabled);
   vtkMRMLWriteXMLFloatMacro(stabilizationCutOffFrequency, StabilizationCutOffFrequency);
+  vtkMRMLWriteXMLFloatMacro(continuousUpdateRateHz, ContinuousUpdateRateHz);
+  vtkMRMLWriteXMLBooleanMacro(timeSynchronizationEnabled, TimeSynchronizationEnabled);
+  vtkMRMLWriteXMLFloatMacro(timeSynchronizationDelaySec, TimeSynchronizationDelaySec);
   vtkMRMLWriteXMLEndMacro();
+
+  if (!this->InputCombineTransformLatenciesSec.empty())
+  {
+    of << " inputCombineTransformLatenciesSec=\"";
+    for (auto latencyIt = this->InputCombineTransformLatenciesSec.begin(); latencyIt != this->InputCombineTransformLatenciesSec.end(); ++latencyIt)
+    {
+      of << (latencyIt == this->InputCombineTransformLatenciesSec.begin() ? "" : " ") << latencyIt->first << " " << latencyIt->second;
+    }
+    of << "\"";
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -142,7 +182,14 @@ void vtkMRMLTransformProcessorNode::PrintSelf( ostream& os, vtkIndent indent )
   vtkMRMLPrintBooleanMacro(CopyTranslationZ);
   vtkMRMLPrintBooleanMacro(StabilizationEnabled);
   vtkMRMLPrintFloatMacro(StabilizationCutOffFrequency);
+  vtkMRMLPrintFloatMacro(ContinuousUpdateRateHz);
+  vtkMRMLPrintBooleanMacro(TimeSynchronizationEnabled);
+  vtkMRMLPrintFloatMacro(TimeSynchronizationDelaySec);
   vtkMRMLPrintEndMacro();
+  for (auto& latencyIt : this->InputCombineTransformLatenciesSec)
+  {
+    os << indent << "InputCombineTransformLatencySec[" << latencyIt.first << "]: " << latencyIt.second << "\n";
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -163,7 +210,16 @@ void vtkMRMLTransformProcessorNode::Copy(vtkMRMLNode *anode)
   vtkMRMLCopyBooleanMacro(CopyTranslationZ);
   vtkMRMLCopyBooleanMacro(StabilizationEnabled);
   vtkMRMLCopyFloatMacro(StabilizationCutOffFrequency);
+  vtkMRMLCopyFloatMacro(ContinuousUpdateRateHz);
+  vtkMRMLCopyBooleanMacro(TimeSynchronizationEnabled);
+  vtkMRMLCopyFloatMacro(TimeSynchronizationDelaySec);
   vtkMRMLCopyEndMacro();
+
+  vtkMRMLTransformProcessorNode* node = vtkMRMLTransformProcessorNode::SafeDownCast(anode);
+  if (node)
+  {
+    this->InputCombineTransformLatenciesSec = node->InputCombineTransformLatenciesSec;
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -186,16 +242,15 @@ void vtkMRMLTransformProcessorNode::ProcessMRMLEvents( vtkObject* caller, unsign
                                         callerNode == this->GetInputForwardTransformNode() ||
                                         callerNode == this->GetInputUnstabilizedTransformNode());
   // Also check the "InputCombine" transforms:
-  if ( !callerNodeIsAnInputTransform ) // don't need to check if we already know the caller node is an input transform
+  bool callerNodeIsAnInputCombineTransform = false;
+  int numberOfInputCombineTransformNodes = GetNumberOfInputCombineTransformNodes();
+  for ( int inputCombineTransformIndex = 0; inputCombineTransformIndex < numberOfInputCombineTransformNodes; inputCombineTransformIndex++ )
   {
-    int numberOfInputCombineTransformNodes = GetNumberOfInputCombineTransformNodes();
-    for ( int inputCombineTransformIndex = 0; inputCombineTransformIndex < numberOfInputCombineTransformNodes; inputCombineTransformIndex++ )
+    if ( callerNode == GetNthInputCombineTransformNode( inputCombineTransformIndex ) )
     {
-      if ( callerNode == GetNthInputCombineTransformNode( inputCombineTransformIndex ) )
-      {
-        callerNodeIsAnInputTransform = true;
-        break;
-      }
+      callerNodeIsAnInputTransform = true;
+      callerNodeIsAnInputCombineTransform = true;
+      break;
     }
   }
 
@@ -203,6 +258,10 @@ void vtkMRMLTransformProcessorNode::ProcessMRMLEvents( vtkObject* caller, unsign
   {
     if ( event == vtkMRMLTransformNode::TransformModifiedEvent )
     {
+      if ( callerNodeIsAnInputCombineTransform )
+      {
+        this->InvokeEvent( InputCombineTransformModifiedEvent, callerNode );
+      }
       this->InvokeCustomModifiedEvent( InputDataModifiedEvent );
     }
   }
@@ -632,6 +691,39 @@ void vtkMRMLTransformProcessorNode::SetAndObserveOutputTransformNode( vtkMRMLTra
   this->SetAndObserveTransformNodeInRole( ROLE_OUTPUT_TRANSFORM, node );
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLTransformProcessorNode::GetInputTransformNodes( std::vector< vtkMRMLTransformNode* >& inputTransformNodes )
+{
+  inputTransformNodes.clear();
+  const char* singleInputRoles[] =
+  {
+    ROLE_INPUT_FROM_TRANSFORM,
+    ROLE_INPUT_TO_TRANSFORM,
+    ROLE_INPUT_INITIAL_TRANSFORM,
+    ROLE_INPUT_CHANGED_TRANSFORM,
+    ROLE_INPUT_ANCHOR_TRANSFORM,
+    ROLE_INPUT_FORWARD_TRANSFORM,
+    ROLE_INPUT_UNSTABILIZED_TRANSFORM
+  };
+  for ( const char* role : singleInputRoles )
+  {
+    vtkMRMLTransformNode* transformNode = this->GetTransformNodeInRole( role );
+    if ( transformNode )
+    {
+      inputTransformNodes.push_back( transformNode );
+    }
+  }
+  int numberOfInputCombineTransformNodes = this->GetNumberOfInputCombineTransformNodes();
+  for ( int inputCombineTransformIndex = 0; inputCombineTransformIndex < numberOfInputCombineTransformNodes; inputCombineTransformIndex++ )
+  {
+    vtkMRMLTransformNode* transformNode = this->GetNthInputCombineTransformNode( inputCombineTransformIndex );
+    if ( transformNode )
+    {
+      inputTransformNodes.push_back( transformNode );
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 const char* vtkMRMLTransformProcessorNode::GetProcessingModeAsString( int mode )
 {
@@ -843,3 +935,110 @@ void vtkMRMLTransformProcessorNode::SetStabilizationEnabled(bool enabled)
   this->Modified();
   this->InvokeCustomModifiedEvent(InputDataModifiedEvent);
 }
+
+//----------------------------------------------------------------------------
+void vtkMRMLTransformProcessorNode::SetContinuousUpdateRateHz(double rateHz)
+{
+  if (rateHz <= 0.0)
+  {
+    vtkWarningMacro("Input continuous update rate " << rateHz << " Hz is not valid, it must be positive. No change will be done.");
+    return;
+  }
+  if (this->ContinuousUpdateRateHz == rateHz)
+  {
+    // no change
+    return;
+  }
+  this->ContinuousUpdateRateHz = rateHz;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTransformProcessorNode::SetTimeSynchronizationEnabled(bool enabled)
+{
+  if (this->TimeSynchronizationEnabled == enabled)
+  {
+    // no change
+    return;
+  }
+  this->TimeSynchronizationEnabled = enabled;
+  this->Modified();
+  this->InvokeCustomModifiedEvent(InputDataModifiedEvent);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTransformProcessorNode::SetTimeSynchronizationDelaySec(double delaySec)
+{
+  if (delaySec < 0.0)
+  {
+    vtkWarningMacro("Input time synchronization delay " << delaySec << " sec is not valid, it must not be negative. No change will be done.");
+    return;
+  }
+  if (this->TimeSynchronizationDelaySec == delaySec)
+  {
+    // no change
+    return;
+  }
+  this->TimeSynchronizationDelaySec = delaySec;
+  this->Modified();
+  this->InvokeCustomModifiedEvent(InputDataModifiedEvent);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTransformProcessorNode::SetInputCombineTransformLatencySec(vtkMRMLTransformNode* node, double latencySec)
+{
+  if (node == NULL || node->GetID() == NULL)
+  {
+    vtkErrorMacro("SetInputCombineTransformLatencySec failed: invalid input transform node");
+    return;
+  }
+  if (latencySec < 0.0)
+  {
+    vtkWarningMacro("Input latency " << latencySec << " sec is not valid, it must not be negative. No change will be done.");
+    return;
+  }
+  if (this->GetInputCombineTransformLatencySec(node) == latencySec)
+  {
+    // no change
+    return;
+  }
+  if (latencySec == 0.0)
+  {
+    this->InputCombineTransformLatenciesSec.erase(node->GetID());
+  }
+  else
+  {
+    this->InputCombineTransformLatenciesSec[node->GetID()] = latencySec;
+  }
+  this->Modified();
+  this->InvokeCustomModifiedEvent(InputDataModifiedEvent);
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLTransformProcessorNode::GetInputCombineTransformLatencySec(vtkMRMLTransformNode* node)
+{
+  if (node == NULL || node->GetID() == NULL)
+  {
+    return 0.0;
+  }
+  auto latencyIt = this->InputCombineTransformLatenciesSec.find(node->GetID());
+  return (latencyIt != this->InputCombineTransformLatenciesSec.end() ? latencyIt->second : 0.0);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTransformProcessorNode::UpdateReferenceID(const char* oldID, const char* newID)
+{
+  Superclass::UpdateReferenceID(oldID, newID);
+  if (oldID == NULL || newID == NULL)
+  {
+    return;
+  }
+  auto latencyIt = this->InputCombineTransformLatenciesSec.find(oldID);
+  if (latencyIt == this->InputCombineTransformLatenciesSec.end())
+  {
+    return;
+  }
+  double latencySec = latencyIt->second;
+  this->InputCombineTransformLatenciesSec.erase(latencyIt);
+  this->InputCombineTransformLatenciesSec[newID] = latencySec;
+}
@@ -31,6 +31,11 @@
 
 #include "vtkSlicerTransformProcessorModuleMRMLExport.h"
 
+// STD includes
+#include <map>
+#include <string>
+#include <vector>
+
 /// \ingroup Slicer_QtModules_TransformProcessor
 class VTK_SLICER_TRANSFORMPROCESSOR_MODULE_MRML_EXPORT vtkMRMLTransformProcessorNode : 
   public vtkMRMLNode
@@ -45,7 +50,11 @@ public:
     // vtkCommand::UserEvent + 777 is just a random value that is very unlikely to be used for anything else in this class
 
     // TODO: Call Modified Event on output node modified?
-    InputDataModifiedEvent = vtkCommand::UserEvent + 777
+    InputDataModifiedEvent = vtkCommand::UserEvent + 777,
+    /// Invoked immediately (not deferred by StartModify/EndModify) when one of the "InputCombine"
+    /// transforms is modified. Call data is the modified transform node.
+    /// Used for recording the time of each input change for time synchronization.
+    InputCombineTransformModifiedEvent
   };
 
   enum
@@ -128,6 +137,10 @@ public:
 
   vtkMRMLTransformNode* GetOutputTransformNode();
   void SetAndObserveOutputTransformNode( vtkMRMLTransformNode* node );
+
+  /// Get all input transform nodes that are referenced by this node (in any input role).
+  /// Used for determining the dependencies between processor nodes.
+  void GetInputTransformNodes( std::vector< vtkMRMLTransformNode* >& inputTransformNodes );
   
   void ProcessMRMLEvents( vtkObject* caller, unsigned long event, void* callData ) override;
 
@@ -168,8 +181,42 @@ public:
   vtkGetMacro(StabilizationEnabled, bool);
   void SetStabilizationEnabled(bool);
 
+  /// Target update rate of continuously updated processing modes (e.g., stabilization), in Hz.
+  /// The output is recomputed at this rate even if the input transforms do not change.
+  vtkGetMacro(ContinuousUpdateRateHz, double);
+  void SetContinuousUpdateRateHz(double);
+
+  /// If enabled then in quaternion average mode each input is resampled to a common
+  /// target time (current time minus TimeSynchronizationDelaySec) before combining them,
+  /// using the recent history of the input. This removes the skew between inputs that
+  /// are coming from devices with different latencies and update rates.
+  /// The output is updated continuously, at ContinuousUpdateRateHz.
+  vtkGetMacro(TimeSynchronizationEnabled, bool);
+  void SetTimeSynchronizationEnabled(bool);
+  vtkBooleanMacro(TimeSynchronizationEnabled, bool);
+
+  /// Delay of the target time compared to the current time, in seconds.
+  /// Should be larger than the update period of the slowest input.
+  vtkGetMacro(TimeSynchronizationDelaySec, double);
+  void SetTimeSynchronizationDelaySec(double);
+
+  /// Latency of an input combine transform, in seconds: the time between the acquisition of a transform
+  /// and its arrival. In time synchronization each sample of the input is treated as if it was
+  /// acquired latencySec earlier. Default is 0.
+  void SetInputCombineTransformLatencySec(vtkMRMLTransformNode* node, double latencySec);
+  double GetInputCombineTransformLatencySec(vtkMRMLTransformNode* node);
+
+  /// Name of the input transform node attribute that stores the acquisition time of the current transform value,
+  /// in seconds, in the same time reference as vtkTimerLog::GetUniversalTime. The attribute must be set
+  /// before the transform is modified. If the attribute is not set then the time when the change
+  /// is received is used in time synchronization.
+  static const char* GetInputTimestampAttributeName() { return "TransformProcessor.TimestampSec"; };
+
   void CheckAndCorrectForDuplicateAxes();
 
+  /// Update the input combine transform latencies when node IDs are changed on scene import
+  void UpdateReferenceID(const char* oldID, const char* newID) override;
+
   static const char* GetProcessingModeAsString( int );
   static int GetProcessingModeFromString( std::string );
 
@@ -220,6 +267,11 @@ protected:
   int SecondaryAxisLabel;
   double StabilizationCutOffFrequency;
   bool StabilizationEnabled;
+  double ContinuousUpdateRateHz;
+  bool TimeSynchronizationEnabled;
+  double TimeSynchronizationDelaySec;
+  // Latencies of input combine transforms, by transform node ID. Only non-zero values are stored.
+  std::map< std::string, double > InputCombineTransformLatenciesSec;
 };
 
 #endif
@@ -0,0 +1,788 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// TransformProcessor includes
+#include <vtkMRMLTransformProcessorNode.h>
+#include <vtkSlicerTransformProcessorLogic.h>
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScene.h>
+
+// Sequences MRML includes
+#include <vtkMRMLSequenceNode.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+  // Continuous update scheduling is tested with simulated time
+  const double FAST_UPDATE_RATE_HZ = 20.0;
+  const double SLOW_UPDATE_RATE_HZ = 8.0;
+  const double SCHEDULING_TEST_DURATION_SEC = 1.5;
+  const double MAXIMUM_TIME_DIFFERENCE_SEC = 1.0e-9;
+  const double MAXIMUM_MATRIX_DIFFERENCE = 1.0e-6;
+
+  //----------------------------------------------------------------------------
+  double GetMatrixDifference( vtkMatrix4x4* matrixA, vtkMatrix4x4* matrixB )
+  {
+    double maximumDifference = 0.0;
+    for ( int row = 0; row < 4; row++ )
+    {
+      for ( int column = 0; column < 4; column++ )
+      {
+        maximumDifference = std::max( maximumDifference, std::abs( matrixA->GetElement( row, column ) - matrixB->GetElement( row, column ) ) );
+      }
+    }
+    return maximumDifference;
+  }
+
+  //----------------------------------------------------------------------------
+  void OnUpdateScheduleModified( vtkObject* vtkNotUsed( caller ), unsigned long vtkNotUsed( eid ), void* clientData, void* vtkNotUsed( callData ) )
+  {
+    int* numberOfScheduleModifiedEvents = reinterpret_cast<int*>( clientData );
+    ( *numberOfScheduleModifiedEvents )++;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkMRMLTransformProcessorNode* AddStabilizerNode( vtkMRMLScene* scene, vtkMRMLTransformNode* inputNode, double updateRateHz )
+  {
+    vtkMRMLLinearTransformNode* outputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode" ) );
+    vtkMRMLTransformProcessorNode* paramNode = vtkMRMLTransformProcessorNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLTransformProcessorNode" ) );
+    paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_STABILIZE );
+    paramNode->SetAndObserveInputUnstabilizedTransformNode( inputNode );
+    paramNode->SetAndObserveOutputTransformNode( outputNode );
+    paramNode->SetContinuousUpdateRateHz( updateRateHz );
+    paramNode->SetUpdateModeToAuto();
+    return paramNode;
+  }
+
+  //----------------------------------------------------------------------------
+  // Logic with a simulated clock, so that scheduling can be tested without waiting
+  class vtkTransformProcessorLogicWithTestClock : public vtkSlicerTransformProcessorLogic
+  {
+  public:
+    static vtkTransformProcessorLogicWithTestClock* New();
+    vtkTypeMacro( vtkTransformProcessorLogicWithTestClock, vtkSlicerTransformProcessorLogic );
+
+    double CurrentTimeSec{ 1000.0 };
+
+  protected:
+    double GetCurrentTimeSec() override
+    {
+      return this->CurrentTimeSec;
+    }
+  };
+  vtkStandardNewMacro( vtkTransformProcessorLogicWithTestClock );
+
+  //----------------------------------------------------------------------------
+  // With a simulated clock updates happen exactly when they are due, so the statistics must be exact
+  bool CheckUpdateStatistics( vtkSlicerTransformProcessorLogic* logic, vtkMRMLTransformProcessorNode* paramNode )
+  {
+    double actualRateHz = 0.0;
+    double jitterSec = 0.0;
+    double maximumLatenessSec = 0.0;
+    if ( !logic->GetContinuousUpdateStatistics( paramNode, actualRateHz, jitterSec, maximumLatenessSec ) )
+    {
+      std::cerr << "No continuous update statistics available for node " << paramNode->GetID() << std::endl;
+      return false;
+    }
+    const double targetRateHz = paramNode->GetContinuousUpdateRateHz();
+    std::cout << "Target rate: " << targetRateHz << " Hz, actual rate: " << actualRateHz << " Hz, jitter: " << jitterSec * 1000.0
+      << " ms, maximum lateness: " << maximumLatenessSec * 1000.0 << " ms" << std::endl;
+    if ( std::abs( actualRateHz - targetRateHz ) > MAXIMUM_TIME_DIFFERENCE_SEC * targetRateHz )
+    {
+      std::cerr << "Actual update rate " << actualRateHz << " Hz differs from target rate " << targetRateHz << " Hz" << std::endl;
+      return false;
+    }
+    if ( jitterSec > MAXIMUM_TIME_DIFFERENCE_SEC || maximumLatenessSec > MAXIMUM_TIME_DIFFERENCE_SEC )
+    {
+      std::cerr << "Unexpected jitter (" << jitterSec << " s) or maximum lateness (" << maximumLatenessSec << " s)" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Nodes with different rates are updated by a single timer that is always restarted with GetTimeUntilNextUpdateSec,
+  // as the module does. The wait time must never exceed the period of the fastest node.
+  // Time is simulated, the timer is assumed to fire exactly after the requested wait time.
+  bool TestContinuousUpdateScheduling()
+  {
+    std::cout << "=================================================================" << std::endl;
+    std::cout << "Starting continuous update scheduling test..." << std::endl;
+
+    vtkNew<vtkMRMLScene> scene;
+    vtkNew<vtkTransformProcessorLogicWithTestClock> logic;
+    logic->SetMRMLScene( scene );
+
+    int numberOfScheduleModifiedEvents = 0;
+    vtkNew<vtkCallbackCommand> scheduleModifiedCallback;
+    scheduleModifiedCallback->SetCallback( OnUpdateScheduleModified );
+    scheduleModifiedCallback->SetClientData( &numberOfScheduleModifiedEvents );
+    logic->AddObserver( vtkSlicerTransformProcessorLogic::UpdateScheduleModifiedEvent, scheduleModifiedCallback );
+
+    vtkMRMLLinearTransformNode* inputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "Unstabilized" ) );
+    vtkMRMLTransformProcessorNode* fastNode = AddStabilizerNode( scene, inputNode, FAST_UPDATE_RATE_HZ );
+    vtkMRMLTransformProcessorNode* slowNode = AddStabilizerNode( scene, inputNode, SLOW_UPDATE_RATE_HZ );
+
+    // Without stabilization the output only changes when the input changes, so there is nothing to schedule
+    if ( logic->GetTimeUntilNextUpdateSec() >= 0.0 )
+    {
+      std::cerr << "Update is scheduled although there are no continuously updated nodes" << std::endl;
+      return false;
+    }
+
+    numberOfScheduleModifiedEvents = 0;
+    fastNode->SetStabilizationEnabled( true );
+    slowNode->SetStabilizationEnabled( true );
+    if ( numberOfScheduleModifiedEvents < 2 )
+    {
+      std::cerr << "UpdateScheduleModifiedEvent is not invoked when continuous update is enabled" << std::endl;
+      return false;
+    }
+    if ( logic->GetTimeUntilNextUpdateSec() != 0.0 )
+    {
+      std::cerr << "Newly continuously updated nodes are not due immediately" << std::endl;
+      return false;
+    }
+
+    // Wait times follow the combined schedule of the two nodes
+    const double fastPeriodSec = 1.0 / FAST_UPDATE_RATE_HZ;
+    const double slowPeriodSec = 1.0 / SLOW_UPDATE_RATE_HZ;
+    const double startTimeSec = logic->CurrentTimeSec;
+    double nextFastUpdateTimeSec = startTimeSec;
+    double nextSlowUpdateTimeSec = startTimeSec;
+    vtkNew<vtkTransform> inputTransform;
+    for ( int updateIndex = 0; logic->CurrentTimeSec - startTimeSec < SCHEDULING_TEST_DURATION_SEC; updateIndex++ )
+    {
+      double expectedTimeUntilNextUpdateSec = std::min( nextFastUpdateTimeSec, nextSlowUpdateTimeSec ) - logic->CurrentTimeSec;
+      double timeUntilNextUpdateSec = logic->GetTimeUntilNextUpdateSec();
+      if ( std::abs( timeUntilNextUpdateSec - expectedTimeUntilNextUpdateSec ) > MAXIMUM_TIME_DIFFERENCE_SEC || timeUntilNextUpdateSec > fastPeriodSec )
+      {
+        std::cerr << "Time until next update is " << timeUntilNextUpdateSec << " s, expected " << expectedTimeUntilNextUpdateSec << " s" << std::endl;
+        return false;
+      }
+      logic->CurrentTimeSec += timeUntilNextUpdateSec;
+      if ( std::abs( logic->CurrentTimeSec - nextFastUpdateTimeSec ) <= MAXIMUM_TIME_DIFFERENCE_SEC )
+      {
+        nextFastUpdateTimeSec += fastPeriodSec;
+      }
+      if ( std::abs( logic->CurrentTimeSec - nextSlowUpdateTimeSec ) <= MAXIMUM_TIME_DIFFERENCE_SEC )
+      {
+        nextSlowUpdateTimeSec += slowPeriodSec;
+      }
+      inputTransform->Identity();
+      inputTransform->Translate( 0.1 * updateIndex, 0.0, 0.0 );
+      inputNode->SetMatrixTransformToParent( inputTransform->GetMatrix() );
+      logic->UpdateAllOutputs();
+    }
+    if ( !CheckUpdateStatistics( logic, fastNode ) || !CheckUpdateStatistics( logic, slowNode ) )
+    {
+      return false;
+    }
+
+    // If the application falls behind by more than a period then the lateness is reported and both nodes
+    // are rescheduled from the current time, without trying to catch up with the missed updates
+    double actualRateHz = 0.0;
+    double jitterSec = 0.0;
+    double maximumLatenessSec = 0.0;
+    logic->ResetContinuousUpdateStatistics();
+    logic->CurrentTimeSec = nextFastUpdateTimeSec;
+    logic->UpdateAllOutputs();
+    const double scheduledFastUpdateTimeSec = nextFastUpdateTimeSec + fastPeriodSec;
+    logic->CurrentTimeSec = std::max( nextFastUpdateTimeSec, nextSlowUpdateTimeSec ) + 2.0 * slowPeriodSec + 0.3 * fastPeriodSec;
+    logic->UpdateAllOutputs();
+    const double expectedLatenessSec = logic->CurrentTimeSec - scheduledFastUpdateTimeSec;
+    if ( !logic->GetContinuousUpdateStatistics( fastNode, actualRateHz, jitterSec, maximumLatenessSec )
+      || std::abs( maximumLatenessSec - expectedLatenessSec ) > MAXIMUM_TIME_DIFFERENCE_SEC )
+    {
+      std::cerr << "Maximum lateness after falling behind is " << maximumLatenessSec << " s, expected " << expectedLatenessSec << " s" << std::endl;
+      return false;
+    }
+    double timeUntilNextUpdateSec = logic->GetTimeUntilNextUpdateSec();
+    if ( std::abs( timeUntilNextUpdateSec - fastPeriodSec ) > MAXIMUM_TIME_DIFFERENCE_SEC )
+    {
+      std::cerr << "Time until next update after falling behind is " << timeUntilNextUpdateSec << " s, expected " << fastPeriodSec << " s" << std::endl;
+      return false;
+    }
+
+    logic->ResetContinuousUpdateStatistics();
+    if ( logic->GetContinuousUpdateStatistics( fastNode, actualRateHz, jitterSec, maximumLatenessSec ) )
+    {
+      std::cerr << "Statistics are available after reset" << std::endl;
+      return false;
+    }
+
+    // Only the slow node remains, the wait time must follow its period
+    fastNode->SetStabilizationEnabled( false );
+    if ( logic->GetContinuousUpdateStatistics( fastNode, actualRateHz, jitterSec, maximumLatenessSec ) )
+    {
+      std::cerr << "Statistics are available for a node that is not continuously updated" << std::endl;
+      return false;
+    }
+    logic->UpdateAllOutputs();
+    timeUntilNextUpdateSec = logic->GetTimeUntilNextUpdateSec();
+    if ( std::abs( timeUntilNextUpdateSec - slowPeriodSec ) > MAXIMUM_TIME_DIFFERENCE_SEC )
+    {
+      std::cerr << "Time until next update of the slow node is " << timeUntilNextUpdateSec << " s, expected " << slowPeriodSec << " s" << std::endl;
+      return false;
+    }
+
+    numberOfScheduleModifiedEvents = 0;
+    slowNode->SetStabilizationEnabled( false );
+    if ( numberOfScheduleModifiedEvents < 1 || logic->GetTimeUntilNextUpdateSec() >= 0.0 )
+    {
+      std::cerr << "Update is still scheduled after continuous update is disabled" << std::endl;
+      return false;
+    }
+
+    // Dirty nodes in batch update mode are due immediately
+    logic->SetBatchUpdateEnabled( true );
+    numberOfScheduleModifiedEvents = 0;
+    inputNode->SetMatrixTransformToParent( inputTransform->GetMatrix() );
+    if ( numberOfScheduleModifiedEvents != 1 || logic->GetTimeUntilNextUpdateSec() != 0.0 )
+    {
+      std::cerr << "Dirty nodes are not scheduled for immediate update" << std::endl;
+      return false;
+    }
+    logic->UpdateAllOutputs();
+    if ( logic->GetTimeUntilNextUpdateSec() >= 0.0 )
+    {
+      std::cerr << "Update is still scheduled after dirty nodes are updated" << std::endl;
+      return false;
+    }
+    logic->SetBatchUpdateEnabled( false );
+
+    logic->RemoveObserver( scheduleModifiedCallback );
+
+    std::cout << "Continuous update scheduling test completed successfully." << std::endl;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Chain of processors where the dependency is created by reparenting an input transform under the output of another processor.
+  // Nodes are added in reverse dependency order, so the batch update is only correct if the graph is updated after the reparenting.
+  // Reparenting is not tracked while batch update is disabled, the graph must be updated when batch update is enabled again.
+  bool TestProcessorNodeGraphReparent( vtkMRMLScene* scene, vtkSlicerTransformProcessorLogic* logic, bool reparentWithBatchUpdateDisabled )
+  {
+    std::cout << "=================================================================" << std::endl;
+    std::cout << "Starting processor node graph reparenting test (batch update "
+      << ( reparentWithBatchUpdateDisabled ? "disabled" : "enabled" ) << " during reparenting)..." << std::endl;
+
+    logic->SetBatchUpdateEnabled( true );
+
+    vtkMRMLLinearTransformNode* forwardNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "Forward" ) );
+    vtkMRMLLinearTransformNode* inverseNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "Inverse" ) );
+    vtkMRMLLinearTransformNode* toolNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "Tool" ) );
+    vtkMRMLLinearTransformNode* toolToWorldNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "ToolToWorld" ) );
+    vtkMRMLLinearTransformNode* worldToToolNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "WorldToTool" ) );
+
+    // WorldToTool = inverse of ToolToWorld
+    vtkMRMLTransformProcessorNode* worldToToolProcessorNode = vtkMRMLTransformProcessorNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLTransformProcessorNode" ) );
+    worldToToolProcessorNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_INVERSE );
+    worldToToolProcessorNode->SetAndObserveInputForwardTransformNode( toolToWorldNode );
+    worldToToolProcessorNode->SetAndObserveOutputTransformNode( worldToToolNode );
+    worldToToolProcessorNode->SetUpdateModeToAuto();
+
+    // ToolToWorld = full transform from Tool to world
+    vtkMRMLTransformProcessorNode* toolToWorldProcessorNode = vtkMRMLTransformProcessorNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLTransformProcessorNode" ) );
+    toolToWorldProcessorNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_FULL_TRANSFORM );
+    toolToWorldProcessorNode->SetAndObserveInputFromTransformNode( toolNode );
+    toolToWorldProcessorNode->SetAndObserveOutputTransformNode( toolToWorldNode );
+    toolToWorldProcessorNode->SetUpdateModeToAuto();
+
+    // Inverse = inverse of Forward
+    vtkMRMLTransformProcessorNode* inverseProcessorNode = vtkMRMLTransformProcessorNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLTransformProcessorNode" ) );
+    inverseProcessorNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_INVERSE );
+    inverseProcessorNode->SetAndObserveInputForwardTransformNode( forwardNode );
+    inverseProcessorNode->SetAndObserveOutputTransformNode( inverseNode );
+    inverseProcessorNode->SetUpdateModeToAuto();
+
+    vtkNew<vtkTransform> transform;
+    transform->Translate( 10.0, -20.0, 30.0 );
+    transform->RotateWXYZ( 30.0, 1.0, 2.0, 3.0 );
+    toolNode->SetMatrixTransformToParent( transform->GetMatrix() );
+    transform->Identity();
+    transform->Translate( 5.0, 0.0, -3.0 );
+    transform->RotateX( 20.0 );
+    forwardNode->SetMatrixTransformToParent( transform->GetMatrix() );
+    logic->UpdateAllOutputs();
+
+    // Tool is now attached to the output of the inverse processor, so the other two processors depend on it
+    if ( reparentWithBatchUpdateDisabled )
+    {
+      logic->SetBatchUpdateEnabled( false );
+    }
+    toolNode->SetAndObserveTransformNodeID( inverseNode->GetID() );
+    logic->SetBatchUpdateEnabled( true );
+    logic->UpdateAllOutputs();
+
+    // Only the inverse processor is dirty, processors that depend on it must be updated after it in the same batch
+    vtkNew<vtkMatrix4x4> expectedMatrix;
+    vtkNew<vtkMatrix4x4> actualMatrix;
+    bool success = true;
+    for ( int updateIndex = 0; success && updateIndex < 5; updateIndex++ )
+    {
+      transform->RotateY( 15.0 );
+      transform->Translate( 1.0, 2.0, 3.0 );
+      forwardNode->SetMatrixTransformToParent( transform->GetMatrix() );
+      logic->UpdateAllOutputs();
+
+      toolNode->GetMatrixTransformToWorld( expectedMatrix );
+      toolToWorldNode->GetMatrixTransformToParent( actualMatrix );
+      if ( GetMatrixDifference( expectedMatrix, actualMatrix ) > MAXIMUM_MATRIX_DIFFERENCE )
+      {
+        std::cerr << "ToolToWorld output is not updated after the input transform is reparented (update " << updateIndex << ")" << std::endl;
+        success = false;
+      }
+      expectedMatrix->Invert();
+      worldToToolNode->GetMatrixTransformToParent( actualMatrix );
+      if ( GetMatrixDifference( expectedMatrix, actualMatrix ) > MAXIMUM_MATRIX_DIFFERENCE )
+      {
+        std::cerr << "WorldToTool output is not updated after the input transform is reparented (update " << updateIndex << ")" << std::endl;
+        success = false;
+      }
+    }
+
+    logic->SetBatchUpdateEnabled( false );
+    scene->RemoveNode( worldToToolProcessorNode );
+    scene->RemoveNode( toolToWorldProcessorNode );
+    scene->RemoveNode( inverseProcessorNode );
+    if ( !success )
+    {
+      return false;
+    }
+
+    std::cout << "Processor node graph reparenting test completed successfully." << std::endl;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void SetInputSample( vtkMRMLTransformNode* inputNode, double timestampSec, double rotationDeg, double translationX )
+  {
+    std::ostringstream timestampSecStr;
+    timestampSecStr << std::setprecision( 17 ) << timestampSec;
+    inputNode->SetAttribute( vtkMRMLTransformProcessorNode::GetInputTimestampAttributeName(), timestampSecStr.str().c_str() );
+    vtkNew<vtkTransform> transform;
+    transform->Translate( translationX, 0.0, 0.0 );
+    transform->RotateZ( rotationDeg );
+    inputNode->SetMatrixTransformToParent( transform->GetMatrix() );
+  }
+
+  //----------------------------------------------------------------------------
+  // Inputs are resampled to the target time by interpolating between the samples before and after it.
+  // Sample times are given by source timestamps, and the second input has a latency that is compensated.
+  bool TestTimeSynchronizedAverage( vtkMRMLScene* scene, vtkSlicerTransformProcessorLogic* logic )
+  {
+    std::cout << "=================================================================" << std::endl;
+    std::cout << "Starting time synchronized average test..." << std::endl;
+
+    const double delaySec = 1.0;
+    const double sampleIntervalSec = 20.0;
+    const double latencySec = 5.0;
+
+    vtkMRMLLinearTransformNode* firstInputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "FirstInput" ) );
+    vtkMRMLLinearTransformNode* secondInputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "SecondInput" ) );
+    vtkMRMLLinearTransformNode* outputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "Average" ) );
+    vtkMRMLTransformProcessorNode* paramNode = vtkMRMLTransformProcessorNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLTransformProcessorNode" ) );
+    paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_QUATERNION_AVERAGE );
+    paramNode->AddAndObserveInputCombineTransformNode( firstInputNode );
+    paramNode->AddAndObserveInputCombineTransformNode( secondInputNode );
+    paramNode->SetAndObserveOutputTransformNode( outputNode );
+    paramNode->SetTimeSynchronizationDelaySec( delaySec );
+    paramNode->SetInputCombineTransformLatencySec( secondInputNode, latencySec );
+    paramNode->SetTimeSynchronizationEnabled( true );
+    if ( paramNode->GetInputCombineTransformLatencySec( secondInputNode ) != latencySec || paramNode->GetInputCombineTransformLatencySec( firstInputNode ) != 0.0 )
+    {
+      std::cerr << "Input latency is not stored" << std::endl;
+      return false;
+    }
+
+    // The target time is in the middle between the two samples of both inputs.
+    // The second input receives the same poses with timestamps that are later by its latency.
+    const double targetTimeSec = vtkTimerLog::GetUniversalTime() - delaySec;
+    SetInputSample( firstInputNode, targetTimeSec - 0.5 * sampleIntervalSec, 0.0, 0.0 );
+    SetInputSample( firstInputNode, targetTimeSec + 0.5 * sampleIntervalSec, 90.0, 100.0 );
+    SetInputSample( secondInputNode, targetTimeSec - 0.5 * sampleIntervalSec + latencySec, 0.0, 0.0 );
+    // sample received out of order is ignored
+    SetInputSample( secondInputNode, targetTimeSec - sampleIntervalSec + latencySec, 180.0, -100.0 );
+    SetInputSample( secondInputNode, targetTimeSec + 0.5 * sampleIntervalSec + latencySec, 90.0, 100.0 );
+
+    logic->UpdateOutputTransform( paramNode );
+
+    // Time elapsed since the target time was computed moves the interpolation point by a negligible amount
+    const double tolerance = 1.0e-2;
+    vtkNew<vtkMatrix4x4> outputMatrix;
+    outputNode->GetMatrixTransformToParent( outputMatrix );
+    const double expectedCos = cos( vtkMath::RadiansFromDegrees( 45.0 ) );
+    bool success = true;
+    if ( std::abs( outputMatrix->GetElement( 0, 3 ) - 50.0 ) > tolerance
+      || std::abs( outputMatrix->GetElement( 1, 3 ) ) > tolerance || std::abs( outputMatrix->GetElement( 2, 3 ) ) > tolerance )
+    {
+      std::cerr << "Interpolated translation is (" << outputMatrix->GetElement( 0, 3 ) << ", " << outputMatrix->GetElement( 1, 3 )
+        << ", " << outputMatrix->GetElement( 2, 3 ) << "), expected (50, 0, 0)" << std::endl;
+      success = false;
+    }
+    if ( std::abs( outputMatrix->GetElement( 0, 0 ) - expectedCos ) > tolerance || std::abs( outputMatrix->GetElement( 1, 0 ) - expectedCos ) > tolerance
+      || std::abs( outputMatrix->GetElement( 2, 2 ) - 1.0 ) > tolerance )
+    {
+      std::cerr << "Interpolated rotation is not 45 degrees around the Z axis" << std::endl;
+      outputMatrix->PrintSelf( std::cerr, vtkIndent() );
+      success = false;
+    }
+
+    scene->RemoveNode( paramNode );
+    if ( !success )
+    {
+      return false;
+    }
+
+    std::cout << "Time synchronized average test completed successfully." << std::endl;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Inputs that are received at a high rate must keep enough samples to cover the time synchronization delay.
+  // The inputs move along the X axis at constant speed, so the expected output is known at any time.
+  bool TestTimeSynchronizationHighRate( vtkMRMLScene* scene, vtkSlicerTransformProcessorLogic* logic )
+  {
+    std::cout << "=================================================================" << std::endl;
+    std::cout << "Starting high rate time synchronization test..." << std::endl;
+
+    const double delaySec = 0.1;
+    const double inputRateHz = 500.0;
+    const double recordingDurationSec = 0.3;
+    const double speedMmPerSec = 10.0;
+
+    vtkMRMLLinearTransformNode* firstInputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "FirstFastInput" ) );
+    vtkMRMLLinearTransformNode* secondInputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "SecondFastInput" ) );
+    vtkMRMLLinearTransformNode* outputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "FastAverage" ) );
+    vtkMRMLTransformProcessorNode* paramNode = vtkMRMLTransformProcessorNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLTransformProcessorNode" ) );
+    paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_QUATERNION_AVERAGE );
+    paramNode->AddAndObserveInputCombineTransformNode( firstInputNode );
+    paramNode->AddAndObserveInputCombineTransformNode( secondInputNode );
+    paramNode->SetAndObserveOutputTransformNode( outputNode );
+    paramNode->SetTimeSynchronizationDelaySec( delaySec );
+    paramNode->SetTimeSynchronizationEnabled( true );
+
+    // Samples of the last recordingDurationSec, which is several times more than the delay
+    const double startTimeSec = vtkTimerLog::GetUniversalTime() - recordingDurationSec;
+    const int numberOfSamples = static_cast<int>( recordingDurationSec * inputRateHz );
+    for ( int sampleIndex = 0; sampleIndex <= numberOfSamples; sampleIndex++ )
+    {
+      const double sampleTimeSec = startTimeSec + sampleIndex / inputRateHz;
+      SetInputSample( firstInputNode, sampleTimeSec, 0.0, speedMmPerSec * ( sampleTimeSec - startTimeSec ) );
+      SetInputSample( secondInputNode, sampleTimeSec, 0.0, speedMmPerSec * ( sampleTimeSec - startTimeSec ) );
+    }
+
+    // Time elapsed between computing the expected value and the update moves the output by less than the tolerance
+    const double tolerance = 0.05;
+    vtkNew<vtkMatrix4x4> outputMatrix;
+    logic->UpdateOutputTransform( paramNode );
+    double expectedTranslationX = speedMmPerSec * ( vtkTimerLog::GetUniversalTime() - delaySec - startTimeSec );
+    outputNode->GetMatrixTransformToParent( outputMatrix );
+    bool success = true;
+    if ( std::abs( outputMatrix->GetElement( 0, 3 ) - expectedTranslationX ) > tolerance )
+    {
+      std::cerr << "Output translation at " << inputRateHz << " Hz input rate is " << outputMatrix->GetElement( 0, 3 )
+        << ", expected " << expectedTranslationX << std::endl;
+      success = false;
+    }
+
+    // Samples before the target time were discarded, so increasing the delay is reported
+    paramNode->SetTimeSynchronizationDelaySec( 2.0 * delaySec );
+    TESTING_OUTPUT_ASSERT_WARNINGS_BEGIN();
+    logic->UpdateOutputTransform( paramNode );
+    TESTING_OUTPUT_ASSERT_WARNINGS_END();
+
+    scene->RemoveNode( paramNode );
+    if ( !success )
+    {
+      return false;
+    }
+
+    std::cout << "High rate time synchronization test completed successfully." << std::endl;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Expected outputs of the processing modes for a rigid input transform with world as target.
+  // These are computed from the definition of each mode, independently of the processor implementation.
+  typedef void ( *ExpectedOutputFunction )( vtkMatrix4x4* inputMatrix, vtkMatrix4x4* expectedMatrix );
+
+  //----------------------------------------------------------------------------
+  // Rotation that maps the primary (Z) axis the same way as the input and keeps
+  // the secondary (Y) axis as close as possible to the secondary axis of the target
+  void GetExpectedSingleAxisRotation( vtkMatrix4x4* inputMatrix, vtkMatrix4x4* expectedMatrix )
+  {
+    const double primaryAxis[ 3 ] = { 0.0, 0.0, 1.0 };
+    const double secondaryAxis[ 3 ] = { 0.0, 1.0, 0.0 };
+    double tertiaryAxis[ 3 ];
+    vtkMath::Cross( primaryAxis, secondaryAxis, tertiaryAxis );
+
+    double primaryOutputAxis[ 3 ];
+    for ( int row = 0; row < 3; row++ )
+    {
+      primaryOutputAxis[ row ] = inputMatrix->GetElement( row, 2 );
+    }
+    double secondaryOutputAxis[ 3 ];
+    const double primaryComponent = vtkMath::Dot( secondaryAxis, primaryOutputAxis );
+    for ( int row = 0; row < 3; row++ )
+    {
+      secondaryOutputAxis[ row ] = secondaryAxis[ row ] - primaryComponent * primaryOutputAxis[ row ];
+    }
+    vtkMath::Normalize( secondaryOutputAxis );
+    double tertiaryOutputAxis[ 3 ];
+    vtkMath::Cross( primaryOutputAxis, secondaryOutputAxis, tertiaryOutputAxis );
+
+    // expected = [ primaryOutput secondaryOutput tertiaryOutput ] * [ primary secondary tertiary ]^T
+    expectedMatrix->Identity();
+    for ( int row = 0; row < 3; row++ )
+    {
+      for ( int column = 0; column < 3; column++ )
+      {
+        expectedMatrix->SetElement( row, column, primaryOutputAxis[ row ] * primaryAxis[ column ]
+          + secondaryOutputAxis[ row ] * secondaryAxis[ column ] + tertiaryOutputAxis[ row ] * tertiaryAxis[ column ] );
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Translation of the input with the Y component not copied
+  void GetExpectedTranslationXZ( vtkMatrix4x4* inputMatrix, vtkMatrix4x4* expectedMatrix )
+  {
+    expectedMatrix->Identity();
+    expectedMatrix->SetElement( 0, 3, inputMatrix->GetElement( 0, 3 ) );
+    expectedMatrix->SetElement( 2, 3, inputMatrix->GetElement( 2, 3 ) );
+  }
+
+  //----------------------------------------------------------------------------
+  void GetExpectedCopy( vtkMatrix4x4* inputMatrix, vtkMatrix4x4* expectedMatrix )
+  {
+    expectedMatrix->DeepCopy( inputMatrix );
+  }
+
+  //----------------------------------------------------------------------------
+  void GetExpectedInverse( vtkMatrix4x4* inputMatrix, vtkMatrix4x4* expectedMatrix )
+  {
+    vtkNew<vtkTransform> transform;
+    transform->SetMatrix( inputMatrix );
+    transform->Inverse();
+    transform->GetMatrix( expectedMatrix );
+  }
+
+  //----------------------------------------------------------------------------
+  // Compare each output item of the sequence with the expected output for the input item
+  bool CheckProcessedSequence( const char* name, vtkSlicerTransformProcessorLogic* logic, vtkMRMLTransformProcessorNode* paramNode,
+    ExpectedOutputFunction getExpectedOutput, vtkMRMLSequenceNode* inputSequenceNode, vtkMRMLSequenceNode* outputSequenceNode )
+  {
+    if ( !logic->ProcessTransformSequence( paramNode, inputSequenceNode, outputSequenceNode ) )
+    {
+      std::cerr << name << ": sequence processing failed" << std::endl;
+      return false;
+    }
+    if ( outputSequenceNode->GetNumberOfDataNodes() != inputSequenceNode->GetNumberOfDataNodes() )
+    {
+      std::cerr << name << ": output sequence has " << outputSequenceNode->GetNumberOfDataNodes() << " items, expected "
+        << inputSequenceNode->GetNumberOfDataNodes() << std::endl;
+      return false;
+    }
+    vtkNew<vtkMatrix4x4> inputMatrix;
+    vtkNew<vtkMatrix4x4> expectedMatrix;
+    vtkNew<vtkMatrix4x4> outputMatrix;
+    for ( int itemIndex = 0; itemIndex < inputSequenceNode->GetNumberOfDataNodes(); itemIndex++ )
+    {
+      if ( outputSequenceNode->GetNthIndexValue( itemIndex ) != inputSequenceNode->GetNthIndexValue( itemIndex ) )
+      {
+        std::cerr << name << ": index value of output item " << itemIndex << " is " << outputSequenceNode->GetNthIndexValue( itemIndex )
+          << ", expected " << inputSequenceNode->GetNthIndexValue( itemIndex ) << std::endl;
+        return false;
+      }
+      vtkMRMLTransformNode::SafeDownCast( inputSequenceNode->GetNthDataNode( itemIndex ) )->GetMatrixTransformToParent( inputMatrix );
+      getExpectedOutput( inputMatrix, expectedMatrix );
+      vtkMRMLTransformNode* outputItemNode = vtkMRMLTransformNode::SafeDownCast( outputSequenceNode->GetNthDataNode( itemIndex ) );
+      if ( outputItemNode == nullptr )
+      {
+        std::cerr << name << ": output item " << itemIndex << " is not a transform" << std::endl;
+        return false;
+      }
+      outputItemNode->GetMatrixTransformToParent( outputMatrix );
+      double difference = GetMatrixDifference( expectedMatrix, outputMatrix );
+      if ( difference > MAXIMUM_MATRIX_DIFFERENCE )
+      {
+        std::cerr << name << ": output item " << itemIndex << " differs from the expected output by " << difference << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  bool TestProcessTransformSequence( vtkMRMLScene* scene, vtkSlicerTransformProcessorLogic* logic )
+  {
+    std::cout << "=================================================================" << std::endl;
+    std::cout << "Starting transform sequence processing test..." << std::endl;
+
+    const int numberOfItems = 6;
+    const double itemIntervalSec = 0.1;
+    vtkNew<vtkMRMLSequenceNode> inputSequenceNode;
+    for ( int itemIndex = 0; itemIndex < numberOfItems; itemIndex++ )
+    {
+      vtkNew<vtkTransform> transform;
+      transform->Translate( 10.0 * itemIndex, -5.0 + itemIndex, 3.0 );
+      transform->RotateWXYZ( 20.0 * itemIndex, 1.0, 2.0, 3.0 );
+      vtkNew<vtkMRMLLinearTransformNode> itemNode;
+      itemNode->SetMatrixTransformToParent( transform->GetMatrix() );
+      inputSequenceNode->SetDataNodeAtValue( itemNode, std::to_string( itemIndex * itemIntervalSec ) );
+    }
+    vtkNew<vtkMRMLSequenceNode> outputSequenceNode;
+
+    vtkMRMLLinearTransformNode* inputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "SequenceInput" ) );
+    vtkMRMLLinearTransformNode* outputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "SequenceOutput" ) );
+    vtkMRMLTransformProcessorNode* paramNode = vtkMRMLTransformProcessorNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLTransformProcessorNode" ) );
+    paramNode->SetAndObserveInputFromTransformNode( inputNode );
+    paramNode->SetAndObserveInputForwardTransformNode( inputNode );
+    paramNode->SetAndObserveInputUnstabilizedTransformNode( inputNode );
+    paramNode->SetAndObserveOutputTransformNode( outputNode );
+
+    bool success = true;
+    paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_ROTATION );
+    paramNode->SetRotationMode( vtkMRMLTransformProcessorNode::ROTATION_MODE_COPY_SINGLE_AXIS );
+    paramNode->SetDependentAxesMode( vtkMRMLTransformProcessorNode::DEPENDENT_AXES_MODE_FROM_SECONDARY_AXIS );
+    paramNode->SetPrimaryAxisLabel( vtkMRMLTransformProcessorNode::AXIS_LABEL_Z );
+    paramNode->SetSecondaryAxisLabel( vtkMRMLTransformProcessorNode::AXIS_LABEL_Y );
+    success &= CheckProcessedSequence( "Rotation", logic, paramNode, GetExpectedSingleAxisRotation, inputSequenceNode, outputSequenceNode );
+    paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_TRANSLATION );
+    paramNode->SetCopyTranslationY( false );
+    success &= CheckProcessedSequence( "Translation", logic, paramNode, GetExpectedTranslationXZ, inputSequenceNode, outputSequenceNode );
+    paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_FULL_TRANSFORM );
+    success &= CheckProcessedSequence( "Full transform", logic, paramNode, GetExpectedCopy, inputSequenceNode, outputSequenceNode );
+    paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_INVERSE );
+    success &= CheckProcessedSequence( "Inverse", logic, paramNode, GetExpectedInverse, inputSequenceNode, outputSequenceNode );
+    paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_STABILIZE );
+    paramNode->SetStabilizationEnabled( false );
+    success &= CheckProcessedSequence( "Stabilize (disabled)", logic, paramNode, GetExpectedCopy, inputSequenceNode, outputSequenceNode );
+
+    // Stabilized output follows the input with a first order low-pass filter that uses the index values as timestamps
+    paramNode->SetStabilizationEnabled( true );
+    if ( success && !logic->ProcessTransformSequence( paramNode, inputSequenceNode, outputSequenceNode ) )
+    {
+      std::cerr << "Stabilize: sequence processing failed" << std::endl;
+      success = false;
+    }
+    const double inputWeight = itemIntervalSec * paramNode->GetStabilizationCutOffFrequency();
+    const double normalizedInputWeight = inputWeight / ( 1.0 + inputWeight );
+    double expectedTranslationX = 0.0;
+    vtkNew<vtkMatrix4x4> outputMatrix;
+    for ( int itemIndex = 0; success && itemIndex < numberOfItems; itemIndex++ )
+    {
+      expectedTranslationX += ( itemIndex == 0 ? 0.0 : ( 10.0 * itemIndex - expectedTranslationX ) * normalizedInputWeight );
+      vtkMRMLTransformNode::SafeDownCast( outputSequenceNode->GetNthDataNode( itemIndex ) )->GetMatrixTransformToParent( outputMatrix );
+      if ( std::abs( outputMatrix->GetElement( 0, 3 ) - expectedTranslationX ) > MAXIMUM_MATRIX_DIFFERENCE )
+      {
+        std::cerr << "Stabilize: translation of output item " << itemIndex << " is " << outputMatrix->GetElement( 0, 3 )
+          << ", expected " << expectedTranslationX << std::endl;
+        success = false;
+      }
+    }
+
+    // Invalid or decreasing timestamps are reported and no output is generated
+    vtkNew<vtkMRMLSequenceNode> invalidSequenceNode;
+    invalidSequenceNode->SetIndexType( vtkMRMLSequenceNode::TextIndex );
+    invalidSequenceNode->SetDataNodeAtValue( inputNode, "first" );
+    invalidSequenceNode->SetDataNodeAtValue( inputNode, "second" );
+    TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+    if ( logic->ProcessTransformSequence( paramNode, invalidSequenceNode, outputSequenceNode ) )
+    {
+      std::cerr << "Stabilize: sequence with text index values is accepted" << std::endl;
+      success = false;
+    }
+    TESTING_OUTPUT_ASSERT_ERRORS_END();
+    invalidSequenceNode->RemoveAllDataNodes();
+    invalidSequenceNode->SetIndexType( vtkMRMLSequenceNode::NumericIndex );
+    invalidSequenceNode->SetDataNodeAtValue( inputNode, "0.5" );
+    invalidSequenceNode->SetDataNodeAtValue( inputNode, "invalid" );
+    TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+    if ( logic->ProcessTransformSequence( paramNode, invalidSequenceNode, outputSequenceNode ) )
+    {
+      std::cerr << "Stabilize: sequence with invalid timestamp is accepted" << std::endl;
+      success = false;
+    }
+    TESTING_OUTPUT_ASSERT_ERRORS_END();
+
+    scene->RemoveNode( paramNode );
+    if ( !success )
+    {
+      return false;
+    }
+
+    std::cout << "Transform sequence processing test completed successfully." << std::endl;
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTransformProcessorTest( int vtkNotUsed( argc ), char* vtkNotUsed( argv )[] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerTransformProcessorLogic> logic;
+  logic->SetMRMLScene( scene );
+
+  if ( !TestContinuousUpdateScheduling() )
+  {
+    return EXIT_FAILURE;
+  }
+  if ( !TestProcessorNodeGraphReparent( scene, logic, false ) )
+  {
+    return EXIT_FAILURE;
+  }
+  if ( !TestProcessorNodeGraphReparent( scene, logic, true ) )
+  {
+    return EXIT_FAILURE;
+  }
+  if ( !TestTimeSynchronizedAverage( scene, logic ) )
+  {
+    return EXIT_FAILURE;
+  }
+  if ( !TestTimeSynchronizationHighRate( scene, logic ) )
+  {
+    return EXIT_FAILURE;
+  }
+  if ( !TestProcessTransformSequence( scene, logic ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
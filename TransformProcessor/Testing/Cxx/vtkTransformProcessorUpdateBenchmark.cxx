@@ -0,0 +1,275 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Microbenchmark of transform processor updates.
+// Reports updates/s for each processing mode, computed by the logic (matrix kernels with
+// pre-allocated matrices) and by the vtkGeneralTransform based methods (allocating new
+// transform objects at each update, as the processing modes did previously).
+// Fails if the two computations give different results.
+
+// TransformProcessor includes
+#include <vtkMRMLTransformProcessorNode.h>
+#include <vtkSlicerTransformProcessorLogic.h>
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkGeneralTransform.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+  const int NUMBER_OF_UPDATES = 20000;
+  const double MAXIMUM_MATRIX_DIFFERENCE = 1.0e-6;
+
+  //----------------------------------------------------------------------------
+  void SetInputPose( vtkMRMLTransformNode* transformNode, int updateIndex )
+  {
+    vtkNew<vtkTransform> transform;
+    transform->Translate( 10.0 + 0.01 * updateIndex, -20.0, 30.0 );
+    transform->RotateX( 0.7 * updateIndex );
+    transform->RotateY( 1.3 * updateIndex );
+    transform->RotateZ( 37.0 );
+    transformNode->SetMatrixTransformToParent( transform->GetMatrix() );
+  }
+
+  //----------------------------------------------------------------------------
+  double GetMatrixDifference( vtkMatrix4x4* matrixA, vtkMatrix4x4* matrixB )
+  {
+    double maximumDifference = 0.0;
+    for ( int row = 0; row < 4; row++ )
+    {
+      for ( int column = 0; column < 4; column++ )
+      {
+        maximumDifference = std::max( maximumDifference, std::abs( matrixA->GetElement( row, column ) - matrixB->GetElement( row, column ) ) );
+      }
+    }
+    return maximumDifference;
+  }
+
+  //----------------------------------------------------------------------------
+  // Compute the output the way the processing modes did before matrix kernels were introduced
+  void ComputeUsingGeneralTransform( vtkMRMLTransformProcessorNode* paramNode, vtkMatrix4x4* outputMatrix )
+  {
+    vtkSmartPointer<vtkGeneralTransform> fromToToGeneralTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+    vtkMRMLTransformNode::GetTransformBetweenNodes( paramNode->GetInputFromTransformNode(), paramNode->GetInputToTransformNode(), fromToToGeneralTransform );
+    double primaryAxis[ 3 ] = { 0.0, 0.0, 1.0 };
+    double secondaryAxis[ 3 ] = { 0.0, 1.0, 0.0 };
+    bool copyComponents[ 3 ] = { true, true, true };
+    vtkSmartPointer<vtkTransform> resultTransform = vtkSmartPointer<vtkTransform>::New();
+    switch ( paramNode->GetProcessingMode() )
+    {
+      case vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_ROTATION:
+        if ( paramNode->GetRotationMode() == vtkMRMLTransformProcessorNode::ROTATION_MODE_COPY_ALL_AXES )
+        {
+          vtkSlicerTransformProcessorLogic::GetRotationAllAxesFromTransform( fromToToGeneralTransform, resultTransform );
+        }
+        else if ( paramNode->GetDependentAxesMode() == vtkMRMLTransformProcessorNode::DEPENDENT_AXES_MODE_FROM_PIVOT )
+        {
+          vtkSlicerTransformProcessorLogic::GetRotationSingleAxisWithPivotFromTransform( fromToToGeneralTransform, primaryAxis, resultTransform );
+        }
+        else
+        {
+          vtkSlicerTransformProcessorLogic::GetRotationSingleAxisWithSecondaryFromTransform( fromToToGeneralTransform, primaryAxis, secondaryAxis, resultTransform );
+        }
+        break;
+      case vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_TRANSLATION:
+        vtkSlicerTransformProcessorLogic::GetTranslationOnlyFromTransform( fromToToGeneralTransform, copyComponents, resultTransform );
+        break;
+      case vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_FULL_TRANSFORM:
+        {
+        vtkSmartPointer<vtkTransform> rotationOnlyTransform = vtkSmartPointer<vtkTransform>::New();
+        vtkSlicerTransformProcessorLogic::GetRotationAllAxesFromTransform( fromToToGeneralTransform, rotationOnlyTransform );
+        vtkSmartPointer<vtkTransform> translationOnlyTransform = vtkSmartPointer<vtkTransform>::New();
+        vtkSlicerTransformProcessorLogic::GetTranslationOnlyFromTransform( fromToToGeneralTransform, copyComponents, translationOnlyTransform );
+        resultTransform->PreMultiply();
+        resultTransform->Concatenate( translationOnlyTransform );
+        resultTransform->Concatenate( rotationOnlyTransform );
+        }
+        break;
+      case vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_INVERSE:
+        {
+        vtkNew<vtkMatrix4x4> forwardMatrix;
+        paramNode->GetInputForwardTransformNode()->GetMatrixTransformToParent( forwardMatrix );
+        resultTransform->SetMatrix( forwardMatrix );
+        resultTransform->Inverse();
+        }
+        break;
+      case vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_SHAFT_PIVOT:
+        {
+        double shaftDirection[ 3 ] = { 0.0, 0.0, -1.0 };
+        vtkSmartPointer<vtkGeneralTransform> changedToInitialTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+        vtkMRMLTransformNode::GetTransformBetweenNodes( paramNode->GetInputChangedTransformNode(), paramNode->GetInputInitialTransformNode(), changedToInitialTransform );
+        vtkSmartPointer<vtkTransform> adjustedToInitialRotationTransform = vtkSmartPointer<vtkTransform>::New();
+        vtkSlicerTransformProcessorLogic::GetRotationSingleAxisWithPivotFromTransform( changedToInitialTransform, shaftDirection, adjustedToInitialRotationTransform );
+        vtkSmartPointer<vtkGeneralTransform> initialToAnchorTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+        vtkMRMLTransformNode::GetTransformBetweenNodes( paramNode->GetInputInitialTransformNode(), paramNode->GetInputAnchorTransformNode(), initialToAnchorTransform );
+        vtkSmartPointer<vtkTransform> initialToAnchorRotationTransform = vtkSmartPointer<vtkTransform>::New();
+        vtkSlicerTransformProcessorLogic::GetRotationAllAxesFromTransform( initialToAnchorTransform, initialToAnchorRotationTransform );
+        vtkSmartPointer<vtkGeneralTransform> changedToAnchorTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+        vtkMRMLTransformNode::GetTransformBetweenNodes( paramNode->GetInputChangedTransformNode(), paramNode->GetInputAnchorTransformNode(), changedToAnchorTransform );
+        vtkSmartPointer<vtkTransform> changedToAnchorTranslationTransform = vtkSmartPointer<vtkTransform>::New();
+        vtkSlicerTransformProcessorLogic::GetTranslationOnlyFromTransform( changedToAnchorTransform, copyComponents, changedToAnchorTranslationTransform );
+        resultTransform->PreMultiply();
+        resultTransform->Concatenate( changedToAnchorTranslationTransform );
+        resultTransform->Concatenate( initialToAnchorRotationTransform );
+        resultTransform->Concatenate( adjustedToInitialRotationTransform );
+        }
+        break;
+      default:
+        break;
+    }
+    resultTransform->Update();
+    outputMatrix->DeepCopy( resultTransform->GetMatrix() );
+  }
+
+  //----------------------------------------------------------------------------
+  bool RunBenchmark( const char* name, vtkSlicerTransformProcessorLogic* logic, vtkMRMLTransformProcessorNode* paramNode,
+    vtkMRMLTransformNode* changingInputNode, bool compareWithGeneralTransform )
+  {
+    vtkNew<vtkTimerLog> timer;
+    timer->StartTimer();
+    for ( int updateIndex = 0; updateIndex < NUMBER_OF_UPDATES; updateIndex++ )
+    {
+      SetInputPose( changingInputNode, updateIndex );
+      logic->UpdateOutputTransform( paramNode );
+    }
+    timer->StopTimer();
+    const double logicUpdatesPerSec = NUMBER_OF_UPDATES / std::max( timer->GetElapsedTime(), 1.0e-9 );
+
+    std::cout << std::left << std::setw( 40 ) << name << std::right << std::fixed << std::setprecision( 0 )
+      << std::setw( 12 ) << logicUpdatesPerSec << " updates/s";
+
+    if ( !compareWithGeneralTransform )
+    {
+      std::cout << std::endl;
+      return true;
+    }
+
+    vtkNew<vtkMatrix4x4> generalTransformMatrix;
+    timer->StartTimer();
+    for ( int updateIndex = 0; updateIndex < NUMBER_OF_UPDATES; updateIndex++ )
+    {
+      SetInputPose( changingInputNode, updateIndex );
+      ComputeUsingGeneralTransform( paramNode, generalTransformMatrix );
+      paramNode->GetOutputTransformNode()->SetMatrixTransformToParent( generalTransformMatrix );
+    }
+    timer->StopTimer();
+    const double generalTransformUpdatesPerSec = NUMBER_OF_UPDATES / std::max( timer->GetElapsedTime(), 1.0e-9 );
+    std::cout << std::setw( 12 ) << generalTransformUpdatesPerSec << " updates/s (vtkGeneralTransform)" << std::endl;
+
+    // Check that the results are the same for a number of poses
+    vtkNew<vtkMatrix4x4> logicMatrix;
+    for ( int updateIndex = 0; updateIndex < 500; updateIndex++ )
+    {
+      SetInputPose( changingInputNode, updateIndex );
+      logic->UpdateOutputTransform( paramNode );
+      paramNode->GetOutputTransformNode()->GetMatrixTransformToParent( logicMatrix );
+      ComputeUsingGeneralTransform( paramNode, generalTransformMatrix );
+      double difference = GetMatrixDifference( logicMatrix, generalTransformMatrix );
+      if ( difference > MAXIMUM_MATRIX_DIFFERENCE )
+      {
+        std::cerr << name << ": result differs from vtkGeneralTransform based computation by " << difference << " at update " << updateIndex << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkTransformProcessorUpdateBenchmark( int vtkNotUsed( argc ), char* vtkNotUsed( argv )[] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerTransformProcessorLogic> logic;
+  logic->SetMRMLScene( scene );
+
+  vtkMRMLLinearTransformNode* fromNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "From" ) );
+  vtkMRMLLinearTransformNode* toNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "To" ) );
+  vtkMRMLLinearTransformNode* secondInputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "SecondInput" ) );
+  vtkMRMLLinearTransformNode* outputNode = vtkMRMLLinearTransformNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLLinearTransformNode", "Output" ) );
+  vtkMRMLTransformProcessorNode* paramNode = vtkMRMLTransformProcessorNode::SafeDownCast( scene->AddNewNodeByClass( "vtkMRMLTransformProcessorNode" ) );
+  if ( !fromNode || !toNode || !secondInputNode || !outputNode || !paramNode )
+  {
+    std::cerr << "Failed to create nodes" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkTransform> toTransform;
+  toTransform->Translate( -5.0, 3.0, 12.0 );
+  toTransform->RotateWXYZ( 25.0, 1.0, 2.0, 3.0 );
+  toNode->SetMatrixTransformToParent( toTransform->GetMatrix() );
+  SetInputPose( secondInputNode, 17 );
+
+  paramNode->SetUpdateModeToManual();
+  paramNode->SetAndObserveInputFromTransformNode( fromNode );
+  paramNode->SetAndObserveInputToTransformNode( toNode );
+  paramNode->SetAndObserveInputForwardTransformNode( fromNode );
+  paramNode->SetAndObserveInputUnstabilizedTransformNode( fromNode );
+  paramNode->SetAndObserveInputChangedTransformNode( fromNode );
+  paramNode->SetAndObserveInputInitialTransformNode( secondInputNode );
+  paramNode->SetAndObserveInputAnchorTransformNode( toNode );
+  paramNode->AddAndObserveInputCombineTransformNode( fromNode );
+  paramNode->AddAndObserveInputCombineTransformNode( secondInputNode );
+  paramNode->SetAndObserveOutputTransformNode( outputNode );
+  paramNode->SetPrimaryAxisLabel( vtkMRMLTransformProcessorNode::AXIS_LABEL_Z );
+  paramNode->SetSecondaryAxisLabel( vtkMRMLTransformProcessorNode::AXIS_LABEL_Y );
+
+  std::cout << "Number of updates per mode: " << NUMBER_OF_UPDATES << std::endl;
+  bool success = true;
+
+  paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_ROTATION );
+  paramNode->SetRotationMode( vtkMRMLTransformProcessorNode::ROTATION_MODE_COPY_ALL_AXES );
+  success &= RunBenchmark( "Rotation (all axes)", logic, paramNode, fromNode, true );
+  paramNode->SetRotationMode( vtkMRMLTransformProcessorNode::ROTATION_MODE_COPY_SINGLE_AXIS );
+  paramNode->SetDependentAxesMode( vtkMRMLTransformProcessorNode::DEPENDENT_AXES_MODE_FROM_PIVOT );
+  success &= RunBenchmark( "Rotation (single axis, from pivot)", logic, paramNode, fromNode, true );
+  paramNode->SetDependentAxesMode( vtkMRMLTransformProcessorNode::DEPENDENT_AXES_MODE_FROM_SECONDARY_AXIS );
+  success &= RunBenchmark( "Rotation (single axis, from secondary)", logic, paramNode, fromNode, true );
+
+  paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_TRANSLATION );
+  success &= RunBenchmark( "Translation", logic, paramNode, fromNode, true );
+
+  paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_FULL_TRANSFORM );
+  success &= RunBenchmark( "Full transform", logic, paramNode, fromNode, true );
+
+  paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_INVERSE );
+  success &= RunBenchmark( "Inverse", logic, paramNode, fromNode, true );
+
+  paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_COMPUTE_SHAFT_PIVOT );
+  success &= RunBenchmark( "Shaft pivot", logic, paramNode, fromNode, true );
+
+  paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_QUATERNION_AVERAGE );
+  success &= RunBenchmark( "Quaternion average", logic, paramNode, fromNode, false );
+
+  paramNode->SetProcessingMode( vtkMRMLTransformProcessorNode::PROCESSING_MODE_STABILIZE );
+  success &= RunBenchmark( "Stabilize", logic, paramNode, fromNode, false );
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
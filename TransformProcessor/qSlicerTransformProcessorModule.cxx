@@ -30,8 +30,6 @@
 #include "qSlicerTransformProcessorModule.h"
 #include "qSlicerTransformProcessorModuleWidget.h"
 
-static const double UPDATE_OUTPUTS_PERIOD_SEC = 0.033; // about 30 fps update rate
-
 //-----------------------------------------------------------------------------
 #if (QT_VERSION < QT_VERSION_CHECK(5, 0, 0))
 #include <QtPlugin>
@@ -65,14 +63,10 @@ qSlicerTransformProcessorModule::qSlicerTransformProcessorModule(QObject* _paren
   , d_ptr(new qSlicerTransformProcessorModulePrivate)
 {
   Q_D(qSlicerTransformProcessorModule);
+  // The timer is restarted after each update with the time remaining until the next node is due
+  d->UpdateAllOutputsTimer.setSingleShot(true);
+  d->UpdateAllOutputsTimer.setTimerType(Qt::PreciseTimer);
   connect(&d->UpdateAllOutputsTimer, SIGNAL(timeout()), this, SLOT(updateAllOutputs()));
-  vtkMRMLScene* scene = qSlicerCoreApplication::application()->mrmlScene();
-  if (scene)
-  {
-    // Need to listen for any new watchdog nodes being added to start/stop timer
-    this->qvtkConnect(scene, vtkMRMLScene::NodeAddedEvent, this, SLOT(onNodeAddedEvent(vtkObject*, vtkObject*)));
-    this->qvtkConnect(scene, vtkMRMLScene::NodeRemovedEvent, this, SLOT(onNodeRemovedEvent(vtkObject*, vtkObject*)));
-  }
 }
 
 //-----------------------------------------------------------------------------
@@ -123,6 +117,9 @@ QIcon qSlicerTransformProcessorModule::icon()const
 void qSlicerTransformProcessorModule::setup()
 {
   this->Superclass::setup();
+  // The logic tells when the next update is due, the timer is only running while there is anything to update
+  this->qvtkConnect(this->logic(), vtkSlicerTransformProcessorLogic::UpdateScheduleModifiedEvent, this, SLOT(scheduleNextUpdate()));
+  this->scheduleNextUpdate();
 }
 
 //-----------------------------------------------------------------------------
@@ -137,51 +134,22 @@ vtkMRMLAbstractLogic* qSlicerTransformProcessorModule::createLogic()
   return vtkSlicerTransformProcessorLogic::New();
 }
 
-// --------------------------------------------------------------------------
-void qSlicerTransformProcessorModule::onNodeAddedEvent(vtkObject*, vtkObject* node)
-{
-  Q_D(qSlicerTransformProcessorModule);
-
-  vtkMRMLTransformProcessorNode* processorNode = vtkMRMLTransformProcessorNode::SafeDownCast(node);
-  if (processorNode)
-  {
-    // If the timer is not active
-    if (!d->UpdateAllOutputsTimer.isActive())
-    {
-      d->UpdateAllOutputsTimer.start(UPDATE_OUTPUTS_PERIOD_SEC * 1000.0);
-    }
-  }
-}
-
-// --------------------------------------------------------------------------
-void qSlicerTransformProcessorModule::onNodeRemovedEvent(vtkObject*, vtkObject* node)
+//-----------------------------------------------------------------------------
+void qSlicerTransformProcessorModule::updateAllOutputs()
 {
   Q_D(qSlicerTransformProcessorModule);
-
-  vtkMRMLTransformProcessorNode* processorNode = vtkMRMLTransformProcessorNode::SafeDownCast(node);
-  if (processorNode)
+  vtkSlicerTransformProcessorLogic* processorLogic = vtkSlicerTransformProcessorLogic::SafeDownCast(this->Superclass::logic());
+  if (!processorLogic)
   {
-    // If the timer is active
-    if (d->UpdateAllOutputsTimer.isActive())
-    {
-      // Check if there is any other sequence browser node left in the Scene
-      vtkMRMLScene* scene = qSlicerCoreApplication::application()->mrmlScene();
-      if (scene)
-      {
-        std::vector<vtkMRMLNode*> nodes;
-        this->mrmlScene()->GetNodesByClass("vtkMRMLTransformProcessorNode", nodes);
-        if (nodes.size() == 0)
-        {
-          // The last sequence browser was removed
-          d->UpdateAllOutputsTimer.stop();
-        }
-      }
-    }
+    return;
   }
+  processorLogic->UpdateAllOutputs();
+  d->UpdateAllOutputsTimer.stop();
+  this->scheduleNextUpdate();
 }
 
 //-----------------------------------------------------------------------------
-void qSlicerTransformProcessorModule::updateAllOutputs()
+void qSlicerTransformProcessorModule::scheduleNextUpdate()
 {
   Q_D(qSlicerTransformProcessorModule);
   vtkSlicerTransformProcessorLogic* processorLogic = vtkSlicerTransformProcessorLogic::SafeDownCast(this->Superclass::logic());
@@ -189,5 +157,18 @@ void qSlicerTransformProcessorModule::updateAllOutputs()
   {
     return;
   }
-  processorLogic->UpdateAllOutputs();
+  double timeUntilNextUpdateSec = processorLogic->GetTimeUntilNextUpdateSec();
+  if (timeUntilNextUpdateSec < 0.0)
+  {
+    // No continuously updated or dirty nodes, the logic invokes UpdateScheduleModifiedEvent when this changes
+    d->UpdateAllOutputsTimer.stop();
+    return;
+  }
+  int timeUntilNextUpdateMsec = static_cast<int>(timeUntilNextUpdateSec * 1000.0 + 0.5);
+  if (d->UpdateAllOutputsTimer.isActive() && d->UpdateAllOutputsTimer.remainingTime() <= timeUntilNextUpdateMsec)
+  {
+    // already scheduled early enough
+    return;
+  }
+  d->UpdateAllOutputsTimer.start(timeUntilNextUpdateMsec);
 }
@@ -63,9 +63,10 @@ public:
   virtual QStringList categories() const override;
 
 public slots:
-  void onNodeAddedEvent(vtkObject*, vtkObject*);
-  void onNodeRemovedEvent(vtkObject*, vtkObject*);
   void updateAllOutputs();
+  /// Start the update timer so that it times out when the next processor node update is due,
+  /// or stop it if there is nothing to update
+  void scheduleNextUpdate();
 
 protected:
 
@@ -24,7 +24,6 @@
 #include <QDebug>
 #include <QListWidgetItem>
 #include <QMenu>
-#include <QTimer>
 
 // SlicerQt includes
 #include "qSlicerTransformProcessorModuleWidget.h"
@@ -74,9 +73,6 @@ qSlicerTransformProcessorModuleWidget::qSlicerTransformProcessorModuleWidget( QW
   : Superclass( _parent )
   , d_ptr( new qSlicerTransformProcessorModuleWidgetPrivate( *this ) )
 {
-  this->updateTimer = new QTimer();
-  updateTimer->setSingleShot( false );
-  updateTimer->setInterval( 17 ); // default is once every sixtieth of a second, = 17 milliseconds
 }
 
 //-----------------------------------------------------------------------------
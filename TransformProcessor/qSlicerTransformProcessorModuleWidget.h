@@ -85,8 +85,6 @@ protected:
   virtual bool eventFilter(QObject * obj, QEvent *event);
   virtual void setup();
 
-  QTimer* updateTimer;
-
 private:
   Q_DECLARE_PRIVATE( qSlicerTransformProcessorModuleWidget );
   Q_DISABLE_COPY( qSlicerTransformProcessorModuleWidget );